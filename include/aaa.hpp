@@ -23,21 +23,56 @@ The library consists of different modules:
   This module defines elementwise arithmetic operations on vectors.
   It consists of the functions:
   @ref add, @ref subtract, @ref negate, @ref multiply, @ref divide.
+- @ref fused.
+  This module defines operations that combine several elementwise operations
+  in a single pass. It consists of the functions:
+  `axpy`, `axpby`, `lerp`, `weighted_blend`.
 - @ref norms_metrics.
   This module defines norms/lengths and metrics/distances for vectors.
   These functions take one or two vectors and returns a single scalar.
   It consists of the functions:
   `dot`, `norm`, `distance`, `squared_norm`, `squared_distance`.
   They are defined for the following vector spaces:
-  @ref euclidean_space, @ref manhattan_space, @ref maximum_space.
+  @ref euclidean_space, @ref manhattan_space, @ref maximum_space,
+  @ref minkowski_space for any power p, and @ref hamming_space for binary
+  codes packed in 64 bit words.
+  The spaces also compare the rows of matrices, see @ref pairwise:
+  `distances`, `pairwise_distances`, `pdist`, and find the nearest rows,
+  see @ref neighbors: `nearest_neighbors`. The spatial indexes of
+  @ref spatial_index find the nearest points in low dimensions:
+  `spatial::kd_tree`, `spatial::vp_tree`. The vectors of high dimensions can be
+  compressed to a few bytes by @ref product_quantization:
+  `pq::product_quantizer`, and searched approximately by the hash tables of
+  @ref lsh_index: `lsh::hash_index`. The rows are clustered by @ref kmeans:
+  `kmeans::fit`, `kmeans::fit_minibatch`. The pairs of rows within a radius
+  are found by @ref similarity_join: `join::radius_join`, `join::radius_self_join`.
+- @ref expression.
+  This module defines lazy versions of the functions in @ref vector_space,
+  that fuse chains of elementwise operations into a single loop.
 - @ref misc_algorithms. This contains the functions:
-  `sum`, `convert`.
+  `sum`, `convert`, `quantize`, `dequantize`.
+- @ref statistics. This module computes the count, mean, variance, standard
+  deviation, skewness, minimum and maximum of a range in a single pass:
+  `describe`, `mean`, `variance`, `standard_deviation`. The partial results
+  of chunks or threads are combined by `statistics::merge`.
+- @ref reductions. This module computes several reductions of a range in a
+  single pass: `reduce_many`, with the descriptors `reductions::sum`,
+  `reductions::squared_norm`, `reductions::euclidean_norm`,
+  `reductions::manhattan_norm`, `reductions::maximum_norm`, `reductions::count`.
 - @ref logical.
   This module defines elementwise boolean operations on ranges/containers.
   The elements should be of type `bool`,
   or any other type that supports the the boolean operations &&, ||, !.
   The module contains the functions:
   @ref logical_and, @ref logical_or, @ref logical_not.
+- @ref accuracy.
+  This module defines accuracy policies, that make `sum`, `euclidean::dot` and
+  `euclidean::squared_norm` more accurate: `accuracy::pairwise`,
+  `accuracy::compensated`, `accuracy::dot2`. They are passed as the first argument.
+- @ref parallel.
+  This module defines execution policies, that run the algorithms of the
+  modules above on several threads: `execution::seq`, `execution::par`,
+  `execution::par_unseq`. They are passed as the first argument.
 - @ref std_algorithms_container.
   This module defines container versions of some range
   algorithms from the standard library header
@@ -135,6 +170,8 @@ std::vector<float> project(const std::vector<float>& a, const std::vector<float>
 @defgroup multiply multiply
 @defgroup divide divide
 @defgroup negate negate
+@defgroup fused Fused Operations
+@defgroup expression Lazy Expressions
 @}
 
 @defgroup norms_metrics Normed and Metric Spaces
@@ -142,6 +179,15 @@ std::vector<float> project(const std::vector<float>& a, const std::vector<float>
 @defgroup euclidean_space Euclidean Space (L-2)
 @defgroup manhattan_space Manhattan Space (L-1)
 @defgroup maximum_space Maximum Space (L-Infinity)
+@defgroup minkowski_space Minkowski Space (L-p)
+@defgroup hamming_space Hamming Space
+@defgroup pairwise Pairwise Distances
+@defgroup neighbors Nearest Neighbors
+@defgroup spatial_index Spatial Indexes
+@defgroup product_quantization Product Quantization
+@defgroup lsh_index Locality-Sensitive Hashing
+@defgroup kmeans K-Means Clustering
+@defgroup similarity_join Similarity Join
 @}
 
 @defgroup logical Logical Operations
@@ -153,8 +199,24 @@ std::vector<float> project(const std::vector<float>& a, const std::vector<float>
 
 @defgroup misc_algorithms Misc Operations
 
+@defgroup statistics Descriptive Statistics
+
+@defgroup reductions Fused Reductions
+
 @defgroup std_algorithms_container STD Algorithms on Containers
 
+@defgroup accuracy Accuracy Policies
+
+@defgroup parallel Execution Policies
+@{
+@defgroup thread_pool Thread Pool
+@}
+
+@defgroup simd SIMD Kernels
+@{
+@defgroup dispatch Runtime Dispatch
+@}
+
 */
 
 
@@ -164,21 +226,39 @@ std::vector<float> project(const std::vector<float>& a, const std::vector<float>
 
 #include "std_algorithms_container.hpp"
 
+#include "accuracy.hpp"
+#include "parallel.hpp"
+
 #include "max_element.hpp"
 #include "min_element.hpp"
 #include "mid_element.hpp"
 
 #include "misc_algorithms.hpp"
+#include "statistics.hpp"
+#include "reductions.hpp"
+
+#include "simd.hpp"
 
 #include "add.hpp"
 #include "subtract.hpp"
 #include "multiply.hpp"
 #include "divide.hpp"
 #include "negate.hpp"
+#include "fused.hpp"
+#include "expression.hpp"
 
 #include "euclidean_space.hpp"
 #include "manhattan_space.hpp"
 #include "maximum_space.hpp"
+#include "minkowski_space.hpp"
+#include "hamming_space.hpp"
+#include "pairwise.hpp"
+#include "neighbors.hpp"
+#include "spatial_index.hpp"
+#include "kmeans.hpp"
+#include "similarity_join.hpp"
+#include "product_quantization.hpp"
+#include "lsh_index.hpp"
 
 #include "logical_and.hpp"
 #include "logical_or.hpp"
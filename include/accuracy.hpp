@@ -0,0 +1,63 @@
+#pragma once
+
+namespace aaa {
+namespace accuracy {
+
+/**
+@addtogroup accuracy
+
+The functions `sum`, `euclidean::dot` and `euclidean::squared_norm` have
+overloads that take an accuracy policy as their first argument.
+The policies trade a little speed for a smaller rounding error,
+without converting the elements to a wider type:
+- `aaa::accuracy::pairwise` splits the range in halves recursively,
+  down to blocks of `simd::pairwise_block_size` elements that are summed directly.
+  The error grows with the logarithm of the size, instead of the size.
+- `aaa::accuracy::compensated` is the summation of Kahan, Babuška and Neumaier.
+  The rounding error of each addition is computed exactly and accumulated
+  separately. The error does not grow with the size.
+- `aaa::accuracy::dot2` is the dot product of Ogita, Rump and Oishi.
+  It also accumulates the rounding error of each multiplication, with a fused
+  multiply-add when the CPU has it. The result is as accurate as if it was
+  computed with twice the precision, and then rounded.
+  For `sum` it is the same as `compensated`.
+
+For contiguous ranges of `float` and `double` the policies use SIMD kernels,
+see @ref simd. The policies are only meaningful for floating point numbers,
+integers give the exact result with all of them.
+
+Example:
+```
+std::vector<float> in(100000000, 0.1f);
+
+using namespace aaa;
+
+auto s1 = sum(in);                       // 2097152
+auto s2 = sum(accuracy::pairwise, in);    // 1e+07
+auto s3 = sum(accuracy::compensated, in); // 1e+07
+auto d = euclidean::dot(accuracy::dot2, in, in);
+```
+
+@{
+*/
+
+struct pairwise_summation {};
+struct compensated_summation {};
+struct dot2_summation {};
+
+/** An accuracy policy. The tag is one of `pairwise_summation`, `compensated_summation`, `dot2_summation`. */
+template<typename Tag>
+struct policy {};
+
+using pairwise_policy = policy<pairwise_summation>;
+using compensated_policy = policy<compensated_summation>;
+using dot2_policy = policy<dot2_summation>;
+
+constexpr pairwise_policy pairwise{};
+constexpr compensated_policy compensated{};
+constexpr dot2_policy dot2{};
+
+/** @} */
+
+} // namespace accuracy
+} // namespace aaa
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+
+#if !defined(AAA_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#define AAA_SIMD 1
+#include <cpuid.h>
+#endif
+
+namespace aaa {
+namespace simd {
+
+/**
+@addtogroup dispatch
+
+The SIMD kernels are compiled for several instruction sets in the same binary.
+The CPU is probed once with `cpuid`, and each kernel is then looked up in a
+table of function pointers, with one entry per instruction set.
+The entry of the best instruction set supported by the CPU is used.
+
+The instruction set can be lowered by setting the environment variable
+`AAA_SIMD_LEVEL` to one of `scalar`, `sse4.2`, `avx2` or `avx512`,
+before the first call to the library. This is useful for benchmarking the
+different kernels on the same machine. A level that is not supported by the
+CPU is ignored.
+
+@{
+*/
+
+enum class simd_level
+{
+    scalar = 0,
+    sse42 = 1,
+    avx2 = 2,
+    avx512 = 3,
+};
+
+constexpr auto num_simd_levels = 4;
+
+inline const char* simd_level_name(simd_level level)
+{
+    switch (level)
+    {
+    case simd_level::sse42: return "sse4.2";
+    case simd_level::avx2: return "avx2";
+    case simd_level::avx512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+/** Returns the best instruction set supported by both the CPU and the operating system. */
+inline simd_level detect_simd_level()
+{
+#if AAA_SIMD
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return simd_level::scalar;
+    }
+    // The kernels of all the instruction sets use popcnt, that came with SSE4.2.
+    const auto has_sse42 = (ecx & bit_SSE4_2) != 0 && (ecx & bit_POPCNT) != 0;
+    const auto has_fma = (ecx & bit_FMA) != 0;
+    const auto has_avx = (ecx & bit_AVX) != 0;
+    const auto has_osxsave = (ecx & bit_OSXSAVE) != 0;
+
+    // The operating system needs to save the wide registers on context switches.
+    auto xcr0 = 0u;
+    if (has_osxsave)
+    {
+        auto xcr0_high = 0u;
+        __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0_high) : "c"(0));
+    }
+    const auto os_avx = (xcr0 & 0x06) == 0x06;
+    const auto os_avx512 = (xcr0 & 0xe6) == 0xe6;
+
+    auto has_avx2 = false;
+    auto has_avx512 = false;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    {
+        has_avx2 = (ebx & bit_AVX2) != 0;
+        has_avx512 = (ebx & bit_AVX512F) != 0 && (ebx & bit_AVX512BW) != 0;
+    }
+
+    if (has_avx512 && has_avx2 && has_fma && has_avx && has_sse42 && os_avx512)
+    {
+        return simd_level::avx512;
+    }
+    if (has_avx2 && has_fma && has_avx && has_sse42 && os_avx)
+    {
+        return simd_level::avx2;
+    }
+    if (has_sse42)
+    {
+        return simd_level::sse42;
+    }
+#endif
+    return simd_level::scalar;
+}
+
+/** Returns the instruction set used by the kernels.
+It is the detected instruction set, lowered by the environment variable `AAA_SIMD_LEVEL`.
+*/
+inline simd_level active_simd_level()
+{
+    static const auto level = []
+    {
+        const auto detected = detect_simd_level();
+        const auto forced = std::getenv("AAA_SIMD_LEVEL");
+        if (forced == nullptr)
+        {
+            return detected;
+        }
+        for (auto i = 0; i < num_simd_levels; ++i)
+        {
+            const auto level = static_cast<simd_level>(i);
+            if (std::strcmp(forced, simd_level_name(level)) == 0)
+            {
+                return level < detected ? level : detected;
+            }
+        }
+        return detected;
+    }();
+    return level;
+}
+
+/** A table of function pointers, with one kernel per `simd_level`.
+An entry is `nullptr` if there is no kernel for that instruction set.
+*/
+template<typename Function>
+using kernel_table = std::array<Function, num_simd_levels>;
+
+/** Returns the kernel of the best instruction set that is not above the active one,
+or `nullptr` if there is none.
+*/
+template<typename Function>
+Function select_kernel(const kernel_table<Function>& table)
+{
+    for (auto i = static_cast<int>(active_simd_level()); i >= 0; --i)
+    {
+        if (table[i] != nullptr)
+        {
+            return table[i];
+        }
+    }
+    return nullptr;
+}
+
+/** @} */
+
+} // namespace simd
+} // namespace aaa
@@ -1,7 +1,20 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iterator>
 #include <numeric>
+#include <type_traits>
 
+#include "accuracy.hpp"
+#include "neighbors.hpp"
+#include "operations.hpp"
+#include "pairwise.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
 #include "traits.hpp"
 
 namespace aaa {
@@ -23,24 +36,39 @@ We represent mathematical vectors as either containers, or ranges of iterators.
 The functions in this module take one or two vectors as input and output a
 single scalar. This is sometimes refered to as a reduction or fold operation.
 
+The functions `distances` and `squared_distances` compare a query to each row of
+a matrix, stored row by row in a single range, and output one scalar per row.
+For contiguous floating point ranges they process several rows at a time, see @ref simd.
+
+The function `cosine_similarity` computes `a.b / (|a| |b|)` with the three sums
+in a single pass. For ranking many rows against a query, `row_norms` computes the
+norms of the rows once, and `cosine_similarities` only computes the dot products.
+`normalize` and `normalize_rows` divide vectors by their norms in place.
+
+The sums are computed in the type of `init`, which is by default the
+`accumulator_type_t` of the elements: the 8 bit integers, like the vectors
+that are quantized by `quantize`, are summed in `int32_t`, and the 16 bit integers
+in `int64_t`, so that the terms do not overflow. Then `dot` and `squared_distance`
+use SIMD kernels that accumulate in these types.
+
 @{
 */
 
 /** The dot product of two vectors.
 Each vector is represented by a range of iterators.
 */
-template<typename InputIterator1, typename InputIterator2, typename T = value_type_i<InputIterator1>>
+template<typename InputIterator1, typename InputIterator2, typename T = accumulator_type_t<value_type_i<InputIterator1>>>
 T dot(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
 {
-    return std::inner_product(first_left, last_left, first_right, init);
+    return simd::dot(first_left, last_left, first_right, init);
 }
 
 /** The dot product of two vectors.
 Each vector is represented by a container.
 The two containers should have the same size.
 */
-template<typename Container1, typename Container2, typename T = value_type<Container1>>
-T dot(const Container1& a, Container2& b, T init = T{})
+template<typename Container1, typename Container2, typename T = accumulator_type_t<value_type<Container1>>>
+T dot(const Container1& a, const Container2& b, T init = T{})
 {
     assert(a.size() == b.size());
     using std::begin;
@@ -51,7 +79,7 @@ T dot(const Container1& a, Container2& b, T init = T{})
 /** The squared Euclidean norm of a vector.
 The vector is represented by a range of iterators.
 */
-template<typename InputIterator, typename T = value_type_i<InputIterator>>
+template<typename InputIterator, typename T = accumulator_type_t<value_type_i<InputIterator>>>
 T squared_norm(InputIterator first, InputIterator last, T init = T{})
 {
     return dot(first, last, first, init);
@@ -60,7 +88,7 @@ T squared_norm(InputIterator first, InputIterator last, T init = T{})
 /** The squared Euclidean norm of a vector.
 The vector is represented by a container.
 */
-template<typename Container, typename T = value_type<Container>>
+template<typename Container, typename T = accumulator_type_t<value_type<Container>>>
 T squared_norm(const Container& a, T init = T{})
 {
     using std::begin;
@@ -72,7 +100,7 @@ T squared_norm(const Container& a, T init = T{})
 The vector is represented by a range of iterators.
 Returns a value of floating point type following the same convention as `std::sqrt`.
 */
-template<typename InputIterator, typename T = value_type_i<InputIterator>>
+template<typename InputIterator, typename T = accumulator_type_t<value_type_i<InputIterator>>>
 sqrt_type_t<T> norm(InputIterator first, InputIterator last, T init = T{})
 {
     return sqrt(squared_norm(first, last, init));
@@ -82,7 +110,7 @@ sqrt_type_t<T> norm(InputIterator first, InputIterator last, T init = T{})
 The vector is represented by a container.
 Returns a value of floating point type following the same convention as `std::sqrt`.
 */
-template<typename Container, typename T = value_type<Container>>
+template<typename Container, typename T = accumulator_type_t<value_type<Container>>>
 sqrt_type_t<T> norm(const Container& a, T init = T{})
 {
     using std::begin;
@@ -90,28 +118,63 @@ sqrt_type_t<T> norm(const Container& a, T init = T{})
     return norm(begin(a), end(a), init);
 }
 
+/** The dot product of two vectors, with an accuracy policy.
+Each vector is represented by a range of iterators.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename T = accumulator_type_t<value_type_i<InputIterator1>>>
+T dot(accuracy::policy<Tag> policy,
+    InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
+{
+    return simd::accurate_sum(policy, first_left, last_left, first_right, init, operations::multiplies{});
+}
+
+/** The dot product of two vectors, with an accuracy policy.
+Each vector is represented by a container.
+The two containers should have the same size.
+*/
+template<typename Tag, typename Container1, typename Container2, typename T = accumulator_type_t<value_type<Container1>>>
+T dot(accuracy::policy<Tag> policy, const Container1& a, const Container2& b, T init = T{})
+{
+    assert(a.size() == b.size());
+    using std::begin;
+    using std::end;
+    return dot(policy, begin(a), end(a), begin(b), init);
+}
+
+/** The squared Euclidean norm of a vector, with an accuracy policy.
+The vector is represented by a range of iterators.
+*/
+template<typename Tag, typename InputIterator, typename T = accumulator_type_t<value_type_i<InputIterator>>>
+T squared_norm(accuracy::policy<Tag> policy, InputIterator first, InputIterator last, T init = T{})
+{
+    return dot(policy, first, last, first, init);
+}
+
+/** The squared Euclidean norm of a vector, with an accuracy policy.
+The vector is represented by a container.
+*/
+template<typename Tag, typename Container, typename T = accumulator_type_t<value_type<Container>>>
+T squared_norm(accuracy::policy<Tag> policy, const Container& a, T init = T{})
+{
+    using std::begin;
+    using std::end;
+    return squared_norm(policy, begin(a), end(a), init);
+}
+
 /** The squared Euclidean distance of two vectors.
 Each vector is represented by a range of iterators.
 */
-template<typename InputIterator1, typename InputIterator2, typename T = value_type_i<InputIterator1>>
+template<typename InputIterator1, typename InputIterator2, typename T = accumulator_type_t<value_type_i<InputIterator1>>>
 T squared_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
 {
-    auto op1 = [](const T left, const T right) -> T
-    {
-        return left + right;
-    };
-    auto op2 = [](const auto left, const auto right) -> T
-    {
-        return (left - right) * (left - right);
-    };
-    return std::inner_product(first_left, last_left, first_right, init, op1, op2);
+    return simd::squared_distance(first_left, last_left, first_right, init);
 }
 
 /** The squared Euclidean distance of two vectors.
 Each vector is represented by a container.
 The two containers should have the same size.
 */
-template<typename Container1, typename Container2, typename T = value_type<Container1>>
+template<typename Container1, typename Container2, typename T = accumulator_type_t<value_type<Container1>>>
 T squared_distance(const Container1& left, const Container2& right, T init = T{})
 {
     assert(left.size() == right.size());
@@ -124,7 +187,7 @@ T squared_distance(const Container1& left, const Container2& right, T init = T{}
 Each vector is represented by a range of iterators.
 Returns a value of a floating point type following the same convention as `std::sqrt`.
 */
-template<typename InputIterator1, typename InputIterator2, typename T = value_type_i<InputIterator1>>
+template<typename InputIterator1, typename InputIterator2, typename T = accumulator_type_t<value_type_i<InputIterator1>>>
 sqrt_type_t<T> distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
 {
     return sqrt(squared_distance(first_left, last_left, first_right, init));
@@ -135,7 +198,7 @@ Each vector is represented by a container.
 The two containers should have the same size.
 Returns a value of a floating point type following the same convention as `std::sqrt`.
 */
-template<typename Container1, typename Container2, typename T = value_type<Container1>>
+template<typename Container1, typename Container2, typename T = accumulator_type_t<value_type<Container1>>>
 sqrt_type_t<T> distance(const Container1& left, const Container2& right, T init = T{})
 {
     assert(left.size() == right.size());
@@ -144,6 +207,727 @@ sqrt_type_t<T> distance(const Container1& left, const Container2& right, T init
     return distance(begin(left), end(left), begin(right), init);
 }
 
+/** The squared Euclidean distance of two vectors, or a value greater than `bound` if the distance is greater.
+Each vector is represented by a range of iterators.
+The partial sum is checked after each block of elements. The function returns as soon as the partial
+distance is greater than `bound`, so that most of the work is skipped for the
+candidates that are rejected by a nearest neighbor search.
+*/
+template<typename InputIterator1, typename InputIterator2, typename T>
+T squared_distance_bounded(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T bound)
+{
+    return simd::bounded_distance<operations::plus, operations::squared_difference>(first_left, last_left, first_right, bound);
+}
+
+/** The squared Euclidean distance of two vectors, or a value greater than `bound` if the distance is greater.
+Each vector is represented by a container.
+The two containers should have the same size.
+*/
+template<typename Container1, typename Container2, typename T>
+T squared_distance_bounded(const Container1& left, const Container2& right, T bound)
+{
+    assert(left.size() == right.size());
+    using std::begin;
+    using std::end;
+    return squared_distance_bounded(begin(left), end(left), begin(right), bound);
+}
+
+/** The squared Euclidean distances of a query to each row of a matrix.
+The matrix is a range of iterators that stores the rows one after the other,
+and each row has the size of the query. The number of rows is the size of the output.
+*/
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void squared_distances(InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out)
+{
+    simd::row_distances<operations::plus, operations::squared_difference>(
+        first_query, last_query, first_matrix, first_out, last_out);
+}
+
+/** The squared Euclidean distances of a query to each row of a matrix.
+The query, the matrix and the output are containers.
+The size of the matrix should be the size of the query times the size of the output.
+*/
+template<typename Container1, typename Container2, typename Container3>
+void squared_distances(const Container1& query, const Container2& matrix, Container3& out)
+{
+    assert(matrix.size() == query.size() * out.size());
+    using std::begin;
+    using std::end;
+    squared_distances(begin(query), end(query), begin(matrix), begin(out), end(out));
+}
+
+/** The Euclidean distances of a query to each row of a matrix.
+The matrix is a range of iterators that stores the rows one after the other,
+and each row has the size of the query. The number of rows is the size of the output.
+The output should have a floating point type.
+*/
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void distances(InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out)
+{
+    squared_distances(first_query, last_query, first_matrix, first_out, last_out);
+    using T = value_type_i<OutputIterator>;
+    std::transform(first_out, last_out, first_out, [](const T d) { return T(std::sqrt(d)); });
+}
+
+/** The Euclidean distances of a query to each row of a matrix.
+The query, the matrix and the output are containers.
+The size of the matrix should be the size of the query times the size of the output.
+*/
+template<typename Container1, typename Container2, typename Container3>
+void distances(const Container1& query, const Container2& matrix, Container3& out)
+{
+    assert(matrix.size() == query.size() * out.size());
+    using std::begin;
+    using std::end;
+    distances(begin(query), end(query), begin(matrix), begin(out), end(out));
+}
+
+/** The cosine of the angle between two vectors, `a.b / (|a| |b|)`.
+Each vector is represented by a range of iterators.
+The dot product and the two squared norms are computed in a single pass.
+Returns 0 if one of the vectors is zero, and a value of floating point type
+following the same convention as `std::sqrt`.
+*/
+template<typename InputIterator1, typename InputIterator2, typename T = accumulator_type_t<value_type_i<InputIterator1>>>
+sqrt_type_t<T> cosine_similarity(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right)
+{
+    using R = sqrt_type_t<T>;
+    const auto sums = simd::cosine_sums<T>(first_left, last_left, first_right);
+    const auto denominator = R(std::sqrt(R(sums[1])) * std::sqrt(R(sums[2])));
+    return denominator == R{} ? R{} : R(R(sums[0]) / denominator);
+}
+
+/** The cosine of the angle between two vectors, `a.b / (|a| |b|)`.
+Each vector is represented by a container.
+The two containers should have the same size.
+*/
+template<typename Container1, typename Container2, typename T = accumulator_type_t<value_type<Container1>>>
+sqrt_type_t<T> cosine_similarity(const Container1& left, const Container2& right)
+{
+    assert(left.size() == right.size());
+    using std::begin;
+    using std::end;
+    return cosine_similarity(begin(left), end(left), begin(right));
+}
+
+/** The cosine distance of two vectors, `1 - cosine_similarity`.
+Each vector is represented by a range of iterators.
+*/
+template<typename InputIterator1, typename InputIterator2, typename T = accumulator_type_t<value_type_i<InputIterator1>>>
+sqrt_type_t<T> cosine_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right)
+{
+    using R = sqrt_type_t<T>;
+    return R(R(1) - cosine_similarity(first_left, last_left, first_right));
+}
+
+/** The cosine distance of two vectors, `1 - cosine_similarity`.
+Each vector is represented by a container.
+The two containers should have the same size.
+*/
+template<typename Container1, typename Container2, typename T = accumulator_type_t<value_type<Container1>>>
+sqrt_type_t<T> cosine_distance(const Container1& left, const Container2& right)
+{
+    assert(left.size() == right.size());
+    using std::begin;
+    using std::end;
+    return cosine_distance(begin(left), end(left), begin(right));
+}
+
+/** The Euclidean norms of the rows of a matrix.
+The matrix is a range of iterators with rows of `dimension` elements, see @ref pairwise.
+The number of rows is the size of the output.
+*/
+template<typename InputIterator, typename OutputIterator>
+void row_norms(InputIterator first, std::size_t dimension, OutputIterator first_out, OutputIterator last_out)
+{
+    using T = value_type_i<OutputIterator>;
+    const auto row_size = static_cast<std::ptrdiff_t>(dimension);
+    for (; first_out != last_out; ++first_out)
+    {
+        const auto last = std::next(first, row_size);
+        *first_out = T(std::sqrt(squared_norm(first, last)));
+        first = last;
+    }
+}
+
+/** The Euclidean norms of the rows of a matrix.
+The matrix is a container with rows of `dimension` elements, see @ref pairwise.
+The size of the output should be the number of rows.
+*/
+template<typename Container1, typename Container2>
+void row_norms(const Container1& matrix, std::size_t dimension, Container2& out)
+{
+    assert(matrix.size() == dimension * out.size());
+    using std::begin;
+    using std::end;
+    row_norms(begin(matrix), dimension, begin(out), end(out));
+}
+
+/** The cosine similarities of a query to each row of a matrix.
+The matrix is a range of iterators that stores the rows one after the other,
+and each row has the size of the query. The number of rows is the size of the output.
+The norms of the rows are given by a range of iterators, for example computed once by `row_norms`.
+The output should have a floating point type.
+*/
+template<typename InputIterator1, typename InputIterator2, typename InputIterator3, typename OutputIterator>
+void cosine_similarities(InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    InputIterator3 first_norm, OutputIterator first_out, OutputIterator last_out)
+{
+    using T = value_type_i<OutputIterator>;
+    simd::row_distances<operations::plus, operations::multiplies>(first_query, last_query, first_matrix, first_out, last_out);
+    const auto query_norm = T(std::sqrt(squared_norm(first_query, last_query)));
+    for (; first_out != last_out; ++first_out, ++first_norm)
+    {
+        const auto denominator = T(query_norm * T(*first_norm));
+        *first_out = denominator == T{} ? T{} : T(*first_out / denominator);
+    }
+}
+
+/** The cosine similarities of a query to each row of a matrix.
+The query, the matrix, the norms of the rows and the output are containers.
+The size of the matrix should be the size of the query times the size of the output.
+*/
+template<typename Container1, typename Container2, typename Container3, typename Container4>
+void cosine_similarities(const Container1& query, const Container2& matrix, const Container3& norms, Container4& out)
+{
+    assert(matrix.size() == query.size() * out.size());
+    assert(norms.size() == out.size());
+    using std::begin;
+    using std::end;
+    cosine_similarities(begin(query), end(query), begin(matrix), begin(norms), begin(out), end(out));
+}
+
+/** Divides a vector by its Euclidean norm, and returns the norm.
+The vector is represented by a range of iterators, and should have a floating point type.
+The norm is computed in a first pass and the elements are scaled in a second pass.
+A zero vector is left unchanged.
+*/
+template<typename ForwardIterator, typename T = value_type_i<ForwardIterator>>
+T normalize(ForwardIterator first, ForwardIterator last)
+{
+    static_assert(std::is_floating_point<T>::value, "The elements should have a floating point type");
+    const auto n = T(std::sqrt(squared_norm(first, last)));
+    if (n != T{})
+    {
+        simd::transform_vector_scalar(first, last, T(T(1) / n), first, operations::multiplies{});
+    }
+    return n;
+}
+
+/** Divides a vector by its Euclidean norm, and returns the norm.
+The vector is represented by a container, and should have a floating point type.
+*/
+template<typename Container, typename T = value_type<Container>>
+T normalize(Container& a)
+{
+    using std::begin;
+    using std::end;
+    return normalize(begin(a), end(a));
+}
+
+/** Divides each row of a matrix by its Euclidean norm, with an execution policy.
+The matrix is a range of iterators with rows of `dimension` elements, see @ref pairwise.
+Each row is scaled right after its norm is computed, while it is still in the cache.
+The norms are written to the output, whose size is the number of rows.
+*/
+template<typename Tag, typename ForwardIterator, typename OutputIterator>
+void normalize_rows(execution::policy<Tag> policy, ForwardIterator first, std::size_t dimension,
+    OutputIterator first_norm, OutputIterator last_norm)
+{
+    const auto num_rows = static_cast<std::size_t>(std::distance(first_norm, last_norm));
+    const auto num_blocks = (num_rows + pairwise::tile_rows - 1) / pairwise::tile_rows;
+    pairwise::for_each_tile(policy, num_blocks, [&](std::ptrdiff_t block)
+    {
+        const auto first_row = static_cast<std::size_t>(block) * pairwise::tile_rows;
+        const auto last_row = std::min(num_rows, first_row + pairwise::tile_rows);
+        for (auto r = first_row; r < last_row; ++r)
+        {
+            const auto row = std::next(first, static_cast<std::ptrdiff_t>(r * dimension));
+            *std::next(first_norm, static_cast<std::ptrdiff_t>(r)) = normalize(row, std::next(row, static_cast<std::ptrdiff_t>(dimension)));
+        }
+    });
+}
+
+/** Divides each row of a matrix by its Euclidean norm, with an execution policy.
+The matrix is a container with rows of `dimension` elements, see @ref pairwise.
+The size of the norms should be the number of rows.
+*/
+template<typename Tag, typename Container1, typename Container2>
+void normalize_rows(execution::policy<Tag> policy, Container1& matrix, std::size_t dimension, Container2& norms)
+{
+    assert(matrix.size() == dimension * norms.size());
+    using std::begin;
+    using std::end;
+    normalize_rows(policy, begin(matrix), dimension, begin(norms), end(norms));
+}
+
+/** Divides each row of a matrix by its Euclidean norm.
+The matrix is a range of iterators with rows of `dimension` elements, see @ref pairwise.
+The norms are written to the output, whose size is the number of rows.
+*/
+template<typename ForwardIterator, typename OutputIterator>
+void normalize_rows(ForwardIterator first, std::size_t dimension, OutputIterator first_norm, OutputIterator last_norm)
+{
+    normalize_rows(execution::seq, first, dimension, first_norm, last_norm);
+}
+
+/** Divides each row of a matrix by its Euclidean norm.
+The matrix is a container with rows of `dimension` elements, see @ref pairwise.
+The size of the norms should be the number of rows.
+*/
+template<typename Container1, typename Container2>
+void normalize_rows(Container1& matrix, std::size_t dimension, Container2& norms)
+{
+    normalize_rows(execution::seq, matrix, dimension, norms);
+}
+
+
+/** The dot product of two vectors, with an execution policy.
+Each vector is represented by a range of iterators.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename T = accumulator_type_t<value_type_i<InputIterator1>>>
+T dot(execution::policy<Tag> policy,
+    InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
+{
+    const auto f = [&](std::ptrdiff_t first, std::ptrdiff_t last, T init_chunk)
+    {
+        return dot(first_left + first, first_left + last, first_right + first, init_chunk);
+    };
+    return execution::parallel_reduce(policy, std::distance(first_left, last_left), init, T{}, f, std::plus<T>{});
+}
+
+/** The dot product of two vectors, with a reproducible execution policy.
+Each vector is represented by a range of iterators.
+The result is the same for any number of threads and instruction set.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename T = accumulator_type_t<value_type_i<InputIterator1>>>
+T dot(execution::policy<execution::reproducible<Tag>> policy,
+    InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
+{
+    return execution::reproducible_sum(policy, first_left, last_left, first_right, init, operations::multiplies{});
+}
+
+/** The dot product of two vectors, with an execution policy.
+Each vector is represented by a container.
+The two containers should have the same size.
+*/
+template<typename Tag, typename Container1, typename Container2, typename T = accumulator_type_t<value_type<Container1>>>
+T dot(execution::policy<Tag> policy, const Container1& a, const Container2& b, T init = T{})
+{
+    assert(a.size() == b.size());
+    using std::begin;
+    using std::end;
+    return dot(policy, begin(a), end(a), begin(b), init);
+}
+
+/** The squared Euclidean norm of a vector, with an execution policy.
+The vector is represented by a range of iterators.
+*/
+template<typename Tag, typename InputIterator, typename T = accumulator_type_t<value_type_i<InputIterator>>>
+T squared_norm(execution::policy<Tag> policy, InputIterator first, InputIterator last, T init = T{})
+{
+    return dot(policy, first, last, first, init);
+}
+
+/** The squared Euclidean norm of a vector, with an execution policy.
+The vector is represented by a container.
+*/
+template<typename Tag, typename Container, typename T = accumulator_type_t<value_type<Container>>>
+T squared_norm(execution::policy<Tag> policy, const Container& a, T init = T{})
+{
+    using std::begin;
+    using std::end;
+    return squared_norm(policy, begin(a), end(a), init);
+}
+
+/** The Euclidean norm of a vector, with an execution policy.
+The vector is represented by a range of iterators.
+*/
+template<typename Tag, typename InputIterator, typename T = accumulator_type_t<value_type_i<InputIterator>>>
+sqrt_type_t<T> norm(execution::policy<Tag> policy, InputIterator first, InputIterator last, T init = T{})
+{
+    return sqrt(squared_norm(policy, first, last, init));
+}
+
+/** The Euclidean norm of a vector, with an execution policy.
+The vector is represented by a container.
+*/
+template<typename Tag, typename Container, typename T = accumulator_type_t<value_type<Container>>>
+sqrt_type_t<T> norm(execution::policy<Tag> policy, const Container& a, T init = T{})
+{
+    using std::begin;
+    using std::end;
+    return norm(policy, begin(a), end(a), init);
+}
+
+/** The squared Euclidean distance of two vectors, with an execution policy.
+Each vector is represented by a range of iterators.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename T = accumulator_type_t<value_type_i<InputIterator1>>>
+T squared_distance(execution::policy<Tag> policy,
+    InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
+{
+    const auto f = [&](std::ptrdiff_t first, std::ptrdiff_t last, T init_chunk)
+    {
+        return squared_distance(first_left + first, first_left + last, first_right + first, init_chunk);
+    };
+    return execution::parallel_reduce(policy, std::distance(first_left, last_left), init, T{}, f, std::plus<T>{});
+}
+
+/** The squared Euclidean distance of two vectors, with a reproducible execution policy.
+Each vector is represented by a range of iterators.
+The result is the same for any number of threads and instruction set.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename T = accumulator_type_t<value_type_i<InputIterator1>>>
+T squared_distance(execution::policy<execution::reproducible<Tag>> policy,
+    InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
+{
+    return execution::reproducible_sum(policy, first_left, last_left, first_right, init, operations::squared_difference{});
+}
+
+/** The squared Euclidean distance of two vectors, with an execution policy.
+Each vector is represented by a container.
+The two containers should have the same size.
+*/
+template<typename Tag, typename Container1, typename Container2, typename T = accumulator_type_t<value_type<Container1>>>
+T squared_distance(execution::policy<Tag> policy, const Container1& left, const Container2& right, T init = T{})
+{
+    assert(left.size() == right.size());
+    using std::begin;
+    using std::end;
+    return squared_distance(policy, begin(left), end(left), begin(right), init);
+}
+
+/** The Euclidean distance of two vectors, with an execution policy.
+Each vector is represented by a range of iterators.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename T = accumulator_type_t<value_type_i<InputIterator1>>>
+sqrt_type_t<T> distance(execution::policy<Tag> policy,
+    InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
+{
+    return sqrt(squared_distance(policy, first_left, last_left, first_right, init));
+}
+
+/** The Euclidean distance of two vectors, with an execution policy.
+Each vector is represented by a container.
+The two containers should have the same size.
+*/
+template<typename Tag, typename Container1, typename Container2, typename T = accumulator_type_t<value_type<Container1>>>
+sqrt_type_t<T> distance(execution::policy<Tag> policy, const Container1& left, const Container2& right, T init = T{})
+{
+    assert(left.size() == right.size());
+    using std::begin;
+    using std::end;
+    return distance(policy, begin(left), end(left), begin(right), init);
+}
+
+/** Calls `store(i, j, d)` with the squared Euclidean distance `d` of each pair of rows, see @ref pairwise. */
+template<typename T, typename Tag, typename InputIterator1, typename InputIterator2, typename Store>
+void for_each_squared_distance(execution::policy<Tag> policy, InputIterator1 first_a, std::size_t num_a,
+    InputIterator2 first_b, std::size_t num_b, std::size_t dimension, bool upper, Store store)
+{
+    const auto norms_a = pairwise::squared_norms<T>(first_a, num_a, dimension);
+    const auto norms_b = upper ? norms_a : pairwise::squared_norms<T>(first_b, num_b, dimension);
+    const auto f = [&](std::size_t i, std::size_t j, T dot)
+    {
+        store(i, j, pairwise::squared_distance_from_dot(norms_a[i], norms_b[j], dot));
+    };
+    pairwise::for_each_pair<T, operations::plus, operations::multiplies>(
+        policy, first_a, num_a, first_b, num_b, dimension, upper, f);
+}
+
+/** The Euclidean distances of each row of the matrix `a` to each row of the matrix `b`, with an execution policy.
+The matrices are ranges of iterators with rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `num_a * num_b` elements.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename RandomAccessIterator>
+void pairwise_distances(execution::policy<Tag> policy, InputIterator1 first_a, InputIterator1 last_a,
+    InputIterator2 first_b, InputIterator2 last_b, std::size_t dimension, RandomAccessIterator first_out)
+{
+    assert(dimension > 0);
+    using T = value_type_i<RandomAccessIterator>;
+    const auto num_a = static_cast<std::size_t>(std::distance(first_a, last_a)) / dimension;
+    const auto num_b = static_cast<std::size_t>(std::distance(first_b, last_b)) / dimension;
+    const auto store = [&](std::size_t i, std::size_t j, T d)
+    {
+        first_out[i * num_b + j] = T(std::sqrt(d));
+    };
+    for_each_squared_distance<T>(policy, first_a, num_a, first_b, num_b, dimension, false, store);
+}
+
+/** The Euclidean distances of each row of the matrix `a` to each row of the matrix `b`, with an execution policy.
+The matrices are containers with rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `num_a * num_b`.
+*/
+template<typename Tag, typename Container1, typename Container2, typename Container3>
+void pairwise_distances(execution::policy<Tag> policy, const Container1& a, const Container2& b, std::size_t dimension, Container3& out)
+{
+    assert(dimension > 0);
+    assert(a.size() % dimension == 0);
+    assert(b.size() % dimension == 0);
+    assert(out.size() == a.size() / dimension * (b.size() / dimension));
+    using std::begin;
+    using std::end;
+    pairwise_distances(policy, begin(a), end(a), begin(b), end(b), dimension, begin(out));
+}
+
+/** The Euclidean distances of each row of the matrix `a` to each row of the matrix `b`.
+The matrices are ranges of iterators with rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `num_a * num_b` elements.
+*/
+template<typename InputIterator1, typename InputIterator2, typename RandomAccessIterator>
+void pairwise_distances(InputIterator1 first_a, InputIterator1 last_a, InputIterator2 first_b, InputIterator2 last_b,
+    std::size_t dimension, RandomAccessIterator first_out)
+{
+    pairwise_distances(execution::seq, first_a, last_a, first_b, last_b, dimension, first_out);
+}
+
+/** The Euclidean distances of each row of the matrix `a` to each row of the matrix `b`.
+The matrices are containers with rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `num_a * num_b`.
+*/
+template<typename Container1, typename Container2, typename Container3>
+void pairwise_distances(const Container1& a, const Container2& b, std::size_t dimension, Container3& out)
+{
+    pairwise_distances(execution::seq, a, b, dimension, out);
+}
+
+/** The Euclidean distances of each pair of rows `i < j` of the matrix `a`, with an execution policy.
+The matrix is a range of iterators with `n` rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `n * (n - 1) / 2` elements.
+*/
+template<typename Tag, typename InputIterator, typename RandomAccessIterator>
+void pdist(execution::policy<Tag> policy, InputIterator first, InputIterator last, std::size_t dimension,
+    RandomAccessIterator first_out)
+{
+    assert(dimension > 0);
+    using T = value_type_i<RandomAccessIterator>;
+    const auto n = static_cast<std::size_t>(std::distance(first, last)) / dimension;
+    const auto store = [&](std::size_t i, std::size_t j, T d)
+    {
+        first_out[pairwise::condensed_index(n, i, j)] = T(std::sqrt(d));
+    };
+    for_each_squared_distance<T>(policy, first, n, first, n, dimension, true, store);
+}
+
+/** The Euclidean distances of each pair of rows `i < j` of the matrix `a`, with an execution policy.
+The matrix is a container with `n` rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `n * (n - 1) / 2`.
+*/
+template<typename Tag, typename Container1, typename Container2>
+void pdist(execution::policy<Tag> policy, const Container1& a, std::size_t dimension, Container2& out)
+{
+    assert(dimension > 0);
+    assert(a.size() % dimension == 0);
+    assert(out.size() == a.size() / dimension * (a.size() / dimension - 1) / 2);
+    using std::begin;
+    using std::end;
+    pdist(policy, begin(a), end(a), dimension, begin(out));
+}
+
+/** The Euclidean distances of each pair of rows `i < j` of the matrix `a`.
+The matrix is a range of iterators with `n` rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `n * (n - 1) / 2` elements.
+*/
+template<typename InputIterator, typename RandomAccessIterator>
+void pdist(InputIterator first, InputIterator last, std::size_t dimension, RandomAccessIterator first_out)
+{
+    pdist(execution::seq, first, last, dimension, first_out);
+}
+
+/** The Euclidean distances of each pair of rows `i < j` of the matrix `a`.
+The matrix is a container with `n` rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `n * (n - 1) / 2`.
+*/
+template<typename Container1, typename Container2>
+void pdist(const Container1& a, std::size_t dimension, Container2& out)
+{
+    pdist(execution::seq, a, dimension, out);
+}
+
+/** The squared Euclidean distances of each row of the matrix `a` to each row of the matrix `b`, with an execution policy.
+The matrices are ranges of iterators with rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `num_a * num_b` elements.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename RandomAccessIterator>
+void pairwise_squared_distances(execution::policy<Tag> policy, InputIterator1 first_a, InputIterator1 last_a,
+    InputIterator2 first_b, InputIterator2 last_b, std::size_t dimension, RandomAccessIterator first_out)
+{
+    assert(dimension > 0);
+    using T = value_type_i<RandomAccessIterator>;
+    const auto num_a = static_cast<std::size_t>(std::distance(first_a, last_a)) / dimension;
+    const auto num_b = static_cast<std::size_t>(std::distance(first_b, last_b)) / dimension;
+    const auto store = [&](std::size_t i, std::size_t j, T d)
+    {
+        first_out[i * num_b + j] = d;
+    };
+    for_each_squared_distance<T>(policy, first_a, num_a, first_b, num_b, dimension, false, store);
+}
+
+/** The squared Euclidean distances of each row of the matrix `a` to each row of the matrix `b`, with an execution policy.
+The matrices are containers with rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `num_a * num_b`.
+*/
+template<typename Tag, typename Container1, typename Container2, typename Container3>
+void pairwise_squared_distances(execution::policy<Tag> policy, const Container1& a, const Container2& b, std::size_t dimension, Container3& out)
+{
+    assert(dimension > 0);
+    assert(a.size() % dimension == 0);
+    assert(b.size() % dimension == 0);
+    assert(out.size() == a.size() / dimension * (b.size() / dimension));
+    using std::begin;
+    using std::end;
+    pairwise_squared_distances(policy, begin(a), end(a), begin(b), end(b), dimension, begin(out));
+}
+
+/** The squared Euclidean distances of each row of the matrix `a` to each row of the matrix `b`.
+The matrices are ranges of iterators with rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `num_a * num_b` elements.
+*/
+template<typename InputIterator1, typename InputIterator2, typename RandomAccessIterator>
+void pairwise_squared_distances(InputIterator1 first_a, InputIterator1 last_a, InputIterator2 first_b, InputIterator2 last_b,
+    std::size_t dimension, RandomAccessIterator first_out)
+{
+    pairwise_squared_distances(execution::seq, first_a, last_a, first_b, last_b, dimension, first_out);
+}
+
+/** The squared Euclidean distances of each row of the matrix `a` to each row of the matrix `b`.
+The matrices are containers with rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `num_a * num_b`.
+*/
+template<typename Container1, typename Container2, typename Container3>
+void pairwise_squared_distances(const Container1& a, const Container2& b, std::size_t dimension, Container3& out)
+{
+    pairwise_squared_distances(execution::seq, a, b, dimension, out);
+}
+
+/** The squared Euclidean distances of each pair of rows `i < j` of the matrix `a`, with an execution policy.
+The matrix is a range of iterators with `n` rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `n * (n - 1) / 2` elements.
+*/
+template<typename Tag, typename InputIterator, typename RandomAccessIterator>
+void squared_pdist(execution::policy<Tag> policy, InputIterator first, InputIterator last, std::size_t dimension,
+    RandomAccessIterator first_out)
+{
+    assert(dimension > 0);
+    using T = value_type_i<RandomAccessIterator>;
+    const auto n = static_cast<std::size_t>(std::distance(first, last)) / dimension;
+    const auto store = [&](std::size_t i, std::size_t j, T d)
+    {
+        first_out[pairwise::condensed_index(n, i, j)] = d;
+    };
+    for_each_squared_distance<T>(policy, first, n, first, n, dimension, true, store);
+}
+
+/** The squared Euclidean distances of each pair of rows `i < j` of the matrix `a`, with an execution policy.
+The matrix is a container with `n` rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `n * (n - 1) / 2`.
+*/
+template<typename Tag, typename Container1, typename Container2>
+void squared_pdist(execution::policy<Tag> policy, const Container1& a, std::size_t dimension, Container2& out)
+{
+    assert(dimension > 0);
+    assert(a.size() % dimension == 0);
+    assert(out.size() == a.size() / dimension * (a.size() / dimension - 1) / 2);
+    using std::begin;
+    using std::end;
+    squared_pdist(policy, begin(a), end(a), dimension, begin(out));
+}
+
+/** The squared Euclidean distances of each pair of rows `i < j` of the matrix `a`.
+The matrix is a range of iterators with `n` rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `n * (n - 1) / 2` elements.
+*/
+template<typename InputIterator, typename RandomAccessIterator>
+void squared_pdist(InputIterator first, InputIterator last, std::size_t dimension, RandomAccessIterator first_out)
+{
+    squared_pdist(execution::seq, first, last, dimension, first_out);
+}
+
+/** The squared Euclidean distances of each pair of rows `i < j` of the matrix `a`.
+The matrix is a container with `n` rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `n * (n - 1) / 2`.
+*/
+template<typename Container1, typename Container2>
+void squared_pdist(const Container1& a, std::size_t dimension, Container2& out)
+{
+    squared_pdist(execution::seq, a, dimension, out);
+}
+
+/** The `k` rows of the dataset that are nearest to each query in the Euclidean distance, with an execution policy.
+The dataset and the queries are ranges of iterators with rows of `dimension` elements, see @ref neighbors.
+The indices and the distances of the neighbors are written to random access iterators to
+`num_queries * k` elements. The dataset should have at least `k` rows, see @ref neighbors.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename IndexIterator, typename DistanceIterator>
+void nearest_neighbors(execution::policy<Tag> policy, InputIterator1 first_data, InputIterator1 last_data,
+    InputIterator2 first_queries, InputIterator2 last_queries, std::size_t dimension, std::size_t k,
+    IndexIterator first_index, DistanceIterator first_distance)
+{
+    assert(dimension > 0);
+    using T = value_type_i<DistanceIterator>;
+    const auto num_data = static_cast<std::size_t>(std::distance(first_data, last_data)) / dimension;
+    const auto num_queries = static_cast<std::size_t>(std::distance(first_queries, last_queries)) / dimension;
+    const auto compare = [](auto first_a, std::size_t num_a, auto first_b, std::size_t num_b, std::size_t dimension, auto store)
+    {
+        // The squared differences are summed directly: the formula with the norms and the dot
+        // products cancels catastrophically for close points with large norms, and changes the ranking.
+        pairwise::for_each_pair<T, operations::plus, operations::squared_difference>(execution::seq,
+            first_a, num_a, first_b, num_b, dimension, false, store);
+    };
+    neighbors::k_nearest<T>(policy, first_data, num_data, first_queries, num_queries, dimension, k,
+        first_index, first_distance, compare);
+    // The neighbors are found with the squared distances, that have the same order.
+    const auto n = static_cast<std::ptrdiff_t>(num_queries * k);
+    std::transform(first_distance, first_distance + n, first_distance, [](const T d) { return T(std::sqrt(d)); });
+}
+
+/** The `k` rows of the dataset that are nearest to each query in the Euclidean distance, with an execution policy.
+The dataset and the queries are containers with rows of `dimension` elements, see @ref neighbors.
+The sizes of the indices and the distances should be `num_queries * k`.
+*/
+template<typename Tag, typename Container1, typename Container2, typename Container3, typename Container4>
+void nearest_neighbors(execution::policy<Tag> policy, const Container1& data, const Container2& queries,
+    std::size_t dimension, std::size_t k, Container3& indices, Container4& distances)
+{
+    assert(dimension > 0);
+    assert(data.size() % dimension == 0);
+    assert(queries.size() % dimension == 0);
+    assert(indices.size() == queries.size() / dimension * k);
+    assert(distances.size() == indices.size());
+    using std::begin;
+    using std::end;
+    nearest_neighbors(policy, begin(data), end(data), begin(queries), end(queries), dimension, k,
+        begin(indices), begin(distances));
+}
+
+/** The `k` rows of the dataset that are nearest to each query in the Euclidean distance.
+The dataset and the queries are ranges of iterators with rows of `dimension` elements, see @ref neighbors.
+The indices and the distances of the neighbors are written to random access iterators to
+`num_queries * k` elements. The dataset should have at least `k` rows, see @ref neighbors.
+*/
+template<typename InputIterator1, typename InputIterator2, typename IndexIterator, typename DistanceIterator>
+void nearest_neighbors(InputIterator1 first_data, InputIterator1 last_data,
+    InputIterator2 first_queries, InputIterator2 last_queries, std::size_t dimension, std::size_t k,
+    IndexIterator first_index, DistanceIterator first_distance)
+{
+    nearest_neighbors(execution::seq, first_data, last_data, first_queries, last_queries, dimension, k,
+        first_index, first_distance);
+}
+
+/** The `k` rows of the dataset that are nearest to each query in the Euclidean distance.
+The dataset and the queries are containers with rows of `dimension` elements, see @ref neighbors.
+The sizes of the indices and the distances should be `num_queries * k`.
+*/
+template<typename Container1, typename Container2, typename Container3, typename Container4>
+void nearest_neighbors(const Container1& data, const Container2& queries,
+    std::size_t dimension, std::size_t k, Container3& indices, Container4& distances)
+{
+    nearest_neighbors(execution::seq, data, queries, dimension, k, indices, distances);
+}
+
 /** @} */
 
 } // namespace euclidean
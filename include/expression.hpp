@@ -0,0 +1,304 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "operations.hpp"
+#include "traits.hpp"
+
+namespace aaa {
+namespace lazy {
+
+/**
+@addtogroup expression
+
+The functions in the namespace `aaa::lazy` do not compute anything.
+They return lightweight expression nodes that remember the operation and
+their operands. A chain of operations is then evaluated in a single fused
+loop, without temporary containers, when it is:
+- Assigned to a container, or passed to @ref evaluate.
+- Passed to a function that takes a container, like a reduction.
+  Expressions have `begin`, `end`, `size` and `value_type`, like containers.
+
+Operands can be containers, scalars or other expressions.
+Containers that are passed as lvalues are referred to, and need to outlive
+the expression. Containers that are passed as rvalues are moved into the expression.
+
+The value type of an expression follows the non-lazy functions:
+it is the common type of the value types of the two containers,
+or the value type of the container if the other operand is a scalar.
+Each intermediate value is converted to this type.
+
+Example:
+```
+std::vector<double> in1 = { 1.1, 2.2, 3.3, 4.4, 5.5 };
+std::vector<double> in2 = { 1.1, 2.2, 3.3, 4.4, 5.5 };
+
+// Blend two images in one pass, without a temporary container.
+std::vector<double> out = aaa::lazy::divide(aaa::lazy::add(in1, in2), 2);
+
+// Compute the squared distance, without a temporary container.
+double d = aaa::euclidean::squared_norm(aaa::lazy::subtract(in1, in2));
+```
+
+@{
+*/
+
+struct expression_base {};
+
+template<typename T>
+using is_expression = std::is_base_of<expression_base, typename std::decay<T>::type>;
+
+////////////////////////////////////////////////////////////////////////////////
+// iterator
+
+/** A random access iterator that computes the elements of an expression. */
+template<typename Expression>
+class expression_iterator
+{
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = typename Expression::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    expression_iterator() = default;
+    expression_iterator(const Expression* expression, difference_type index)
+        : expression_(expression), index_(index)
+    {}
+
+    value_type operator*() const { return (*expression_)[index_]; }
+    value_type operator[](difference_type n) const { return (*expression_)[index_ + n]; }
+
+    expression_iterator& operator++() { ++index_; return *this; }
+    expression_iterator& operator--() { --index_; return *this; }
+    expression_iterator operator++(int) { auto it = *this; ++index_; return it; }
+    expression_iterator operator--(int) { auto it = *this; --index_; return it; }
+    expression_iterator& operator+=(difference_type n) { index_ += n; return *this; }
+    expression_iterator& operator-=(difference_type n) { index_ -= n; return *this; }
+
+    friend expression_iterator operator+(expression_iterator it, difference_type n) { return it += n; }
+    friend expression_iterator operator+(difference_type n, expression_iterator it) { return it += n; }
+    friend expression_iterator operator-(expression_iterator it, difference_type n) { return it -= n; }
+    friend difference_type operator-(const expression_iterator& a, const expression_iterator& b) { return a.index_ - b.index_; }
+
+    friend bool operator==(const expression_iterator& a, const expression_iterator& b) { return a.index_ == b.index_; }
+    friend bool operator!=(const expression_iterator& a, const expression_iterator& b) { return a.index_ != b.index_; }
+    friend bool operator<(const expression_iterator& a, const expression_iterator& b) { return a.index_ < b.index_; }
+    friend bool operator>(const expression_iterator& a, const expression_iterator& b) { return a.index_ > b.index_; }
+    friend bool operator<=(const expression_iterator& a, const expression_iterator& b) { return a.index_ <= b.index_; }
+    friend bool operator>=(const expression_iterator& a, const expression_iterator& b) { return a.index_ >= b.index_; }
+
+private:
+    const Expression* expression_ = nullptr;
+    difference_type index_ = 0;
+};
+
+/** Gives expressions the interface of a read only container. */
+template<typename Expression>
+class container_interface : public expression_base
+{
+public:
+    using const_iterator = expression_iterator<Expression>;
+    using iterator = const_iterator;
+
+    const_iterator begin() const { return const_iterator(&self(), 0); }
+    const_iterator end() const { return const_iterator(&self(), static_cast<std::ptrdiff_t>(self().size())); }
+
+    /** Evaluates the expression into a new container. */
+    template<typename Container,
+        typename = aaa::value_type<Container>,
+        typename = typename std::enable_if<std::is_constructible<Container, std::size_t>::value>::type>
+    operator Container() const
+    {
+        auto out = Container(self().size());
+        evaluate(self(), out);
+        return out;
+    }
+
+private:
+    const Expression& self() const { return static_cast<const Expression&>(*this); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// operands
+
+/** Refers to a container that outlives the expression. */
+template<typename Container>
+class reference_operand
+{
+public:
+    using value_type = aaa::value_type<Container>;
+    static constexpr bool is_scalar = false;
+
+    explicit reference_operand(const Container& container)
+        : first_(std::begin(container)), size_(container.size())
+    {}
+
+    value_type operator[](std::ptrdiff_t i) const { return first_[i]; }
+    std::size_t size() const { return size_; }
+
+private:
+    decltype(std::begin(std::declval<const Container&>())) first_;
+    std::size_t size_;
+};
+
+/** Owns a container that was moved into the expression. */
+template<typename Container>
+class value_operand
+{
+public:
+    using value_type = aaa::value_type<Container>;
+    static constexpr bool is_scalar = false;
+
+    explicit value_operand(Container&& container) : container_(std::move(container)) {}
+
+    value_type operator[](std::ptrdiff_t i) const { return std::begin(container_)[i]; }
+    std::size_t size() const { return container_.size(); }
+
+private:
+    Container container_;
+};
+
+/** A scalar that is used for every element. */
+template<typename T>
+class scalar_operand
+{
+public:
+    using value_type = T;
+    static constexpr bool is_scalar = true;
+
+    explicit scalar_operand(T value) : value_(value) {}
+
+    value_type operator[](std::ptrdiff_t) const { return value_; }
+    std::size_t size() const { return 0; }
+
+private:
+    T value_;
+};
+
+template<typename X, typename D = typename std::decay<X>::type>
+using operand_t = typename std::conditional<is_expression<D>::value, D,
+    typename std::conditional<std::is_arithmetic<D>::value, scalar_operand<D>,
+    typename std::conditional<std::is_lvalue_reference<X>::value, reference_operand<D>, value_operand<D>>::type>::type>::type;
+
+template<typename Left, typename Right>
+using binary_value_type =
+    typename std::conditional<Left::is_scalar, typename Right::value_type,
+    typename std::conditional<Right::is_scalar, typename Left::value_type,
+    typename std::common_type<typename Left::value_type, typename Right::value_type>::type>::type>::type;
+
+////////////////////////////////////////////////////////////////////////////////
+// expressions
+
+template<typename Op, typename Left, typename Right>
+class binary_expression : public container_interface<binary_expression<Op, Left, Right>>
+{
+public:
+    using value_type = binary_value_type<Left, Right>;
+    static constexpr bool is_scalar = false;
+
+    binary_expression(Left left, Right right) : left_(std::move(left)), right_(std::move(right))
+    {
+        assert(Left::is_scalar || Right::is_scalar || left_.size() == right_.size());
+    }
+
+    value_type operator[](std::ptrdiff_t i) const { return value_type(Op{}(left_[i], right_[i])); }
+    std::size_t size() const { return Left::is_scalar ? right_.size() : left_.size(); }
+
+private:
+    Left left_;
+    Right right_;
+};
+
+template<typename Op, typename Operand>
+class unary_expression : public container_interface<unary_expression<Op, Operand>>
+{
+public:
+    using value_type = typename Operand::value_type;
+    static constexpr bool is_scalar = false;
+
+    explicit unary_expression(Operand operand) : operand_(std::move(operand)) {}
+
+    value_type operator[](std::ptrdiff_t i) const { return value_type(Op{}(operand_[i])); }
+    std::size_t size() const { return operand_.size(); }
+
+private:
+    Operand operand_;
+};
+
+template<typename Left, typename Right>
+using enable_if_not_both_scalars = typename std::enable_if<
+    !(std::is_arithmetic<typename std::decay<Left>::type>::value &&
+      std::is_arithmetic<typename std::decay<Right>::type>::value), void*>::type;
+
+template<typename Op, typename Left, typename Right>
+using binary_expression_t = binary_expression<Op, operand_t<Left>, operand_t<Right>>;
+
+////////////////////////////////////////////////////////////////////////////////
+// evaluation
+
+/** Evaluates an expression into a container, in a single loop.
+The container should have the same size as the expression.
+*/
+template<typename Expression, typename Container,
+    typename std::enable_if<is_expression<Expression>::value, void*>::type = nullptr>
+void evaluate(const Expression& expression, Container& out)
+{
+    assert(expression.size() == out.size());
+    using std::begin;
+    auto first_out = begin(out);
+    const auto size = static_cast<std::ptrdiff_t>(expression.size());
+    for (auto i = std::ptrdiff_t{0}; i < size; ++i)
+    {
+        first_out[i] = expression[i];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// operations
+
+/** Lazy elementwise addition of two vectors, or of a scalar and a vector. */
+template<typename Left, typename Right, enable_if_not_both_scalars<Left, Right> = nullptr>
+binary_expression_t<operations::plus, Left, Right> add(Left&& left, Right&& right)
+{
+    return { operand_t<Left>(std::forward<Left>(left)), operand_t<Right>(std::forward<Right>(right)) };
+}
+
+/** Lazy elementwise subtraction of two vectors, or of a scalar and a vector. */
+template<typename Left, typename Right, enable_if_not_both_scalars<Left, Right> = nullptr>
+binary_expression_t<operations::minus, Left, Right> subtract(Left&& left, Right&& right)
+{
+    return { operand_t<Left>(std::forward<Left>(left)), operand_t<Right>(std::forward<Right>(right)) };
+}
+
+/** Lazy elementwise multiplication of two vectors, or of a scalar and a vector. */
+template<typename Left, typename Right, enable_if_not_both_scalars<Left, Right> = nullptr>
+binary_expression_t<operations::multiplies, Left, Right> multiply(Left&& left, Right&& right)
+{
+    return { operand_t<Left>(std::forward<Left>(left)), operand_t<Right>(std::forward<Right>(right)) };
+}
+
+/** Lazy elementwise division of two vectors, or of a scalar and a vector. */
+template<typename Left, typename Right, enable_if_not_both_scalars<Left, Right> = nullptr>
+binary_expression_t<operations::divides, Left, Right> divide(Left&& left, Right&& right)
+{
+    return { operand_t<Left>(std::forward<Left>(left)), operand_t<Right>(std::forward<Right>(right)) };
+}
+
+/** Lazy elementwise negation of a vector. */
+template<typename In,
+    typename std::enable_if<!std::is_arithmetic<typename std::decay<In>::type>::value, void*>::type = nullptr>
+unary_expression<operations::negation, operand_t<In>> negate(In&& in)
+{
+    return unary_expression<operations::negation, operand_t<In>>(operand_t<In>(std::forward<In>(in)));
+}
+
+/** @} */
+
+} // namespace lazy
+} // namespace aaa
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <utility>
+
+#include "operations.hpp"
+#include "simd.hpp"
+#include "traits.hpp"
+
+namespace aaa {
+
+/**
+@addtogroup fused
+
+These functions combine several elementwise operations in a single pass over
+the data, without temporary containers:
+- `axpy(a, x, y)` computes `a * x + y`.
+- `axpby(a, x, b, y)` computes `a * x + b * y`.
+- `lerp(x, y, t)` computes `(1 - t) * x + t * y`,
+  which gives exactly `x` for `t = 0` and exactly `y` for `t = 1`.
+- `weighted_blend(inputs, weights)` computes
+  `weights[0] * inputs[0] + weights[1] * inputs[1] + ...`.
+
+For contiguous floating point ranges they use a fused multiply-add when the
+CPU has it, see @ref simd. The last bit of the result can then differ from the
+separate multiplication and addition.
+
+Examples:
+```
+std::vector<double>   in1 = { 1.1, 2.2, 3.3, 4.4, 5.5 };
+std::vector<double>   in2 = { 1.1, 2.2, 3.3, 4.4, 5.5 };
+std::valarray<double> in3 = { 1.1, 2.2, 3.3, 4.4, 5.5 };
+std::array<double, 5> in4 = { 1.1, 2.2, 3.3, 4.4, 5.5 };
+std::vector<double>   out = { 1.1, 2.2, 3.3, 4.4, 5.5 };
+
+using namespace aaa;
+
+// In these examples we want the same type of container
+// for both the input and output. We can then return the output by value.
+out = axpy(2.0, in1, in2); // 2 * in1 + in2
+out = axpby(0.3, in1, 0.7, in2); // 0.3 * in1 + 0.7 * in2
+out = lerp(in1, in2, 0.25); // 0.75 * in1 + 0.25 * in2
+
+// Blend several images with one weight per image.
+std::vector<std::vector<double>> images = { in1, in2, in1 };
+std::vector<double> weights = { 0.2, 0.3, 0.5 };
+out = weighted_blend(images, weights);
+
+// In these examples we mix arbitrary type of containers
+// for the input and output. We then use a reference for output.
+axpy(2.0, in3, in4, out);
+axpby(0.3, in3, 0.7, in4, out);
+lerp(in3, in4, 0.25, out);
+weighted_blend(images, weights, out);
+
+// In these examples we use iterators for the input and output.
+axpy(2.0, begin(in3), end(in3), begin(in4), begin(out));
+axpby(0.3, begin(in3), end(in3), 0.7, begin(in4), begin(out));
+lerp(begin(in3), end(in3), begin(in4), 0.25, begin(out));
+weighted_blend(begin(images), end(images), begin(weights), begin(out), end(out));
+```
+
+@{
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+// iterators
+
+template<typename Element, typename InputIterator1, typename InputIterator2, typename OutputIterator,
+    check_sum<value_type_i<InputIterator1>, value_type_i<InputIterator2>, value_type_i<OutputIterator>> = nullptr>
+    void axpy(const Element& a, InputIterator1 first_x, InputIterator1 last_x, InputIterator2 first_y, OutputIterator first_out)
+{
+    simd::axpby(a, first_x, last_x, Element(1), first_y, first_out);
+}
+
+template<typename Element1, typename InputIterator1, typename Element2, typename InputIterator2, typename OutputIterator,
+    check_sum<value_type_i<InputIterator1>, value_type_i<InputIterator2>, value_type_i<OutputIterator>> = nullptr>
+    void axpby(const Element1& a, InputIterator1 first_x, InputIterator1 last_x,
+        const Element2& b, InputIterator2 first_y, OutputIterator first_out)
+{
+    simd::axpby(a, first_x, last_x, b, first_y, first_out);
+}
+
+template<typename InputIterator1, typename InputIterator2, typename Element, typename OutputIterator,
+    check_sum<value_type_i<InputIterator1>, value_type_i<InputIterator2>, value_type_i<OutputIterator>> = nullptr>
+    void lerp(InputIterator1 first_x, InputIterator1 last_x, InputIterator2 first_y, const Element& t, OutputIterator first_out)
+{
+    simd::axpby(Element(1) - t, first_x, last_x, t, first_y, first_out);
+}
+
+/** The inputs are random access containers, with the same size as the output.
+The output is computed block by block, so that each block stays in the cache
+while all the inputs are added to it.
+*/
+template<typename InputIterator, typename WeightIterator, typename OutputIterator>
+void weighted_blend(InputIterator first_input, InputIterator last_input, WeightIterator first_weight,
+    OutputIterator first_out, OutputIterator last_out)
+{
+    using difference_type = typename std::iterator_traits<OutputIterator>::difference_type;
+    constexpr auto block_size = difference_type{1024};
+    const auto size = std::distance(first_out, last_out);
+    if (first_input == last_input)
+    {
+        std::fill(first_out, last_out, value_type_i<OutputIterator>{});
+        return;
+    }
+    using std::begin;
+    for (auto offset = difference_type{0}; offset < size; offset += block_size)
+    {
+        const auto n = std::min(block_size, size - offset);
+        const auto out = first_out + offset;
+        auto input = first_input;
+        auto weight = first_weight;
+        const auto in = begin(*input) + offset;
+        simd::transform_scalar_vector(*weight, in, in + n, out, operations::multiplies{});
+        for (++input, ++weight; input != last_input; ++input, ++weight)
+        {
+            assert(static_cast<difference_type>(input->size()) == size);
+            const auto in = begin(*input) + offset;
+            simd::axpby(*weight, in, in + n, 1, out, out);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// containers
+
+template<typename Element, typename Container1, typename Container2, typename Container3,
+    check_sum<value_type<Container1>, value_type<Container2>, value_type<Container3>> = nullptr>
+    void axpy(const Element& a, const Container1& x, const Container2& y, Container3& out)
+{
+    assert(x.size() == out.size());
+    assert(y.size() == out.size());
+    using std::begin;
+    using std::end;
+    axpy(a, begin(x), end(x), begin(y), begin(out));
+}
+
+template<typename Element1, typename Container1, typename Element2, typename Container2, typename Container3,
+    check_sum<value_type<Container1>, value_type<Container2>, value_type<Container3>> = nullptr>
+    void axpby(const Element1& a, const Container1& x, const Element2& b, const Container2& y, Container3& out)
+{
+    assert(x.size() == out.size());
+    assert(y.size() == out.size());
+    using std::begin;
+    using std::end;
+    axpby(a, begin(x), end(x), b, begin(y), begin(out));
+}
+
+template<typename Container1, typename Container2, typename Element, typename Container3,
+    check_sum<value_type<Container1>, value_type<Container2>, value_type<Container3>> = nullptr>
+    void lerp(const Container1& x, const Container2& y, const Element& t, Container3& out)
+{
+    assert(x.size() == out.size());
+    assert(y.size() == out.size());
+    using std::begin;
+    using std::end;
+    lerp(begin(x), end(x), begin(y), t, begin(out));
+}
+
+template<typename Inputs, typename Weights, typename Container>
+void weighted_blend(const Inputs& inputs, const Weights& weights, Container& out)
+{
+    assert(inputs.size() == weights.size());
+    using std::begin;
+    using std::end;
+    weighted_blend(begin(inputs), end(inputs), begin(weights), begin(out), end(out));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// make container
+
+template<typename Container>
+Container axpy(const value_type<Container>& a, const Container& x, const Container& y)
+{
+    auto out = x;
+    axpy(a, x, y, out);
+    return out;
+}
+
+template<typename Container>
+Container axpby(const value_type<Container>& a, const Container& x, const value_type<Container>& b, const Container& y)
+{
+    auto out = x;
+    axpby(a, x, b, y, out);
+    return out;
+}
+
+template<typename Container>
+Container lerp(const Container& x, const Container& y, const value_type<Container>& t)
+{
+    auto out = x;
+    lerp(x, y, t, out);
+    return out;
+}
+
+template<typename Inputs, typename Weights>
+value_type<Inputs> weighted_blend(const Inputs& inputs, const Weights& weights)
+{
+    assert(inputs.size() > 0);
+    using std::begin;
+    auto out = *begin(inputs);
+    weighted_blend(inputs, weights, out);
+    return out;
+}
+
+// Overloads for temporary containers, that reuse their storage for the output.
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container axpy(const value_type<Container>& a, Container&& x, const Container& y)
+{
+    axpy(a, x, y, x);
+    return std::move(x);
+}
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container axpy(const value_type<Container>& a, const Container& x, Container&& y)
+{
+    axpy(a, x, y, y);
+    return std::move(y);
+}
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container axpy(const value_type<Container>& a, Container&& x, Container&& y)
+{
+    axpy(a, x, y, x);
+    return std::move(x);
+}
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container axpby(const value_type<Container>& a, Container&& x, const value_type<Container>& b, const Container& y)
+{
+    axpby(a, x, b, y, x);
+    return std::move(x);
+}
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container axpby(const value_type<Container>& a, const Container& x, const value_type<Container>& b, Container&& y)
+{
+    axpby(a, x, b, y, y);
+    return std::move(y);
+}
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container axpby(const value_type<Container>& a, Container&& x, const value_type<Container>& b, Container&& y)
+{
+    axpby(a, x, b, y, x);
+    return std::move(x);
+}
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container lerp(Container&& x, const Container& y, const value_type<Container>& t)
+{
+    lerp(x, y, t, x);
+    return std::move(x);
+}
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container lerp(const Container& x, Container&& y, const value_type<Container>& t)
+{
+    lerp(x, y, t, y);
+    return std::move(y);
+}
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container lerp(Container&& x, Container&& y, const value_type<Container>& t)
+{
+    lerp(x, y, t, x);
+    return std::move(x);
+}
+
+/** @} */
+
+} // namespace aaa
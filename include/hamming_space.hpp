@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "neighbors.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "traits.hpp"
+
+namespace aaa {
+namespace hamming {
+
+/**
+@addtogroup hamming_space Hamming Space
+
+Hamming space compares binary vectors, like the binary codes of hashes or
+fingerprints. The bits are packed in words of type `uint64_t`, so a code of 256
+bits takes 4 words. Hamming space defines the following functions:
+- The norm of a vector is the number of bits that are set:
+  \f$ \| a \|_H = \sum_i popcount(a_i) \f$
+- The distance between the vectors a and b is the number of bits that differ:
+  \f$ d_H(a, b) = \sum_i popcount(a_i \oplus b_i) \f$
+
+The functions `distances` and `nearest_neighbors` compare a query to each row of
+a matrix of codes, stored row by row in a single range of words, see @ref pairwise
+and @ref neighbors. The dimension of these matrices is the number of words of a row.
+
+The bits are counted with the popcnt instruction. For long codes the SIMD kernels
+count the bits of the bytes with table lookups, see @ref simd.
+
+Example:
+```
+// 1000000 codes and 100 queries of 256 bits.
+std::vector<std::uint64_t> data(1000000 * 4);
+std::vector<std::uint64_t> queries(100 * 4);
+
+using namespace aaa;
+
+// The number of bits that differ between the first query and each code.
+std::vector<std::uint64_t> out(1000000);
+hamming::distances(queries.begin(), queries.begin() + 4, data.begin(), out.begin(), out.end());
+
+// The 10 nearest codes of each query.
+std::vector<std::size_t> indices(100 * 10);
+std::vector<std::uint64_t> distances(100 * 10);
+hamming::nearest_neighbors(execution::par, data, queries, 4, 10, indices, distances);
+```
+
+@{
+*/
+
+/** The number of bits that are set in a vector of words.
+The vector is represented by a range of iterators.
+*/
+template<typename InputIterator>
+std::uint64_t norm(InputIterator first, InputIterator last)
+{
+    return simd::bit_count<false>(first, last, first);
+}
+
+/** The number of bits that are set in a vector of words.
+The vector is represented by a container.
+*/
+template<typename Container>
+std::uint64_t norm(const Container& a)
+{
+    using std::begin;
+    using std::end;
+    return norm(begin(a), end(a));
+}
+
+/** The number of bits that differ between two vectors of words.
+The vectors are represented by ranges of iterators, and the second has the size of the first.
+*/
+template<typename InputIterator1, typename InputIterator2>
+std::uint64_t distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right)
+{
+    return simd::bit_count<true>(first_left, last_left, first_right);
+}
+
+/** The number of bits that differ between two vectors of words.
+The vectors are represented by containers of the same size.
+*/
+template<typename Container1, typename Container2>
+std::uint64_t distance(const Container1& left, const Container2& right)
+{
+    assert(left.size() == right.size());
+    using std::begin;
+    using std::end;
+    return distance(begin(left), end(left), begin(right));
+}
+
+/** The Hamming distances of a query to each row of a matrix.
+The matrix is a range of iterators that stores the rows one after the other,
+and each row has the size of the query. The number of rows is the size of the output.
+*/
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void distances(InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out)
+{
+    simd::hamming_distances(first_query, last_query, first_matrix, first_out, last_out);
+}
+
+/** The Hamming distances of a query to each row of a matrix.
+The query, the matrix and the output are containers.
+The size of the matrix should be the size of the query times the size of the output.
+*/
+template<typename Container1, typename Container2, typename Container3>
+void distances(const Container1& query, const Container2& matrix, Container3& out)
+{
+    assert(matrix.size() == query.size() * out.size());
+    using std::begin;
+    using std::end;
+    distances(begin(query), end(query), begin(matrix), begin(out), end(out));
+}
+
+/** The `k` rows of the dataset that are nearest to each query in the Hamming distance, with an execution policy.
+The dataset and the queries are ranges of iterators with rows of `num_words` words, see @ref neighbors.
+The indices and the distances of the neighbors are written to random access iterators to
+`num_queries * k` elements. The dataset should have at least `k` rows, see @ref neighbors.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename IndexIterator, typename DistanceIterator>
+void nearest_neighbors(execution::policy<Tag> policy, InputIterator1 first_data, InputIterator1 last_data,
+    InputIterator2 first_queries, InputIterator2 last_queries, std::size_t num_words, std::size_t k,
+    IndexIterator first_index, DistanceIterator first_distance)
+{
+    assert(num_words > 0);
+    using T = value_type_i<DistanceIterator>;
+    const auto num_data = static_cast<std::size_t>(std::distance(first_data, last_data)) / num_words;
+    const auto num_queries = static_cast<std::size_t>(std::distance(first_queries, last_queries)) / num_words;
+    const auto compare = [](auto first_a, std::size_t num_a, auto first_b, std::size_t num_b, std::size_t num_words, auto store)
+    {
+        auto row_distances = std::vector<std::uint64_t>(num_b);
+        for (auto i = std::size_t{0}; i < num_a; ++i)
+        {
+            const auto query = std::next(first_a, static_cast<std::ptrdiff_t>(i * num_words));
+            distances(query, std::next(query, static_cast<std::ptrdiff_t>(num_words)), first_b,
+                row_distances.begin(), row_distances.end());
+            for (auto j = std::size_t{0}; j < num_b; ++j)
+            {
+                store(i, j, static_cast<T>(row_distances[j]));
+            }
+        }
+    };
+    neighbors::k_nearest<T>(policy, first_data, num_data, first_queries, num_queries, num_words, k,
+        first_index, first_distance, compare);
+}
+
+/** The `k` rows of the dataset that are nearest to each query in the Hamming distance, with an execution policy.
+The dataset and the queries are containers with rows of `num_words` words, see @ref neighbors.
+The sizes of the indices and the distances should be `num_queries * k`.
+*/
+template<typename Tag, typename Container1, typename Container2, typename Container3, typename Container4>
+void nearest_neighbors(execution::policy<Tag> policy, const Container1& data, const Container2& queries,
+    std::size_t num_words, std::size_t k, Container3& indices, Container4& distances)
+{
+    assert(num_words > 0);
+    assert(data.size() % num_words == 0);
+    assert(queries.size() % num_words == 0);
+    assert(indices.size() == queries.size() / num_words * k);
+    assert(distances.size() == indices.size());
+    using std::begin;
+    using std::end;
+    nearest_neighbors(policy, begin(data), end(data), begin(queries), end(queries), num_words, k,
+        begin(indices), begin(distances));
+}
+
+/** The `k` rows of the dataset that are nearest to each query in the Hamming distance.
+The dataset and the queries are ranges of iterators with rows of `num_words` words, see @ref neighbors.
+The indices and the distances of the neighbors are written to random access iterators to
+`num_queries * k` elements. The dataset should have at least `k` rows, see @ref neighbors.
+*/
+template<typename InputIterator1, typename InputIterator2, typename IndexIterator, typename DistanceIterator>
+void nearest_neighbors(InputIterator1 first_data, InputIterator1 last_data,
+    InputIterator2 first_queries, InputIterator2 last_queries, std::size_t num_words, std::size_t k,
+    IndexIterator first_index, DistanceIterator first_distance)
+{
+    nearest_neighbors(execution::seq, first_data, last_data, first_queries, last_queries, num_words, k,
+        first_index, first_distance);
+}
+
+/** The `k` rows of the dataset that are nearest to each query in the Hamming distance.
+The dataset and the queries are containers with rows of `num_words` words, see @ref neighbors.
+The sizes of the indices and the distances should be `num_queries * k`.
+*/
+template<typename Container1, typename Container2, typename Container3, typename Container4>
+void nearest_neighbors(const Container1& data, const Container2& queries,
+    std::size_t num_words, std::size_t k, Container3& indices, Container4& distances)
+{
+    nearest_neighbors(execution::seq, data, queries, num_words, k, indices, distances);
+}
+
+/** @} */
+
+} // namespace hamming
+} // namespace aaa
@@ -0,0 +1,661 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "euclidean_space.hpp"
+#include "pairwise.hpp"
+#include "parallel.hpp"
+#include "traits.hpp"
+
+namespace aaa {
+namespace kmeans {
+
+/**
+@addtogroup kmeans
+
+k-means clusters the rows of a matrix around `k` centroids, such that the sum of
+the squared Euclidean distances of the rows to their nearest centroid, the
+inertia, is small. The matrices are stored row by row, like in @ref pairwise,
+and their elements have a floating point type.
+- `seed_centroids` picks `k` rows by k-means++: each row after the first is
+  picked with a probability proportional to its squared distance to the nearest
+  row picked so far. The picks come from a random generator with a `seed`, so
+  they are the same for each run.
+- `lloyd` alternates between assigning each row to its nearest centroid, and
+  moving each centroid to the mean of its rows, until no row changes centroid.
+  The assignments keep Hamerly's bounds: an upper bound of the distance to the
+  assigned centroid, and a lower bound of the distance to any other centroid.
+  When the upper bound is below the lower bound, or below half the distance to
+  the nearest other centroid, the row keeps its centroid without computing any
+  distance. After the first iterations, most rows are skipped.
+- `fit` runs `lloyd` from the centroids of `seed_centroids`.
+- `fit_minibatch` moves the centroids by the rows of random batches, and is
+  much faster than `fit` for large matrices, at the cost of a higher inertia.
+- `assign` finds the nearest centroid of each row.
+
+The distances of a row to the centroids are computed by the SIMD kernels of
+`euclidean::squared_distances`. With a parallel execution policy, the rows are
+split in parts that are assigned in parallel, and each part sums its rows in its
+own accumulators, which are added up at the end of an iteration. The number of
+parts depends on the size of the matrix and not on the number of threads, so
+the results are the same for all execution policies.
+
+Example:
+```
+// 1000000 rows of 32 floats.
+std::vector<float> data(1000000 * 32);
+
+using namespace aaa;
+
+// 100 clusters of the rows, from the seed 42.
+const auto clusters = kmeans::fit(execution::par, data, 32, 100, 300, 42);
+// clusters.centroids has 100 * 32 elements, clusters.labels has 1000000.
+
+// The same from 100 batches of 1024 rows.
+const auto minibatch = kmeans::fit_minibatch(execution::par, data, 32, 100, 1024, 100, 42);
+```
+
+@{
+*/
+
+/** The result of k-means: the centroids stored row by row, the index of the
+centroid of each row, the sum of the squared distances of the rows to their
+centroids, and the number of iterations that were run.
+*/
+template<typename T>
+struct clusters
+{
+    std::vector<T> centroids;
+    std::vector<std::size_t> labels;
+    T inertia;
+    std::size_t iterations;
+};
+
+/** The type of the sums of rows, which is at least `double`. */
+template<typename T>
+using accumulator_t = typename std::common_type<T, double>::type;
+
+/** The maximum number of parts of the rows. */
+constexpr std::size_t max_parts = 64;
+
+/** The minimum number of rows of a part. */
+constexpr std::size_t min_part_rows = 1024;
+
+/** The maximum number of elements of the accumulators of all the parts. */
+constexpr std::size_t max_accumulator_elements = std::size_t{1} << 23;
+
+/** The number of parts of `num_rows` rows, that have accumulators of `num_elements` each.
+It does not depend on the number of threads, so neither do the sums of the parts.
+*/
+inline std::size_t num_parts(std::size_t num_rows, std::size_t num_elements)
+{
+    const auto by_rows = (num_rows + min_part_rows - 1) / min_part_rows;
+    const auto by_memory = max_accumulator_elements / std::max(std::size_t{1}, num_elements);
+    return std::max(std::size_t{1}, std::min({max_parts, by_rows, by_memory}));
+}
+
+/** Calls `f(part, first_row, last_row)` for each part of `num_rows` rows, with an execution policy. */
+template<typename Tag, typename Function>
+void for_each_part(execution::policy<Tag> policy, std::size_t num_rows, std::size_t num_parts, Function f)
+{
+    const auto part_rows = (num_rows + num_parts - 1) / num_parts;
+    pairwise::for_each_tile(policy, num_parts, [&](std::ptrdiff_t p)
+    {
+        const auto part = static_cast<std::size_t>(p);
+        const auto first_row = std::min(num_rows, part * part_rows);
+        const auto last_row = std::min(num_rows, first_row + part_rows);
+        if (first_row < last_row)
+        {
+            f(part, first_row, last_row);
+        }
+    });
+}
+
+/** The index of the nearest centroid, and the squared distances to the nearest and second nearest. */
+template<typename T>
+struct nearest_two
+{
+    std::size_t index;
+    T first;
+    T second;
+};
+
+/** The nearest two of the squared distances to the centroids. Equal distances are ordered by index. */
+template<typename T>
+nearest_two<T> find_nearest_two(const std::vector<T>& squared_distances)
+{
+    auto nearest = nearest_two<T>{0, std::numeric_limits<T>::infinity(), std::numeric_limits<T>::infinity()};
+    for (auto c = std::size_t{0}; c < squared_distances.size(); ++c)
+    {
+        const auto d = squared_distances[c];
+        if (d < nearest.first)
+        {
+            nearest = {c, d, nearest.first};
+        }
+        else if (d < nearest.second)
+        {
+            nearest.second = d;
+        }
+    }
+    return nearest;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** Picks `k` rows of a matrix by k-means++, with an execution policy.
+The matrix is a range of random access iterators with rows of `dimension`
+elements, and should have at least `k` rows. Returns the `k` rows one after the other.
+*/
+template<typename Tag, typename RandomAccessIterator, typename T = value_type_i<RandomAccessIterator>>
+std::vector<T> seed_centroids(execution::policy<Tag> policy, RandomAccessIterator first, RandomAccessIterator last,
+    std::size_t dimension, std::size_t k, std::uint64_t seed = 0)
+{
+    static_assert(std::is_floating_point<T>::value, "The elements should have a floating point type");
+    assert(dimension > 0);
+    const auto num_rows = static_cast<std::size_t>(std::distance(first, last)) / dimension;
+    assert(k > 0 && k <= num_rows);
+    const auto row = [&](std::size_t i) { return first + static_cast<std::ptrdiff_t>(i * dimension); };
+    auto random = std::mt19937_64(seed);
+    auto centroids = std::vector<T>();
+    centroids.reserve(k * dimension);
+    auto chosen = std::uniform_int_distribution<std::size_t>(0, num_rows - 1)(random);
+    auto nearest = std::vector<T>(num_rows, std::numeric_limits<T>::max());
+    auto distances = std::vector<T>(num_rows);
+    const auto parts = num_parts(num_rows, 0);
+    for (auto c = std::size_t{0}; c < k; ++c)
+    {
+        centroids.insert(centroids.end(), row(chosen), row(chosen + 1));
+        if (c + 1 == k)
+        {
+            break;
+        }
+        const auto centroid = centroids.end() - static_cast<std::ptrdiff_t>(dimension);
+        for_each_part(policy, num_rows, parts, [&](std::size_t, std::size_t first_row, std::size_t last_row)
+        {
+            const auto out = distances.begin() + static_cast<std::ptrdiff_t>(first_row);
+            euclidean::squared_distances(centroid, centroids.end(), row(first_row),
+                out, out + static_cast<std::ptrdiff_t>(last_row - first_row));
+            for (auto i = first_row; i < last_row; ++i)
+            {
+                nearest[i] = std::min(nearest[i], distances[i]);
+            }
+        });
+        using A = accumulator_t<T>;
+        auto total = A{0};
+        for (const auto d : nearest)
+        {
+            total += d;
+        }
+        if (!(total > 0))
+        {
+            chosen = std::uniform_int_distribution<std::size_t>(0, num_rows - 1)(random);
+            continue;
+        }
+        const auto target = std::uniform_real_distribution<A>(0, total)(random);
+        auto cumulative = A{0};
+        for (auto i = std::size_t{0}; i < num_rows; ++i)
+        {
+            if (nearest[i] > 0)
+            {
+                chosen = i;
+                cumulative += nearest[i];
+                if (cumulative > target)
+                {
+                    break;
+                }
+            }
+        }
+    }
+    return centroids;
+}
+
+/** Picks `k` rows of a matrix by k-means++, with an execution policy.
+The matrix is a container with rows of `dimension` elements.
+*/
+template<typename Tag, typename Container, typename T = value_type<Container>>
+std::vector<T> seed_centroids(execution::policy<Tag> policy, const Container& data,
+    std::size_t dimension, std::size_t k, std::uint64_t seed = 0)
+{
+    assert(dimension > 0 && data.size() % dimension == 0);
+    using std::begin;
+    using std::end;
+    return seed_centroids(policy, begin(data), end(data), dimension, k, seed);
+}
+
+/** Picks `k` rows of a matrix by k-means++.
+The matrix is a range of random access iterators with rows of `dimension` elements.
+*/
+template<typename RandomAccessIterator, typename T = value_type_i<RandomAccessIterator>>
+std::vector<T> seed_centroids(RandomAccessIterator first, RandomAccessIterator last,
+    std::size_t dimension, std::size_t k, std::uint64_t seed = 0)
+{
+    return seed_centroids(execution::seq, first, last, dimension, k, seed);
+}
+
+/** Picks `k` rows of a matrix by k-means++.
+The matrix is a container with rows of `dimension` elements.
+*/
+template<typename Container, typename T = value_type<Container>>
+std::vector<T> seed_centroids(const Container& data, std::size_t dimension, std::size_t k, std::uint64_t seed = 0)
+{
+    return seed_centroids(execution::seq, data, dimension, k, seed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** Assigns each row of a matrix to its nearest centroid, with an execution policy.
+The matrix is a range of random access iterators with rows of `dimension` elements,
+the centroids are stored row by row, and the size of the labels is the number of rows.
+Returns the inertia.
+*/
+template<typename Tag, typename RandomAccessIterator, typename T = value_type_i<RandomAccessIterator>>
+T assign(execution::policy<Tag> policy, RandomAccessIterator first, RandomAccessIterator last,
+    std::size_t dimension, const std::vector<T>& centroids, std::vector<std::size_t>& labels)
+{
+    static_assert(std::is_floating_point<T>::value, "The elements should have a floating point type");
+    assert(dimension > 0 && !centroids.empty() && centroids.size() % dimension == 0);
+    const auto num_rows = static_cast<std::size_t>(std::distance(first, last)) / dimension;
+    assert(labels.size() == num_rows);
+    const auto k = centroids.size() / dimension;
+    const auto parts = num_parts(num_rows, 0);
+    auto inertias = std::vector<accumulator_t<T>>(parts);
+    for_each_part(policy, num_rows, parts, [&](std::size_t part, std::size_t first_row, std::size_t last_row)
+    {
+        auto distances = std::vector<T>(k);
+        for (auto i = first_row; i < last_row; ++i)
+        {
+            const auto row = first + static_cast<std::ptrdiff_t>(i * dimension);
+            euclidean::squared_distances(row, row + static_cast<std::ptrdiff_t>(dimension), centroids.begin(),
+                distances.begin(), distances.end());
+            const auto nearest = find_nearest_two(distances);
+            labels[i] = nearest.index;
+            inertias[part] += nearest.first;
+        }
+    });
+    auto inertia = accumulator_t<T>{0};
+    for (const auto value : inertias)
+    {
+        inertia += value;
+    }
+    return static_cast<T>(inertia);
+}
+
+/** Assigns each row of a matrix to its nearest centroid, with an execution policy.
+The matrix is a container with rows of `dimension` elements. Returns the inertia.
+*/
+template<typename Tag, typename Container, typename T = value_type<Container>>
+T assign(execution::policy<Tag> policy, const Container& data, std::size_t dimension,
+    const std::vector<T>& centroids, std::vector<std::size_t>& labels)
+{
+    assert(dimension > 0 && data.size() % dimension == 0);
+    using std::begin;
+    using std::end;
+    return assign(policy, begin(data), end(data), dimension, centroids, labels);
+}
+
+/** Assigns each row of a matrix to its nearest centroid. Returns the inertia. */
+template<typename RandomAccessIterator, typename T = value_type_i<RandomAccessIterator>>
+T assign(RandomAccessIterator first, RandomAccessIterator last, std::size_t dimension,
+    const std::vector<T>& centroids, std::vector<std::size_t>& labels)
+{
+    return assign(execution::seq, first, last, dimension, centroids, labels);
+}
+
+/** Assigns each row of a matrix to its nearest centroid. Returns the inertia. */
+template<typename Container, typename T = value_type<Container>>
+T assign(const Container& data, std::size_t dimension, const std::vector<T>& centroids, std::vector<std::size_t>& labels)
+{
+    return assign(execution::seq, data, dimension, centroids, labels);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** Lloyd's k-means from the given centroids, with an execution policy.
+The matrix is a range of random access iterators with rows of `dimension` elements,
+and the centroids are stored row by row. Stops when no row changes centroid, or after
+`max_iterations`. A centroid that has no rows keeps its position. The labels and the
+inertia are those of the returned centroids: when the iterations run out, the rows are
+assigned to them once more.
+*/
+template<typename Tag, typename RandomAccessIterator, typename T = value_type_i<RandomAccessIterator>>
+clusters<T> lloyd(execution::policy<Tag> policy, RandomAccessIterator first, RandomAccessIterator last,
+    std::size_t dimension, std::vector<T> centroids, std::size_t max_iterations = 100)
+{
+    static_assert(std::is_floating_point<T>::value, "The elements should have a floating point type");
+    assert(dimension > 0 && !centroids.empty() && centroids.size() % dimension == 0);
+    using A = accumulator_t<T>;
+    const auto num_rows = static_cast<std::size_t>(std::distance(first, last)) / dimension;
+    const auto k = centroids.size() / dimension;
+    const auto d = static_cast<std::ptrdiff_t>(dimension);
+    const auto row = [&](std::size_t i) { return first + static_cast<std::ptrdiff_t>(i) * d; };
+    const auto centroid = [&](const std::vector<T>& c, std::size_t j) { return c.begin() + static_cast<std::ptrdiff_t>(j) * d; };
+
+    auto labels = std::vector<std::size_t>(num_rows);
+    auto upper = std::vector<T>(num_rows);
+    auto lower = std::vector<T>(num_rows);
+    const auto parts = num_parts(num_rows, k * dimension);
+    auto sums = std::vector<std::vector<A>>(parts, std::vector<A>(k * dimension));
+    auto counts = std::vector<std::vector<std::size_t>>(parts, std::vector<std::size_t>(k));
+    auto changes = std::vector<std::size_t>(parts);
+    auto half_gaps = std::vector<T>(k);
+    auto moves = std::vector<T>(k);
+    auto next = centroids;
+
+    auto iteration = std::size_t{0};
+    auto converged = false;
+    while (iteration < max_iterations)
+    {
+        const auto first_iteration = iteration == 0;
+        ++iteration;
+
+        // Half the distance of each centroid to its nearest other centroid.
+        pairwise::for_each_tile(policy, k, [&](std::ptrdiff_t c)
+        {
+            auto distances = std::vector<T>(k);
+            euclidean::squared_distances(centroid(centroids, c), centroid(centroids, c + 1), centroids.begin(),
+                distances.begin(), distances.end());
+            distances[c] = std::numeric_limits<T>::infinity();
+            half_gaps[c] = std::sqrt(*std::min_element(distances.begin(), distances.end())) / 2;
+        });
+
+        for_each_part(policy, num_rows, parts, [&](std::size_t part, std::size_t first_row, std::size_t last_row)
+        {
+            auto distances = std::vector<T>(k);
+            auto& part_sums = sums[part];
+            auto& part_counts = counts[part];
+            std::fill(part_sums.begin(), part_sums.end(), A{0});
+            std::fill(part_counts.begin(), part_counts.end(), std::size_t{0});
+            changes[part] = 0;
+            for (auto i = first_row; i < last_row; ++i)
+            {
+                const auto x = row(i);
+                const auto bound = std::max(half_gaps[labels[i]], lower[i]);
+                if (first_iteration || upper[i] > bound)
+                {
+                    if (!first_iteration)
+                    {
+                        upper[i] = std::sqrt(euclidean::squared_distance(x, x + d, centroid(centroids, labels[i])));
+                    }
+                    if (first_iteration || upper[i] > bound)
+                    {
+                        euclidean::squared_distances(x, x + d, centroids.begin(), distances.begin(), distances.end());
+                        const auto nearest = find_nearest_two(distances);
+                        changes[part] += nearest.index != labels[i];
+                        labels[i] = nearest.index;
+                        upper[i] = std::sqrt(nearest.first);
+                        lower[i] = std::sqrt(nearest.second);
+                    }
+                }
+                const auto label = labels[i];
+                ++part_counts[label];
+                auto sum = part_sums.begin() + static_cast<std::ptrdiff_t>(label) * d;
+                for (auto j = std::ptrdiff_t{0}; j < d; ++j)
+                {
+                    sum[j] += static_cast<A>(x[j]);
+                }
+            }
+        });
+
+        auto num_changes = std::size_t{0};
+        for (const auto value : changes)
+        {
+            num_changes += value;
+        }
+        if (!first_iteration && num_changes == 0)
+        {
+            converged = true;
+            break;
+        }
+
+        // Move each centroid to the mean of its rows, adding up the parts in order.
+        pairwise::for_each_tile(policy, k, [&](std::ptrdiff_t c)
+        {
+            auto count = std::size_t{0};
+            for (auto p = std::size_t{0}; p < parts; ++p)
+            {
+                count += counts[p][c];
+            }
+            auto out = next.begin() + c * d;
+            for (auto j = std::ptrdiff_t{0}; j < d && count > 0; ++j)
+            {
+                auto sum = A{0};
+                for (auto p = std::size_t{0}; p < parts; ++p)
+                {
+                    sum += sums[p][c * d + j];
+                }
+                out[j] = static_cast<T>(sum / static_cast<A>(count));
+            }
+            moves[c] = std::sqrt(euclidean::squared_distance(out, out + d, centroid(centroids, c)));
+        });
+        centroids.swap(next);
+        std::copy(centroids.begin(), centroids.end(), next.begin());
+
+        // Widen the bounds by the moves of the centroids.
+        const auto farthest = static_cast<std::size_t>(std::max_element(moves.begin(), moves.end()) - moves.begin());
+        auto second_move = T{0};
+        for (auto c = std::size_t{0}; c < k; ++c)
+        {
+            second_move = c == farthest ? second_move : std::max(second_move, moves[c]);
+        }
+        for_each_part(policy, num_rows, parts, [&](std::size_t, std::size_t first_row, std::size_t last_row)
+        {
+            for (auto i = first_row; i < last_row; ++i)
+            {
+                upper[i] += moves[labels[i]];
+                lower[i] -= labels[i] == farthest ? second_move : moves[farthest];
+            }
+        });
+    }
+
+    // After the last iteration the labels are those of the previous centroids.
+    if (!converged)
+    {
+        assign(policy, first, last, dimension, centroids, labels);
+    }
+
+    auto inertias = std::vector<A>(parts);
+    for_each_part(policy, num_rows, parts, [&](std::size_t part, std::size_t first_row, std::size_t last_row)
+    {
+        for (auto i = first_row; i < last_row; ++i)
+        {
+            inertias[part] += euclidean::squared_distance(row(i), row(i + 1), centroid(centroids, labels[i]));
+        }
+    });
+    auto inertia = A{0};
+    for (const auto value : inertias)
+    {
+        inertia += value;
+    }
+    return {std::move(centroids), std::move(labels), static_cast<T>(inertia), iteration};
+}
+
+/** Lloyd's k-means from the given centroids, with an execution policy.
+The matrix is a container with rows of `dimension` elements.
+*/
+template<typename Tag, typename Container, typename T = value_type<Container>>
+clusters<T> lloyd(execution::policy<Tag> policy, const Container& data, std::size_t dimension,
+    std::vector<T> centroids, std::size_t max_iterations = 100)
+{
+    assert(dimension > 0 && data.size() % dimension == 0);
+    using std::begin;
+    using std::end;
+    return lloyd(policy, begin(data), end(data), dimension, std::move(centroids), max_iterations);
+}
+
+/** Lloyd's k-means from the given centroids.
+The matrix is a range of random access iterators with rows of `dimension` elements.
+*/
+template<typename RandomAccessIterator, typename T = value_type_i<RandomAccessIterator>>
+clusters<T> lloyd(RandomAccessIterator first, RandomAccessIterator last, std::size_t dimension,
+    std::vector<T> centroids, std::size_t max_iterations = 100)
+{
+    return lloyd(execution::seq, first, last, dimension, std::move(centroids), max_iterations);
+}
+
+/** Lloyd's k-means from the given centroids.
+The matrix is a container with rows of `dimension` elements.
+*/
+template<typename Container, typename T = value_type<Container>>
+clusters<T> lloyd(const Container& data, std::size_t dimension, std::vector<T> centroids, std::size_t max_iterations = 100)
+{
+    return lloyd(execution::seq, data, dimension, std::move(centroids), max_iterations);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** k-means with `k` clusters, seeded by k-means++, with an execution policy.
+The matrix is a range of random access iterators with rows of `dimension`
+elements, and should have at least `k` rows.
+*/
+template<typename Tag, typename RandomAccessIterator, typename T = value_type_i<RandomAccessIterator>>
+clusters<T> fit(execution::policy<Tag> policy, RandomAccessIterator first, RandomAccessIterator last,
+    std::size_t dimension, std::size_t k, std::size_t max_iterations = 100, std::uint64_t seed = 0)
+{
+    return lloyd(policy, first, last, dimension, seed_centroids(policy, first, last, dimension, k, seed), max_iterations);
+}
+
+/** k-means with `k` clusters, seeded by k-means++, with an execution policy.
+The matrix is a container with rows of `dimension` elements.
+*/
+template<typename Tag, typename Container, typename T = value_type<Container>>
+clusters<T> fit(execution::policy<Tag> policy, const Container& data, std::size_t dimension,
+    std::size_t k, std::size_t max_iterations = 100, std::uint64_t seed = 0)
+{
+    assert(dimension > 0 && data.size() % dimension == 0);
+    using std::begin;
+    using std::end;
+    return fit(policy, begin(data), end(data), dimension, k, max_iterations, seed);
+}
+
+/** k-means with `k` clusters, seeded by k-means++.
+The matrix is a range of random access iterators with rows of `dimension` elements.
+*/
+template<typename RandomAccessIterator, typename T = value_type_i<RandomAccessIterator>>
+clusters<T> fit(RandomAccessIterator first, RandomAccessIterator last, std::size_t dimension,
+    std::size_t k, std::size_t max_iterations = 100, std::uint64_t seed = 0)
+{
+    return fit(execution::seq, first, last, dimension, k, max_iterations, seed);
+}
+
+/** k-means with `k` clusters, seeded by k-means++.
+The matrix is a container with rows of `dimension` elements.
+*/
+template<typename Container, typename T = value_type<Container>>
+clusters<T> fit(const Container& data, std::size_t dimension, std::size_t k,
+    std::size_t max_iterations = 100, std::uint64_t seed = 0)
+{
+    return fit(execution::seq, data, dimension, k, max_iterations, seed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** Mini-batch k-means with `k` clusters, with an execution policy.
+The matrix is a range of random access iterators with rows of `dimension` elements,
+and should have at least `k` rows. The centroids are seeded by k-means++ on a sample of
+`3 * batch_size` rows. Each of the `iterations` draws `batch_size` random rows, assigns
+them in parallel, and moves the centroid of each row towards it by the inverse of
+the number of rows the centroid has had so far. At the end all the rows are assigned.
+*/
+template<typename Tag, typename RandomAccessIterator, typename T = value_type_i<RandomAccessIterator>>
+clusters<T> fit_minibatch(execution::policy<Tag> policy, RandomAccessIterator first, RandomAccessIterator last,
+    std::size_t dimension, std::size_t k, std::size_t batch_size, std::size_t iterations, std::uint64_t seed = 0)
+{
+    assert(dimension > 0 && batch_size > 0);
+    const auto num_rows = static_cast<std::size_t>(std::distance(first, last)) / dimension;
+    assert(k > 0 && k <= num_rows);
+    const auto d = static_cast<std::ptrdiff_t>(dimension);
+    auto random = std::mt19937_64(seed);
+    auto pick = std::uniform_int_distribution<std::size_t>(0, num_rows - 1);
+    const auto sample_rows = [&](std::size_t size)
+    {
+        auto sample = std::vector<T>(size * dimension);
+        for (auto i = std::size_t{0}; i < size; ++i)
+        {
+            std::copy_n(first + static_cast<std::ptrdiff_t>(pick(random)) * d, d,
+                sample.begin() + static_cast<std::ptrdiff_t>(i) * d);
+        }
+        return sample;
+    };
+
+    auto centroids = std::vector<T>();
+    if (num_rows <= std::max(k, 3 * batch_size))
+    {
+        centroids = seed_centroids(policy, first, last, dimension, k, random());
+    }
+    else
+    {
+        const auto sample = sample_rows(std::max(k, 3 * batch_size));
+        centroids = seed_centroids(policy, sample, dimension, k, random());
+    }
+
+    auto counts = std::vector<std::size_t>(k);
+    auto labels = std::vector<std::size_t>(batch_size);
+    for (auto iteration = std::size_t{0}; iteration < iterations; ++iteration)
+    {
+        const auto batch = sample_rows(batch_size);
+        assign(policy, batch, dimension, centroids, labels);
+        for (auto i = std::size_t{0}; i < batch_size; ++i)
+        {
+            const auto c = labels[i];
+            const auto rate = T(1) / static_cast<T>(++counts[c]);
+            const auto x = batch.begin() + static_cast<std::ptrdiff_t>(i) * d;
+            const auto out = centroids.begin() + static_cast<std::ptrdiff_t>(c) * d;
+            for (auto j = std::ptrdiff_t{0}; j < d; ++j)
+            {
+                out[j] += rate * (x[j] - out[j]);
+            }
+        }
+    }
+
+    labels.resize(num_rows);
+    const auto inertia = assign(policy, first, last, dimension, centroids, labels);
+    return {std::move(centroids), std::move(labels), inertia, iterations};
+}
+
+/** Mini-batch k-means with `k` clusters, with an execution policy.
+The matrix is a container with rows of `dimension` elements.
+*/
+template<typename Tag, typename Container, typename T = value_type<Container>>
+clusters<T> fit_minibatch(execution::policy<Tag> policy, const Container& data, std::size_t dimension,
+    std::size_t k, std::size_t batch_size, std::size_t iterations, std::uint64_t seed = 0)
+{
+    assert(dimension > 0 && data.size() % dimension == 0);
+    using std::begin;
+    using std::end;
+    return fit_minibatch(policy, begin(data), end(data), dimension, k, batch_size, iterations, seed);
+}
+
+/** Mini-batch k-means with `k` clusters.
+The matrix is a range of random access iterators with rows of `dimension` elements.
+*/
+template<typename RandomAccessIterator, typename T = value_type_i<RandomAccessIterator>>
+clusters<T> fit_minibatch(RandomAccessIterator first, RandomAccessIterator last, std::size_t dimension,
+    std::size_t k, std::size_t batch_size, std::size_t iterations, std::uint64_t seed = 0)
+{
+    return fit_minibatch(execution::seq, first, last, dimension, k, batch_size, iterations, seed);
+}
+
+/** Mini-batch k-means with `k` clusters.
+The matrix is a container with rows of `dimension` elements.
+*/
+template<typename Container, typename T = value_type<Container>>
+clusters<T> fit_minibatch(const Container& data, std::size_t dimension, std::size_t k,
+    std::size_t batch_size, std::size_t iterations, std::uint64_t seed = 0)
+{
+    return fit_minibatch(execution::seq, data, dimension, k, batch_size, iterations, seed);
+}
+
+/** @} */
+
+} // namespace kmeans
+} // namespace aaa
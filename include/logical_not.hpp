@@ -1,7 +1,12 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
 #include <functional>
+#include <iterator>
+
+#include "parallel.hpp"
+#include "traits.hpp"
 
 namespace aaa {
 
@@ -31,7 +36,7 @@ void logical_not(InputIterator first_in, InputIterator last_in, OutputIterator f
     std::transform(first_in, last_in, first_out, std::logical_not<bool>());
 }
 
-template<typename Container1, typename Container2>
+template<typename Container1, typename Container2, check_container<Container1> = nullptr>
 void logical_not(const Container1& in, Container2& out)
 {
     using namespace std;
@@ -46,6 +51,31 @@ Container logical_not(const Container& in)
     return out;
 }
 
+
+template<typename Tag, typename InputIterator, typename OutputIterator>
+void logical_not(execution::policy<Tag> policy, InputIterator first_in, InputIterator last_in, OutputIterator first_out)
+{
+    execution::parallel_for(policy, std::distance(first_in, last_in), [&](std::ptrdiff_t first, std::ptrdiff_t last)
+    {
+        aaa::logical_not(first_in + first, first_in + last, first_out + first);
+    });
+}
+
+template<typename Tag, typename Container1, typename Container2>
+void logical_not(execution::policy<Tag> policy, const Container1& in, Container2& out)
+{
+    using namespace std;
+    aaa::logical_not(policy, begin(in), end(in), begin(out));
+}
+
+template<typename Tag, typename Container>
+Container logical_not(execution::policy<Tag> policy, const Container& in)
+{
+    auto out = in;
+    aaa::logical_not(policy, in, out);
+    return out;
+}
+
 /** @} */
 
 } // namespace aaa
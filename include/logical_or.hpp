@@ -1,7 +1,12 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
 #include <functional>
+#include <iterator>
+
+#include "parallel.hpp"
+#include "traits.hpp"
 
 namespace aaa {
 
@@ -33,7 +38,7 @@ void logical_or(InputIterator1 first_left, InputIterator1 last_left, InputIterat
     std::transform(first_left, last_left, first_right, first_out, std::logical_or<bool>());
 }
 
-template<typename Container1, typename Container2, typename Container3>
+template<typename Container1, typename Container2, typename Container3, check_container<Container1> = nullptr>
 void logical_or(const Container1& left, const Container2& right, Container3& out)
 {
     using namespace std;
@@ -48,6 +53,32 @@ Container logical_or(const Container& left, const Container& right)
     return out;
 }
 
+
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void logical_or(execution::policy<Tag> policy,
+    InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, OutputIterator first_out)
+{
+    execution::parallel_for(policy, std::distance(first_left, last_left), [&](std::ptrdiff_t first, std::ptrdiff_t last)
+    {
+        aaa::logical_or(first_left + first, first_left + last, first_right + first, first_out + first);
+    });
+}
+
+template<typename Tag, typename Container1, typename Container2, typename Container3>
+void logical_or(execution::policy<Tag> policy, const Container1& left, const Container2& right, Container3& out)
+{
+    using namespace std;
+    aaa::logical_or(policy, begin(left), end(left), begin(right), begin(out));
+}
+
+template<typename Tag, typename Container>
+Container logical_or(execution::policy<Tag> policy, const Container& left, const Container& right)
+{
+    auto out = left;
+    aaa::logical_or(policy, left, right, out);
+    return out;
+}
+
 /** @} */
 
 } // namespace aaa
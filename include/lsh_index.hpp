@@ -0,0 +1,515 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "euclidean_space.hpp"
+#include "neighbors.hpp"
+#include "operations.hpp"
+#include "pairwise.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "traits.hpp"
+
+namespace aaa {
+namespace lsh {
+
+/**
+@addtogroup lsh_index
+
+Locality-sensitive hashing finds approximate nearest neighbors of a query in
+data of high dimension, where the spatial indexes of @ref spatial_index do not
+prune, by only comparing the query with the points that hash to the same buckets.
+The points are a matrix that is stored row by row, like in @ref pairwise.
+The hash family is a parameter of `hash_index<T, Family>`:
+- `cosine_hash` is random-projection hashing (SimHash) for the cosine distance.
+  A hash is the sign of the dot product with a random normal vector, so it is one
+  bit, and the probability that two vectors have different bits grows with their angle.
+- `euclidean_hash` is p-stable hashing for the Euclidean distance. A hash is
+  \f$ \lfloor (a \cdot x + b) / w \rfloor \f$ for a random normal vector `a`, a
+  random offset `b` in `[0, w)` and the bucket width `w`.
+
+Each of the `num_tables` hash tables concatenates `num_hashes` hashes into the key
+of a bucket. The buckets of a table are stored in flat arrays: the keys in sorted
+order, and for each bucket the indices of its points, which are found by a binary
+search of the key.
+
+A query probes the bucket of its own key in each table, and, with multi-probe,
+the `num_probes - 1` nearby buckets that are most likely to have its neighbors.
+They differ by one or more hashes that are closest to their boundaries, and are
+generated in the order of the sum of the squared distances to the boundaries.
+The points of all the probed buckets are candidates, which are re-ranked by
+their exact distances, `euclidean::distance` or `euclidean::cosine_distance`.
+
+The parameters trade the recall for the latency:
+- More tables find more neighbors, at the cost of memory and more candidates.
+- More hashes make smaller buckets, with fewer candidates and fewer neighbors.
+- More probes find more neighbors with the same tables, at the cost of more candidates.
+- A wider `euclidean_hash` makes larger buckets. It should be about the distance
+  of the neighbors that are searched for.
+
+The projections of the points are computed by the SIMD tile kernels of @ref pairwise,
+and with a parallel execution policy the points are hashed, and the tables are
+sorted, on the threads of the shared pool. The index is the same for all policies.
+The random projections come from a random generator with a `seed`.
+
+Example:
+```
+// 1000000 points and 1000 queries of 128 floats.
+std::vector<float> points(1000000 * 128);
+std::vector<float> queries(1000 * 128);
+
+using namespace aaa;
+
+// 8 tables of 16 hashes, with a bucket width of 4.
+const auto index = lsh::hash_index<float, lsh::euclidean_hash>(
+    execution::par, points, 128, lsh::euclidean_hash{4}, 8, 16);
+
+// The 10 nearest candidates of each query, from 20 probes per table.
+// Missing neighbors have the index lsh::no_neighbor.
+std::vector<std::uint32_t> indices(1000 * 10);
+std::vector<float> distances(1000 * 10);
+lsh::nearest_neighbors(execution::par, index, queries, 10, 20, indices, distances);
+```
+
+@{
+*/
+
+/** The type of the indices of the points. */
+using index_type = std::uint32_t;
+
+/** The index of the neighbors that are not found. */
+constexpr index_type no_neighbor = std::numeric_limits<index_type>::max();
+
+/** A change of one hash of a key, and its squared distance to the boundary of the hash. */
+struct perturbation
+{
+    std::size_t hash;
+    std::int64_t delta;
+    double score;
+};
+
+/** Random-projection hashing (SimHash) for the cosine distance. */
+struct cosine_hash
+{
+    template<typename T>
+    T offset(std::mt19937_64&) const { return T{0}; }
+
+    template<typename T>
+    std::int64_t hash(T projection, T) const { return projection >= 0 ? 1 : 0; }
+
+    /** Flips the bit, with the squared projection as score. */
+    template<typename T, typename Push>
+    void perturb(T projection, T, std::int64_t value, Push push) const
+    {
+        push(value == 1 ? -1 : 1, double(projection) * double(projection));
+    }
+
+    template<typename InputIterator1, typename InputIterator2, typename T = value_type_i<InputIterator1>>
+    sqrt_type_t<T> distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right) const
+    {
+        return euclidean::cosine_distance(first_left, last_left, first_right);
+    }
+};
+
+/** p-stable hashing for the Euclidean distance, with buckets of `width`. */
+struct euclidean_hash
+{
+    double width;
+
+    template<typename T>
+    T offset(std::mt19937_64& random) const
+    {
+        return T(std::uniform_real_distribution<double>(0, width)(random));
+    }
+
+    template<typename T>
+    std::int64_t hash(T projection, T offset) const
+    {
+        return static_cast<std::int64_t>(std::floor((double(projection) + double(offset)) / width));
+    }
+
+    /** Moves to the lower and the upper bucket, with the squared distances to their boundaries as scores. */
+    template<typename T, typename Push>
+    void perturb(T projection, T offset, std::int64_t value, Push push) const
+    {
+        const auto fraction = (double(projection) + double(offset)) / width - double(value);
+        push(-1, fraction * fraction);
+        push(1, (1 - fraction) * (1 - fraction));
+    }
+
+    template<typename InputIterator1, typename InputIterator2, typename T = value_type_i<InputIterator1>>
+    sqrt_type_t<T> distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right) const
+    {
+        return euclidean::distance(first_left, last_left, first_right);
+    }
+};
+
+/** Calls `probe(set)` for the `num_probes - 1` first sets of the perturbations, that are
+sorted by score, in the order of the sum of their scores. A set is a vector of indices of
+the perturbations, and has at most one perturbation of each hash. The sets are generated
+by shifting the last index of a set, or appending the next index, like Lv et al.
+*/
+template<typename Probe>
+void for_each_probe(const std::vector<perturbation>& perturbations, std::size_t num_probes, Probe probe)
+{
+    using scored_set = std::pair<double, std::vector<std::size_t>>;
+    const auto greater = [](const scored_set& a, const scored_set& b) { return a.first > b.first; };
+    auto heap = std::priority_queue<scored_set, std::vector<scored_set>, decltype(greater)>(greater);
+    if (perturbations.empty() || num_probes <= 1)
+    {
+        return;
+    }
+    heap.push({perturbations[0].score, {0}});
+    auto num_found = std::size_t{1};
+    while (!heap.empty() && num_found < num_probes)
+    {
+        auto set = heap.top();
+        heap.pop();
+        const auto last = set.second.back();
+        if (last + 1 < perturbations.size())
+        {
+            auto expanded = set;
+            expanded.first += perturbations[last + 1].score;
+            expanded.second.push_back(last + 1);
+            heap.push(std::move(expanded));
+            auto shifted = set;
+            shifted.first += perturbations[last + 1].score - perturbations[last].score;
+            shifted.second.back() = last + 1;
+            heap.push(std::move(shifted));
+        }
+        auto valid = true;
+        for (auto i = std::size_t{0}; valid && i + 1 < set.second.size(); ++i)
+        {
+            for (auto j = i + 1; valid && j < set.second.size(); ++j)
+            {
+                valid = perturbations[set.second[i]].hash != perturbations[set.second[j]].hash;
+            }
+        }
+        if (valid)
+        {
+            probe(set.second);
+            ++num_found;
+        }
+    }
+}
+
+/** An index of points of type `T` in hash tables of a hash family. */
+template<typename T, typename Family>
+class hash_index
+{
+public:
+    /** Hashes the points in the range of iterators in `num_tables` tables of `num_hashes` hashes,
+    with an execution policy.
+    */
+    template<typename Tag, typename InputIterator>
+    hash_index(execution::policy<Tag> policy, InputIterator first, InputIterator last, std::size_t dimension,
+        Family family, std::size_t num_tables, std::size_t num_hashes, std::uint64_t seed = 0)
+        : dimension_(dimension), num_tables_(num_tables), num_hashes_(num_hashes), family_(family),
+        points_(first, last)
+    {
+        assert(dimension > 0 && num_tables > 0 && num_hashes > 0);
+        assert(points_.size() % dimension == 0);
+        const auto size = points_.size() / dimension;
+        assert(size < no_neighbor);
+        const auto num_projections = num_tables * num_hashes;
+        auto random = std::mt19937_64(seed);
+        auto normal = std::normal_distribution<double>();
+        projections_.resize(num_projections * dimension);
+        for (auto& x : projections_)
+        {
+            x = T(normal(random));
+        }
+        offsets_.resize(num_projections);
+        multipliers_.resize(num_projections);
+        for (auto j = std::size_t{0}; j < num_projections; ++j)
+        {
+            offsets_[j] = family_.template offset<T>(random);
+            multipliers_[j] = random() | 1;
+        }
+
+        // The keys of the points, table after table.
+        auto keys = std::vector<std::uint64_t>(num_tables * size);
+        const auto num_blocks = (size + pairwise::tile_rows - 1) / pairwise::tile_rows;
+        pairwise::for_each_tile(policy, num_blocks, [&](std::ptrdiff_t block)
+        {
+            const auto first_row = static_cast<std::size_t>(block) * pairwise::tile_rows;
+            const auto rows = std::min(pairwise::tile_rows, size - first_row);
+            auto projections = std::vector<T>(rows * num_projections);
+            project(point(first_row), rows, projections.begin());
+            for (auto i = std::size_t{0}; i < rows; ++i)
+            {
+                for (auto t = std::size_t{0}; t < num_tables; ++t)
+                {
+                    keys[t * size + first_row + i] = key(projections.begin() +
+                        static_cast<std::ptrdiff_t>(i * num_projections), t);
+                }
+            }
+        });
+
+        // The buckets of each table, sorted by key and then by index.
+        auto table_keys = std::vector<std::vector<std::uint64_t>>(num_tables);
+        auto table_starts = std::vector<std::vector<index_type>>(num_tables);
+        indices_.resize(num_tables * size);
+        pairwise::for_each_tile(policy, num_tables, [&](std::ptrdiff_t t)
+        {
+            auto entries = std::vector<std::pair<std::uint64_t, index_type>>(size);
+            for (auto i = std::size_t{0}; i < size; ++i)
+            {
+                entries[i] = {keys[static_cast<std::size_t>(t) * size + i], static_cast<index_type>(i)};
+            }
+            std::sort(entries.begin(), entries.end());
+            for (auto i = std::size_t{0}; i < size; ++i)
+            {
+                if (i == 0 || entries[i].first != entries[i - 1].first)
+                {
+                    table_keys[t].push_back(entries[i].first);
+                    table_starts[t].push_back(static_cast<index_type>(i));
+                }
+                indices_[static_cast<std::size_t>(t) * size + i] = entries[i].second;
+            }
+        });
+        table_offsets_.push_back(0);
+        for (auto t = std::size_t{0}; t < num_tables; ++t)
+        {
+            bucket_keys_.insert(bucket_keys_.end(), table_keys[t].begin(), table_keys[t].end());
+            bucket_starts_.insert(bucket_starts_.end(), table_starts[t].begin(), table_starts[t].end());
+            table_offsets_.push_back(bucket_keys_.size());
+        }
+    }
+
+    /** Hashes the points in the container, with an execution policy. */
+    template<typename Tag, typename Container>
+    hash_index(execution::policy<Tag> policy, const Container& points, std::size_t dimension,
+        Family family, std::size_t num_tables, std::size_t num_hashes, std::uint64_t seed = 0)
+        : hash_index(policy, std::begin(points), std::end(points), dimension, family, num_tables, num_hashes, seed)
+    {
+    }
+
+    /** Hashes the points in the range of iterators. */
+    template<typename InputIterator>
+    hash_index(InputIterator first, InputIterator last, std::size_t dimension,
+        Family family, std::size_t num_tables, std::size_t num_hashes, std::uint64_t seed = 0)
+        : hash_index(execution::seq, first, last, dimension, family, num_tables, num_hashes, seed)
+    {
+    }
+
+    /** Hashes the points in the container. */
+    template<typename Container>
+    hash_index(const Container& points, std::size_t dimension,
+        Family family, std::size_t num_tables, std::size_t num_hashes, std::uint64_t seed = 0)
+        : hash_index(execution::seq, points, dimension, family, num_tables, num_hashes, seed)
+    {
+    }
+
+    std::size_t dimension() const { return dimension_; }
+    std::size_t size() const { return points_.size() / dimension_; }
+    std::size_t num_tables() const { return num_tables_; }
+    std::size_t num_hashes() const { return num_hashes_; }
+
+    /** The number of buckets of all the tables. */
+    std::size_t num_buckets() const { return bucket_keys_.size(); }
+
+    const std::vector<T>& points() const { return points_; }
+
+    /** Appends the indices of the points in the buckets of the query, and of `num_probes - 1`
+    nearby buckets, of each table. The indices are sorted, without duplicates.
+    */
+    template<typename InputIterator>
+    void candidates(InputIterator query, std::size_t num_probes, std::vector<index_type>& out) const
+    {
+        const auto num_projections = num_tables_ * num_hashes_;
+        auto projections = std::vector<T>(num_projections);
+        const auto query_row = std::vector<T>(query, std::next(query, static_cast<std::ptrdiff_t>(dimension_)));
+        project(query_row.begin(), 1, projections.begin());
+        const auto first_out = out.size();
+        auto perturbations = std::vector<perturbation>();
+        for (auto t = std::size_t{0}; t < num_tables_; ++t)
+        {
+            const auto base = key(projections.begin(), t);
+            append_bucket(t, base, out);
+            if (num_probes <= 1)
+            {
+                continue;
+            }
+            perturbations.clear();
+            for (auto h = std::size_t{0}; h < num_hashes_; ++h)
+            {
+                const auto j = t * num_hashes_ + h;
+                const auto value = family_.hash(projections[j], offsets_[j]);
+                family_.perturb(projections[j], offsets_[j], value, [&](std::int64_t delta, double score)
+                {
+                    perturbations.push_back({h, delta, score});
+                });
+            }
+            std::sort(perturbations.begin(), perturbations.end(), [](const perturbation& a, const perturbation& b)
+            {
+                return a.score < b.score;
+            });
+            for_each_probe(perturbations, num_probes, [&](const std::vector<std::size_t>& set)
+            {
+                auto probe = base;
+                for (const auto p : set)
+                {
+                    const auto& change = perturbations[p];
+                    probe += multipliers_[t * num_hashes_ + change.hash] * static_cast<std::uint64_t>(change.delta);
+                }
+                append_bucket(t, probe, out);
+            });
+        }
+        std::sort(out.begin() + static_cast<std::ptrdiff_t>(first_out), out.end());
+        out.erase(std::unique(out.begin() + static_cast<std::ptrdiff_t>(first_out), out.end()), out.end());
+    }
+
+    /** Writes the indices and the distances of the `k` nearest candidates of the query,
+    from the nearest to the farthest, and returns their number. Equal distances are ordered by index.
+    */
+    template<typename InputIterator, typename IndexIterator, typename DistanceIterator>
+    std::size_t nearest(InputIterator query, std::size_t k, std::size_t num_probes,
+        IndexIterator first_index, DistanceIterator first_distance) const
+    {
+        if (k == 0)
+        {
+            return 0;
+        }
+        auto found = std::vector<index_type>();
+        candidates(query, num_probes, found);
+        const auto query_row = std::vector<T>(query, std::next(query, static_cast<std::ptrdiff_t>(dimension_)));
+        using D = value_type_i<DistanceIterator>;
+        auto heap = neighbors::bounded_heap<D>(k);
+        for (const auto i : found)
+        {
+            heap.push(D(family_.distance(query_row.begin(), query_row.end(), point(i))), i);
+        }
+        const auto sorted = heap.take_sorted();
+        for (const auto& candidate : sorted)
+        {
+            *first_index = static_cast<value_type_i<IndexIterator>>(candidate.second);
+            *first_distance = candidate.first;
+            ++first_index;
+            ++first_distance;
+        }
+        return sorted.size();
+    }
+
+private:
+    typename std::vector<T>::const_iterator point(std::size_t i) const
+    {
+        return points_.begin() + static_cast<std::ptrdiff_t>(i * dimension_);
+    }
+
+    /** The projections of `rows` rows on all the random vectors, row after row. */
+    template<typename InputIterator, typename OutputIterator>
+    void project(InputIterator first_row, std::size_t rows, OutputIterator first_out) const
+    {
+        const auto num_projections = num_tables_ * num_hashes_;
+        simd::tile_distances<operations::plus, operations::multiplies>(first_row, rows, projections_.begin(),
+            num_projections, dimension_, first_out, num_projections);
+    }
+
+    /** The key of table `t` is a sum of its hashes times random odd multipliers. */
+    template<typename InputIterator>
+    std::uint64_t key(InputIterator projections, std::size_t t) const
+    {
+        auto result = std::uint64_t{0};
+        for (auto h = std::size_t{0}; h < num_hashes_; ++h)
+        {
+            const auto j = t * num_hashes_ + h;
+            result += multipliers_[j] * static_cast<std::uint64_t>(family_.hash(projections[j], offsets_[j]));
+        }
+        return result;
+    }
+
+    void append_bucket(std::size_t t, std::uint64_t key, std::vector<index_type>& out) const
+    {
+        const auto first = bucket_keys_.begin() + static_cast<std::ptrdiff_t>(table_offsets_[t]);
+        const auto last = bucket_keys_.begin() + static_cast<std::ptrdiff_t>(table_offsets_[t + 1]);
+        const auto bucket = std::lower_bound(first, last, key);
+        if (bucket == last || *bucket != key)
+        {
+            return;
+        }
+        const auto b = static_cast<std::size_t>(bucket - bucket_keys_.begin());
+        const auto start = bucket_starts_[b];
+        const auto end = b + 1 < table_offsets_[t + 1] ? bucket_starts_[b + 1] : static_cast<index_type>(size());
+        const auto table = indices_.begin() + static_cast<std::ptrdiff_t>(t * size());
+        out.insert(out.end(), table + start, table + end);
+    }
+
+    std::size_t dimension_;
+    std::size_t num_tables_;
+    std::size_t num_hashes_;
+    Family family_;
+    std::vector<T> points_;
+    std::vector<T> projections_;
+    std::vector<T> offsets_;
+    std::vector<std::uint64_t> multipliers_;
+    std::vector<std::uint64_t> bucket_keys_;
+    std::vector<index_type> bucket_starts_;
+    std::vector<std::size_t> table_offsets_;
+    std::vector<index_type> indices_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// batches of queries
+
+/** The number of queries of each task of the batches. */
+constexpr std::size_t query_block_size = 16;
+
+/** The `k` nearest candidates of each query, from `num_probes` buckets of each table,
+with an execution policy. The queries are a container with rows of the dimension of the index.
+The sizes of the indices and the distances should be `num_queries * k`. When a query has
+fewer than `k` candidates, the missing neighbors have the index `no_neighbor` and an
+infinite distance.
+*/
+template<typename Tag, typename Index, typename Container1, typename Container2, typename Container3>
+void nearest_neighbors(execution::policy<Tag> policy, const Index& index, const Container1& queries,
+    std::size_t k, std::size_t num_probes, Container2& indices, Container3& distances)
+{
+    const auto dimension = index.dimension();
+    assert(queries.size() % dimension == 0);
+    const auto num_queries = queries.size() / dimension;
+    assert(indices.size() == num_queries * k);
+    assert(distances.size() == indices.size());
+    using std::begin;
+    using D = value_type<Container3>;
+    const auto num_blocks = (num_queries + query_block_size - 1) / query_block_size;
+    pairwise::for_each_tile(policy, num_blocks, [&](std::ptrdiff_t block)
+    {
+        const auto first = static_cast<std::size_t>(block) * query_block_size;
+        const auto last = std::min(num_queries, first + query_block_size);
+        for (auto q = first; q < last; ++q)
+        {
+            const auto first_index = std::next(begin(indices), static_cast<std::ptrdiff_t>(q * k));
+            const auto first_distance = std::next(begin(distances), static_cast<std::ptrdiff_t>(q * k));
+            const auto found = index.nearest(std::next(begin(queries), static_cast<std::ptrdiff_t>(q * dimension)),
+                k, num_probes, first_index, first_distance);
+            std::fill(std::next(first_index, static_cast<std::ptrdiff_t>(found)),
+                std::next(first_index, static_cast<std::ptrdiff_t>(k)), static_cast<value_type<Container2>>(no_neighbor));
+            std::fill(std::next(first_distance, static_cast<std::ptrdiff_t>(found)),
+                std::next(first_distance, static_cast<std::ptrdiff_t>(k)), std::numeric_limits<D>::infinity());
+        }
+    });
+}
+
+/** The `k` nearest candidates of each query, from `num_probes` buckets of each table. */
+template<typename Index, typename Container1, typename Container2, typename Container3>
+void nearest_neighbors(const Index& index, const Container1& queries, std::size_t k, std::size_t num_probes,
+    Container2& indices, Container3& distances)
+{
+    nearest_neighbors(execution::seq, index, queries, k, num_probes, indices, distances);
+}
+
+/** @} */
+
+} // namespace lsh
+} // namespace aaa
@@ -2,7 +2,11 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <iterator>
 
+#include "parallel.hpp"
+#include "simd.hpp"
 #include "traits.hpp"
 
 namespace aaa {
@@ -28,14 +32,14 @@ template<typename Container>
 typename Container::iterator max_element(Container& container) {
     using std::begin;
     using std::end;
-    return std::max_element(begin(container), end(container));
+    return simd::max_element(begin(container), end(container));
 }
 
 template<typename Container>
 typename Container::const_iterator max_element(const Container& container) {
     using std::begin;
     using std::end;
-    return std::max_element(begin(container), end(container));
+    return simd::max_element(begin(container), end(container));
 }
 
 template<typename Container, typename Compare, check_compare<Compare, value_type<Container>> = nullptr>
@@ -66,4 +70,32 @@ typename Container::const_iterator max_element(const Container& container, Key k
     return aaa::max_element(begin(container), end(container), key);
 }
 
+/** Same as `std::max_element` with an execution policy.
+Returns the first of the maximal elements, like the sequential version.
+*/
+template<typename Tag, typename Iterator>
+Iterator max_element(execution::policy<Tag> policy, Iterator first, Iterator last) {
+    const auto f = [&](std::ptrdiff_t first_chunk, std::ptrdiff_t last_chunk, Iterator) {
+        return simd::max_element(first + first_chunk, first + last_chunk);
+    };
+    const auto combine = [](Iterator left, Iterator right) {
+        return *right > *left ? right : left;
+    };
+    return execution::parallel_reduce(policy, std::distance(first, last), first, first, f, combine);
+}
+
+template<typename Tag, typename Container>
+typename Container::iterator max_element(execution::policy<Tag> policy, Container& container) {
+    using std::begin;
+    using std::end;
+    return aaa::max_element(policy, begin(container), end(container));
+}
+
+template<typename Tag, typename Container>
+typename Container::const_iterator max_element(execution::policy<Tag> policy, const Container& container) {
+    using std::begin;
+    using std::end;
+    return aaa::max_element(policy, begin(container), end(container));
+}
+
 } // namespace aaa
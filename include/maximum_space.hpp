@@ -1,8 +1,18 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iterator>
 #include <numeric>
 
+#include "neighbors.hpp"
+#include "operations.hpp"
+#include "pairwise.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
 #include "traits.hpp"
 
 namespace aaa {
@@ -22,6 +32,10 @@ We represent mathematical vectors as either containers, or ranges of iterators.
 The functions in this module take one or two vectors as input and output a
 single scalar. This is sometimes refered to as a reduction or fold operation.
 
+The functions `distances` and `squared_distances` compare a query to each row of
+a matrix, stored row by row in a single range, and output one scalar per row.
+For contiguous floating point ranges they process several rows at a time, see @ref simd.
+
 @{
 */
 
@@ -123,6 +137,481 @@ T squared_distance(const Container1& left, const Container2& right, T init = T{}
     return squared_distance(begin(left), end(left), begin(right), init);
 }
 
+/** The maximum distance of two vectors, or a value greater than `bound` if the distance is greater.
+Each vector is represented by a range of iterators.
+The differences are checked one by one, or one group of registers at a time by
+the SIMD kernels. The function returns as soon as a difference is greater than
+`bound`, so that most of the work is skipped for the candidates that are
+rejected by a nearest neighbor search.
+*/
+template<typename InputIterator1, typename InputIterator2, typename T>
+T distance_bounded(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T bound)
+{
+    return simd::bounded_distance<operations::maximum, operations::absolute_difference>(first_left, last_left, first_right, bound);
+}
+
+/** The maximum distance of two vectors, or a value greater than `bound` if the distance is greater.
+Each vector is represented by a container.
+The two containers should have the same size.
+*/
+template<typename Container1, typename Container2, typename T>
+T distance_bounded(const Container1& left, const Container2& right, T bound)
+{
+    assert(left.size() == right.size());
+    using std::begin;
+    using std::end;
+    return distance_bounded(begin(left), end(left), begin(right), bound);
+}
+
+/** The maximum distances of a query to each row of a matrix.
+The matrix is a range of iterators that stores the rows one after the other,
+and each row has the size of the query. The number of rows is the size of the output.
+*/
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void distances(InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out)
+{
+    simd::row_distances<operations::maximum, operations::absolute_difference>(
+        first_query, last_query, first_matrix, first_out, last_out);
+}
+
+/** The maximum distances of a query to each row of a matrix.
+The query, the matrix and the output are containers.
+The size of the matrix should be the size of the query times the size of the output.
+*/
+template<typename Container1, typename Container2, typename Container3>
+void distances(const Container1& query, const Container2& matrix, Container3& out)
+{
+    assert(matrix.size() == query.size() * out.size());
+    using std::begin;
+    using std::end;
+    distances(begin(query), end(query), begin(matrix), begin(out), end(out));
+}
+
+/** The squared maximum distances of a query to each row of a matrix.
+The matrix is a range of iterators that stores the rows one after the other,
+and each row has the size of the query. The number of rows is the size of the output.
+*/
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void squared_distances(InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out)
+{
+    distances(first_query, last_query, first_matrix, first_out, last_out);
+    using T = value_type_i<OutputIterator>;
+    std::transform(first_out, last_out, first_out, [](const T d) { return T(d * d); });
+}
+
+/** The squared maximum distances of a query to each row of a matrix.
+The query, the matrix and the output are containers.
+The size of the matrix should be the size of the query times the size of the output.
+*/
+template<typename Container1, typename Container2, typename Container3>
+void squared_distances(const Container1& query, const Container2& matrix, Container3& out)
+{
+    assert(matrix.size() == query.size() * out.size());
+    using std::begin;
+    using std::end;
+    squared_distances(begin(query), end(query), begin(matrix), begin(out), end(out));
+}
+
+
+/** The maximum norm of a vector, with an execution policy.
+The vector is represented by a range of iterators.
+*/
+template<typename Tag, typename InputIterator, typename T = value_type_i<InputIterator>>
+T norm(execution::policy<Tag> policy, InputIterator first, InputIterator last, T init = T{})
+{
+    const auto f = [&](std::ptrdiff_t first_chunk, std::ptrdiff_t last_chunk, T init_chunk)
+    {
+        return norm(first + first_chunk, first + last_chunk, init_chunk);
+    };
+    const auto combine = [](const T left, const T right) -> T
+    {
+        return std::max(left, right);
+    };
+    return execution::parallel_reduce(policy, std::distance(first, last), init, T{}, f, combine);
+}
+
+/** The maximum norm of a vector, with an execution policy.
+The vector is represented by a container.
+*/
+template<typename Tag, typename Container, typename T = value_type<Container>>
+T norm(execution::policy<Tag> policy, const Container& a, T init = T{})
+{
+    using std::begin;
+    using std::end;
+    return norm(policy, begin(a), end(a), init);
+}
+
+/** The squared maximum norm of a vector, with an execution policy.
+The vector is represented by a range of iterators.
+*/
+template<typename Tag, typename InputIterator, typename T = value_type_i<InputIterator>>
+T squared_norm(execution::policy<Tag> policy, InputIterator first, InputIterator last, T init = T{})
+{
+    const auto n = norm(policy, first, last, init);
+    return n * n;
+}
+
+/** The squared maximum norm of a vector, with an execution policy.
+The vector is represented by a container.
+*/
+template<typename Tag, typename Container, typename T = value_type<Container>>
+T squared_norm(execution::policy<Tag> policy, const Container& a, T init = T{})
+{
+    using std::begin;
+    using std::end;
+    return squared_norm(policy, begin(a), end(a), init);
+}
+
+/** The maximum distance of two vectors, with an execution policy.
+Each vector is represented by a range of iterators.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename T = value_type_i<InputIterator1>>
+T distance(execution::policy<Tag> policy,
+    InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
+{
+    const auto f = [&](std::ptrdiff_t first, std::ptrdiff_t last, T init_chunk)
+    {
+        return distance(first_left + first, first_left + last, first_right + first, init_chunk);
+    };
+    const auto combine = [](const T left, const T right) -> T
+    {
+        return std::max(left, right);
+    };
+    return execution::parallel_reduce(policy, std::distance(first_left, last_left), init, T{}, f, combine);
+}
+
+/** The maximum distance of two vectors, with an execution policy.
+Each vector is represented by a container.
+The two containers should have the same size.
+*/
+template<typename Tag, typename Container1, typename Container2, typename T = value_type<Container1>>
+T distance(execution::policy<Tag> policy, const Container1& left, const Container2& right, T init = T{})
+{
+    assert(left.size() == right.size());
+    using std::begin;
+    using std::end;
+    return distance(policy, begin(left), end(left), begin(right), init);
+}
+
+/** The squared maximum distance of two vectors, with an execution policy.
+Each vector is represented by a range of iterators.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename T = value_type_i<InputIterator1>>
+T squared_distance(execution::policy<Tag> policy,
+    InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
+{
+    const auto d = distance(policy, first_left, last_left, first_right, init);
+    return d * d;
+}
+
+/** The squared maximum distance of two vectors, with an execution policy.
+Each vector is represented by a container.
+The two containers should have the same size.
+*/
+template<typename Tag, typename Container1, typename Container2, typename T = value_type<Container1>>
+T squared_distance(execution::policy<Tag> policy, const Container1& left, const Container2& right, T init = T{})
+{
+    assert(left.size() == right.size());
+    using std::begin;
+    using std::end;
+    return squared_distance(policy, begin(left), end(left), begin(right), init);
+}
+
+/** Calls `store(i, j, d)` with the maximum distance `d` of each pair of rows, see @ref pairwise. */
+template<typename T, typename Tag, typename InputIterator1, typename InputIterator2, typename Store>
+void for_each_distance(execution::policy<Tag> policy, InputIterator1 first_a, std::size_t num_a,
+    InputIterator2 first_b, std::size_t num_b, std::size_t dimension, bool upper, Store store)
+{
+    pairwise::for_each_pair<T, operations::maximum, operations::absolute_difference>(
+        policy, first_a, num_a, first_b, num_b, dimension, upper, store);
+}
+
+/** The maximum distances of each row of the matrix `a` to each row of the matrix `b`, with an execution policy.
+The matrices are ranges of iterators with rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `num_a * num_b` elements.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename RandomAccessIterator>
+void pairwise_distances(execution::policy<Tag> policy, InputIterator1 first_a, InputIterator1 last_a,
+    InputIterator2 first_b, InputIterator2 last_b, std::size_t dimension, RandomAccessIterator first_out)
+{
+    assert(dimension > 0);
+    using T = value_type_i<RandomAccessIterator>;
+    const auto num_a = static_cast<std::size_t>(std::distance(first_a, last_a)) / dimension;
+    const auto num_b = static_cast<std::size_t>(std::distance(first_b, last_b)) / dimension;
+    const auto store = [&](std::size_t i, std::size_t j, T d)
+    {
+        first_out[i * num_b + j] = d;
+    };
+    for_each_distance<T>(policy, first_a, num_a, first_b, num_b, dimension, false, store);
+}
+
+/** The maximum distances of each row of the matrix `a` to each row of the matrix `b`, with an execution policy.
+The matrices are containers with rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `num_a * num_b`.
+*/
+template<typename Tag, typename Container1, typename Container2, typename Container3>
+void pairwise_distances(execution::policy<Tag> policy, const Container1& a, const Container2& b, std::size_t dimension, Container3& out)
+{
+    assert(dimension > 0);
+    assert(a.size() % dimension == 0);
+    assert(b.size() % dimension == 0);
+    assert(out.size() == a.size() / dimension * (b.size() / dimension));
+    using std::begin;
+    using std::end;
+    pairwise_distances(policy, begin(a), end(a), begin(b), end(b), dimension, begin(out));
+}
+
+/** The maximum distances of each row of the matrix `a` to each row of the matrix `b`.
+The matrices are ranges of iterators with rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `num_a * num_b` elements.
+*/
+template<typename InputIterator1, typename InputIterator2, typename RandomAccessIterator>
+void pairwise_distances(InputIterator1 first_a, InputIterator1 last_a, InputIterator2 first_b, InputIterator2 last_b,
+    std::size_t dimension, RandomAccessIterator first_out)
+{
+    pairwise_distances(execution::seq, first_a, last_a, first_b, last_b, dimension, first_out);
+}
+
+/** The maximum distances of each row of the matrix `a` to each row of the matrix `b`.
+The matrices are containers with rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `num_a * num_b`.
+*/
+template<typename Container1, typename Container2, typename Container3>
+void pairwise_distances(const Container1& a, const Container2& b, std::size_t dimension, Container3& out)
+{
+    pairwise_distances(execution::seq, a, b, dimension, out);
+}
+
+/** The maximum distances of each pair of rows `i < j` of the matrix `a`, with an execution policy.
+The matrix is a range of iterators with `n` rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `n * (n - 1) / 2` elements.
+*/
+template<typename Tag, typename InputIterator, typename RandomAccessIterator>
+void pdist(execution::policy<Tag> policy, InputIterator first, InputIterator last, std::size_t dimension,
+    RandomAccessIterator first_out)
+{
+    assert(dimension > 0);
+    using T = value_type_i<RandomAccessIterator>;
+    const auto n = static_cast<std::size_t>(std::distance(first, last)) / dimension;
+    const auto store = [&](std::size_t i, std::size_t j, T d)
+    {
+        first_out[pairwise::condensed_index(n, i, j)] = d;
+    };
+    for_each_distance<T>(policy, first, n, first, n, dimension, true, store);
+}
+
+/** The maximum distances of each pair of rows `i < j` of the matrix `a`, with an execution policy.
+The matrix is a container with `n` rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `n * (n - 1) / 2`.
+*/
+template<typename Tag, typename Container1, typename Container2>
+void pdist(execution::policy<Tag> policy, const Container1& a, std::size_t dimension, Container2& out)
+{
+    assert(dimension > 0);
+    assert(a.size() % dimension == 0);
+    assert(out.size() == a.size() / dimension * (a.size() / dimension - 1) / 2);
+    using std::begin;
+    using std::end;
+    pdist(policy, begin(a), end(a), dimension, begin(out));
+}
+
+/** The maximum distances of each pair of rows `i < j` of the matrix `a`.
+The matrix is a range of iterators with `n` rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `n * (n - 1) / 2` elements.
+*/
+template<typename InputIterator, typename RandomAccessIterator>
+void pdist(InputIterator first, InputIterator last, std::size_t dimension, RandomAccessIterator first_out)
+{
+    pdist(execution::seq, first, last, dimension, first_out);
+}
+
+/** The maximum distances of each pair of rows `i < j` of the matrix `a`.
+The matrix is a container with `n` rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `n * (n - 1) / 2`.
+*/
+template<typename Container1, typename Container2>
+void pdist(const Container1& a, std::size_t dimension, Container2& out)
+{
+    pdist(execution::seq, a, dimension, out);
+}
+
+/** The squared maximum distances of each row of the matrix `a` to each row of the matrix `b`, with an execution policy.
+The matrices are ranges of iterators with rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `num_a * num_b` elements.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename RandomAccessIterator>
+void pairwise_squared_distances(execution::policy<Tag> policy, InputIterator1 first_a, InputIterator1 last_a,
+    InputIterator2 first_b, InputIterator2 last_b, std::size_t dimension, RandomAccessIterator first_out)
+{
+    assert(dimension > 0);
+    using T = value_type_i<RandomAccessIterator>;
+    const auto num_a = static_cast<std::size_t>(std::distance(first_a, last_a)) / dimension;
+    const auto num_b = static_cast<std::size_t>(std::distance(first_b, last_b)) / dimension;
+    const auto store = [&](std::size_t i, std::size_t j, T d)
+    {
+        first_out[i * num_b + j] = T(d * d);
+    };
+    for_each_distance<T>(policy, first_a, num_a, first_b, num_b, dimension, false, store);
+}
+
+/** The squared maximum distances of each row of the matrix `a` to each row of the matrix `b`, with an execution policy.
+The matrices are containers with rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `num_a * num_b`.
+*/
+template<typename Tag, typename Container1, typename Container2, typename Container3>
+void pairwise_squared_distances(execution::policy<Tag> policy, const Container1& a, const Container2& b, std::size_t dimension, Container3& out)
+{
+    assert(dimension > 0);
+    assert(a.size() % dimension == 0);
+    assert(b.size() % dimension == 0);
+    assert(out.size() == a.size() / dimension * (b.size() / dimension));
+    using std::begin;
+    using std::end;
+    pairwise_squared_distances(policy, begin(a), end(a), begin(b), end(b), dimension, begin(out));
+}
+
+/** The squared maximum distances of each row of the matrix `a` to each row of the matrix `b`.
+The matrices are ranges of iterators with rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `num_a * num_b` elements.
+*/
+template<typename InputIterator1, typename InputIterator2, typename RandomAccessIterator>
+void pairwise_squared_distances(InputIterator1 first_a, InputIterator1 last_a, InputIterator2 first_b, InputIterator2 last_b,
+    std::size_t dimension, RandomAccessIterator first_out)
+{
+    pairwise_squared_distances(execution::seq, first_a, last_a, first_b, last_b, dimension, first_out);
+}
+
+/** The squared maximum distances of each row of the matrix `a` to each row of the matrix `b`.
+The matrices are containers with rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `num_a * num_b`.
+*/
+template<typename Container1, typename Container2, typename Container3>
+void pairwise_squared_distances(const Container1& a, const Container2& b, std::size_t dimension, Container3& out)
+{
+    pairwise_squared_distances(execution::seq, a, b, dimension, out);
+}
+
+/** The squared maximum distances of each pair of rows `i < j` of the matrix `a`, with an execution policy.
+The matrix is a range of iterators with `n` rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `n * (n - 1) / 2` elements.
+*/
+template<typename Tag, typename InputIterator, typename RandomAccessIterator>
+void squared_pdist(execution::policy<Tag> policy, InputIterator first, InputIterator last, std::size_t dimension,
+    RandomAccessIterator first_out)
+{
+    assert(dimension > 0);
+    using T = value_type_i<RandomAccessIterator>;
+    const auto n = static_cast<std::size_t>(std::distance(first, last)) / dimension;
+    const auto store = [&](std::size_t i, std::size_t j, T d)
+    {
+        first_out[pairwise::condensed_index(n, i, j)] = T(d * d);
+    };
+    for_each_distance<T>(policy, first, n, first, n, dimension, true, store);
+}
+
+/** The squared maximum distances of each pair of rows `i < j` of the matrix `a`, with an execution policy.
+The matrix is a container with `n` rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `n * (n - 1) / 2`.
+*/
+template<typename Tag, typename Container1, typename Container2>
+void squared_pdist(execution::policy<Tag> policy, const Container1& a, std::size_t dimension, Container2& out)
+{
+    assert(dimension > 0);
+    assert(a.size() % dimension == 0);
+    assert(out.size() == a.size() / dimension * (a.size() / dimension - 1) / 2);
+    using std::begin;
+    using std::end;
+    squared_pdist(policy, begin(a), end(a), dimension, begin(out));
+}
+
+/** The squared maximum distances of each pair of rows `i < j` of the matrix `a`.
+The matrix is a range of iterators with `n` rows of `dimension` elements, see @ref pairwise.
+The output is a random access iterator to `n * (n - 1) / 2` elements.
+*/
+template<typename InputIterator, typename RandomAccessIterator>
+void squared_pdist(InputIterator first, InputIterator last, std::size_t dimension, RandomAccessIterator first_out)
+{
+    squared_pdist(execution::seq, first, last, dimension, first_out);
+}
+
+/** The squared maximum distances of each pair of rows `i < j` of the matrix `a`.
+The matrix is a container with `n` rows of `dimension` elements, see @ref pairwise.
+The size of the output should be `n * (n - 1) / 2`.
+*/
+template<typename Container1, typename Container2>
+void squared_pdist(const Container1& a, std::size_t dimension, Container2& out)
+{
+    squared_pdist(execution::seq, a, dimension, out);
+}
+
+/** The `k` rows of the dataset that are nearest to each query in the maximum distance, with an execution policy.
+The dataset and the queries are ranges of iterators with rows of `dimension` elements, see @ref neighbors.
+The indices and the distances of the neighbors are written to random access iterators to
+`num_queries * k` elements. The dataset should have at least `k` rows, see @ref neighbors.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename IndexIterator, typename DistanceIterator>
+void nearest_neighbors(execution::policy<Tag> policy, InputIterator1 first_data, InputIterator1 last_data,
+    InputIterator2 first_queries, InputIterator2 last_queries, std::size_t dimension, std::size_t k,
+    IndexIterator first_index, DistanceIterator first_distance)
+{
+    assert(dimension > 0);
+    using T = value_type_i<DistanceIterator>;
+    const auto num_data = static_cast<std::size_t>(std::distance(first_data, last_data)) / dimension;
+    const auto num_queries = static_cast<std::size_t>(std::distance(first_queries, last_queries)) / dimension;
+    const auto compare = [](auto first_a, std::size_t num_a, auto first_b, std::size_t num_b, std::size_t dimension, auto store)
+    {
+        for_each_distance<T>(execution::seq, first_a, num_a, first_b, num_b, dimension, false, store);
+    };
+    neighbors::k_nearest<T>(policy, first_data, num_data, first_queries, num_queries, dimension, k,
+        first_index, first_distance, compare);
+}
+
+/** The `k` rows of the dataset that are nearest to each query in the maximum distance, with an execution policy.
+The dataset and the queries are containers with rows of `dimension` elements, see @ref neighbors.
+The sizes of the indices and the distances should be `num_queries * k`.
+*/
+template<typename Tag, typename Container1, typename Container2, typename Container3, typename Container4>
+void nearest_neighbors(execution::policy<Tag> policy, const Container1& data, const Container2& queries,
+    std::size_t dimension, std::size_t k, Container3& indices, Container4& distances)
+{
+    assert(dimension > 0);
+    assert(data.size() % dimension == 0);
+    assert(queries.size() % dimension == 0);
+    assert(indices.size() == queries.size() / dimension * k);
+    assert(distances.size() == indices.size());
+    using std::begin;
+    using std::end;
+    nearest_neighbors(policy, begin(data), end(data), begin(queries), end(queries), dimension, k,
+        begin(indices), begin(distances));
+}
+
+/** The `k` rows of the dataset that are nearest to each query in the maximum distance.
+The dataset and the queries are ranges of iterators with rows of `dimension` elements, see @ref neighbors.
+The indices and the distances of the neighbors are written to random access iterators to
+`num_queries * k` elements. The dataset should have at least `k` rows, see @ref neighbors.
+*/
+template<typename InputIterator1, typename InputIterator2, typename IndexIterator, typename DistanceIterator>
+void nearest_neighbors(InputIterator1 first_data, InputIterator1 last_data,
+    InputIterator2 first_queries, InputIterator2 last_queries, std::size_t dimension, std::size_t k,
+    IndexIterator first_index, DistanceIterator first_distance)
+{
+    nearest_neighbors(execution::seq, first_data, last_data, first_queries, last_queries, dimension, k,
+        first_index, first_distance);
+}
+
+/** The `k` rows of the dataset that are nearest to each query in the maximum distance.
+The dataset and the queries are containers with rows of `dimension` elements, see @ref neighbors.
+The sizes of the indices and the distances should be `num_queries * k`.
+*/
+template<typename Container1, typename Container2, typename Container3, typename Container4>
+void nearest_neighbors(const Container1& data, const Container2& queries,
+    std::size_t dimension, std::size_t k, Container3& indices, Container4& distances)
+{
+    nearest_neighbors(execution::seq, data, queries, dimension, k, indices, distances);
+}
+
 /** @} */
 
 } // namespace maximum
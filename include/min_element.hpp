@@ -3,7 +3,11 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <iterator>
 
+#include "parallel.hpp"
+#include "simd.hpp"
 #include "traits.hpp"
 
 namespace aaa {
@@ -29,14 +33,14 @@ template<typename Container>
 typename Container::iterator min_element(Container& container) {
     using std::begin;
     using std::end;
-    return std::min_element(begin(container), end(container));
+    return simd::min_element(begin(container), end(container));
 }
 
 template<typename Container>
 typename Container::const_iterator min_element(const Container& container) {
     using std::begin;
     using std::end;
-    return std::min_element(begin(container), end(container));
+    return simd::min_element(begin(container), end(container));
 }
 
 template<typename Container, typename Compare, check_compare<Compare, value_type<Container>> = nullptr>
@@ -67,4 +71,32 @@ typename Container::const_iterator min_element(const Container& container, Key k
     return aaa::min_element(begin(container), end(container), key);
 }
 
+/** Same as `std::min_element` with an execution policy.
+Returns the first of the minimal elements, like the sequential version.
+*/
+template<typename Tag, typename Iterator>
+Iterator min_element(execution::policy<Tag> policy, Iterator first, Iterator last) {
+    const auto f = [&](std::ptrdiff_t first_chunk, std::ptrdiff_t last_chunk, Iterator) {
+        return simd::min_element(first + first_chunk, first + last_chunk);
+    };
+    const auto combine = [](Iterator left, Iterator right) {
+        return *right < *left ? right : left;
+    };
+    return execution::parallel_reduce(policy, std::distance(first, last), first, first, f, combine);
+}
+
+template<typename Tag, typename Container>
+typename Container::iterator min_element(execution::policy<Tag> policy, Container& container) {
+    using std::begin;
+    using std::end;
+    return aaa::min_element(policy, begin(container), end(container));
+}
+
+template<typename Tag, typename Container>
+typename Container::const_iterator min_element(execution::policy<Tag> policy, const Container& container) {
+    using std::begin;
+    using std::end;
+    return aaa::min_element(policy, begin(container), end(container));
+}
+
 } // namespace aaa
@@ -0,0 +1,423 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <numeric>
+#include <type_traits>
+
+#include "operations.hpp"
+#include "simd.hpp"
+#include "traits.hpp"
+
+namespace aaa {
+namespace minkowski {
+
+/**
+@addtogroup minkowski_space Minkowski Space
+
+Minkowski space is also known as L-p space. It generalizes the Manhattan space
+for p = 1 and the Euclidean space for p = 2, see @ref manhattan_space and
+@ref euclidean_space. It defines the following functions:
+- The Minkowski norm or length of a vector is defined as:
+  \f$ \| a \|_p = \left( \sum_i |a_i|^p \right)^{1/p} \f$
+- The Minkowski distance between the vectors a and b is defined as:
+  \f$ d_p(a, b) = \|a-b\|_p = \left( \sum_i |a_i-b_i|^p \right)^{1/p} \f$
+- The powered norm and the powered distance are the sums without the root.
+  They have the same order as the norm and the distance, and are cheaper.
+
+The power p is given in two ways:
+- As a template argument, like `minkowski::distance<3>(a, b)`. The powers of the
+  terms are then computed by multiplications, for example `x * x * x`, and the
+  sums of contiguous floating point ranges are computed by the SIMD kernels of
+  the other spaces, see @ref simd.
+- As a runtime argument, like `minkowski::distance(3.0, a, b)`. The integer powers
+  up to `max_specialized_power` are forwarded to the template functions, and the
+  other powers use `std::pow` for each term.
+
+The functions `distances` and `powered_distances` compare a query to each row of
+a matrix, stored row by row in a single range, and output one scalar per row.
+
+@{
+*/
+
+/** The largest integer power that is forwarded by the runtime functions to the template functions. */
+constexpr unsigned max_specialized_power = 8;
+
+/** The `P`-th root, which undoes the power of the powered norm and distance. */
+template<unsigned P, typename T>
+sqrt_type_t<T> root(T x)
+{
+    using R = sqrt_type_t<T>;
+    return P == 1 ? R(x) : P == 2 ? R(std::sqrt(R(x))) : R(std::pow(R(x), R(1) / R(P)));
+}
+
+/** The `p`-th root, which undoes the power of the powered norm and distance. */
+template<typename T>
+sqrt_type_t<T> root(double p, T x)
+{
+    using R = sqrt_type_t<T>;
+    return p == 1 ? R(x) : p == 2 ? R(std::sqrt(R(x))) : R(std::pow(R(x), R(1 / p)));
+}
+
+/** Calls `integral(std::integral_constant<unsigned, P>{})` if `p` is an integer `P` from 1 to
+`max_specialized_power`, and `generic()` otherwise. Both should return the same type.
+*/
+template<typename Integral, typename Generic>
+auto with_power(double p, Integral integral, Generic generic)
+{
+    assert(p > 0);
+    if (p == std::floor(p) && p <= max_specialized_power)
+    {
+        switch (static_cast<unsigned>(p))
+        {
+        case 1: return integral(std::integral_constant<unsigned, 1>{});
+        case 2: return integral(std::integral_constant<unsigned, 2>{});
+        case 3: return integral(std::integral_constant<unsigned, 3>{});
+        case 4: return integral(std::integral_constant<unsigned, 4>{});
+        case 5: return integral(std::integral_constant<unsigned, 5>{});
+        case 6: return integral(std::integral_constant<unsigned, 6>{});
+        case 7: return integral(std::integral_constant<unsigned, 7>{});
+        case 8: return integral(std::integral_constant<unsigned, 8>{});
+        }
+    }
+    return generic();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// compile time power
+
+/** The sum of `|a_i|^P`.
+The vector is represented by a range of iterators.
+*/
+template<unsigned P, typename InputIterator, typename T = value_type_i<InputIterator>>
+T powered_norm(InputIterator first, InputIterator last, T init = T{})
+{
+    static_assert(P > 0, "The power should be positive");
+    return simd::reduce_distance<operations::plus, operations::powered_absolute<P>>(first, last, first, init);
+}
+
+/** The sum of `|a_i|^P`.
+The vector is represented by a container.
+*/
+template<unsigned P, typename Container, typename T = value_type<Container>>
+T powered_norm(const Container& a, T init = T{})
+{
+    using std::begin;
+    using std::end;
+    return powered_norm<P>(begin(a), end(a), init);
+}
+
+/** The Minkowski norm of a vector.
+The vector is represented by a range of iterators.
+Returns a value of floating point type following the same convention as `std::sqrt`.
+*/
+template<unsigned P, typename InputIterator, typename T = value_type_i<InputIterator>>
+sqrt_type_t<T> norm(InputIterator first, InputIterator last, T init = T{})
+{
+    return root<P>(powered_norm<P>(first, last, init));
+}
+
+/** The Minkowski norm of a vector.
+The vector is represented by a container.
+Returns a value of floating point type following the same convention as `std::sqrt`.
+*/
+template<unsigned P, typename Container, typename T = value_type<Container>>
+sqrt_type_t<T> norm(const Container& a, T init = T{})
+{
+    using std::begin;
+    using std::end;
+    return norm<P>(begin(a), end(a), init);
+}
+
+/** The sum of `|a_i - b_i|^P`.
+Each vector is represented by a range of iterators.
+*/
+template<unsigned P, typename InputIterator1, typename InputIterator2, typename T = value_type_i<InputIterator1>>
+T powered_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
+{
+    static_assert(P > 0, "The power should be positive");
+    return simd::reduce_distance<operations::plus, operations::powered_absolute_difference<P>>(
+        first_left, last_left, first_right, init);
+}
+
+/** The sum of `|a_i - b_i|^P`.
+Each vector is represented by a container.
+The two containers should have the same size.
+*/
+template<unsigned P, typename Container1, typename Container2, typename T = value_type<Container1>>
+T powered_distance(const Container1& left, const Container2& right, T init = T{})
+{
+    assert(left.size() == right.size());
+    using std::begin;
+    using std::end;
+    return powered_distance<P>(begin(left), end(left), begin(right), init);
+}
+
+/** The Minkowski distance of two vectors.
+Each vector is represented by a range of iterators.
+Returns a value of floating point type following the same convention as `std::sqrt`.
+*/
+template<unsigned P, typename InputIterator1, typename InputIterator2, typename T = value_type_i<InputIterator1>>
+sqrt_type_t<T> distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
+{
+    return root<P>(powered_distance<P>(first_left, last_left, first_right, init));
+}
+
+/** The Minkowski distance of two vectors.
+Each vector is represented by a container.
+The two containers should have the same size.
+Returns a value of floating point type following the same convention as `std::sqrt`.
+*/
+template<unsigned P, typename Container1, typename Container2, typename T = value_type<Container1>>
+sqrt_type_t<T> distance(const Container1& left, const Container2& right, T init = T{})
+{
+    assert(left.size() == right.size());
+    using std::begin;
+    using std::end;
+    return distance<P>(begin(left), end(left), begin(right), init);
+}
+
+/** The powered Minkowski distances of a query to each row of a matrix.
+The matrix is a range of iterators that stores the rows one after the other,
+and each row has the size of the query. The number of rows is the size of the output.
+*/
+template<unsigned P, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void powered_distances(InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out)
+{
+    static_assert(P > 0, "The power should be positive");
+    simd::row_distances<operations::plus, operations::powered_absolute_difference<P>>(
+        first_query, last_query, first_matrix, first_out, last_out);
+}
+
+/** The powered Minkowski distances of a query to each row of a matrix.
+The query, the matrix and the output are containers.
+The size of the matrix should be the size of the query times the size of the output.
+*/
+template<unsigned P, typename Container1, typename Container2, typename Container3>
+void powered_distances(const Container1& query, const Container2& matrix, Container3& out)
+{
+    assert(matrix.size() == query.size() * out.size());
+    using std::begin;
+    using std::end;
+    powered_distances<P>(begin(query), end(query), begin(matrix), begin(out), end(out));
+}
+
+/** The Minkowski distances of a query to each row of a matrix.
+The matrix is a range of iterators that stores the rows one after the other,
+and each row has the size of the query. The number of rows is the size of the output.
+The output should have a floating point type.
+*/
+template<unsigned P, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void distances(InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out)
+{
+    powered_distances<P>(first_query, last_query, first_matrix, first_out, last_out);
+    using T = value_type_i<OutputIterator>;
+    std::transform(first_out, last_out, first_out, [](const T d) { return T(root<P>(d)); });
+}
+
+/** The Minkowski distances of a query to each row of a matrix.
+The query, the matrix and the output are containers.
+The size of the matrix should be the size of the query times the size of the output.
+*/
+template<unsigned P, typename Container1, typename Container2, typename Container3>
+void distances(const Container1& query, const Container2& matrix, Container3& out)
+{
+    assert(matrix.size() == query.size() * out.size());
+    using std::begin;
+    using std::end;
+    distances<P>(begin(query), end(query), begin(matrix), begin(out), end(out));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// runtime power
+
+/** The sum of `|a_i|^p`.
+The vector is represented by a range of iterators.
+*/
+template<typename InputIterator, typename T = value_type_i<InputIterator>>
+T powered_norm(double p, InputIterator first, InputIterator last, T init = T{})
+{
+    const auto integral = [&](auto power)
+    {
+        return powered_norm<decltype(power)::value>(first, last, init);
+    };
+    const auto generic = [&]
+    {
+        const auto add_term = [p](const T sum, const T x) -> T
+        {
+            return T(sum + T(std::pow(operations::absolute_difference{}(T(x), T{}), p)));
+        };
+        return std::accumulate(first, last, init, add_term);
+    };
+    return with_power(p, integral, generic);
+}
+
+/** The sum of `|a_i|^p`.
+The vector is represented by a container.
+*/
+template<typename Container, typename T = value_type<Container>>
+T powered_norm(double p, const Container& a, T init = T{})
+{
+    using std::begin;
+    using std::end;
+    return powered_norm(p, begin(a), end(a), init);
+}
+
+/** The Minkowski norm of a vector.
+The vector is represented by a range of iterators.
+Returns a value of floating point type following the same convention as `std::sqrt`.
+*/
+template<typename InputIterator, typename T = value_type_i<InputIterator>>
+sqrt_type_t<T> norm(double p, InputIterator first, InputIterator last, T init = T{})
+{
+    return root(p, powered_norm(p, first, last, init));
+}
+
+/** The Minkowski norm of a vector.
+The vector is represented by a container.
+Returns a value of floating point type following the same convention as `std::sqrt`.
+*/
+template<typename Container, typename T = value_type<Container>>
+sqrt_type_t<T> norm(double p, const Container& a, T init = T{})
+{
+    using std::begin;
+    using std::end;
+    return norm(p, begin(a), end(a), init);
+}
+
+/** The sum of `|a_i - b_i|^p`.
+Each vector is represented by a range of iterators.
+*/
+template<typename InputIterator1, typename InputIterator2, typename T = value_type_i<InputIterator1>>
+T powered_distance(double p, InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
+{
+    const auto integral = [&](auto power)
+    {
+        return powered_distance<decltype(power)::value>(first_left, last_left, first_right, init);
+    };
+    const auto generic = [&]
+    {
+        const auto plus = [](const T left, const T right) -> T
+        {
+            return T(left + right);
+        };
+        const auto term = [p](const auto left, const auto right) -> T
+        {
+            return T(std::pow(T(operations::absolute_difference{}(T(left), T(right))), p));
+        };
+        return std::inner_product(first_left, last_left, first_right, init, plus, term);
+    };
+    return with_power(p, integral, generic);
+}
+
+/** The sum of `|a_i - b_i|^p`.
+Each vector is represented by a container.
+The two containers should have the same size.
+*/
+template<typename Container1, typename Container2, typename T = value_type<Container1>>
+T powered_distance(double p, const Container1& left, const Container2& right, T init = T{})
+{
+    assert(left.size() == right.size());
+    using std::begin;
+    using std::end;
+    return powered_distance(p, begin(left), end(left), begin(right), init);
+}
+
+/** The Minkowski distance of two vectors.
+Each vector is represented by a range of iterators.
+Returns a value of floating point type following the same convention as `std::sqrt`.
+*/
+template<typename InputIterator1, typename InputIterator2, typename T = value_type_i<InputIterator1>>
+sqrt_type_t<T> distance(double p, InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init = T{})
+{
+    return root(p, powered_distance(p, first_left, last_left, first_right, init));
+}
+
+/** The Minkowski distance of two vectors.
+Each vector is represented by a container.
+The two containers should have the same size.
+Returns a value of floating point type following the same convention as `std::sqrt`.
+*/
+template<typename Container1, typename Container2, typename T = value_type<Container1>>
+sqrt_type_t<T> distance(double p, const Container1& left, const Container2& right, T init = T{})
+{
+    assert(left.size() == right.size());
+    using std::begin;
+    using std::end;
+    return distance(p, begin(left), end(left), begin(right), init);
+}
+
+/** The powered Minkowski distances of a query to each row of a matrix.
+The matrix is a range of iterators that stores the rows one after the other,
+and each row has the size of the query. The number of rows is the size of the output.
+*/
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void powered_distances(double p, InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out)
+{
+    const auto integral = [&](auto power)
+    {
+        powered_distances<decltype(power)::value>(first_query, last_query, first_matrix, first_out, last_out);
+    };
+    const auto generic = [&]
+    {
+        using T = value_type_i<OutputIterator>;
+        const auto dimension = std::distance(first_query, last_query);
+        for (; first_out != last_out; ++first_out)
+        {
+            *first_out = powered_distance(p, first_query, last_query, first_matrix, T{});
+            std::advance(first_matrix, dimension);
+        }
+    };
+    with_power(p, integral, generic);
+}
+
+/** The powered Minkowski distances of a query to each row of a matrix.
+The query, the matrix and the output are containers.
+The size of the matrix should be the size of the query times the size of the output.
+*/
+template<typename Container1, typename Container2, typename Container3>
+void powered_distances(double p, const Container1& query, const Container2& matrix, Container3& out)
+{
+    assert(matrix.size() == query.size() * out.size());
+    using std::begin;
+    using std::end;
+    powered_distances(p, begin(query), end(query), begin(matrix), begin(out), end(out));
+}
+
+/** The Minkowski distances of a query to each row of a matrix.
+The matrix is a range of iterators that stores the rows one after the other,
+and each row has the size of the query. The number of rows is the size of the output.
+The output should have a floating point type.
+*/
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void distances(double p, InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out)
+{
+    powered_distances(p, first_query, last_query, first_matrix, first_out, last_out);
+    using T = value_type_i<OutputIterator>;
+    std::transform(first_out, last_out, first_out, [p](const T d) { return T(root(p, d)); });
+}
+
+/** The Minkowski distances of a query to each row of a matrix.
+The query, the matrix and the output are containers.
+The size of the matrix should be the size of the query times the size of the output.
+*/
+template<typename Container1, typename Container2, typename Container3>
+void distances(double p, const Container1& query, const Container2& matrix, Container3& out)
+{
+    assert(matrix.size() == query.size() * out.size());
+    using std::begin;
+    using std::end;
+    distances(p, begin(query), end(query), begin(matrix), begin(out), end(out));
+}
+
+/** @} */
+
+} // namespace minkowski
+} // namespace aaa
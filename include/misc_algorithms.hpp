@@ -1,7 +1,18 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
 #include <numeric>
 
+#include "accuracy.hpp"
+#include "operations.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
 #include "traits.hpp"
 
 namespace aaa {
@@ -37,13 +48,62 @@ void convert(const Container1& in, Container2& out)
     return convert(begin(in), end(in), begin(out));
 }
 
+/**
+Quantizes the elements from one range of floating point numbers to another range
+of integers, `out = round(in / scale) + zero_point`. The results are clamped to
+the range of the output type, and rounded to nearest even. Contiguous ranges of
+`float` and bytes use the SIMD kernels, see @ref simd.
+*/
+template<typename InputIterator, typename OutputIterator, typename T>
+void quantize(InputIterator first_in, InputIterator last_in, OutputIterator first_out, T scale, int zero_point)
+{
+    simd::quantize(first_in, last_in, first_out, scale, zero_point);
+}
+
+/**
+Quantizes the elements from one container of floating point numbers to another
+container of integers, `out = round(in / scale) + zero_point`.
+*/
+template<typename Container1, typename Container2, typename T>
+void quantize(const Container1& in, Container2& out, T scale, int zero_point)
+{
+    assert(in.size() == out.size());
+    using std::begin;
+    using std::end;
+    quantize(begin(in), end(in), begin(out), scale, zero_point);
+}
+
+/**
+Dequantizes the elements from one range of integers to another range of
+floating point numbers, `out = (in - zero_point) * scale`. Contiguous ranges of
+bytes and `float` use the SIMD kernels, see @ref simd.
+*/
+template<typename InputIterator, typename OutputIterator, typename T>
+void dequantize(InputIterator first_in, InputIterator last_in, OutputIterator first_out, T scale, int zero_point)
+{
+    simd::dequantize(first_in, last_in, first_out, scale, zero_point);
+}
+
+/**
+Dequantizes the elements from one container of integers to another container of
+floating point numbers, `out = (in - zero_point) * scale`.
+*/
+template<typename Container1, typename Container2, typename T>
+void dequantize(const Container1& in, Container2& out, T scale, int zero_point)
+{
+    assert(in.size() == out.size());
+    using std::begin;
+    using std::end;
+    dequantize(begin(in), end(in), begin(out), scale, zero_point);
+}
+
 /**
 Computes the sum of the elements of a range.
 */
 template<typename InputIterator, typename T = value_type_i<InputIterator>>
 T sum(InputIterator first, InputIterator last, T init = T{})
 {
-    return std::accumulate(first, last, init);
+    return simd::sum(first, last, init);
 }
 
 /**
@@ -57,6 +117,86 @@ T sum(const Container& container, T init = T{})
     return sum(begin(container), end(container), init);
 }
 
+/**
+Computes the sum of the elements of a range, with an accuracy policy.
+*/
+template<typename Tag, typename InputIterator, typename T = value_type_i<InputIterator>>
+T sum(accuracy::policy<Tag> policy, InputIterator first, InputIterator last, T init = T{})
+{
+    return simd::accurate_sum(policy, first, last, first, init, operations::first_operand{});
+}
+
+/**
+Computes the sum of the elements of a container, with an accuracy policy.
+*/
+template<typename Tag, typename Container, typename T = value_type<Container>>
+T sum(accuracy::policy<Tag> policy, const Container& container, T init = T{})
+{
+    using std::begin;
+    using std::end;
+    return sum(policy, begin(container), end(container), init);
+}
+
+/**
+Does elementwise `static_cast` on the elements from one range to another range,
+with an execution policy.
+*/
+template<typename Tag, typename InputIterator, typename OutputIterator>
+void convert(execution::policy<Tag> policy, InputIterator first_in, InputIterator last_in, OutputIterator first_out)
+{
+    execution::parallel_for(policy, std::distance(first_in, last_in), [&](std::ptrdiff_t first, std::ptrdiff_t last)
+    {
+        convert(first_in + first, first_in + last, first_out + first);
+    });
+}
+
+/**
+Does elementwise `static_cast` on the elements from one container to another container,
+with an execution policy.
+*/
+template<typename Tag, typename Container1, typename Container2>
+void convert(execution::policy<Tag> policy, const Container1& in, Container2& out)
+{
+    assert(in.size() == out.size());
+    using std::begin;
+    using std::end;
+    return convert(policy, begin(in), end(in), begin(out));
+}
+
+/**
+Computes the sum of the elements of a range, with an execution policy.
+*/
+template<typename Tag, typename InputIterator, typename T = value_type_i<InputIterator>>
+T sum(execution::policy<Tag> policy, InputIterator first, InputIterator last, T init = T{})
+{
+    const auto f = [&](std::ptrdiff_t first_chunk, std::ptrdiff_t last_chunk, T init_chunk)
+    {
+        return sum(first + first_chunk, first + last_chunk, init_chunk);
+    };
+    return execution::parallel_reduce(policy, std::distance(first, last), init, T{}, f, std::plus<T>{});
+}
+
+/**
+Computes the sum of the elements of a range, with a reproducible execution policy.
+The result is the same for any number of threads and instruction set.
+*/
+template<typename Tag, typename InputIterator, typename T = value_type_i<InputIterator>>
+T sum(execution::policy<execution::reproducible<Tag>> policy, InputIterator first, InputIterator last, T init = T{})
+{
+    return execution::reproducible_sum(policy, first, last, first, init, operations::first_operand{});
+}
+
+/**
+Computes the sum of the elements of a container, with an execution policy.
+*/
+template<typename Tag, typename Container, typename T = value_type<Container>>
+T sum(execution::policy<Tag> policy, const Container& container, T init = T{})
+{
+    using std::begin;
+    using std::end;
+    return sum(policy, begin(container), end(container), init);
+}
+
 /** @} */
 
 } // namespace aaa
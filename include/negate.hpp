@@ -1,7 +1,11 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
 
+#include "parallel.hpp"
 #include "traits.hpp"
 
 namespace aaa {
@@ -30,6 +34,13 @@ negate(in3, out);
 
 // In this example we use iterators for the input and output.
 negate(begin(in5) + 1, begin(in5) + 6, begin(out));
+
+// In this example the input is a temporary container.
+// Its storage is reused for the output, instead of allocating a new container.
+out = negate(add(in1, in2));
+
+// In this example we modify the vector in place.
+negate_inplace(out);
 ```
 
 @{
@@ -42,7 +53,7 @@ void negate(InputIterator first_in, InputIterator last_in, OutputIterator first_
     std::transform(first_in, last_in, first_out, f);
 }
 
-template<typename Container1, typename Container2>
+template<typename Container1, typename Container2, check_container<Container1> = nullptr>
 void negate(const Container1& in, Container2& out)
 {
     assert(in.size() == out.size());
@@ -59,6 +70,46 @@ Container negate(const Container& in)
     return out;
 }
 
+template<typename Container, check_rvalue<Container> = nullptr>
+Container negate(Container&& in)
+{
+    negate(in, in);
+    return std::move(in);
+}
+
+template<typename Container>
+void negate_inplace(Container& in)
+{
+    negate(in, in);
+}
+
+
+template<typename Tag, typename InputIterator, typename OutputIterator>
+void negate(execution::policy<Tag> policy, InputIterator first_in, InputIterator last_in, OutputIterator first_out)
+{
+    execution::parallel_for(policy, std::distance(first_in, last_in), [&](std::ptrdiff_t first, std::ptrdiff_t last)
+    {
+        negate(first_in + first, first_in + last, first_out + first);
+    });
+}
+
+template<typename Tag, typename Container1, typename Container2>
+void negate(execution::policy<Tag> policy, const Container1& in, Container2& out)
+{
+    assert(in.size() == out.size());
+    using std::begin;
+    using std::end;
+    negate(policy, begin(in), end(in), begin(out));
+}
+
+template<typename Tag, typename Container>
+Container negate(execution::policy<Tag> policy, const Container& in)
+{
+    auto out = in;
+    negate(policy, in, out);
+    return out;
+}
+
 /** @} */
 
 } // namespace aaa
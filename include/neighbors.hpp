@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "pairwise.hpp"
+#include "parallel.hpp"
+#include "traits.hpp"
+
+namespace aaa {
+namespace neighbors {
+
+/**
+@addtogroup neighbors
+
+The Euclidean, Manhattan and maximum spaces have a function `nearest_neighbors`,
+that finds the `k` rows of a dataset that are nearest to each row of a batch of
+queries. The dataset and the queries are matrices that are stored row by row,
+like in @ref pairwise. The search is exact, it compares each query with each row:
+- The distances are computed in tiles of queries and rows, by the kernels of
+  @ref pairwise.
+- Each query has a bounded heap that keeps its `k` nearest rows so far.
+- With an execution policy, the blocks of queries run on the threads of the
+  shared pool. When there are fewer blocks than threads, the dataset is split
+  in parts too, and the heaps of the parts are merged at the end.
+
+The output are two matrices with `k` columns and one row per query, with the
+indices and the distances of the neighbors from the nearest to the farthest.
+Equal distances are ordered by index, so the result does not depend on the
+policy or the number of threads. When the dataset has fewer than `k` rows, the
+extra columns get the index `num_data` and the largest value of the distance
+type, or its square root for the Euclidean distance.
+
+The Euclidean distances are computed from the squared differences of the
+elements, and not from the norms and the dot products like in @ref pairwise:
+those cancel for close points with large norms, and would change the ranking.
+
+Example:
+```
+// 100000 points and 1000 queries in 16 dimensions.
+std::vector<float> data(100000 * 16);
+std::vector<float> queries(1000 * 16);
+std::vector<std::size_t> indices(1000 * 10);
+std::vector<float> distances(1000 * 10);
+
+using namespace aaa;
+
+// The 10 nearest points of each query.
+euclidean::nearest_neighbors(execution::par, data, queries, 16, 10, indices, distances);
+```
+
+@{
+*/
+
+/** The dataset is only split in parts of at least this number of rows. */
+constexpr std::size_t min_part_rows = 1024;
+
+/** Keeps the `k` smallest of the candidates that are pushed to it.
+The candidates are ordered by distance, and then by index.
+*/
+template<typename T>
+class bounded_heap
+{
+public:
+    using candidate = std::pair<T, std::size_t>;
+
+    explicit bounded_heap(std::size_t k) : k_(k)
+    {
+        candidates_.reserve(k);
+    }
+
+    void push(T distance, std::size_t index)
+    {
+        const auto c = candidate(distance, index);
+        if (candidates_.size() < k_)
+        {
+            candidates_.push_back(c);
+            std::push_heap(candidates_.begin(), candidates_.end());
+        }
+        else if (c < candidates_.front())
+        {
+            std::pop_heap(candidates_.begin(), candidates_.end());
+            candidates_.back() = c;
+            std::push_heap(candidates_.begin(), candidates_.end());
+        }
+    }
+
+    std::size_t size() const
+    {
+        return candidates_.size();
+    }
+
+    /** The distance of the farthest candidate. The heap should not be empty. */
+    T farthest() const
+    {
+        return candidates_.front().first;
+    }
+
+    /** Returns the candidates from the nearest to the farthest, and leaves the heap empty. */
+    std::vector<candidate> take_sorted()
+    {
+        std::sort_heap(candidates_.begin(), candidates_.end());
+        auto sorted = std::move(candidates_);
+        candidates_.clear();
+        return sorted;
+    }
+
+private:
+    std::size_t k_;
+    std::vector<candidate> candidates_;
+};
+
+/** The number of threads that run the tasks of the policy. */
+inline std::size_t concurrency(execution::sequenced_policy)
+{
+    return 1;
+}
+
+inline std::size_t concurrency(execution::sequenced_reproducible_policy)
+{
+    return 1;
+}
+
+template<typename Tag>
+std::size_t concurrency(execution::policy<Tag>)
+{
+    return execution::num_threads();
+}
+
+/** Finds the `k` nearest of the `num_data` rows of the dataset to each of the `num_queries` queries.
+The distances are computed by `compare(first_a, num_a, first_b, num_b, dimension, store)`,
+which calls `store(i, j, distance)` for each row `i` of `a` and `j` of `b`.
+The distances are computed in the type `T`.
+*/
+template<typename T, typename Tag, typename InputIterator1, typename InputIterator2,
+    typename IndexIterator, typename DistanceIterator, typename Compare>
+void k_nearest(execution::policy<Tag> policy, InputIterator1 first_data, std::size_t num_data,
+    InputIterator2 first_queries, std::size_t num_queries, std::size_t dimension, std::size_t k,
+    IndexIterator first_index, DistanceIterator first_distance, Compare compare)
+{
+    assert(k <= num_data);
+    if (k == 0 || num_queries == 0)
+    {
+        return;
+    }
+    // Without the assertion, the missing neighbors are filled in, see @ref neighbors.
+    const auto found = std::min(k, num_data);
+    using index_type = value_type_i<IndexIterator>;
+    using candidate = typename bounded_heap<T>::candidate;
+    const auto block_size = pairwise::tile_rows;
+    const auto num_blocks = (num_queries + block_size - 1) / block_size;
+    const auto max_parts = (num_data + min_part_rows - 1) / min_part_rows;
+    const auto num_parts = std::max(std::size_t{1}, std::min(max_parts, concurrency(policy) / num_blocks));
+    const auto part_size = (num_data + num_parts - 1) / num_parts;
+
+    // The candidates of each query in each part of the dataset.
+    auto candidates = std::vector<std::vector<candidate>>(num_queries * num_parts);
+    pairwise::for_each_tile(policy, num_blocks * num_parts, [&](std::ptrdiff_t t)
+    {
+        const auto first_query = static_cast<std::size_t>(t) / num_parts * block_size;
+        const auto part = static_cast<std::size_t>(t) % num_parts;
+        const auto first_row = part * part_size;
+        if (first_row >= num_data)
+        {
+            return;
+        }
+        const auto rows = std::min(block_size, num_queries - first_query);
+        const auto cols = std::min(part_size, num_data - first_row);
+        auto heaps = std::vector<bounded_heap<T>>(rows, bounded_heap<T>(found));
+        const auto store = [&](std::size_t i, std::size_t j, T distance)
+        {
+            heaps[i].push(distance, first_row + j);
+        };
+        compare(std::next(first_queries, static_cast<std::ptrdiff_t>(first_query * dimension)), rows,
+            std::next(first_data, static_cast<std::ptrdiff_t>(first_row * dimension)), cols, dimension, store);
+        for (auto i = std::size_t{0}; i < rows; ++i)
+        {
+            candidates[(first_query + i) * num_parts + part] = heaps[i].take_sorted();
+        }
+    });
+
+    pairwise::for_each_tile(policy, num_blocks, [&](std::ptrdiff_t block)
+    {
+        const auto first_query = static_cast<std::size_t>(block) * block_size;
+        const auto last_query = std::min(num_queries, first_query + block_size);
+        for (auto q = first_query; q < last_query; ++q)
+        {
+            auto heap = bounded_heap<T>(found);
+            for (auto part = std::size_t{0}; part < num_parts; ++part)
+            {
+                for (const auto& c : candidates[q * num_parts + part])
+                {
+                    heap.push(c.first, c.second);
+                }
+            }
+            const auto nearest = heap.take_sorted();
+            for (auto n = std::size_t{0}; n < found; ++n)
+            {
+                first_index[q * k + n] = static_cast<index_type>(nearest[n].second);
+                first_distance[q * k + n] = nearest[n].first;
+            }
+            for (auto n = found; n < k; ++n)
+            {
+                first_index[q * k + n] = static_cast<index_type>(num_data);
+                first_distance[q * k + n] = std::numeric_limits<T>::max();
+            }
+        }
+    });
+}
+
+/** @} */
+
+} // namespace neighbors
+} // namespace aaa
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cmath>
+#include <type_traits>
+
+namespace aaa {
+
+/** Function objects for the elementwise operations.
+They live in their own namespace, so that argument dependent lookup on types
+that are templated on them does not find any algorithms.
+*/
+namespace operations {
+
+/** Operations that are `wraps` give the same bits for signed and unsigned integers. */
+struct plus
+{
+    static constexpr bool wraps = true;
+    template<typename Left, typename Right>
+    auto operator()(const Left& left, const Right& right) const { return left + right; }
+};
+
+struct minus
+{
+    static constexpr bool wraps = true;
+    template<typename Left, typename Right>
+    auto operator()(const Left& left, const Right& right) const { return left - right; }
+};
+
+struct multiplies
+{
+    static constexpr bool wraps = true;
+    template<typename Left, typename Right>
+    auto operator()(const Left& left, const Right& right) const { return left * right; }
+};
+
+struct divides
+{
+    static constexpr bool wraps = false;
+    template<typename Left, typename Right>
+    auto operator()(const Left& left, const Right& right) const { return left / right; }
+};
+
+/** Returns `right` if the elements are unordered, like the min instructions. */
+struct minimum
+{
+    static constexpr bool wraps = false;
+    template<typename T>
+    T operator()(const T& left, const T& right) const { return left < right ? left : right; }
+};
+
+/** Returns `right` if the elements are unordered, like the max instructions. */
+struct maximum
+{
+    static constexpr bool wraps = false;
+    template<typename T>
+    T operator()(const T& left, const T& right) const { return left > right ? left : right; }
+};
+
+/** Returns the left operand. It turns a binary reduction into a unary one. */
+struct first_operand
+{
+    template<typename Left, typename Right>
+    const Left& operator()(const Left& left, const Right&) const { return left; }
+};
+
+struct squared_difference
+{
+    template<typename Left, typename Right>
+    auto operator()(const Left& left, const Right& right) const { return (left - right) * (left - right); }
+};
+
+/** Also correct for unsigned integers, where `left - right` can wrap.
+Floating point numbers take the absolute value of the difference, which has the
+same bits and does not branch on the order of the operands.
+*/
+struct absolute_difference
+{
+    template<typename T>
+    T operator()(const T& left, const T& right) const { return difference(left, right, std::is_floating_point<T>{}); }
+
+private:
+    template<typename T>
+    static T difference(const T& left, const T& right, std::true_type) { return T(std::abs(left - right)); }
+
+    template<typename T>
+    static T difference(const T& left, const T& right, std::false_type) { return left < right ? T(right - left) : T(left - right); }
+};
+
+/** `x` to the power `P`, by repeated squaring. The kernels multiply in the same order. */
+template<unsigned P>
+struct power
+{
+    template<typename T>
+    T operator()(const T& x) const
+    {
+        const auto half = power<P / 2>{}(x);
+        return P % 2 == 0 ? T(half * half) : T(T(half * half) * x);
+    }
+};
+
+template<>
+struct power<1>
+{
+    template<typename T>
+    T operator()(const T& x) const { return x; }
+};
+
+/** `|left - right|` to the power `P`. */
+template<unsigned P>
+struct powered_absolute_difference
+{
+    template<typename T>
+    T operator()(const T& left, const T& right) const { return power<P>{}(absolute_difference{}(left, right)); }
+};
+
+/** `|left|` to the power `P`. It turns a distance into a norm. */
+template<unsigned P>
+struct powered_absolute
+{
+    template<typename T>
+    T operator()(const T& left, const T&) const { return power<P>{}(absolute_difference{}(left, T{})); }
+};
+
+struct negation
+{
+    template<typename T>
+    auto operator()(const T& in) const { return -in; }
+};
+
+} // namespace operations
+} // namespace aaa
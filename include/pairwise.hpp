@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "operations.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+namespace aaa {
+namespace pairwise {
+
+/**
+@addtogroup pairwise
+
+The Euclidean, Manhattan and maximum spaces have functions that compute the
+distances between all the pairs of rows of matrices. A matrix with `n` rows of
+`dimension` elements is stored row by row in a single range of `n * dimension`
+elements:
+- `pairwise_distances(a, b, dimension, out)` compares each row `i` of `a` with
+  each row `j` of `b`, and stores the distance at `out[i * num_b + j]`.
+  This is also known as `cdist`.
+- `pdist(a, dimension, out)` compares each pair of rows `i < j` of `a`.
+  The distances are stored in the order `(0, 1), (0, 2), ..., (0, n - 1), (1, 2), ...`,
+  and there are `n * (n - 1) / 2` of them.
+- `pairwise_squared_distances` and `squared_pdist` give the squared distances.
+
+The pairs are computed in tiles of `tile_rows` rows of the first matrix and
+`tile_columns` rows of the second matrix, that stay in the cache while they are
+compared. Each tile is compared by the SIMD kernels of @ref simd, that keep
+several rows of both matrices in the registers. With an execution policy,
+the tiles are processed on the threads of the shared pool, see @ref parallel.
+
+The Euclidean distances are computed as `|a|^2 + |b|^2 - 2 a.b`, so that most of
+the work is dot products, like in a matrix multiplication. For floating point
+numbers this loses accuracy when the distance is much smaller than the norms,
+since the terms cancel. Rows that are equal still get a distance of exactly zero,
+and the rounding errors never give negative squared distances.
+
+Example:
+```
+// 1000 and 2000 points in 3 dimensions.
+std::vector<float> a(1000 * 3);
+std::vector<float> b(2000 * 3);
+std::vector<float> out(1000 * 2000);
+std::vector<float> condensed(1000 * 999 / 2);
+
+using namespace aaa;
+
+euclidean::pairwise_distances(a, b, 3, out);
+manhattan::pdist(execution::par, a, 3, condensed);
+```
+
+@{
+*/
+
+/** The number of rows of the first matrix in a tile. */
+constexpr std::size_t tile_rows = 64;
+
+/** The number of rows of the second matrix in a tile.
+They take about 128 KiB, so that they stay in the L2 cache while the rows of
+the first matrix are compared with them.
+*/
+template<typename T>
+std::size_t tile_columns(std::size_t dimension)
+{
+    constexpr auto tile_bytes = std::size_t{128 * 1024};
+    constexpr auto max_columns = std::size_t{512};
+    const auto columns = tile_bytes / (sizeof(T) * std::max(std::size_t{1}, dimension));
+    return std::max(std::size_t{8}, std::min(max_columns, columns));
+}
+
+/** The index of the pair `i < j` of `n` rows in the output of `pdist`. */
+inline std::size_t condensed_index(std::size_t n, std::size_t i, std::size_t j)
+{
+    return i * n - i * (i + 1) / 2 + j - i - 1;
+}
+
+template<typename Function>
+void for_each_tile(execution::sequenced_policy, std::size_t num_tiles, Function f)
+{
+    for (auto i = std::size_t{0}; i < num_tiles; ++i)
+    {
+        f(static_cast<std::ptrdiff_t>(i));
+    }
+}
+
+template<typename Function>
+void for_each_tile(execution::sequenced_reproducible_policy, std::size_t num_tiles, Function f)
+{
+    for_each_tile(execution::seq, num_tiles, f);
+}
+
+template<typename Tag, typename Function>
+void for_each_tile(execution::policy<Tag>, std::size_t num_tiles, Function f)
+{
+    execution::run_chunks(static_cast<std::ptrdiff_t>(num_tiles), f);
+}
+
+/** Calls `store(i, j, value)` for each row `i` of `a` and row `j` of `b`, where `value`
+is `reduce` over the elements of `map(a_i[k], b_j[k])`, computed in the type `T`.
+If `upper` is true, `a` and `b` are the same matrix, and only the pairs `i < j` are stored.
+The tiles are processed with the execution policy, and `store` is called from
+the thread of the tile.
+*/
+template<typename T, typename Reduce, typename Map, typename Tag,
+    typename InputIterator1, typename InputIterator2, typename Store>
+void for_each_pair(execution::policy<Tag> policy, InputIterator1 first_a, std::size_t num_a,
+    InputIterator2 first_b, std::size_t num_b, std::size_t dimension, bool upper, Store store)
+{
+    const auto columns = tile_columns<T>(dimension);
+    auto tiles = std::vector<std::pair<std::size_t, std::size_t>>{};
+    for (auto i = std::size_t{0}; i < num_a; i += tile_rows)
+    {
+        for (auto j = std::size_t{0}; j < num_b; j += columns)
+        {
+            // The tiles below the diagonal have no pair i < j.
+            if (!upper || std::min(num_b, j + columns) > i + 1)
+            {
+                tiles.emplace_back(i, j);
+            }
+        }
+    }
+    for_each_tile(policy, tiles.size(), [&](std::ptrdiff_t t)
+    {
+        const auto first_i = tiles[t].first;
+        const auto first_j = tiles[t].second;
+        const auto rows = std::min(tile_rows, num_a - first_i);
+        const auto cols = std::min(columns, num_b - first_j);
+        auto values = std::vector<T>(rows * cols);
+        simd::tile_distances<Reduce, Map>(
+            std::next(first_a, static_cast<std::ptrdiff_t>(first_i * dimension)), rows,
+            std::next(first_b, static_cast<std::ptrdiff_t>(first_j * dimension)), cols,
+            dimension, values.data(), cols);
+        for (auto i = std::size_t{0}; i < rows; ++i)
+        {
+            for (auto j = upper ? std::max(first_i + i + 1, first_j) - first_j : 0; j < cols; ++j)
+            {
+                store(first_i + i, first_j + j, values[i * cols + j]);
+            }
+        }
+    });
+}
+
+/** The dot products of each row with itself, computed by the same kernel as
+the dot products of the pairs, so that equal rows give the same value.
+*/
+template<typename T, typename InputIterator>
+std::vector<T> squared_norms(InputIterator first, std::size_t num_rows, std::size_t dimension)
+{
+    auto norms = std::vector<T>(num_rows);
+    for (auto i = std::size_t{0}; i < num_rows; ++i)
+    {
+        const auto row = std::next(first, static_cast<std::ptrdiff_t>(i * dimension));
+        simd::tile_distances<operations::plus, operations::multiplies>(row, 1, row, 1, dimension, norms.data() + i, 1);
+    }
+    return norms;
+}
+
+/** `|a|^2 + |b|^2 - 2 a.b`, which is never negative. */
+template<typename T>
+T squared_distance_from_dot(T squared_norm_a, T squared_norm_b, T dot)
+{
+    const auto squared_distance = T(T(squared_norm_a + squared_norm_b) - T(2) * dot);
+    return std::max(T{}, squared_distance);
+}
+
+/** @} */
+
+} // namespace pairwise
+} // namespace aaa
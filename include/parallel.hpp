@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+namespace aaa {
+namespace execution {
+
+/**
+@addtogroup parallel
+
+The algorithms have overloads that take an execution policy as their first
+argument, like the algorithms of the C++17 standard library.
+The policies are usable from C++14:
+- `aaa::execution::seq` runs the algorithm on the calling thread.
+  It gives the same result as the overload without a policy.
+- `aaa::execution::par` splits the range into chunks of `chunk_size` elements,
+  and processes the chunks on the threads of a shared pool, see @ref thread_pool.
+- `aaa::execution::par_unseq` is the same as `par`.
+  The chunks are always vectorized when possible, see @ref simd.
+
+The overloads with a policy require random access iterators.
+A reduction with `par` combines the results of the chunks in order,
+so it gives the same result for any number of threads.
+For floating point numbers it can differ from the sequential result,
+since the additions are done in a different order.
+
+The reproducible policies give bitwise identical results for `sum`,
+`euclidean::dot`, `euclidean::squared_norm`, `euclidean::norm`,
+`euclidean::squared_distance` and `euclidean::distance`, whatever the number of
+threads and the instruction set:
+- `aaa::execution::seq_reproducible` runs on the calling thread.
+- `aaa::execution::par_reproducible` runs on the shared pool,
+  and gives the same result as `seq_reproducible`.
+
+They use a reduction tree of a fixed shape. Each chunk is summed with 16
+accumulators, where element `i` goes to accumulator `i % 16`, and the
+accumulators are added pairwise. The sums of the chunks are then added pairwise.
+The result usually differs from the sequential result, and it is often more
+accurate. The multiplications and additions are not fused. With GCC the
+reductions are compiled with `-ffp-contract=off` whatever the flags of the
+program. Other compilers need `-ffp-contract=off` when the target has fused
+multiply-adds.
+The other algorithms run as with `seq` and `par`.
+
+Example:
+```
+std::vector<double> in1(100000000, 1.0);
+std::vector<double> in2(100000000, 2.0);
+std::vector<double> out(100000000);
+
+using namespace aaa;
+
+add(execution::par, in1, in2, out);
+auto d = euclidean::dot(execution::par, in1, in2);
+auto s = sum(execution::par, out);
+
+// Same bits as on the regression machine, with any number of threads.
+auto r = sum(execution::par_reproducible, out);
+```
+
+@{
+*/
+
+struct sequenced {};
+struct parallel {};
+struct parallel_unsequenced {};
+
+/** Makes the reductions of a policy reproducible. */
+template<typename Tag>
+struct reproducible {};
+
+/** An execution policy. The tag is one of `sequenced`, `parallel`, `parallel_unsequenced`,
+or `reproducible` of one of them.
+*/
+template<typename Tag>
+struct policy {};
+
+using sequenced_policy = policy<sequenced>;
+using parallel_policy = policy<parallel>;
+using parallel_unsequenced_policy = policy<parallel_unsequenced>;
+using sequenced_reproducible_policy = policy<reproducible<sequenced>>;
+using parallel_reproducible_policy = policy<reproducible<parallel>>;
+
+constexpr sequenced_policy seq{};
+constexpr parallel_policy par{};
+constexpr parallel_unsequenced_policy par_unseq{};
+constexpr sequenced_reproducible_policy seq_reproducible{};
+constexpr parallel_reproducible_policy par_reproducible{};
+
+/** The number of elements of each chunk.
+The chunk of each input fits in the L2 cache for the common element types.
+It is a multiple of 64, so that the chunks of a `std::vector<bool>` do not share words.
+*/
+constexpr std::ptrdiff_t chunk_size = 16384;
+
+/** Calls `f(i)` for `i` in `[0, num_chunks)`, on the shared thread pool.
+If `f` throws, the remaining chunks are skipped and the first exception is rethrown.
+*/
+template<typename Function>
+void run_chunks(std::ptrdiff_t num_chunks, Function f)
+{
+    default_thread_pool().run(num_chunks, f);
+}
+
+inline std::ptrdiff_t num_chunks(std::ptrdiff_t size)
+{
+    return (size + chunk_size - 1) / chunk_size;
+}
+
+/** Calls `f(first, last)` for the index range `[0, size)`. */
+template<typename Function>
+void parallel_for(sequenced_policy, std::ptrdiff_t size, Function f)
+{
+    f(std::ptrdiff_t{0}, size);
+}
+
+/** Calls `f(first, last)` for chunks of the index range `[0, size)`, in parallel. */
+template<typename Tag, typename Function>
+void parallel_for(policy<Tag>, std::ptrdiff_t size, Function f)
+{
+    if (size <= chunk_size)
+    {
+        f(std::ptrdiff_t{0}, size);
+        return;
+    }
+    run_chunks(num_chunks(size), [&](std::ptrdiff_t i)
+    {
+        f(i * chunk_size, std::min(size, (i + 1) * chunk_size));
+    });
+}
+
+/** Returns `f(0, size, init)`. */
+template<typename T, typename Function, typename Combine>
+T parallel_reduce(sequenced_policy, std::ptrdiff_t size, T init, T, Function f, Combine)
+{
+    return f(std::ptrdiff_t{0}, size, init);
+}
+
+/** Reduces chunks of the index range `[0, size)` in parallel.
+The first chunk is reduced by `f(first, last, init)` and the other chunks by
+`f(first, last, identity)`. The results of the chunks are then combined in order
+with `combine`. A range with a single chunk gives the same result as `seq`.
+*/
+template<typename Tag, typename T, typename Function, typename Combine>
+T parallel_reduce(policy<Tag>, std::ptrdiff_t size, T init, T identity, Function f, Combine combine)
+{
+    if (size <= chunk_size)
+    {
+        return f(std::ptrdiff_t{0}, size, init);
+    }
+    auto results = std::vector<T>(num_chunks(size), identity);
+    run_chunks(num_chunks(size), [&](std::ptrdiff_t i)
+    {
+        results[i] = f(i * chunk_size, std::min(size, (i + 1) * chunk_size), i == 0 ? init : identity);
+    });
+    auto result = results.front();
+    for (auto i = std::size_t{1}; i < results.size(); ++i)
+    {
+        result = combine(result, results[i]);
+    }
+    return result;
+}
+
+template<typename Function>
+void parallel_for(sequenced_reproducible_policy, std::ptrdiff_t size, Function f)
+{
+    parallel_for(seq, size, f);
+}
+
+template<typename T, typename Function, typename Combine>
+T parallel_reduce(sequenced_reproducible_policy, std::ptrdiff_t size, T init, T identity, Function f, Combine combine)
+{
+    return parallel_reduce(seq, size, init, identity, f, combine);
+}
+
+/** Calls `f(i)` for `i` in `[0, num_chunks)`, in order. */
+template<typename Function>
+void for_each_chunk(sequenced, std::ptrdiff_t num_chunks, Function f)
+{
+    for (auto i = std::ptrdiff_t{0}; i < num_chunks; ++i)
+    {
+        f(i);
+    }
+}
+
+/** Calls `f(i)` for `i` in `[0, num_chunks)`, on the shared thread pool. */
+template<typename Tag, typename Function>
+void for_each_chunk(Tag, std::ptrdiff_t num_chunks, Function f)
+{
+    run_chunks(num_chunks, f);
+}
+
+/** Adds the values by splitting them in halves, recursively. The size should not be 0. */
+template<typename T>
+T pairwise_sum(const T* values, std::size_t size)
+{
+    if (size == 1)
+    {
+        return values[0];
+    }
+    const auto half = size / 2;
+    return T(pairwise_sum(values, half) + pairwise_sum(values + half, size - half));
+}
+
+/** Computes `init + (map(left[0], right[0]) + map(left[1], right[1]) + ...)`
+with a reduction tree that does not depend on the number of threads.
+Each chunk is summed by `simd::lane_sum`, and the sums of the chunks are added by `pairwise_sum`.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename T, typename Map>
+T reproducible_sum(policy<reproducible<Tag>>,
+    InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init, Map map)
+{
+    const auto size = std::distance(first_left, last_left);
+    if (size == 0)
+    {
+        return init;
+    }
+    auto sums = std::vector<T>(num_chunks(size));
+    for_each_chunk(Tag{}, num_chunks(size), [&](std::ptrdiff_t i)
+    {
+        const auto first = i * chunk_size;
+        const auto last = std::min(size, first + chunk_size);
+        sums[i] = simd::lane_sum<T>(first_left + first, first_left + last, first_right + first, map);
+    });
+    return T(init + pairwise_sum(sums.data(), sums.size()));
+}
+
+/** @} */
+
+} // namespace execution
+} // namespace aaa
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "euclidean_space.hpp"
+#include "kmeans.hpp"
+#include "neighbors.hpp"
+#include "pairwise.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "traits.hpp"
+
+namespace aaa {
+namespace pq {
+
+/**
+@addtogroup product_quantization
+
+Product quantization compresses vectors to a few bytes each, and estimates
+their Euclidean distances to a query without decompressing them. The vectors
+are split in `num_subspaces` parts of `dimension / num_subspaces` elements:
+- Each subspace has a codebook of up to 256 centroids, that are trained by
+  k-means, see @ref kmeans, on the parts of a sample of the vectors: at most
+  `training_rows_per_centroid` evenly spaced rows per centroid.
+- A vector is encoded by the index of the nearest centroid of each part, so it
+  takes `num_subspaces` bytes. A vector of 128 floats in 16 subspaces is
+  compressed from 512 to 16 bytes.
+- For a query, a table has the squared distances of each part of the query to
+  each centroid of its subspace. The squared distance to an encoded vector is
+  estimated by summing one entry of the table per subspace, which is called
+  asymmetric distance computation. For `float` the SIMD kernels gather the
+  entries of several codes at a time, see @ref simd.
+- `search` finds the candidates with the smallest estimated distances, and
+  re-ranks them by their exact distances to the original vectors.
+
+The matrices of vectors and codes are stored row by row, like in @ref pairwise.
+
+Example:
+```
+// 1000000 vectors and 100 queries of 128 floats.
+std::vector<float> data(1000000 * 128);
+std::vector<float> queries(100 * 128);
+
+using namespace aaa;
+
+// Train 16 codebooks of 256 centroids, and encode the vectors in 16 bytes each.
+const auto quantizer = pq::product_quantizer<float>(execution::par, data, 128, 16);
+std::vector<std::uint8_t> codes(1000000 * 16);
+quantizer.encode(execution::par, data, codes);
+
+// The 10 nearest vectors of each query, re-ranked from 100 candidates.
+std::vector<std::size_t> indices(100 * 10);
+std::vector<float> distances(100 * 10);
+quantizer.search(execution::par, queries, codes, data, 10, 100, indices, distances);
+```
+
+@{
+*/
+
+/** The codebooks are trained on at most this number of rows per centroid.
+More rows barely move the centroids, and k-means reads all of them at each iteration.
+*/
+constexpr std::size_t training_rows_per_centroid = 256;
+
+/** A product quantizer of vectors of `T`, with a codebook for each subspace. */
+template<typename T>
+class product_quantizer
+{
+public:
+    /** Trains the codebooks on the rows of `data`, with an execution policy.
+    Each codebook is trained by `iterations` of k-means on a sample of at most
+    `training_rows_per_centroid * num_centroids` evenly spaced rows, starting from evenly spaced rows.
+    The data should have at least `num_centroids` rows, and `num_centroids` is at most 256.
+    */
+    template<typename Tag, typename Container>
+    product_quantizer(execution::policy<Tag> policy, const Container& data, std::size_t dimension,
+        std::size_t num_subspaces, std::size_t num_centroids = 256, std::size_t iterations = 25)
+        : dimension_(dimension), num_subspaces_(num_subspaces), num_centroids_(num_centroids)
+    {
+        assert(num_subspaces > 0 && dimension % num_subspaces == 0);
+        assert(num_centroids > 0 && num_centroids <= 256);
+        assert(data.size() % dimension == 0 && data.size() / dimension >= num_centroids);
+        codebooks_.resize(num_subspaces * num_centroids * subspace_dimension());
+        using std::begin;
+        const auto num_rows = data.size() / dimension;
+        const auto num_samples = std::min(num_rows, training_rows_per_centroid * num_centroids);
+        for (auto j = std::size_t{0}; j < num_subspaces; ++j)
+        {
+            const auto parts = subspace_parts(begin(data), num_rows, j, num_samples);
+            train_codebook(policy, parts, j, iterations);
+        }
+    }
+
+    /** Trains the codebooks on the rows of `data`. */
+    template<typename Container>
+    product_quantizer(const Container& data, std::size_t dimension,
+        std::size_t num_subspaces, std::size_t num_centroids = 256, std::size_t iterations = 25)
+        : product_quantizer(execution::seq, data, dimension, num_subspaces, num_centroids, iterations)
+    {
+    }
+
+    /** Restores a quantizer from the codebooks of another one. */
+    product_quantizer(std::size_t dimension, std::size_t num_subspaces, std::size_t num_centroids, std::vector<T> codebooks)
+        : dimension_(dimension), num_subspaces_(num_subspaces), num_centroids_(num_centroids),
+        codebooks_(std::move(codebooks))
+    {
+        assert(codebooks_.size() == num_subspaces * num_centroids * subspace_dimension());
+    }
+
+    std::size_t dimension() const { return dimension_; }
+    std::size_t num_subspaces() const { return num_subspaces_; }
+    std::size_t num_centroids() const { return num_centroids_; }
+    std::size_t subspace_dimension() const { return dimension_ / num_subspaces_; }
+
+    /** The centroids of each subspace, one after the other. */
+    const std::vector<T>& codebooks() const { return codebooks_; }
+
+    /** Encodes each row of `data` in `num_subspaces` bytes, with an execution policy.
+    The size of the codes should be `num_rows * num_subspaces`.
+    */
+    template<typename Tag, typename Container>
+    void encode(execution::policy<Tag> policy, const Container& data, std::vector<std::uint8_t>& codes) const
+    {
+        assert(data.size() % dimension_ == 0);
+        const auto num_rows = data.size() / dimension_;
+        assert(codes.size() == num_rows * num_subspaces_);
+        using std::begin;
+        auto nearest = std::vector<std::size_t>(num_rows);
+        auto distances = std::vector<T>(num_rows);
+        for (auto j = std::size_t{0}; j < num_subspaces_; ++j)
+        {
+            const auto parts = subspace_parts(begin(data), num_rows, j, num_rows);
+            euclidean::nearest_neighbors(policy, codebook(j), parts, subspace_dimension(), 1, nearest, distances);
+            for (auto i = std::size_t{0}; i < num_rows; ++i)
+            {
+                codes[i * num_subspaces_ + j] = static_cast<std::uint8_t>(nearest[i]);
+            }
+        }
+    }
+
+    /** Encodes each row of `data` in `num_subspaces` bytes. */
+    template<typename Container>
+    void encode(const Container& data, std::vector<std::uint8_t>& codes) const
+    {
+        encode(execution::seq, data, codes);
+    }
+
+    /** Replaces each row of codes by the centroids that it selects.
+    The size of the output should be `num_rows * dimension`.
+    */
+    template<typename Container>
+    void decode(const std::vector<std::uint8_t>& codes, Container& out) const
+    {
+        assert(codes.size() % num_subspaces_ == 0);
+        assert(out.size() == codes.size() / num_subspaces_ * dimension_);
+        using std::begin;
+        const auto part_size = subspace_dimension();
+        auto it = begin(out);
+        for (auto i = std::size_t{0}; i < codes.size(); ++i)
+        {
+            const auto centroid = centroid_begin(i % num_subspaces_, codes[i]);
+            it = std::copy(centroid, centroid + static_cast<std::ptrdiff_t>(part_size), it);
+        }
+    }
+
+    /** Computes the table of the squared distances of each part of the query to
+    each centroid of its subspace. The table has `num_subspaces * num_centroids` entries.
+    */
+    template<typename InputIterator>
+    void distance_table(InputIterator query, std::vector<T>& table) const
+    {
+        table.resize(num_subspaces_ * num_centroids_);
+        const auto part_size = static_cast<std::ptrdiff_t>(subspace_dimension());
+        for (auto j = std::size_t{0}; j < num_subspaces_; ++j)
+        {
+            const auto first = table.begin() + static_cast<std::ptrdiff_t>(j * num_centroids_);
+            euclidean::squared_distances(query, std::next(query, part_size), centroid_begin(j, 0),
+                first, first + static_cast<std::ptrdiff_t>(num_centroids_));
+            std::advance(query, part_size);
+        }
+    }
+
+    /** Estimates the squared distances of the query of the table to each row of codes.
+    The size of the output should be `num_rows`.
+    */
+    void asymmetric_distances(const std::vector<T>& table, const std::vector<std::uint8_t>& codes, std::vector<T>& out) const
+    {
+        assert(table.size() == num_subspaces_ * num_centroids_);
+        assert(out.size() * num_subspaces_ == codes.size());
+        simd::table_lookup_sums(table.data(), num_centroids_, codes.data(), num_subspaces_, out.size(), out.data());
+    }
+
+    /** Finds the `k` nearest rows of `data` to each query, with an execution policy.
+    The `num_candidates` rows with the smallest estimated distances are re-ranked
+    by their exact distances to the rows of `data`, that are encoded by `codes`.
+    The indices and the Euclidean distances are written from the nearest to the farthest,
+    and their sizes should be `num_queries * k`. Equal distances are ordered by index.
+    */
+    template<typename Tag, typename Container1, typename Container2, typename Container3, typename Container4>
+    void search(execution::policy<Tag> policy, const Container1& queries, const std::vector<std::uint8_t>& codes,
+        const Container2& data, std::size_t k, std::size_t num_candidates, Container3& indices, Container4& distances) const
+    {
+        assert(queries.size() % dimension_ == 0);
+        const auto num_queries = queries.size() / dimension_;
+        const auto num_rows = codes.size() / num_subspaces_;
+        assert(data.size() == num_rows * dimension_);
+        assert(k <= num_candidates && num_candidates <= num_rows);
+        assert(indices.size() == num_queries * k);
+        assert(distances.size() == indices.size());
+        if (k == 0)
+        {
+            return;
+        }
+        using std::begin;
+        pairwise::for_each_tile(policy, num_queries, [&](std::ptrdiff_t q)
+        {
+            const auto query = std::next(begin(queries), q * static_cast<std::ptrdiff_t>(dimension_));
+            auto table = std::vector<T>{};
+            distance_table(query, table);
+            auto estimates = std::vector<T>(num_rows);
+            asymmetric_distances(table, codes, estimates);
+            auto candidates = neighbors::bounded_heap<T>(num_candidates);
+            for (auto i = std::size_t{0}; i < num_rows; ++i)
+            {
+                candidates.push(estimates[i], i);
+            }
+            auto nearest = neighbors::bounded_heap<T>(k);
+            for (const auto& candidate : candidates.take_sorted())
+            {
+                const auto row = std::next(begin(data), static_cast<std::ptrdiff_t>(candidate.second * dimension_));
+                const auto last_query = std::next(query, static_cast<std::ptrdiff_t>(dimension_));
+                nearest.push(euclidean::squared_distance(query, last_query, row, T{}), candidate.second);
+            }
+            auto n = static_cast<std::ptrdiff_t>(q) * static_cast<std::ptrdiff_t>(k);
+            for (const auto& neighbor : nearest.take_sorted())
+            {
+                *std::next(begin(indices), n) = static_cast<value_type<Container3>>(neighbor.second);
+                *std::next(begin(distances), n) = std::sqrt(neighbor.first);
+                ++n;
+            }
+        });
+    }
+
+    /** Finds the `k` nearest rows of `data` to each query, re-ranked from `num_candidates`. */
+    template<typename Container1, typename Container2, typename Container3, typename Container4>
+    void search(const Container1& queries, const std::vector<std::uint8_t>& codes, const Container2& data,
+        std::size_t k, std::size_t num_candidates, Container3& indices, Container4& distances) const
+    {
+        search(execution::seq, queries, codes, data, k, num_candidates, indices, distances);
+    }
+
+private:
+    typename std::vector<T>::const_iterator centroid_begin(std::size_t subspace, std::size_t centroid) const
+    {
+        const auto offset = (subspace * num_centroids_ + centroid) * subspace_dimension();
+        return codebooks_.begin() + static_cast<std::ptrdiff_t>(offset);
+    }
+
+    std::vector<T> codebook(std::size_t subspace) const
+    {
+        const auto first = centroid_begin(subspace, 0);
+        return std::vector<T>(first, first + static_cast<std::ptrdiff_t>(num_centroids_ * subspace_dimension()));
+    }
+
+    /** The parts in a subspace of `num_samples` evenly spaced rows, or of all the rows when
+    `num_samples == num_rows`, as a matrix with rows of `subspace_dimension` elements.
+    */
+    template<typename InputIterator>
+    std::vector<T> subspace_parts(InputIterator first, std::size_t num_rows, std::size_t subspace,
+        std::size_t num_samples) const
+    {
+        const auto part_size = subspace_dimension();
+        auto parts = std::vector<T>(num_samples * part_size);
+        std::advance(first, static_cast<std::ptrdiff_t>(subspace * part_size));
+        auto row = std::size_t{0};
+        for (auto i = std::size_t{0}; i < num_samples; ++i)
+        {
+            const auto sample_row = i * num_rows / num_samples;
+            std::advance(first, static_cast<std::ptrdiff_t>((sample_row - row) * dimension_));
+            row = sample_row;
+            std::copy_n(first, part_size, parts.begin() + static_cast<std::ptrdiff_t>(i * part_size));
+        }
+        return parts;
+    }
+
+    /** Lloyd's k-means, see @ref kmeans. A centroid that has no parts keeps its position. */
+    template<typename Tag>
+    void train_codebook(execution::policy<Tag> policy, const std::vector<T>& parts, std::size_t subspace,
+        std::size_t iterations)
+    {
+        const auto part_size = subspace_dimension();
+        const auto num_rows = parts.size() / part_size;
+        auto centroids = std::vector<T>(num_centroids_ * part_size);
+        for (auto c = std::size_t{0}; c < num_centroids_; ++c)
+        {
+            const auto row = c * num_rows / num_centroids_;
+            std::copy_n(parts.begin() + static_cast<std::ptrdiff_t>(row * part_size), part_size,
+                centroids.begin() + static_cast<std::ptrdiff_t>(c * part_size));
+        }
+        centroids = kmeans::lloyd(policy, parts, part_size, std::move(centroids), iterations).centroids;
+        std::copy(centroids.begin(), centroids.end(), codebooks_.begin() +
+            static_cast<std::ptrdiff_t>(subspace * num_centroids_ * part_size));
+    }
+
+    std::size_t dimension_;
+    std::size_t num_subspaces_;
+    std::size_t num_centroids_;
+    std::vector<T> codebooks_;
+};
+
+/** @} */
+
+} // namespace pq
+} // namespace aaa
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "operations.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "traits.hpp"
+
+namespace aaa {
+
+/**
+@addtogroup reductions
+
+`reduce_many` computes several reductions of the same range in a single pass,
+and returns their results in a `std::tuple`, in the order of the reductions.
+Computing the reductions one by one reads the range once per reduction, which
+is the bottleneck when the range does not fit in the cache.
+
+The reductions are given by descriptors from the namespace `reductions`:
+- `reductions::sum`, like `sum`.
+- `reductions::squared_norm`, like `euclidean::squared_norm`.
+- `reductions::euclidean_norm`, like `euclidean::norm`.
+- `reductions::manhattan_norm`, like `manhattan::norm`.
+- `reductions::maximum_norm`, like `maximum::norm`.
+- `reductions::count`, the number of elements.
+
+Each descriptor names the operations of @ref simd that reduce the elements: `reduce`
+combines the partial result with `map(x, x)` for each element `x`, starting from 0.
+The reductions are computed in the `accumulator_type_t` of the elements, like
+`euclidean::squared_norm` and `manhattan::norm`, so that the 8 and 16 bit
+integers do not overflow. The SIMD kernels keep two accumulators per reduction,
+and share the loads of the elements. Like `dot`, the kernels only vectorize floating point numbers, and the
+sums then depend on the order of the additions, which differs from `sum` in the
+last bits. With an execution policy, the chunks of the range are reduced in
+parallel and combined in order.
+
+Example:
+```
+std::vector<float> a = { 1, -2, 3, -4 };
+
+using namespace aaa;
+
+const auto results = reduce_many(a, reductions::sum{}, reductions::manhattan_norm{},
+    reductions::maximum_norm{}, reductions::count{});
+// std::get<0>(results) == -2, std::get<1>(results) == 10, std::get<2>(results) == 4,
+// std::get<3>(results) == 4.
+
+// The same in parallel.
+const auto parallel = reduce_many(execution::par, a, reductions::sum{}, reductions::count{});
+```
+
+@{
+*/
+
+/** Descriptors of the reductions of `reduce_many`.
+They live in their own namespace, like `operations`.
+*/
+namespace reductions {
+
+/** The base of the descriptors, that tells them apart from the ranges. */
+struct reduction
+{
+};
+
+/** The sum of the elements. */
+struct sum : reduction
+{
+    using reduce = operations::plus;
+    using map = operations::first_operand;
+    template<typename T> static T result(T value, std::size_t) { return value; }
+};
+
+/** The sum of the squared elements. */
+struct squared_norm : reduction
+{
+    using reduce = operations::plus;
+    using map = operations::multiplies;
+    template<typename T> static T result(T value, std::size_t) { return value; }
+};
+
+/** The square root of the sum of the squared elements, following the same convention as `std::sqrt`. */
+struct euclidean_norm : reduction
+{
+    using reduce = operations::plus;
+    using map = operations::multiplies;
+    template<typename T> static sqrt_type_t<T> result(T value, std::size_t) { return std::sqrt(sqrt_type_t<T>(value)); }
+};
+
+/** The sum of the absolute values of the elements. */
+struct manhattan_norm : reduction
+{
+    using reduce = operations::plus;
+    using map = operations::powered_absolute<1>;
+    template<typename T> static T result(T value, std::size_t) { return value; }
+};
+
+/** The largest absolute value of the elements, or 0 for an empty range. */
+struct maximum_norm : reduction
+{
+    using reduce = operations::maximum;
+    using map = operations::powered_absolute<1>;
+    template<typename T> static T result(T value, std::size_t) { return value; }
+};
+
+/** The number of elements. The kernels keep its value, and do not read anything for it. */
+struct count : reduction
+{
+    using reduce = operations::first_operand;
+    using map = operations::first_operand;
+    template<typename T> static std::size_t result(T, std::size_t size) { return size; }
+};
+
+/** True if all the types are descriptors of reductions. */
+template<typename... Reductions>
+using are_reductions = std::is_same<
+    std::integer_sequence<bool, true, std::is_base_of<reduction, Reductions>::value...>,
+    std::integer_sequence<bool, std::is_base_of<reduction, Reductions>::value..., true>>;
+
+/** The results of the reductions of elements of type `T`, which are computed in `accumulator_type_t<T>`. */
+template<typename T, typename... Reductions>
+using results_t = std::tuple<decltype(Reductions::result(accumulator_type_t<T>{}, std::size_t{}))...>;
+
+/** Combines the partial results of two chunks, by the `reduce` of each reduction. */
+template<typename... Reductions, typename T, std::size_t N, std::size_t... I>
+std::array<T, N> combine(const std::array<T, N>& left, const std::array<T, N>& right, std::index_sequence<I...>)
+{
+    return {{ T(typename Reductions::reduce{}(left[I], right[I]))... }};
+}
+
+/** The results of the reductions, from their partial results and the number of elements. */
+template<typename... Reductions, typename T, std::size_t N, std::size_t... I>
+results_t<T, Reductions...> results(const std::array<T, N>& values, std::size_t size, std::index_sequence<I...>)
+{
+    return results_t<T, Reductions...>(Reductions::result(values[I], size)...);
+}
+
+} // namespace reductions
+
+/** Computes several reductions of a range in a single pass.
+Returns a tuple with the result of each reduction.
+*/
+template<typename InputIterator, typename... Reductions>
+reductions::results_t<value_type_i<InputIterator>, Reductions...>
+reduce_many(InputIterator first, InputIterator last, Reductions...)
+{
+    using T = accumulator_type_t<value_type_i<InputIterator>>;
+    const auto size = static_cast<std::size_t>(std::distance(first, last));
+    const auto values = simd::reduce_many<T, Reductions...>(first, last);
+    return reductions::results<Reductions...>(values, size, std::index_sequence_for<Reductions...>{});
+}
+
+/** Computes several reductions of a container in a single pass.
+Returns a tuple with the result of each reduction.
+*/
+template<typename Container, typename... Reductions,
+    typename = std::enable_if_t<reductions::are_reductions<Reductions...>::value>>
+reductions::results_t<value_type<Container>, Reductions...>
+reduce_many(const Container& a, Reductions... descriptors)
+{
+    using std::begin;
+    using std::end;
+    return reduce_many(begin(a), end(a), descriptors...);
+}
+
+/** Computes several reductions of a range in a single pass, with an execution policy.
+The chunks of the range are reduced in parallel, and combined in order.
+*/
+template<typename Tag, typename InputIterator, typename... Reductions>
+reductions::results_t<value_type_i<InputIterator>, Reductions...>
+reduce_many(execution::policy<Tag> policy, InputIterator first, InputIterator last, Reductions...)
+{
+    using T = accumulator_type_t<value_type_i<InputIterator>>;
+    using values_t = std::array<T, sizeof...(Reductions)>;
+    const auto f = [&](std::ptrdiff_t first_chunk, std::ptrdiff_t last_chunk, values_t init_chunk)
+    {
+        const auto values = simd::reduce_many<T, Reductions...>(first + first_chunk, first + last_chunk);
+        return reductions::combine<Reductions...>(init_chunk, values, std::index_sequence_for<Reductions...>{});
+    };
+    const auto combine = [](const values_t& left, const values_t& right)
+    {
+        return reductions::combine<Reductions...>(left, right, std::index_sequence_for<Reductions...>{});
+    };
+    const auto size = std::distance(first, last);
+    const auto values = execution::parallel_reduce(policy, size, values_t{}, values_t{}, f, combine);
+    return reductions::results<Reductions...>(values, static_cast<std::size_t>(size),
+        std::index_sequence_for<Reductions...>{});
+}
+
+/** Computes several reductions of a container in a single pass, with an execution policy.
+The chunks of the container are reduced in parallel, and combined in order.
+*/
+template<typename Tag, typename Container, typename... Reductions,
+    typename = std::enable_if_t<reductions::are_reductions<Reductions...>::value>>
+reductions::results_t<value_type<Container>, Reductions...>
+reduce_many(execution::policy<Tag> policy, const Container& a, Reductions... descriptors)
+{
+    using std::begin;
+    using std::end;
+    return reduce_many(policy, begin(a), end(a), descriptors...);
+}
+
+/** @} */
+
+} // namespace aaa
@@ -0,0 +1,2660 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "accuracy.hpp"
+#include "dispatch.hpp"
+#include "operations.hpp"
+#include "traits.hpp"
+
+// The reproducible and accurate reductions need each multiplication and addition
+// to be rounded separately. GCC contracts them to fused multiply-adds by default
+// in C++, even with -std=c++14, as soon as the target has them. The kernels and
+// the loops of these reductions are compiled without contraction. The explicit
+// fused multiply-adds of the kernels are not affected.
+#if defined(__GNUC__) && !defined(__clang__)
+#define AAA_NO_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+#define AAA_NO_CONTRACT
+#endif
+
+// The loops over the registers of a tile are unrolled, so that the registers are
+// not spilled to the stack. GCC does not unroll them at -O2 without the pragma,
+// which it has since version 8.
+#if defined(__clang__)
+#define AAA_UNROLL _Pragma("unroll 8")
+#elif defined(__GNUC__) && __GNUC__ >= 8
+#define AAA_UNROLL _Pragma("GCC unroll 8")
+#else
+#define AAA_UNROLL
+#endif
+
+// The kernels of each instruction set are compiled with the target attribute,
+// so the library does not need to be built with for example -mavx2.
+// They are only selected at runtime if the CPU supports them.
+#if AAA_SIMD
+#include <immintrin.h>
+#define AAA_TARGET_SSE42 __attribute__((target("sse4.2,popcnt"))) AAA_NO_CONTRACT
+#define AAA_TARGET_AVX2 __attribute__((target("avx2,fma,popcnt"))) AAA_NO_CONTRACT
+#define AAA_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx2,fma,popcnt"))) AAA_NO_CONTRACT
+#endif
+
+namespace aaa {
+namespace simd {
+
+/**
+@addtogroup simd
+
+This module routes some of the algorithms to hand written SIMD kernels,
+when the inputs and outputs are contiguous ranges of the same arithmetic type.
+Contiguous ranges are given by pointers, or iterators of `std::vector`,
+`std::array` and `std::valarray`. For all other ranges and types the generic
+algorithms of the standard library are used as a fallback.
+
+The accelerated algorithms are:
+- The elementwise operations: @ref add, @ref subtract, @ref multiply, @ref divide.
+- The fused operations: `axpy`, `axpby`, `lerp`, `weighted_blend`,
+  for floating point types.
+- The reduction `sum`, for integer types. It is not used for floating point
+  types, since changing the order of the additions would change the result.
+- The products `euclidean::dot`, `euclidean::squared_norm` and
+  `euclidean::squared_distance`, for integer and floating point types.
+  The kernels unroll the loop over several accumulators, and use fused
+  multiply-adds when the CPU has them. For floating point types the last bits
+  of the result depend on the instruction set. `int8_t` and `uint8_t`
+  elements with an `int32_t` init, and `int16_t`, `uint16_t` and `int32_t`
+  elements with an `int64_t` init, are accumulated in the wider type.
+- The quantized distance `manhattan::distance`, for `int8_t` and `uint8_t`
+  elements with an `int32_t` init.
+- The quantization `quantize` and `dequantize`, between `float` and `int8_t`
+  or `uint8_t`.
+- The accuracy policies of `sum`, `euclidean::dot` and `euclidean::squared_norm`,
+  see @ref accuracy, for floating point types.
+- The reproducible reductions, see @ref parallel, for floating point types.
+  They add the elements in a fixed order that does not depend on the
+  instruction set.
+- The distances of a query to each row of a matrix, `euclidean::squared_distances`,
+  `manhattan::distances`, `maximum::distances` and the others, for floating
+  point types, and the pairwise distances, see @ref pairwise. The kernels
+  compare tiles of several rows in the registers.
+- The bounded distances `euclidean::squared_distance_bounded`,
+  `manhattan::distance_bounded` and `maximum::distance_bounded`, for floating
+  point types.
+- The table lookups of product quantization, see @ref product_quantization,
+  for `float`. The kernels gather the entries of several codes at a time.
+- The fused sums of `euclidean::cosine_similarity`, for floating point types.
+  The dot product and the two squared norms are computed in a single pass.
+- The bit counts of the Hamming space, see @ref hamming_space. They use the
+  popcnt instruction, and for long codes the kernels look up the counts of
+  the halves of the bytes in a table.
+- The search: `min_element`, `max_element`.
+
+The kernels are selected at runtime, see @ref dispatch.
+
+@{
+*/
+
+using operations::plus;
+using operations::minus;
+using operations::multiplies;
+using operations::divides;
+using operations::minimum;
+using operations::maximum;
+
+////////////////////////////////////////////////////////////////////////////////
+// traits
+
+template<typename...>
+using void_t = void;
+
+template<typename Iterator>
+using element_t = typename std::remove_cv<value_type_i<Iterator>>::type;
+
+template<typename T>
+struct is_simd_element : std::integral_constant<bool,
+    std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>
+{};
+
+/** True for iterators that point into a contiguous array of arithmetic elements. */
+template<typename Iterator, bool = is_simd_element<element_t<Iterator>>::value>
+struct is_contiguous_iterator : std::false_type {};
+
+template<typename Iterator>
+struct is_contiguous_iterator<Iterator, true> : std::integral_constant<bool,
+    std::is_pointer<Iterator>::value ||
+    std::is_same<Iterator, typename std::vector<element_t<Iterator>>::iterator>::value ||
+    std::is_same<Iterator, typename std::vector<element_t<Iterator>>::const_iterator>::value>
+{};
+
+template<typename Iterator>
+auto to_pointer(Iterator it) { return &*it; }
+
+template<typename T>
+T* to_pointer(T* it) { return it; }
+
+template<std::size_t Size> struct sized_int {};
+template<> struct sized_int<1> { using type = std::int8_t; };
+template<> struct sized_int<2> { using type = std::int16_t; };
+template<> struct sized_int<4> { using type = std::int32_t; };
+template<> struct sized_int<8> { using type = std::int64_t; };
+
+/** A tag that selects the instruction for a given type of element. */
+template<typename T> struct lane {};
+
+template<typename T, bool Wraps, bool = std::is_integral<T>::value && is_simd_element<T>::value>
+struct lane_of { using type = lane<T>; };
+
+template<typename T, bool Wraps>
+struct lane_of<T, Wraps, true>
+{
+    using sized = typename sized_int<sizeof(T)>::type;
+    using type = lane<typename std::conditional<Wraps || std::is_signed<T>::value,
+        sized, typename std::make_unsigned<sized>::type>::type>;
+};
+
+/** Integers of the same size share the same instructions for the wrapping
+operations, regardless of their signedness. Other operations distinguish them.
+*/
+template<typename Op, typename T>
+using lane_t = typename lane_of<T, Op::wraps>::type;
+
+/** True if `Op(Element, T)` converted back to `T` gives the same result as
+`Op(T(Element), T)`, so that a scalar can be broadcast to a SIMD register. */
+template<typename Op, typename Element, typename T>
+struct is_exact_broadcast : std::integral_constant<bool,
+    std::is_same<typename std::common_type<Element, T>::type, T>::value ||
+    (Op::wraps && std::is_integral<Element>::value && std::is_integral<T>::value)>
+{};
+
+////////////////////////////////////////////////////////////////////////////////
+// lanes
+
+/** The number of accumulators of `lane_sum`. It does not depend on the instruction set. */
+constexpr std::size_t num_lanes = 16;
+
+/** Adds the accumulators in a fixed pairwise order. */
+template<typename T>
+T reduce_lanes(T* lanes)
+{
+    for (auto width = num_lanes / 2; width > 0; width /= 2)
+    {
+        for (auto j = std::size_t{0}; j < width; ++j)
+        {
+            lanes[j] = T(lanes[j] + lanes[j + width]);
+        }
+    }
+    return lanes[0];
+}
+
+/** Adds the terms of the elements `[first, size)` to their accumulators, then reduces the accumulators.
+The elements are converted to `T` before they are mapped, so that the products of
+integers are computed in the type of the accumulators.
+*/
+template<typename Map, typename T, typename InputIterator1, typename InputIterator2>
+AAA_NO_CONTRACT T lane_sum_loop(InputIterator1 left, InputIterator2 right, std::size_t first, std::size_t size, T* lanes)
+{
+    for (auto i = first; i < size; ++i, ++left, ++right)
+    {
+        const auto term = T(Map{}(T(*left), T(*right)));
+        lanes[i % num_lanes] = T(lanes[i % num_lanes] + term);
+    }
+    return reduce_lanes(lanes);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// widening
+
+template<typename T> struct wide {};
+template<> struct wide<std::int8_t> { using type = std::int32_t; };
+template<> struct wide<std::uint8_t> { using type = std::int32_t; };
+template<> struct wide<std::int16_t> { using type = std::int64_t; };
+template<> struct wide<std::uint16_t> { using type = std::int64_t; };
+template<> struct wide<std::int32_t> { using type = std::int64_t; };
+
+/** The type of the accumulators of the widening reductions of `T`. */
+template<typename T>
+using wide_t = typename wide<T>::type;
+
+/** Adds the accumulators of a widening reduction, and the absolute differences of the elements `[first, size)`. */
+template<typename Wide, std::size_t NumLanes, typename Lane, typename T>
+Wide widening_absolute_tail(const Lane (&lanes)[NumLanes], const T* left, const T* right, std::size_t first, std::size_t size)
+{
+    auto result = Wide{};
+    for (auto x : lanes)
+    {
+        result = Wide(result + x);
+    }
+    for (auto i = first; i < size; ++i)
+    {
+        result = Wide(result + operations::absolute_difference{}(Wide(left[i]), Wide(right[i])));
+    }
+    return result;
+}
+
+/** Adds the accumulators of a widening reduction, and the terms of the elements `[first, size)`. */
+template<typename Wide, std::size_t NumLanes, typename T>
+Wide widening_tail(const Wide (&lanes)[NumLanes], const T* left, const T* right,
+    std::size_t first, std::size_t size, bool difference)
+{
+    auto result = Wide{};
+    for (auto x : lanes)
+    {
+        result = Wide(result + x);
+    }
+    for (auto i = first; i < size; ++i)
+    {
+        const auto a = difference ? Wide(Wide(left[i]) - Wide(right[i])) : Wide(left[i]);
+        const auto b = difference ? a : Wide(right[i]);
+        result = Wide(result + a * b);
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// quantization
+
+/** The largest value of `T` that fits in the integer type `Out`.
+The largest value of `Out` is `2^digits - 1`, which rounds up to `2^digits` when `T`
+has fewer digits, and then the conversion back to `Out` would overflow.
+*/
+template<typename Out, typename T>
+T quantize_highest()
+{
+    const auto highest = T(std::numeric_limits<Out>::max());
+    return highest == std::ldexp(T(1), std::numeric_limits<Out>::digits) ? std::nextafter(highest, T{}) : highest;
+}
+
+/** The kernels clamp the quotients to `[-quantize_bound, quantize_bound]` before they convert them to `int32_t`. */
+constexpr auto quantize_bound = float(std::int32_t{1} << 30);
+
+/** The kernels are only used for zero points in `[-max_zero_point, max_zero_point]`: then the sums
+do not overflow, and they are exact in `float` as in `quantize_loop`, whenever they are in the range of the output.
+*/
+constexpr auto max_zero_point = std::int32_t{1} << 24;
+
+/** Computes `out[i] = round(in[i] / scale) + zero_point`, rounded to nearest even and clamped to the range of the output. */
+template<typename InputIterator, typename T, typename OutputIterator>
+void quantize_loop(InputIterator first_in, InputIterator last_in, T scale, int zero_point, OutputIterator first_out)
+{
+    using Out = element_t<OutputIterator>;
+    const auto lowest = T(std::numeric_limits<Out>::lowest());
+    const auto highest = quantize_highest<Out, T>();
+    for (; first_in != last_in; ++first_in, ++first_out)
+    {
+        const auto q = T(std::nearbyint(T(*first_in) / scale) + T(zero_point));
+        *first_out = Out(std::min(highest, std::max(lowest, q)));
+    }
+}
+
+/** Computes `out[i] = (in[i] - zero_point) * scale`. */
+template<typename InputIterator, typename T, typename OutputIterator>
+void dequantize_loop(InputIterator first_in, InputIterator last_in, T scale, int zero_point, OutputIterator first_out)
+{
+    for (; first_in != last_in; ++first_in, ++first_out)
+    {
+        *first_out = element_t<OutputIterator>(T(int(*first_in) - zero_point) * scale);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// accuracy
+
+/** The size of the blocks of `accuracy::pairwise`, that are summed directly. */
+constexpr std::size_t pairwise_block_size = 1024;
+
+/** Splits a range of more than `pairwise_block_size` elements at a multiple of the block size. */
+inline std::size_t pairwise_split(std::size_t size)
+{
+    return (size / 2 + pairwise_block_size - 1) / pairwise_block_size * pairwise_block_size;
+}
+
+/** Adds `x` to `sum`, and sets `error` to the exact rounding error of the addition. */
+template<typename T>
+AAA_NO_CONTRACT void two_sum(T& sum, T x, T& error)
+{
+    const auto s = T(sum + x);
+    const auto z = T(s - sum);
+    error = T(T(sum - T(s - z)) + T(x - z));
+    sum = s;
+}
+
+/** `2^ceil(digits / 2) + 1`, that splits a floating point number in two halves. */
+template<typename T>
+T split_factor()
+{
+    return T(std::ldexp(T(1), (std::numeric_limits<T>::digits + 1) / 2) + 1);
+}
+
+/** The exact rounding error of the product `p = a * b`, without fused multiply-add. */
+template<typename T>
+AAA_NO_CONTRACT T split_product_error(T a, T b, T p)
+{
+    const auto ca = T(split_factor<T>() * a);
+    const auto cb = T(split_factor<T>() * b);
+    const auto a_high = T(ca - T(ca - a));
+    const auto b_high = T(cb - T(cb - b));
+    const auto a_low = T(a - a_high);
+    const auto b_low = T(b - b_high);
+    auto error = T(T(a_high * b_high) - p);
+    error = T(error + T(a_high * b_low));
+    error = T(error + T(a_low * b_high));
+    return T(error + T(a_low * b_low));
+}
+
+template<typename Map, typename T, typename InputIterator1, typename InputIterator2>
+AAA_NO_CONTRACT T pairwise_sum_loop(InputIterator1 left, InputIterator2 right, std::size_t size)
+{
+    if (size <= pairwise_block_size)
+    {
+        T lanes[num_lanes] = {};
+        return lane_sum_loop<Map>(left, right, 0, size, lanes);
+    }
+    const auto half = pairwise_split(size);
+    const auto offset = static_cast<std::ptrdiff_t>(half);
+    return T(pairwise_sum_loop<Map, T>(left, right, half) +
+        pairwise_sum_loop<Map, T>(std::next(left, offset), std::next(right, offset), size - half));
+}
+
+/** The elements are spread over `num_lanes` sums, like in the SIMD kernels.
+The compensations are summed without compensation, so their own error grows
+with the square of the number of elements of each sum.
+*/
+template<typename Map, bool ExactProducts, typename T, typename InputIterator1, typename InputIterator2>
+AAA_NO_CONTRACT T compensated_sum_loop(InputIterator1 left, InputIterator2 right, std::size_t size, T init)
+{
+    T sums[num_lanes] = {};
+    T errors[num_lanes] = {};
+    sums[0] = init;
+    for (auto i = std::size_t{0}; i < size; ++i, ++left, ++right)
+    {
+        const auto x = T(Map{}(*left, *right));
+        auto e = T{};
+        two_sum(sums[i % num_lanes], x, e);
+        if (ExactProducts)
+        {
+            e = T(e + T(std::fma(T(*left), T(*right), T(-x))));
+        }
+        errors[i % num_lanes] = T(errors[i % num_lanes] + e);
+    }
+    auto sum = T{};
+    auto error = T{};
+    for (auto k = std::size_t{0}; k < num_lanes; ++k)
+    {
+        auto e = T{};
+        two_sum(sum, sums[k], e);
+        error = T(error + e + errors[k]);
+    }
+    return T(sum + error);
+}
+
+template<typename Map, typename T, typename InputIterator1, typename InputIterator2>
+T accurate_sum_loop(accuracy::pairwise_summation, InputIterator1 left, InputIterator2 right, std::size_t size, T init)
+{
+    return T(init + pairwise_sum_loop<Map, T>(left, right, size));
+}
+
+template<typename Map, typename T, typename InputIterator1, typename InputIterator2>
+T accurate_sum_loop(accuracy::compensated_summation, InputIterator1 left, InputIterator2 right, std::size_t size, T init)
+{
+    return compensated_sum_loop<Map, false>(left, right, size, init);
+}
+
+/** The product errors are only computed for floating point numbers. Integer products are exact. */
+template<typename Map, typename T, typename InputIterator1, typename InputIterator2>
+T accurate_sum_loop(accuracy::dot2_summation, InputIterator1 left, InputIterator2 right, std::size_t size, T init)
+{
+    constexpr auto exact_products = std::is_same<Map, multiplies>::value && std::is_floating_point<T>::value;
+    return compensated_sum_loop<Map, exact_products>(left, right, size, init);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// rows
+
+/** Computes `out[r] = reduce(... reduce(reduce(T{}, map(query[0], row[0])), map(query[1], row[1])) ...)`
+for each row `r` of the row-major matrix, where the dimension is the size of the query.
+The elements are converted to the value type `T` of the output.
+*/
+template<typename Reduce, typename Map, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void row_distances_loop(InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out)
+{
+    using T = value_type_i<OutputIterator>;
+    for (; first_out != last_out; ++first_out)
+    {
+        auto result = T{};
+        for (auto query = first_query; query != last_query; ++query, ++first_matrix)
+        {
+            result = T(Reduce{}(result, T(Map{}(T(*query), T(*first_matrix)))));
+        }
+        *first_out = result;
+    }
+}
+
+/** Computes the distances of each of the `num_a` rows of `a` to each of the `num_b` rows of `b`.
+The distances of row `r` of `a` start at `out + r * stride`.
+*/
+template<typename Reduce, typename Map, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void tile_distances_loop(InputIterator1 a, std::size_t num_a, InputIterator2 b, std::size_t num_b,
+    std::size_t dimension, OutputIterator out, std::size_t stride)
+{
+    const auto row_size = static_cast<std::ptrdiff_t>(dimension);
+    for (auto r = std::size_t{0}; r < num_a; ++r)
+    {
+        const auto first_out = std::next(out, static_cast<std::ptrdiff_t>(r * stride));
+        row_distances_loop<Reduce, Map>(a, std::next(a, row_size), b, first_out,
+            std::next(first_out, static_cast<std::ptrdiff_t>(num_b)));
+        std::advance(a, row_size);
+    }
+}
+
+/** The number of elements between the checks of the bound of `bounded_distance`.
+Checking a sum folds the accumulators, so it is done once per block. A maximum
+is checked after each element, or each group of registers for the kernels.
+*/
+template<typename Reduce>
+struct bound_check_size : std::integral_constant<std::size_t, 128> {};
+
+template<>
+struct bound_check_size<maximum> : std::integral_constant<std::size_t, 1> {};
+
+/** Computes the distance like `row_distances_loop`, but returns as soon as the
+partial distance is greater than `bound`. The terms should not be negative.
+*/
+template<typename Reduce, typename Map, typename T, typename InputIterator1, typename InputIterator2>
+T bounded_distance_loop(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T bound)
+{
+    constexpr auto check_size = bound_check_size<Reduce>::value;
+    auto result = T{};
+    auto count = std::size_t{0};
+    for (; first_left != last_left; ++first_left, ++first_right)
+    {
+        result = T(Reduce{}(result, T(Map{}(T(*first_left), T(*first_right)))));
+        if (++count == check_size)
+        {
+            if (result > bound)
+            {
+                return result;
+            }
+            count = 0;
+        }
+    }
+    return result;
+}
+
+/** Computes `out[c] = table[codes[c][0]] + table[num_centroids + codes[c][1]] + ...`
+for each of the `num_codes` rows of `num_subspaces` codes. The entries are added
+in order, so the kernels give the same result.
+*/
+template<typename T>
+void table_lookup_sums_loop(const T* table, std::size_t num_centroids, const std::uint8_t* codes,
+    std::size_t num_subspaces, std::size_t num_codes, T* out)
+{
+    for (auto c = std::size_t{0}; c < num_codes; ++c, codes += num_subspaces)
+    {
+        auto sum = T{};
+        for (auto j = std::size_t{0}; j < num_subspaces; ++j)
+        {
+            sum = T(sum + table[j * num_centroids + codes[j]]);
+        }
+        out[c] = sum;
+    }
+}
+
+/** Computes the dot product `a.b` and the squared norms `a.a` and `b.b` in a single pass. */
+template<typename T, typename InputIterator1, typename InputIterator2>
+std::array<T, 3> cosine_sums_loop(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right)
+{
+    auto sums = std::array<T, 3>{};
+    for (; first_left != last_left; ++first_left, ++first_right)
+    {
+        const auto a = T(*first_left);
+        const auto b = T(*first_right);
+        sums[0] = T(sums[0] + a * b);
+        sums[1] = T(sums[1] + a * a);
+        sums[2] = T(sums[2] + b * b);
+    }
+    return sums;
+}
+
+/** Computes the sums of `x - shift`, `(x - shift)^2` and `(x - shift)^3`, and the
+minimum and the maximum of the elements, in a single pass. The range should not be empty.
+*/
+template<typename T, typename InputIterator>
+std::array<T, 5> shifted_moments_loop(InputIterator first, InputIterator last, T shift)
+{
+    auto moments = std::array<T, 5>{ T{}, T{}, T{}, T(*first), T(*first) };
+    for (; first != last; ++first)
+    {
+        const auto x = T(*first);
+        const auto d = T(x - shift);
+        const auto d2 = T(d * d);
+        moments[0] = T(moments[0] + d);
+        moments[1] = T(moments[1] + d2);
+        moments[2] = T(moments[2] + d2 * d);
+        moments[3] = minimum{}(moments[3], x);
+        moments[4] = maximum{}(moments[4], x);
+    }
+    return moments;
+}
+
+/** Computes `values[j] = reduce(values[j], map(x, x))` from `values[j] = T{}`, for
+each element `x` and each of the reductions, in a single pass. Each reduction has the
+member types `reduce` and `map`. A reduction by `operations::first_operand` keeps
+its initial value, and reads nothing.
+*/
+template<typename T, typename... Reductions, typename InputIterator, std::size_t... I>
+std::array<T, sizeof...(I)> reduce_many_loop(InputIterator first, InputIterator last, std::index_sequence<I...>)
+{
+    using expand = int[];
+    auto values = std::array<T, sizeof...(I)>{};
+    for (; first != last; ++first)
+    {
+        const auto x = T(*first);
+        (void)expand{ 0, (values[I] = T(typename Reductions::reduce{}(values[I], T(typename Reductions::map{}(x, x)))), 0)... };
+    }
+    return values;
+}
+
+/** The number of bits that are set in a word, without the popcnt instruction. */
+inline std::uint64_t popcount(std::uint64_t x)
+{
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (x * 0x0101010101010101ull) >> 56;
+}
+
+/** The number of bits that are set in the words of `a`, or in `a ^ b` if `Xor` is true. */
+template<bool Xor>
+std::uint64_t bit_count_loop(const std::uint64_t* a, const std::uint64_t* b, std::size_t size)
+{
+    auto count = std::uint64_t{0};
+    for (auto i = std::size_t{0}; i < size; ++i)
+    {
+        count += popcount(Xor ? a[i] ^ b[i] : a[i]);
+    }
+    return count;
+}
+
+#if AAA_SIMD
+
+////////////////////////////////////////////////////////////////////////////////
+// scalar
+
+/** Plain loops, used when the CPU has none of the supported instruction sets. */
+struct scalar
+{
+    template<typename Op, typename T>
+    static void transform(const T* left, const T* right, T* out, std::size_t size)
+    {
+        for (auto i = std::size_t{0}; i < size; ++i)
+        {
+            out[i] = Op{}(left[i], right[i]);
+        }
+    }
+
+    template<typename Op, typename T>
+    static void transform_scalar_vector(T left, const T* right, T* out, std::size_t size)
+    {
+        for (auto i = std::size_t{0}; i < size; ++i)
+        {
+            out[i] = Op{}(left, right[i]);
+        }
+    }
+
+    template<typename Op, typename T>
+    static void transform_vector_scalar(const T* left, T right, T* out, std::size_t size)
+    {
+        for (auto i = std::size_t{0}; i < size; ++i)
+        {
+            out[i] = Op{}(left[i], right);
+        }
+    }
+
+    template<typename T>
+    static void axpby(T a, const T* x, T b, const T* y, T* out, std::size_t size)
+    {
+        for (auto i = std::size_t{0}; i < size; ++i)
+        {
+            out[i] = a * x[i] + b * y[i];
+        }
+    }
+
+    template<typename T>
+    static T sum(const T* in, std::size_t size)
+    {
+        auto result = T{};
+        for (auto i = std::size_t{0}; i < size; ++i)
+        {
+            result = T(result + in[i]);
+        }
+        return result;
+    }
+
+    template<typename T>
+    static T dot(const T* left, const T* right, std::size_t size)
+    {
+        auto result = T{};
+        for (auto i = std::size_t{0}; i < size; ++i)
+        {
+            result = T(result + left[i] * right[i]);
+        }
+        return result;
+    }
+
+    template<typename T>
+    static T squared_distance(const T* left, const T* right, std::size_t size)
+    {
+        auto result = T{};
+        for (auto i = std::size_t{0}; i < size; ++i)
+        {
+            const auto difference = T(left[i] - right[i]);
+            result = T(result + difference * difference);
+        }
+        return result;
+    }
+
+    template<typename T>
+    static std::array<T, 3> cosine_sums(const T* left, const T* right, std::size_t size)
+    {
+        return cosine_sums_loop<T>(left, left + size, right);
+    }
+
+    template<typename T>
+    static std::array<T, 5> shifted_moments(const T* in, std::size_t size, T shift)
+    {
+        return shifted_moments_loop<T>(in, in + size, shift);
+    }
+
+    template<typename T, typename... Reductions>
+    static std::array<T, sizeof...(Reductions)> reduce_many(const T* in, std::size_t size)
+    {
+        return reduce_many_loop<T, Reductions...>(in, in + size, std::index_sequence_for<Reductions...>{});
+    }
+
+    template<typename Reduce, typename Map, typename T>
+    static T bounded_distance(const T* left, const T* right, std::size_t size, T bound)
+    {
+        return bounded_distance_loop<Reduce, Map>(left, left + size, right, bound);
+    }
+
+    template<typename Reduce, typename Map, typename T>
+    static void tile_distances(const T* a, std::size_t num_a, const T* b, std::size_t num_b,
+        std::size_t dimension, T* out, std::size_t stride)
+    {
+        tile_distances_loop<Reduce, Map>(a, num_a, b, num_b, dimension, out, stride);
+    }
+
+    template<typename Map, typename Tag, typename T>
+    static T accurate_sum(Tag, const T* left, const T* right, std::size_t size, T init)
+    {
+        return accurate_sum_loop<Map>(Tag{}, left, right, size, init);
+    }
+
+    template<typename T>
+    static wide_t<T> widening_dot(const T* left, const T* right, std::size_t size)
+    {
+        const wide_t<T> lanes[1] = {};
+        return widening_tail(lanes, left, right, 0, size, false);
+    }
+
+    template<typename T>
+    static wide_t<T> widening_squared_distance(const T* left, const T* right, std::size_t size)
+    {
+        const wide_t<T> lanes[1] = {};
+        return widening_tail(lanes, left, right, 0, size, true);
+    }
+
+    template<typename T>
+    static void table_lookup_sums(const T* table, std::size_t num_centroids, const std::uint8_t* codes,
+        std::size_t num_subspaces, std::size_t num_codes, T* out)
+    {
+        table_lookup_sums_loop(table, num_centroids, codes, num_subspaces, num_codes, out);
+    }
+
+    template<bool Xor>
+    static std::uint64_t bit_count(const std::uint64_t* a, const std::uint64_t* b, std::size_t size)
+    {
+        return bit_count_loop<Xor>(a, b, size);
+    }
+
+    static void hamming_distances(const std::uint64_t* query, const std::uint64_t* matrix,
+        std::size_t num_words, std::size_t num_rows, std::uint64_t* out)
+    {
+        for (auto r = std::size_t{0}; r < num_rows; ++r)
+        {
+            out[r] = bit_count_loop<true>(query, matrix + r * num_words, num_words);
+        }
+    }
+
+    template<typename T>
+    static wide_t<T> widening_manhattan_distance(const T* left, const T* right, std::size_t size)
+    {
+        const wide_t<T> lanes[1] = {};
+        return widening_absolute_tail<wide_t<T>>(lanes, left, right, 0, size);
+    }
+
+    template<typename T>
+    static void quantize(const float* in, float scale, std::int32_t zero_point, T* out, std::size_t size)
+    {
+        quantize_loop(in, in + size, scale, zero_point, out);
+    }
+
+    template<typename T>
+    static void dequantize(const T* in, float scale, std::int32_t zero_point, float* out, std::size_t size)
+    {
+        dequantize_loop(in, in + size, scale, zero_point, out);
+    }
+
+    template<typename Map, typename T>
+    static T lane_sum(const T* left, const T* right, std::size_t size)
+    {
+        T lanes[num_lanes] = {};
+        return lane_sum_loop<Map>(left, right, 0, size, lanes);
+    }
+
+    template<typename Op, typename T>
+    static T extremum(const T* in, std::size_t size, T init)
+    {
+        auto result = init;
+        for (auto i = std::size_t{0}; i < size; ++i)
+        {
+            result = Op{}(in[i], result);
+        }
+        return result;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// SSE4.2
+
+struct sse42
+{
+    static constexpr std::size_t register_size = 16;
+    static constexpr bool fused_multiply_add = false;
+
+    static AAA_TARGET_SSE42 __m128  load(const float* p)  { return _mm_loadu_ps(p); }
+    static AAA_TARGET_SSE42 __m128d load(const double* p) { return _mm_loadu_pd(p); }
+    template<typename T>
+    static AAA_TARGET_SSE42 __m128i load(const T* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+
+    static AAA_TARGET_SSE42 void store(float* p, __m128 x)   { _mm_storeu_ps(p, x); }
+    static AAA_TARGET_SSE42 void store(double* p, __m128d x) { _mm_storeu_pd(p, x); }
+    template<typename T>
+    static AAA_TARGET_SSE42 void store(T* p, __m128i x) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), x); }
+
+    static AAA_TARGET_SSE42 __m128  broadcast(lane<float>, float x)   { return _mm_set1_ps(x); }
+    static AAA_TARGET_SSE42 __m128d broadcast(lane<double>, double x) { return _mm_set1_pd(x); }
+    static AAA_TARGET_SSE42 __m128i broadcast(lane<std::int8_t>, std::int8_t x)   { return _mm_set1_epi8(x); }
+    static AAA_TARGET_SSE42 __m128i broadcast(lane<std::int16_t>, std::int16_t x) { return _mm_set1_epi16(x); }
+    static AAA_TARGET_SSE42 __m128i broadcast(lane<std::int32_t>, std::int32_t x) { return _mm_set1_epi32(x); }
+    static AAA_TARGET_SSE42 __m128i broadcast(lane<std::int64_t>, std::int64_t x) { return _mm_set1_epi64x(x); }
+
+    static AAA_TARGET_SSE42 __m128 apply(plus, lane<float>, __m128 a, __m128 b)       { return _mm_add_ps(a, b); }
+    static AAA_TARGET_SSE42 __m128 apply(minus, lane<float>, __m128 a, __m128 b)      { return _mm_sub_ps(a, b); }
+    static AAA_TARGET_SSE42 __m128 apply(multiplies, lane<float>, __m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+    static AAA_TARGET_SSE42 __m128 apply(divides, lane<float>, __m128 a, __m128 b)    { return _mm_div_ps(a, b); }
+    static AAA_TARGET_SSE42 __m128 apply(minimum, lane<float>, __m128 a, __m128 b)    { return _mm_min_ps(a, b); }
+    static AAA_TARGET_SSE42 __m128 apply(maximum, lane<float>, __m128 a, __m128 b)    { return _mm_max_ps(a, b); }
+
+    static AAA_TARGET_SSE42 __m128d apply(plus, lane<double>, __m128d a, __m128d b)       { return _mm_add_pd(a, b); }
+    static AAA_TARGET_SSE42 __m128d apply(minus, lane<double>, __m128d a, __m128d b)      { return _mm_sub_pd(a, b); }
+    static AAA_TARGET_SSE42 __m128d apply(multiplies, lane<double>, __m128d a, __m128d b) { return _mm_mul_pd(a, b); }
+    static AAA_TARGET_SSE42 __m128d apply(divides, lane<double>, __m128d a, __m128d b)    { return _mm_div_pd(a, b); }
+    static AAA_TARGET_SSE42 __m128d apply(minimum, lane<double>, __m128d a, __m128d b)    { return _mm_min_pd(a, b); }
+    static AAA_TARGET_SSE42 __m128d apply(maximum, lane<double>, __m128d a, __m128d b)    { return _mm_max_pd(a, b); }
+
+    static AAA_TARGET_SSE42 __m128i apply(plus, lane<std::int8_t>, __m128i a, __m128i b)   { return _mm_add_epi8(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(plus, lane<std::int16_t>, __m128i a, __m128i b)  { return _mm_add_epi16(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(plus, lane<std::int32_t>, __m128i a, __m128i b)  { return _mm_add_epi32(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(plus, lane<std::int64_t>, __m128i a, __m128i b)  { return _mm_add_epi64(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(minus, lane<std::int8_t>, __m128i a, __m128i b)  { return _mm_sub_epi8(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(minus, lane<std::int16_t>, __m128i a, __m128i b) { return _mm_sub_epi16(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(minus, lane<std::int32_t>, __m128i a, __m128i b) { return _mm_sub_epi32(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(minus, lane<std::int64_t>, __m128i a, __m128i b) { return _mm_sub_epi64(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(multiplies, lane<std::int16_t>, __m128i a, __m128i b) { return _mm_mullo_epi16(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(multiplies, lane<std::int32_t>, __m128i a, __m128i b) { return _mm_mullo_epi32(a, b); }
+
+    static AAA_TARGET_SSE42 __m128i apply(minimum, lane<std::int8_t>, __m128i a, __m128i b)   { return _mm_min_epi8(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(minimum, lane<std::uint8_t>, __m128i a, __m128i b)  { return _mm_min_epu8(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(minimum, lane<std::int16_t>, __m128i a, __m128i b)  { return _mm_min_epi16(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(minimum, lane<std::uint16_t>, __m128i a, __m128i b) { return _mm_min_epu16(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(minimum, lane<std::int32_t>, __m128i a, __m128i b)  { return _mm_min_epi32(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(minimum, lane<std::uint32_t>, __m128i a, __m128i b) { return _mm_min_epu32(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(maximum, lane<std::int8_t>, __m128i a, __m128i b)   { return _mm_max_epi8(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(maximum, lane<std::uint8_t>, __m128i a, __m128i b)  { return _mm_max_epu8(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(maximum, lane<std::int16_t>, __m128i a, __m128i b)  { return _mm_max_epi16(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(maximum, lane<std::uint16_t>, __m128i a, __m128i b) { return _mm_max_epu16(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(maximum, lane<std::int32_t>, __m128i a, __m128i b)  { return _mm_max_epi32(a, b); }
+    static AAA_TARGET_SSE42 __m128i apply(maximum, lane<std::uint32_t>, __m128i a, __m128i b) { return _mm_max_epu32(a, b); }
+
+    // SSE4.2 has no fused multiply-add.
+    template<typename T>
+    static AAA_TARGET_SSE42 T multiply_add(T a, T x, T y) { return a * x + y; }
+    static AAA_TARGET_SSE42 __m128  multiply_add(lane<float>, __m128 a, __m128 x, __m128 y)    { return _mm_add_ps(_mm_mul_ps(a, x), y); }
+    static AAA_TARGET_SSE42 __m128d multiply_add(lane<double>, __m128d a, __m128d x, __m128d y) { return _mm_add_pd(_mm_mul_pd(a, x), y); }
+
+    // Widening of the low and high halves of a register of integers to twice their size.
+    static AAA_TARGET_SSE42 __m128i widen_low(lane<std::int8_t>, __m128i a)   { return _mm_cvtepi8_epi16(a); }
+    static AAA_TARGET_SSE42 __m128i widen_high(lane<std::int8_t>, __m128i a)  { return _mm_cvtepi8_epi16(_mm_srli_si128(a, 8)); }
+    static AAA_TARGET_SSE42 __m128i widen_low(lane<std::uint8_t>, __m128i a)  { return _mm_cvtepu8_epi16(a); }
+    static AAA_TARGET_SSE42 __m128i widen_high(lane<std::uint8_t>, __m128i a) { return _mm_cvtepu8_epi16(_mm_srli_si128(a, 8)); }
+    static AAA_TARGET_SSE42 __m128i widen_low(lane<std::int16_t>, __m128i a)  { return _mm_cvtepi16_epi32(a); }
+    static AAA_TARGET_SSE42 __m128i widen_high(lane<std::int16_t>, __m128i a) { return _mm_cvtepi16_epi32(_mm_srli_si128(a, 8)); }
+    static AAA_TARGET_SSE42 __m128i widen_low(lane<std::uint16_t>, __m128i a)  { return _mm_cvtepu16_epi32(a); }
+    static AAA_TARGET_SSE42 __m128i widen_high(lane<std::uint16_t>, __m128i a) { return _mm_cvtepu16_epi32(_mm_srli_si128(a, 8)); }
+    static AAA_TARGET_SSE42 __m128i widen_low(lane<std::int32_t>, __m128i a)  { return _mm_cvtepi32_epi64(a); }
+    static AAA_TARGET_SSE42 __m128i widen_high(lane<std::int32_t>, __m128i a) { return _mm_cvtepi32_epi64(_mm_srli_si128(a, 8)); }
+    static AAA_TARGET_SSE42 __m128i multiply_pairs(__m128i a, __m128i b) { return _mm_madd_epi16(a, b); }
+    // Conversions for the quantization, rounded to nearest even, and narrowed with saturation.
+    static AAA_TARGET_SSE42 __m128i round_to_int32(__m128 a) { return _mm_cvtps_epi32(a); }
+    static AAA_TARGET_SSE42 __m128 to_float(__m128i a)        { return _mm_cvtepi32_ps(a); }
+    static AAA_TARGET_SSE42 __m128i narrow(lane<std::int8_t>, __m128i a, __m128i b, __m128i c, __m128i d)
+    {
+        return _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+    }
+    static AAA_TARGET_SSE42 __m128i narrow(lane<std::uint8_t>, __m128i a, __m128i b, __m128i c, __m128i d)
+    {
+        return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+    }
+    // The 4 bytes are copied to an int, because GCC only has _mm_loadu_si32 since version 11.
+    static AAA_TARGET_SSE42 __m128i load_4_bytes(const void* p)
+    {
+        std::int32_t x;
+        std::memcpy(&x, p, sizeof(x));
+        return _mm_cvtsi32_si128(x);
+    }
+    static AAA_TARGET_SSE42 __m128i load_widened(lane<std::int8_t>, const std::int8_t* p)   { return _mm_cvtepi8_epi32(load_4_bytes(p)); }
+    static AAA_TARGET_SSE42 __m128i load_widened(lane<std::uint8_t>, const std::uint8_t* p) { return _mm_cvtepu8_epi32(load_4_bytes(p)); }
+    static AAA_TARGET_SSE42 __m128i multiply_wide(__m128i a, __m128i b) { return _mm_mul_epi32(a, b); }
+    static AAA_TARGET_SSE42 __m128i square_wide(__m128i a)
+    {
+        const auto sign = _mm_cmpgt_epi64(_mm_setzero_si128(), a);
+        const auto absolute = _mm_sub_epi64(_mm_xor_si128(a, sign), sign);
+        return _mm_mul_epu32(absolute, absolute);
+    }
+
+    // Sums of the absolute differences of groups of 8 bytes, in 64 bit lanes.
+    // Flipping the sign bits maps int8 to uint8 in the same order.
+    static AAA_TARGET_SSE42 __m128i sum_absolute_differences(lane<std::uint8_t>, __m128i a, __m128i b) { return _mm_sad_epu8(a, b); }
+    static AAA_TARGET_SSE42 __m128i sum_absolute_differences(lane<std::int8_t>, __m128i a, __m128i b)
+    {
+        const auto sign = _mm_set1_epi8(std::numeric_limits<std::int8_t>::min());
+        return _mm_sad_epu8(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+    }
+
+    template<bool Xor>
+    static AAA_TARGET_SSE42 std::uint64_t bit_count(const std::uint64_t* a, const std::uint64_t* b, std::size_t size)
+    {
+        return popcount_words<Xor>(a, b, size);
+    }
+
+#define AAA_KERNEL_TARGET AAA_TARGET_SSE42
+#include "simd_kernels.hpp"
+#undef AAA_KERNEL_TARGET
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// AVX2
+
+struct avx2
+{
+    static constexpr std::size_t register_size = 32;
+    static constexpr bool fused_multiply_add = true;
+
+    static AAA_TARGET_AVX2 __m256  load(const float* p)  { return _mm256_loadu_ps(p); }
+    static AAA_TARGET_AVX2 __m256d load(const double* p) { return _mm256_loadu_pd(p); }
+    template<typename T>
+    static AAA_TARGET_AVX2 __m256i load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+
+    static AAA_TARGET_AVX2 void store(float* p, __m256 x)   { _mm256_storeu_ps(p, x); }
+    static AAA_TARGET_AVX2 void store(double* p, __m256d x) { _mm256_storeu_pd(p, x); }
+    template<typename T>
+    static AAA_TARGET_AVX2 void store(T* p, __m256i x) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x); }
+
+    static AAA_TARGET_AVX2 __m256  broadcast(lane<float>, float x)   { return _mm256_set1_ps(x); }
+    static AAA_TARGET_AVX2 __m256d broadcast(lane<double>, double x) { return _mm256_set1_pd(x); }
+    static AAA_TARGET_AVX2 __m256i broadcast(lane<std::int8_t>, std::int8_t x)   { return _mm256_set1_epi8(x); }
+    static AAA_TARGET_AVX2 __m256i broadcast(lane<std::int16_t>, std::int16_t x) { return _mm256_set1_epi16(x); }
+    static AAA_TARGET_AVX2 __m256i broadcast(lane<std::int32_t>, std::int32_t x) { return _mm256_set1_epi32(x); }
+    static AAA_TARGET_AVX2 __m256i broadcast(lane<std::int64_t>, std::int64_t x) { return _mm256_set1_epi64x(x); }
+
+    static AAA_TARGET_AVX2 __m256 apply(plus, lane<float>, __m256 a, __m256 b)       { return _mm256_add_ps(a, b); }
+    static AAA_TARGET_AVX2 __m256 apply(minus, lane<float>, __m256 a, __m256 b)      { return _mm256_sub_ps(a, b); }
+    static AAA_TARGET_AVX2 __m256 apply(multiplies, lane<float>, __m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+    static AAA_TARGET_AVX2 __m256 apply(divides, lane<float>, __m256 a, __m256 b)    { return _mm256_div_ps(a, b); }
+    static AAA_TARGET_AVX2 __m256 apply(minimum, lane<float>, __m256 a, __m256 b)    { return _mm256_min_ps(a, b); }
+    static AAA_TARGET_AVX2 __m256 apply(maximum, lane<float>, __m256 a, __m256 b)    { return _mm256_max_ps(a, b); }
+
+    static AAA_TARGET_AVX2 __m256d apply(plus, lane<double>, __m256d a, __m256d b)       { return _mm256_add_pd(a, b); }
+    static AAA_TARGET_AVX2 __m256d apply(minus, lane<double>, __m256d a, __m256d b)      { return _mm256_sub_pd(a, b); }
+    static AAA_TARGET_AVX2 __m256d apply(multiplies, lane<double>, __m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+    static AAA_TARGET_AVX2 __m256d apply(divides, lane<double>, __m256d a, __m256d b)    { return _mm256_div_pd(a, b); }
+    static AAA_TARGET_AVX2 __m256d apply(minimum, lane<double>, __m256d a, __m256d b)    { return _mm256_min_pd(a, b); }
+    static AAA_TARGET_AVX2 __m256d apply(maximum, lane<double>, __m256d a, __m256d b)    { return _mm256_max_pd(a, b); }
+
+    static AAA_TARGET_AVX2 __m256i apply(plus, lane<std::int8_t>, __m256i a, __m256i b)   { return _mm256_add_epi8(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(plus, lane<std::int16_t>, __m256i a, __m256i b)  { return _mm256_add_epi16(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(plus, lane<std::int32_t>, __m256i a, __m256i b)  { return _mm256_add_epi32(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(plus, lane<std::int64_t>, __m256i a, __m256i b)  { return _mm256_add_epi64(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(minus, lane<std::int8_t>, __m256i a, __m256i b)  { return _mm256_sub_epi8(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(minus, lane<std::int16_t>, __m256i a, __m256i b) { return _mm256_sub_epi16(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(minus, lane<std::int32_t>, __m256i a, __m256i b) { return _mm256_sub_epi32(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(minus, lane<std::int64_t>, __m256i a, __m256i b) { return _mm256_sub_epi64(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(multiplies, lane<std::int16_t>, __m256i a, __m256i b) { return _mm256_mullo_epi16(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(multiplies, lane<std::int32_t>, __m256i a, __m256i b) { return _mm256_mullo_epi32(a, b); }
+
+    static AAA_TARGET_AVX2 __m256i apply(minimum, lane<std::int8_t>, __m256i a, __m256i b)   { return _mm256_min_epi8(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(minimum, lane<std::uint8_t>, __m256i a, __m256i b)  { return _mm256_min_epu8(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(minimum, lane<std::int16_t>, __m256i a, __m256i b)  { return _mm256_min_epi16(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(minimum, lane<std::uint16_t>, __m256i a, __m256i b) { return _mm256_min_epu16(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(minimum, lane<std::int32_t>, __m256i a, __m256i b)  { return _mm256_min_epi32(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(minimum, lane<std::uint32_t>, __m256i a, __m256i b) { return _mm256_min_epu32(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(maximum, lane<std::int8_t>, __m256i a, __m256i b)   { return _mm256_max_epi8(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(maximum, lane<std::uint8_t>, __m256i a, __m256i b)  { return _mm256_max_epu8(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(maximum, lane<std::int16_t>, __m256i a, __m256i b)  { return _mm256_max_epi16(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(maximum, lane<std::uint16_t>, __m256i a, __m256i b) { return _mm256_max_epu16(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(maximum, lane<std::int32_t>, __m256i a, __m256i b)  { return _mm256_max_epi32(a, b); }
+    static AAA_TARGET_AVX2 __m256i apply(maximum, lane<std::uint32_t>, __m256i a, __m256i b) { return _mm256_max_epu32(a, b); }
+
+    template<typename T>
+    static AAA_TARGET_AVX2 T multiply_add(T a, T x, T y) { return std::fma(a, x, y); }
+    static AAA_TARGET_AVX2 __m256  multiply_add(lane<float>, __m256 a, __m256 x, __m256 y)    { return _mm256_fmadd_ps(a, x, y); }
+    static AAA_TARGET_AVX2 __m256d multiply_add(lane<double>, __m256d a, __m256d x, __m256d y) { return _mm256_fmadd_pd(a, x, y); }
+
+    // Widening of the low and high halves of a register of integers to twice their size.
+    static AAA_TARGET_AVX2 __m256i widen_low(lane<std::int8_t>, __m256i a)   { return _mm256_cvtepi8_epi16(_mm256_castsi256_si128(a)); }
+    static AAA_TARGET_AVX2 __m256i widen_high(lane<std::int8_t>, __m256i a)  { return _mm256_cvtepi8_epi16(_mm256_extracti128_si256(a, 1)); }
+    static AAA_TARGET_AVX2 __m256i widen_low(lane<std::uint8_t>, __m256i a)  { return _mm256_cvtepu8_epi16(_mm256_castsi256_si128(a)); }
+    static AAA_TARGET_AVX2 __m256i widen_high(lane<std::uint8_t>, __m256i a) { return _mm256_cvtepu8_epi16(_mm256_extracti128_si256(a, 1)); }
+    static AAA_TARGET_AVX2 __m256i widen_low(lane<std::int16_t>, __m256i a)  { return _mm256_cvtepi16_epi32(_mm256_castsi256_si128(a)); }
+    static AAA_TARGET_AVX2 __m256i widen_high(lane<std::int16_t>, __m256i a) { return _mm256_cvtepi16_epi32(_mm256_extracti128_si256(a, 1)); }
+    static AAA_TARGET_AVX2 __m256i widen_low(lane<std::uint16_t>, __m256i a)  { return _mm256_cvtepu16_epi32(_mm256_castsi256_si128(a)); }
+    static AAA_TARGET_AVX2 __m256i widen_high(lane<std::uint16_t>, __m256i a) { return _mm256_cvtepu16_epi32(_mm256_extracti128_si256(a, 1)); }
+    static AAA_TARGET_AVX2 __m256i widen_low(lane<std::int32_t>, __m256i a)  { return _mm256_cvtepi32_epi64(_mm256_castsi256_si128(a)); }
+    static AAA_TARGET_AVX2 __m256i widen_high(lane<std::int32_t>, __m256i a) { return _mm256_cvtepi32_epi64(_mm256_extracti128_si256(a, 1)); }
+    static AAA_TARGET_AVX2 __m256i multiply_pairs(__m256i a, __m256i b) { return _mm256_madd_epi16(a, b); }
+    // Conversions for the quantization, rounded to nearest even, and narrowed with saturation.
+    static AAA_TARGET_AVX2 __m256i round_to_int32(__m256 a) { return _mm256_cvtps_epi32(a); }
+    static AAA_TARGET_AVX2 __m256 to_float(__m256i a)        { return _mm256_cvtepi32_ps(a); }
+    // The packs work on the halves of the registers, and the permutation puts the groups of 4 bytes back in order.
+    static AAA_TARGET_AVX2 __m256i narrow(lane<std::int8_t>, __m256i a, __m256i b, __m256i c, __m256i d)
+    {
+        const auto packed = _mm256_packs_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        return _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    }
+    static AAA_TARGET_AVX2 __m256i narrow(lane<std::uint8_t>, __m256i a, __m256i b, __m256i c, __m256i d)
+    {
+        const auto packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        return _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    }
+    static AAA_TARGET_AVX2 __m256i load_widened(lane<std::int8_t>, const std::int8_t* p)
+    {
+        return _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+    }
+    static AAA_TARGET_AVX2 __m256i load_widened(lane<std::uint8_t>, const std::uint8_t* p)
+    {
+        return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+    }
+    static AAA_TARGET_AVX2 __m256i multiply_wide(__m256i a, __m256i b) { return _mm256_mul_epi32(a, b); }
+    static AAA_TARGET_AVX2 __m256i square_wide(__m256i a)
+    {
+        const auto sign = _mm256_cmpgt_epi64(_mm256_setzero_si256(), a);
+        const auto absolute = _mm256_sub_epi64(_mm256_xor_si256(a, sign), sign);
+        return _mm256_mul_epu32(absolute, absolute);
+    }
+
+    // Sums of the absolute differences of groups of 8 bytes, in 64 bit lanes.
+    // Flipping the sign bits maps int8 to uint8 in the same order.
+    static AAA_TARGET_AVX2 __m256i sum_absolute_differences(lane<std::uint8_t>, __m256i a, __m256i b) { return _mm256_sad_epu8(a, b); }
+    static AAA_TARGET_AVX2 __m256i sum_absolute_differences(lane<std::int8_t>, __m256i a, __m256i b)
+    {
+        const auto sign = _mm256_set1_epi8(std::numeric_limits<std::int8_t>::min());
+        return _mm256_sad_epu8(_mm256_xor_si256(a, sign), _mm256_xor_si256(b, sign));
+    }
+
+    // The table lookups of 8 rows of codes at a time. The code of each row is
+    // gathered as a 32 bit word and masked, and then its entry of the table.
+    // The last rows are done by the loop, so that the words do not pass the end of the codes.
+    static AAA_TARGET_AVX2 void table_lookup_sums(const float* table, std::size_t num_centroids, const std::uint8_t* codes,
+        std::size_t num_subspaces, std::size_t num_codes, float* out)
+    {
+        constexpr auto width = std::size_t{8};
+        const auto rows = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+            _mm256_set1_epi32(static_cast<int>(num_subspaces)));
+        const auto byte_mask = _mm256_set1_epi32(0xFF);
+        auto c = std::size_t{0};
+        for (; (c + width) * num_subspaces + 3 <= num_codes * num_subspaces; c += width)
+        {
+            const auto first = codes + c * num_subspaces;
+            auto sum = _mm256_setzero_ps();
+            for (auto j = std::size_t{0}; j < num_subspaces; ++j)
+            {
+                const auto words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(first + j), rows, 1);
+                const auto entries = _mm256_i32gather_ps(table + j * num_centroids, _mm256_and_si256(words, byte_mask), 4);
+                sum = _mm256_add_ps(sum, entries);
+            }
+            _mm256_storeu_ps(out + c, sum);
+        }
+        table_lookup_sums_loop(table, num_centroids, codes + c * num_subspaces, num_subspaces, num_codes - c, out + c);
+    }
+
+    // The bits of each byte are counted by looking up its two halves in a table of
+    // 16 entries, and the counts of the bytes are summed in 64 bit lanes.
+    // Below this number of words the popcnt instruction is faster.
+    static constexpr std::size_t min_lookup_words = 32;
+
+    template<bool Xor>
+    static AAA_TARGET_AVX2 std::uint64_t bit_count(const std::uint64_t* a, const std::uint64_t* b, std::size_t size)
+    {
+        if (size < min_lookup_words)
+        {
+            return popcount_words<Xor>(a, b, size);
+        }
+        const auto table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const auto low_mask = _mm256_set1_epi8(0x0f);
+        auto acc = _mm256_setzero_si256();
+        auto i = std::size_t{0};
+        for (; i + 4 <= size; i += 4)
+        {
+            auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            if (Xor)
+            {
+                x = _mm256_xor_si256(x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+            }
+            const auto low = _mm256_shuffle_epi8(table, _mm256_and_si256(x, low_mask));
+            const auto high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(x, 4), low_mask));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+        }
+        std::uint64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + popcount_words<Xor>(a + i, b + i, size - i);
+    }
+
+#define AAA_KERNEL_TARGET AAA_TARGET_AVX2
+#include "simd_kernels.hpp"
+#undef AAA_KERNEL_TARGET
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// AVX-512
+
+struct avx512
+{
+    static constexpr std::size_t register_size = 64;
+    static constexpr bool fused_multiply_add = true;
+
+    // GCC builds many AVX-512 intrinsics on an uninitialized register, that -Wmaybe-uninitialized
+    // reports once they are inlined. Their masked forms, with all the lanes selected, do the same.
+    static constexpr __mmask8 all_8 = 0xFF;
+    static constexpr __mmask16 all_16 = 0xFFFF;
+    static AAA_TARGET_AVX512 __m256i low_half(__m512i a)  { return _mm512_maskz_extracti64x4_epi64(0xF, a, 0); }
+    static AAA_TARGET_AVX512 __m256i high_half(__m512i a) { return _mm512_maskz_extracti64x4_epi64(0xF, a, 1); }
+
+    static AAA_TARGET_AVX512 __m512  load(const float* p)  { return _mm512_loadu_ps(p); }
+    static AAA_TARGET_AVX512 __m512d load(const double* p) { return _mm512_loadu_pd(p); }
+    template<typename T>
+    static AAA_TARGET_AVX512 __m512i load(const T* p) { return _mm512_loadu_si512(p); }
+
+    static AAA_TARGET_AVX512 void store(float* p, __m512 x)   { _mm512_storeu_ps(p, x); }
+    static AAA_TARGET_AVX512 void store(double* p, __m512d x) { _mm512_storeu_pd(p, x); }
+    template<typename T>
+    static AAA_TARGET_AVX512 void store(T* p, __m512i x) { _mm512_storeu_si512(p, x); }
+
+    static AAA_TARGET_AVX512 __m512  broadcast(lane<float>, float x)   { return _mm512_set1_ps(x); }
+    static AAA_TARGET_AVX512 __m512d broadcast(lane<double>, double x) { return _mm512_set1_pd(x); }
+    static AAA_TARGET_AVX512 __m512i broadcast(lane<std::int8_t>, std::int8_t x)   { return _mm512_set1_epi8(x); }
+    static AAA_TARGET_AVX512 __m512i broadcast(lane<std::int16_t>, std::int16_t x) { return _mm512_set1_epi16(x); }
+    static AAA_TARGET_AVX512 __m512i broadcast(lane<std::int32_t>, std::int32_t x) { return _mm512_set1_epi32(x); }
+    static AAA_TARGET_AVX512 __m512i broadcast(lane<std::int64_t>, std::int64_t x) { return _mm512_set1_epi64(x); }
+
+    static AAA_TARGET_AVX512 __m512 apply(plus, lane<float>, __m512 a, __m512 b)       { return _mm512_add_ps(a, b); }
+    static AAA_TARGET_AVX512 __m512 apply(minus, lane<float>, __m512 a, __m512 b)      { return _mm512_sub_ps(a, b); }
+    static AAA_TARGET_AVX512 __m512 apply(multiplies, lane<float>, __m512 a, __m512 b) { return _mm512_mul_ps(a, b); }
+    static AAA_TARGET_AVX512 __m512 apply(divides, lane<float>, __m512 a, __m512 b)    { return _mm512_div_ps(a, b); }
+    static AAA_TARGET_AVX512 __m512 apply(minimum, lane<float>, __m512 a, __m512 b)    { return _mm512_maskz_min_ps(all_16, a, b); }
+    static AAA_TARGET_AVX512 __m512 apply(maximum, lane<float>, __m512 a, __m512 b)    { return _mm512_maskz_max_ps(all_16, a, b); }
+
+    static AAA_TARGET_AVX512 __m512d apply(plus, lane<double>, __m512d a, __m512d b)       { return _mm512_add_pd(a, b); }
+    static AAA_TARGET_AVX512 __m512d apply(minus, lane<double>, __m512d a, __m512d b)      { return _mm512_sub_pd(a, b); }
+    static AAA_TARGET_AVX512 __m512d apply(multiplies, lane<double>, __m512d a, __m512d b) { return _mm512_mul_pd(a, b); }
+    static AAA_TARGET_AVX512 __m512d apply(divides, lane<double>, __m512d a, __m512d b)    { return _mm512_div_pd(a, b); }
+    static AAA_TARGET_AVX512 __m512d apply(minimum, lane<double>, __m512d a, __m512d b)    { return _mm512_maskz_min_pd(all_8, a, b); }
+    static AAA_TARGET_AVX512 __m512d apply(maximum, lane<double>, __m512d a, __m512d b)    { return _mm512_maskz_max_pd(all_8, a, b); }
+
+    static AAA_TARGET_AVX512 __m512i apply(plus, lane<std::int8_t>, __m512i a, __m512i b)   { return _mm512_add_epi8(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(plus, lane<std::int16_t>, __m512i a, __m512i b)  { return _mm512_add_epi16(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(plus, lane<std::int32_t>, __m512i a, __m512i b)  { return _mm512_add_epi32(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(plus, lane<std::int64_t>, __m512i a, __m512i b)  { return _mm512_add_epi64(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(minus, lane<std::int8_t>, __m512i a, __m512i b)  { return _mm512_sub_epi8(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(minus, lane<std::int16_t>, __m512i a, __m512i b) { return _mm512_sub_epi16(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(minus, lane<std::int32_t>, __m512i a, __m512i b) { return _mm512_sub_epi32(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(minus, lane<std::int64_t>, __m512i a, __m512i b) { return _mm512_sub_epi64(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(multiplies, lane<std::int16_t>, __m512i a, __m512i b) { return _mm512_mullo_epi16(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(multiplies, lane<std::int32_t>, __m512i a, __m512i b) { return _mm512_mullo_epi32(a, b); }
+
+    static AAA_TARGET_AVX512 __m512i apply(minimum, lane<std::int8_t>, __m512i a, __m512i b)   { return _mm512_min_epi8(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(minimum, lane<std::uint8_t>, __m512i a, __m512i b)  { return _mm512_min_epu8(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(minimum, lane<std::int16_t>, __m512i a, __m512i b)  { return _mm512_min_epi16(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(minimum, lane<std::uint16_t>, __m512i a, __m512i b) { return _mm512_min_epu16(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(minimum, lane<std::int32_t>, __m512i a, __m512i b)  { return _mm512_maskz_min_epi32(all_16, a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(minimum, lane<std::uint32_t>, __m512i a, __m512i b) { return _mm512_maskz_min_epu32(all_16, a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(minimum, lane<std::int64_t>, __m512i a, __m512i b)  { return _mm512_maskz_min_epi64(all_8, a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(minimum, lane<std::uint64_t>, __m512i a, __m512i b) { return _mm512_maskz_min_epu64(all_8, a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(maximum, lane<std::int8_t>, __m512i a, __m512i b)   { return _mm512_max_epi8(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(maximum, lane<std::uint8_t>, __m512i a, __m512i b)  { return _mm512_max_epu8(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(maximum, lane<std::int16_t>, __m512i a, __m512i b)  { return _mm512_max_epi16(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(maximum, lane<std::uint16_t>, __m512i a, __m512i b) { return _mm512_max_epu16(a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(maximum, lane<std::int32_t>, __m512i a, __m512i b)  { return _mm512_maskz_max_epi32(all_16, a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(maximum, lane<std::uint32_t>, __m512i a, __m512i b) { return _mm512_maskz_max_epu32(all_16, a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(maximum, lane<std::int64_t>, __m512i a, __m512i b)  { return _mm512_maskz_max_epi64(all_8, a, b); }
+    static AAA_TARGET_AVX512 __m512i apply(maximum, lane<std::uint64_t>, __m512i a, __m512i b) { return _mm512_maskz_max_epu64(all_8, a, b); }
+
+    template<typename T>
+    static AAA_TARGET_AVX512 T multiply_add(T a, T x, T y) { return std::fma(a, x, y); }
+    static AAA_TARGET_AVX512 __m512  multiply_add(lane<float>, __m512 a, __m512 x, __m512 y)    { return _mm512_fmadd_ps(a, x, y); }
+    static AAA_TARGET_AVX512 __m512d multiply_add(lane<double>, __m512d a, __m512d x, __m512d y) { return _mm512_fmadd_pd(a, x, y); }
+
+    // Widening of the low and high halves of a register of integers to twice their size.
+    static AAA_TARGET_AVX512 __m512i widen_low(lane<std::int8_t>, __m512i a)   { return _mm512_cvtepi8_epi16(low_half(a)); }
+    static AAA_TARGET_AVX512 __m512i widen_high(lane<std::int8_t>, __m512i a)  { return _mm512_cvtepi8_epi16(high_half(a)); }
+    static AAA_TARGET_AVX512 __m512i widen_low(lane<std::uint8_t>, __m512i a)  { return _mm512_cvtepu8_epi16(low_half(a)); }
+    static AAA_TARGET_AVX512 __m512i widen_high(lane<std::uint8_t>, __m512i a) { return _mm512_cvtepu8_epi16(high_half(a)); }
+    static AAA_TARGET_AVX512 __m512i widen_low(lane<std::int16_t>, __m512i a)  { return _mm512_maskz_cvtepi16_epi32(all_16, low_half(a)); }
+    static AAA_TARGET_AVX512 __m512i widen_high(lane<std::int16_t>, __m512i a) { return _mm512_maskz_cvtepi16_epi32(all_16, high_half(a)); }
+    static AAA_TARGET_AVX512 __m512i widen_low(lane<std::uint16_t>, __m512i a)  { return _mm512_maskz_cvtepu16_epi32(all_16, low_half(a)); }
+    static AAA_TARGET_AVX512 __m512i widen_high(lane<std::uint16_t>, __m512i a) { return _mm512_maskz_cvtepu16_epi32(all_16, high_half(a)); }
+    static AAA_TARGET_AVX512 __m512i widen_low(lane<std::int32_t>, __m512i a)  { return _mm512_maskz_cvtepi32_epi64(all_8, low_half(a)); }
+    static AAA_TARGET_AVX512 __m512i widen_high(lane<std::int32_t>, __m512i a) { return _mm512_maskz_cvtepi32_epi64(all_8, high_half(a)); }
+    static AAA_TARGET_AVX512 __m512i multiply_pairs(__m512i a, __m512i b) { return _mm512_madd_epi16(a, b); }
+    // Conversions for the quantization, rounded to nearest even, and narrowed with saturation.
+    static AAA_TARGET_AVX512 __m512i round_to_int32(__m512 a) { return _mm512_maskz_cvtps_epi32(all_16, a); }
+    static AAA_TARGET_AVX512 __m512 to_float(__m512i a)        { return _mm512_maskz_cvtepi32_ps(all_16, a); }
+    // The packs work on the quarters of the registers, and the permutation puts the groups of 4 bytes back in order.
+    static AAA_TARGET_AVX512 __m512i narrow(lane<std::int8_t>, __m512i a, __m512i b, __m512i c, __m512i d)
+    {
+        const auto packed = _mm512_packs_epi16(_mm512_packs_epi32(a, b), _mm512_packs_epi32(c, d));
+        return _mm512_maskz_permutexvar_epi32(all_16, _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15), packed);
+    }
+    static AAA_TARGET_AVX512 __m512i narrow(lane<std::uint8_t>, __m512i a, __m512i b, __m512i c, __m512i d)
+    {
+        const auto packed = _mm512_packus_epi16(_mm512_packs_epi32(a, b), _mm512_packs_epi32(c, d));
+        return _mm512_maskz_permutexvar_epi32(all_16, _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15), packed);
+    }
+    static AAA_TARGET_AVX512 __m512i load_widened(lane<std::int8_t>, const std::int8_t* p)
+    {
+        return _mm512_maskz_cvtepi8_epi32(all_16, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+    static AAA_TARGET_AVX512 __m512i load_widened(lane<std::uint8_t>, const std::uint8_t* p)
+    {
+        return _mm512_maskz_cvtepu8_epi32(all_16, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+    static AAA_TARGET_AVX512 __m512i multiply_wide(__m512i a, __m512i b) { return _mm512_maskz_mul_epi32(all_8, a, b); }
+    static AAA_TARGET_AVX512 __m512i square_wide(__m512i a)
+    {
+        const auto absolute = _mm512_maskz_abs_epi64(all_8, a);
+        return _mm512_maskz_mul_epu32(all_8, absolute, absolute);
+    }
+
+    // Sums of the absolute differences of groups of 8 bytes, in 64 bit lanes.
+    // Flipping the sign bits maps int8 to uint8 in the same order.
+    static AAA_TARGET_AVX512 __m512i sum_absolute_differences(lane<std::uint8_t>, __m512i a, __m512i b) { return _mm512_sad_epu8(a, b); }
+    static AAA_TARGET_AVX512 __m512i sum_absolute_differences(lane<std::int8_t>, __m512i a, __m512i b)
+    {
+        const auto sign = _mm512_set1_epi8(std::numeric_limits<std::int8_t>::min());
+        return _mm512_sad_epu8(_mm512_xor_si512(a, sign), _mm512_xor_si512(b, sign));
+    }
+
+    // The table lookups of 16 rows of codes at a time, like for AVX2.
+    static AAA_TARGET_AVX512 void table_lookup_sums(const float* table, std::size_t num_centroids, const std::uint8_t* codes,
+        std::size_t num_subspaces, std::size_t num_codes, float* out)
+    {
+        constexpr auto width = std::size_t{16};
+        const auto rows = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+            _mm512_set1_epi32(static_cast<int>(num_subspaces)));
+        const auto byte_mask = _mm512_set1_epi32(0xFF);
+        auto c = std::size_t{0};
+        for (; (c + width) * num_subspaces + 3 <= num_codes * num_subspaces; c += width)
+        {
+            const auto first = codes + c * num_subspaces;
+            auto sum = _mm512_setzero_ps();
+            for (auto j = std::size_t{0}; j < num_subspaces; ++j)
+            {
+                const auto words = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), all_16, rows, first + j, 1);
+                const auto entries = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), all_16,
+                    _mm512_and_si512(words, byte_mask), table + j * num_centroids, 4);
+                sum = _mm512_add_ps(sum, entries);
+            }
+            _mm512_storeu_ps(out + c, sum);
+        }
+        table_lookup_sums_loop(table, num_centroids, codes + c * num_subspaces, num_subspaces, num_codes - c, out + c);
+    }
+
+    // The bits are counted by table lookups, like for AVX2.
+    static constexpr std::size_t min_lookup_words = 16;
+
+    template<bool Xor>
+    static AAA_TARGET_AVX512 std::uint64_t bit_count(const std::uint64_t* a, const std::uint64_t* b, std::size_t size)
+    {
+        if (size < min_lookup_words)
+        {
+            return popcount_words<Xor>(a, b, size);
+        }
+        const auto table = _mm512_set4_epi32(0x04030302, 0x03020201, 0x03020201, 0x02010100);
+        const auto low_mask = _mm512_set1_epi8(0x0f);
+        auto acc = _mm512_setzero_si512();
+        auto i = std::size_t{0};
+        for (; i + 8 <= size; i += 8)
+        {
+            auto x = _mm512_loadu_si512(a + i);
+            if (Xor)
+            {
+                x = _mm512_xor_si512(x, _mm512_loadu_si512(b + i));
+            }
+            const auto low = _mm512_shuffle_epi8(table, _mm512_and_si512(x, low_mask));
+            const auto high = _mm512_shuffle_epi8(table, _mm512_and_si512(_mm512_srli_epi16(x, 4), low_mask));
+            acc = _mm512_add_epi64(acc, _mm512_sad_epu8(_mm512_add_epi8(low, high), _mm512_setzero_si512()));
+        }
+        std::uint64_t lanes[8];
+        _mm512_storeu_si512(lanes, acc);
+        return std::accumulate(lanes, lanes + 8, std::uint64_t{0}) + popcount_words<Xor>(a + i, b + i, size - i);
+    }
+
+#define AAA_KERNEL_TARGET AAA_TARGET_AVX512
+#include "simd_kernels.hpp"
+#undef AAA_KERNEL_TARGET
+};
+
+/** True if the instruction set `Isa` has an instruction for `Op` on elements of type `T`.
+The expressions are cast to `void`, so that the vector types with their alignment
+attributes are not template arguments.
+*/
+template<typename Isa, typename Op, typename T, typename = void>
+struct has_kernel : std::false_type {};
+
+template<typename Isa, typename Op, typename T>
+struct has_kernel<Isa, Op, T, void_t<decltype(void(
+    Isa::apply(Op{}, lane_t<Op, T>{}, Isa::load(static_cast<const T*>(nullptr)), Isa::load(static_cast<const T*>(nullptr)))))>>
+    : std::true_type
+{};
+
+/** The plain loops work for all elements. */
+template<typename Op, typename T>
+struct has_kernel<scalar, Op, T, void> : is_simd_element<T> {};
+
+/** True if the instruction set `Isa` has a multiply-add for elements of type `T`. */
+template<typename Isa, typename T, typename = void>
+struct has_multiply_add : std::false_type {};
+
+template<typename Isa, typename T>
+struct has_multiply_add<Isa, T, void_t<decltype(void(
+    Isa::multiply_add(lane<T>{}, Isa::load(static_cast<const T*>(nullptr)),
+        Isa::load(static_cast<const T*>(nullptr)), Isa::load(static_cast<const T*>(nullptr)))))>>
+    : std::true_type
+{};
+
+template<typename T>
+struct has_multiply_add<scalar, T, void> : std::is_floating_point<T> {};
+
+////////////////////////////////////////////////////////////////////////////////
+// function pointer tables
+
+template<typename Op, typename T>
+struct transform_kernels
+{
+    using function = void (*)(const T*, const T*, T*, std::size_t);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template transform<Op, T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get() { return get<Isa>(has_kernel<Isa, Op, T>{}); }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+template<typename Op, typename T>
+struct transform_scalar_vector_kernels
+{
+    using function = void (*)(T, const T*, T*, std::size_t);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template transform_scalar_vector<Op, T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get() { return get<Isa>(has_kernel<Isa, Op, T>{}); }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+template<typename Op, typename T>
+struct transform_vector_scalar_kernels
+{
+    using function = void (*)(const T*, T, T*, std::size_t);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template transform_vector_scalar<Op, T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get() { return get<Isa>(has_kernel<Isa, Op, T>{}); }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+template<typename T>
+struct axpby_kernels
+{
+    using function = void (*)(T, const T*, T, const T*, T*, std::size_t);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template axpby<T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get() { return get<Isa>(has_multiply_add<Isa, T>{}); }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+template<typename T>
+struct sum_kernels
+{
+    using function = T (*)(const T*, std::size_t);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template sum<T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get() { return get<Isa>(has_kernel<Isa, plus, T>{}); }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+template<typename T>
+struct dot_kernels
+{
+    using function = T (*)(const T*, const T*, std::size_t);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template dot<T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get()
+    {
+        using available = std::integral_constant<bool,
+            has_kernel<Isa, plus, T>::value && has_kernel<Isa, multiplies, T>::value>;
+        return get<Isa>(available{});
+    }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+template<typename T>
+struct squared_distance_kernels
+{
+    using function = T (*)(const T*, const T*, std::size_t);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template squared_distance<T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get()
+    {
+        using available = std::integral_constant<bool, has_kernel<Isa, plus, T>::value &&
+            has_kernel<Isa, minus, T>::value && has_kernel<Isa, multiplies, T>::value>;
+        return get<Isa>(available{});
+    }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+/** The widening kernels exist for all instruction sets. */
+template<typename T>
+struct widening_dot_kernels
+{
+    using function = wide_t<T> (*)(const T*, const T*, std::size_t);
+    template<typename Isa> static function get() { return &Isa::widening_dot; }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ &scalar::widening_dot<T>, get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+template<typename T>
+struct widening_squared_distance_kernels
+{
+    using function = wide_t<T> (*)(const T*, const T*, std::size_t);
+    template<typename Isa> static function get() { return &Isa::widening_squared_distance; }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ &scalar::widening_squared_distance<T>, get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+template<typename T>
+struct widening_manhattan_distance_kernels
+{
+    using function = wide_t<T> (*)(const T*, const T*, std::size_t);
+    template<typename Isa> static function get() { return &Isa::template widening_manhattan_distance<T>; }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ &scalar::widening_manhattan_distance<T>, get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+/** The quantization kernels exist for all instruction sets. */
+template<typename T>
+struct quantize_kernels
+{
+    using function = void (*)(const float*, float, std::int32_t, T*, std::size_t);
+    template<typename Isa> static function get() { return &Isa::template quantize<T>; }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+template<typename T>
+struct dequantize_kernels
+{
+    using function = void (*)(const T*, float, std::int32_t, float*, std::size_t);
+    template<typename Isa> static function get() { return &Isa::template dequantize<T>; }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+/** The gathers of the table lookups only exist for AVX2 and AVX-512. */
+struct table_lookup_sums_kernels
+{
+    using function = void (*)(const float*, std::size_t, const std::uint8_t*, std::size_t, std::size_t, float*);
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ &scalar::table_lookup_sums<float>, nullptr,
+            &avx2::table_lookup_sums, &avx512::table_lookup_sums }});
+        return kernel;
+    }
+};
+
+template<bool Xor>
+struct bit_count_kernels
+{
+    using function = std::uint64_t (*)(const std::uint64_t*, const std::uint64_t*, std::size_t);
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ &scalar::bit_count<Xor>,
+            &sse42::bit_count<Xor>, &avx2::bit_count<Xor>, &avx512::bit_count<Xor> }});
+        return kernel;
+    }
+};
+
+struct hamming_distances_kernels
+{
+    using function = void (*)(const std::uint64_t*, const std::uint64_t*, std::size_t, std::size_t, std::uint64_t*);
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ &scalar::hamming_distances,
+            &sse42::hamming_distances, &avx2::hamming_distances, &avx512::hamming_distances }});
+        return kernel;
+    }
+};
+
+/** The kernels of the accuracy policies are only used for floating point numbers. */
+template<typename Tag, typename Map, typename T>
+struct accurate_sum_kernels
+{
+    using function = T (*)(Tag, const T*, const T*, std::size_t, T);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template accurate_sum<Map, T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get() { return get<Isa>(std::is_floating_point<T>{}); }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ &scalar::accurate_sum<Map, Tag, T>, get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+/** The kernels of `lane_sum` are only used for floating point numbers. */
+template<typename Map, typename T>
+struct lane_sum_kernels
+{
+    using function = T (*)(const T*, const T*, std::size_t);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template lane_sum<Map, T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get() { return get<Isa>(std::is_floating_point<T>{}); }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+/** The kernels of `tile_distances` are only used for floating point numbers. */
+template<typename Reduce, typename Map, typename T>
+struct tile_distances_kernels
+{
+    using function = void (*)(const T*, std::size_t, const T*, std::size_t, std::size_t, T*, std::size_t);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template tile_distances<Reduce, Map, T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get() { return get<Isa>(std::is_floating_point<T>{}); }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+/** The kernels of `cosine_sums` are only used for floating point numbers. */
+template<typename T>
+struct cosine_sums_kernels
+{
+    using function = std::array<T, 3> (*)(const T*, const T*, std::size_t);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template cosine_sums<T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get() { return get<Isa>(std::is_floating_point<T>{}); }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+/** The kernels of `reduce_many` are only used for floating point numbers. */
+template<typename T, typename... Reductions>
+struct reduce_many_kernels
+{
+    using function = std::array<T, sizeof...(Reductions)> (*)(const T*, std::size_t);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template reduce_many<T, Reductions...>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get() { return get<Isa>(std::is_floating_point<T>{}); }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+/** The kernels of `shifted_moments` are only used for floating point numbers. */
+template<typename T>
+struct shifted_moments_kernels
+{
+    using function = std::array<T, 5> (*)(const T*, std::size_t, T);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template shifted_moments<T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get() { return get<Isa>(std::is_floating_point<T>{}); }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+/** The kernels of `bounded_distance` are only used for floating point numbers. */
+template<typename Reduce, typename Map, typename T>
+struct bounded_distance_kernels
+{
+    using function = T (*)(const T*, const T*, std::size_t, T);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template bounded_distance<Reduce, Map, T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get() { return get<Isa>(std::is_floating_point<T>{}); }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+template<typename Op, typename T>
+struct extremum_kernels
+{
+    using function = T (*)(const T*, std::size_t, T);
+    template<typename Isa> static function get(std::true_type) { return &Isa::template extremum<Op, T>; }
+    template<typename Isa> static function get(std::false_type) { return nullptr; }
+    template<typename Isa> static function get() { return get<Isa>(has_kernel<Isa, Op, T>{}); }
+    static function select()
+    {
+        static const auto kernel = select_kernel<function>({{ get<scalar>(), get<sse42>(), get<avx2>(), get<avx512>() }});
+        return kernel;
+    }
+};
+
+#endif // AAA_SIMD
+
+////////////////////////////////////////////////////////////////////////////////
+// routing
+
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+using can_vectorize = std::integral_constant<bool,
+#if AAA_SIMD
+    std::is_same<element_t<InputIterator1>, element_t<OutputIterator>>::value &&
+    std::is_same<element_t<InputIterator2>, element_t<OutputIterator>>::value &&
+    is_contiguous_iterator<InputIterator1>::value &&
+    is_contiguous_iterator<InputIterator2>::value &&
+    is_contiguous_iterator<OutputIterator>::value
+#else
+    false
+#endif
+    >;
+
+template<typename Op, typename Element, typename InputIterator, typename OutputIterator>
+using can_vectorize_scalar = std::integral_constant<bool,
+    can_vectorize<InputIterator, InputIterator, OutputIterator>::value &&
+    std::is_arithmetic<Element>::value &&
+    is_exact_broadcast<Op, Element, element_t<OutputIterator>>::value>;
+
+/** The fused operations are only vectorized for floating point numbers. */
+template<typename Element1, typename Element2, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+using can_vectorize_fused = std::integral_constant<bool,
+    can_vectorize<InputIterator1, InputIterator2, OutputIterator>::value &&
+    std::is_floating_point<element_t<OutputIterator>>::value &&
+    std::is_arithmetic<Element1>::value &&
+    std::is_arithmetic<Element2>::value &&
+    is_exact_broadcast<multiplies, Element1, element_t<OutputIterator>>::value &&
+    is_exact_broadcast<multiplies, Element2, element_t<OutputIterator>>::value>;
+
+/** Reductions are only vectorized for integers, where the order of the additions does not matter. */
+template<typename InputIterator1, typename InputIterator2, typename T>
+using can_vectorize_reduction = std::integral_constant<bool,
+    can_vectorize<InputIterator1, InputIterator2, InputIterator1>::value &&
+    std::is_integral<T>::value &&
+    std::is_same<element_t<InputIterator1>, T>::value>;
+
+/** The products are vectorized for integers and floating point numbers.
+For floating point numbers the result then depends on the instruction set.
+*/
+template<typename InputIterator1, typename InputIterator2, typename T>
+using can_vectorize_products = std::integral_constant<bool,
+    can_vectorize<InputIterator1, InputIterator2, InputIterator1>::value &&
+    std::is_same<element_t<InputIterator1>, T>::value>;
+
+template<typename Element, typename T> struct is_widening : std::false_type {};
+template<> struct is_widening<std::int8_t, std::int32_t> : std::true_type {};
+template<> struct is_widening<std::uint8_t, std::int32_t> : std::true_type {};
+template<> struct is_widening<std::int16_t, std::int64_t> : std::true_type {};
+template<> struct is_widening<std::uint16_t, std::int64_t> : std::true_type {};
+template<> struct is_widening<std::int32_t, std::int64_t> : std::true_type {};
+
+/** Selects the widening kernels, where `T` is wider than the elements. */
+struct widening {};
+
+template<typename InputIterator1, typename InputIterator2, typename T>
+using products_tag = typename std::conditional<is_widening<element_t<InputIterator1>, T>::value,
+    widening, can_vectorize_products<InputIterator1, InputIterator2, T>>::type;
+
+////////////////////////////////////////////////////////////////////////////////
+// vector-vector
+
+template<typename Op, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void transform(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, OutputIterator first_out,
+    Op op, std::false_type)
+{
+    std::transform(first_left, last_left, first_right, first_out, op);
+}
+
+#if AAA_SIMD
+template<typename Op, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void transform(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, OutputIterator first_out,
+    Op, std::true_type)
+{
+    using T = element_t<OutputIterator>;
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    if (size == 0)
+    {
+        return;
+    }
+    const auto kernel = transform_kernels<Op, T>::select();
+    kernel(to_pointer(first_left), to_pointer(first_right), to_pointer(first_out), size);
+}
+#endif
+
+/** Computes `out[i] = op(left[i], right[i])`. */
+template<typename Op, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void transform(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, OutputIterator first_out, Op op)
+{
+    using tag = can_vectorize<InputIterator1, InputIterator2, OutputIterator>;
+    transform(first_left, last_left, first_right, first_out, op, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// scalar-vector
+
+template<typename Op, typename Element, typename InputIterator, typename OutputIterator>
+void transform_scalar_vector(const Element& left, InputIterator first_right, InputIterator last_right, OutputIterator first_out,
+    Op op, std::false_type)
+{
+    auto f = [&](const value_type_i<InputIterator>& right) { return op(left, right); };
+    std::transform(first_right, last_right, first_out, f);
+}
+
+#if AAA_SIMD
+template<typename Op, typename Element, typename InputIterator, typename OutputIterator>
+void transform_scalar_vector(const Element& left, InputIterator first_right, InputIterator last_right, OutputIterator first_out,
+    Op, std::true_type)
+{
+    using T = element_t<OutputIterator>;
+    const auto size = static_cast<std::size_t>(std::distance(first_right, last_right));
+    if (size == 0)
+    {
+        return;
+    }
+    const auto kernel = transform_scalar_vector_kernels<Op, T>::select();
+    kernel(static_cast<T>(left), to_pointer(first_right), to_pointer(first_out), size);
+}
+#endif
+
+/** Computes `out[i] = op(left, right[i])`. */
+template<typename Op, typename Element, typename InputIterator, typename OutputIterator>
+void transform_scalar_vector(const Element& left, InputIterator first_right, InputIterator last_right, OutputIterator first_out, Op op)
+{
+    using tag = can_vectorize_scalar<Op, Element, InputIterator, OutputIterator>;
+    transform_scalar_vector(left, first_right, last_right, first_out, op, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// vector-scalar
+
+template<typename Op, typename InputIterator, typename Element, typename OutputIterator>
+void transform_vector_scalar(InputIterator first_left, InputIterator last_left, const Element& right, OutputIterator first_out,
+    Op op, std::false_type)
+{
+    auto f = [&](const value_type_i<InputIterator>& left) { return op(left, right); };
+    std::transform(first_left, last_left, first_out, f);
+}
+
+#if AAA_SIMD
+template<typename Op, typename InputIterator, typename Element, typename OutputIterator>
+void transform_vector_scalar(InputIterator first_left, InputIterator last_left, const Element& right, OutputIterator first_out,
+    Op, std::true_type)
+{
+    using T = element_t<OutputIterator>;
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    if (size == 0)
+    {
+        return;
+    }
+    const auto kernel = transform_vector_scalar_kernels<Op, T>::select();
+    kernel(to_pointer(first_left), static_cast<T>(right), to_pointer(first_out), size);
+}
+#endif
+
+/** Computes `out[i] = op(left[i], right)`. */
+template<typename Op, typename InputIterator, typename Element, typename OutputIterator>
+void transform_vector_scalar(InputIterator first_left, InputIterator last_left, const Element& right, OutputIterator first_out, Op op)
+{
+    using tag = can_vectorize_scalar<Op, Element, InputIterator, OutputIterator>;
+    transform_vector_scalar(first_left, last_left, right, first_out, op, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// axpby
+
+template<typename Element1, typename Element2, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void axpby(const Element1& a, InputIterator1 first_x, InputIterator1 last_x, const Element2& b, InputIterator2 first_y, OutputIterator first_out,
+    std::false_type)
+{
+    for (; first_x != last_x; ++first_x, ++first_y, ++first_out)
+    {
+        *first_out = a * *first_x + b * *first_y;
+    }
+}
+
+#if AAA_SIMD
+template<typename Element1, typename Element2, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void axpby(const Element1& a, InputIterator1 first_x, InputIterator1 last_x, const Element2& b, InputIterator2 first_y, OutputIterator first_out,
+    std::true_type)
+{
+    using T = element_t<OutputIterator>;
+    const auto size = static_cast<std::size_t>(std::distance(first_x, last_x));
+    if (size == 0)
+    {
+        return;
+    }
+    const auto kernel = axpby_kernels<T>::select();
+    kernel(static_cast<T>(a), to_pointer(first_x), static_cast<T>(b), to_pointer(first_y), to_pointer(first_out), size);
+}
+#endif
+
+/** Computes `out[i] = a * x[i] + b * y[i]`.
+The vectorized kernels use a fused multiply-add when the CPU has it,
+so the last bit of the result can depend on the instruction set.
+*/
+template<typename Element1, typename Element2, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void axpby(const Element1& a, InputIterator1 first_x, InputIterator1 last_x, const Element2& b, InputIterator2 first_y, OutputIterator first_out)
+{
+    using tag = can_vectorize_fused<Element1, Element2, InputIterator1, InputIterator2, OutputIterator>;
+    axpby(a, first_x, last_x, b, first_y, first_out, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// sum
+
+template<typename InputIterator, typename T>
+T sum(InputIterator first, InputIterator last, T init, std::false_type)
+{
+    return std::accumulate(first, last, init);
+}
+
+#if AAA_SIMD
+template<typename InputIterator, typename T>
+T sum(InputIterator first, InputIterator last, T init, std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first, last));
+    if (size == 0)
+    {
+        return init;
+    }
+    const auto kernel = sum_kernels<T>::select();
+    return T(init + kernel(to_pointer(first), size));
+}
+#endif
+
+/** Computes `init + in[0] + in[1] + ...`. */
+template<typename InputIterator, typename T>
+T sum(InputIterator first, InputIterator last, T init)
+{
+    using tag = can_vectorize_reduction<InputIterator, InputIterator, T>;
+    return sum(first, last, init, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// dot
+
+/** The elements are converted to `T` before they are multiplied, like `widening_dot`. */
+template<typename InputIterator1, typename InputIterator2, typename T>
+T dot(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init, std::false_type)
+{
+    const auto op = [](const T a, const T b)
+    {
+        return T(a * b);
+    };
+    return std::inner_product(first_left, last_left, first_right, init, std::plus<T>{}, op);
+}
+
+#if AAA_SIMD
+template<typename InputIterator1, typename InputIterator2, typename T>
+T dot(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init, std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    if (size == 0)
+    {
+        return init;
+    }
+    const auto kernel = dot_kernels<T>::select();
+    return T(init + kernel(to_pointer(first_left), to_pointer(first_right), size));
+}
+#endif
+
+/** The elements are converted to `T` before they are multiplied. */
+template<typename InputIterator1, typename InputIterator2, typename T>
+T widening_dot(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init,
+    std::false_type)
+{
+    const auto op = [](const T a, const T b)
+    {
+        return T(a * b);
+    };
+    return std::inner_product(first_left, last_left, first_right, init, std::plus<T>{}, op);
+}
+
+#if AAA_SIMD
+template<typename InputIterator1, typename InputIterator2, typename T>
+T widening_dot(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init,
+    std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    if (size == 0)
+    {
+        return init;
+    }
+    const auto kernel = widening_dot_kernels<element_t<InputIterator1>>::select();
+    return T(init + kernel(to_pointer(first_left), to_pointer(first_right), size));
+}
+#endif
+
+template<typename InputIterator1, typename InputIterator2, typename T>
+T dot(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init, widening)
+{
+    using tag = can_vectorize<InputIterator1, InputIterator2, InputIterator1>;
+    return widening_dot(first_left, last_left, first_right, init, tag{});
+}
+
+/** Computes `init + left[0] * right[0] + left[1] * right[1] + ...`. */
+template<typename InputIterator1, typename InputIterator2, typename T>
+T dot(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init)
+{
+    using tag = products_tag<InputIterator1, InputIterator2, T>;
+    return dot(first_left, last_left, first_right, init, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// squared distance
+
+template<typename InputIterator1, typename InputIterator2, typename T>
+T squared_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init,
+    std::false_type)
+{
+    auto op1 = [](const T left, const T right) -> T
+    {
+        return left + right;
+    };
+    // The elements are converted to `T` first, since the product of the promoted
+    // differences of two uint16_t can overflow int.
+    auto op2 = [](const T left, const T right) -> T
+    {
+        return T((left - right) * (left - right));
+    };
+    return std::inner_product(first_left, last_left, first_right, init, op1, op2);
+}
+
+#if AAA_SIMD
+template<typename InputIterator1, typename InputIterator2, typename T>
+T squared_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init,
+    std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    if (size == 0)
+    {
+        return init;
+    }
+    const auto kernel = squared_distance_kernels<T>::select();
+    return T(init + kernel(to_pointer(first_left), to_pointer(first_right), size));
+}
+#endif
+
+/** The elements are converted to `T` before they are multiplied. */
+template<typename InputIterator1, typename InputIterator2, typename T>
+T widening_squared_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init,
+    std::false_type)
+{
+    const auto op = [](const T a, const T b)
+    {
+        return T((a - b) * (a - b));
+    };
+    return std::inner_product(first_left, last_left, first_right, init, std::plus<T>{}, op);
+}
+
+#if AAA_SIMD
+template<typename InputIterator1, typename InputIterator2, typename T>
+T widening_squared_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init,
+    std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    if (size == 0)
+    {
+        return init;
+    }
+    const auto kernel = widening_squared_distance_kernels<element_t<InputIterator1>>::select();
+    return T(init + kernel(to_pointer(first_left), to_pointer(first_right), size));
+}
+#endif
+
+template<typename InputIterator1, typename InputIterator2, typename T>
+T squared_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init, widening)
+{
+    using tag = can_vectorize<InputIterator1, InputIterator2, InputIterator1>;
+    return widening_squared_distance(first_left, last_left, first_right, init, tag{});
+}
+
+/** Computes `init + (left[0] - right[0])^2 + (left[1] - right[1])^2 + ...`. */
+template<typename InputIterator1, typename InputIterator2, typename T>
+T squared_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init)
+{
+    using tag = products_tag<InputIterator1, InputIterator2, T>;
+    return squared_distance(first_left, last_left, first_right, init, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// manhattan distance
+
+template<typename InputIterator1, typename InputIterator2, typename T>
+T manhattan_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init,
+    std::false_type)
+{
+    auto op1 = [](const T left, const T right) -> T
+    {
+        return left + right;
+    };
+    auto op2 = [](const auto left, const auto right) -> T
+    {
+        return std::abs(left - right);
+    };
+    return std::inner_product(first_left, last_left, first_right, init, op1, op2);
+}
+
+#if AAA_SIMD
+template<typename InputIterator1, typename InputIterator2, typename T>
+T manhattan_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init,
+    std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    if (size == 0)
+    {
+        return init;
+    }
+    const auto kernel = widening_manhattan_distance_kernels<element_t<InputIterator1>>::select();
+    return T(init + kernel(to_pointer(first_left), to_pointer(first_right), size));
+}
+#endif
+
+/** Computes `init + |left[0] - right[0]| + |left[1] - right[1]| + ...`.
+Only bytes with an `int32_t` init are vectorized.
+*/
+template<typename InputIterator1, typename InputIterator2, typename T>
+T manhattan_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init)
+{
+    using tag = std::integral_constant<bool,
+        can_vectorize<InputIterator1, InputIterator2, InputIterator1>::value &&
+        is_widening<element_t<InputIterator1>, T>::value &&
+        sizeof(element_t<InputIterator1>) == 1>;
+    return manhattan_distance(first_left, last_left, first_right, init, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// quantization
+
+/** The quantization is vectorized between contiguous ranges of `float` and of bytes, with a `float` scale. */
+template<typename FloatIterator, typename ByteIterator, typename T>
+using can_vectorize_quantization = std::integral_constant<bool,
+    can_vectorize<FloatIterator, FloatIterator, FloatIterator>::value &&
+    can_vectorize<ByteIterator, ByteIterator, ByteIterator>::value &&
+    std::is_same<element_t<FloatIterator>, float>::value &&
+    std::is_same<T, float>::value &&
+    sizeof(element_t<ByteIterator>) == 1 &&
+    std::is_integral<element_t<ByteIterator>>::value>;
+
+template<typename InputIterator, typename OutputIterator, typename T>
+void quantize(InputIterator first_in, InputIterator last_in, OutputIterator first_out, T scale, int zero_point,
+    std::false_type)
+{
+    quantize_loop(first_in, last_in, scale, zero_point, first_out);
+}
+
+#if AAA_SIMD
+template<typename InputIterator, typename OutputIterator, typename T>
+void quantize(InputIterator first_in, InputIterator last_in, OutputIterator first_out, T scale, int zero_point,
+    std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_in, last_in));
+    if (size == 0 || zero_point < -max_zero_point || zero_point > max_zero_point)
+    {
+        quantize_loop(first_in, last_in, scale, zero_point, first_out);
+        return;
+    }
+    const auto kernel = quantize_kernels<element_t<OutputIterator>>::select();
+    kernel(to_pointer(first_in), scale, zero_point, to_pointer(first_out), size);
+}
+#endif
+
+/** Computes `out[i] = round(in[i] / scale) + zero_point`, rounded to nearest even and clamped to the range of the output. */
+template<typename InputIterator, typename OutputIterator, typename T>
+void quantize(InputIterator first_in, InputIterator last_in, OutputIterator first_out, T scale, int zero_point)
+{
+    using tag = can_vectorize_quantization<InputIterator, OutputIterator, T>;
+    quantize(first_in, last_in, first_out, scale, zero_point, tag{});
+}
+
+template<typename InputIterator, typename OutputIterator, typename T>
+void dequantize(InputIterator first_in, InputIterator last_in, OutputIterator first_out, T scale, int zero_point,
+    std::false_type)
+{
+    dequantize_loop(first_in, last_in, scale, zero_point, first_out);
+}
+
+#if AAA_SIMD
+template<typename InputIterator, typename OutputIterator, typename T>
+void dequantize(InputIterator first_in, InputIterator last_in, OutputIterator first_out, T scale, int zero_point,
+    std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_in, last_in));
+    if (size == 0)
+    {
+        return;
+    }
+    const auto kernel = dequantize_kernels<element_t<InputIterator>>::select();
+    kernel(to_pointer(first_in), scale, zero_point, to_pointer(first_out), size);
+}
+#endif
+
+/** Computes `out[i] = (in[i] - zero_point) * scale`. */
+template<typename InputIterator, typename OutputIterator, typename T>
+void dequantize(InputIterator first_in, InputIterator last_in, OutputIterator first_out, T scale, int zero_point)
+{
+    using tag = can_vectorize_quantization<OutputIterator, InputIterator, T>;
+    dequantize(first_in, last_in, first_out, scale, zero_point, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// cosine sums
+
+template<typename T, typename InputIterator1, typename InputIterator2>
+std::array<T, 3> cosine_sums(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right,
+    std::false_type)
+{
+    return cosine_sums_loop<T>(first_left, last_left, first_right);
+}
+
+#if AAA_SIMD
+template<typename T, typename InputIterator1, typename InputIterator2>
+std::array<T, 3> cosine_sums(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right,
+    std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    if (size == 0)
+    {
+        return std::array<T, 3>{};
+    }
+    const auto kernel = cosine_sums_kernels<T>::select();
+    return kernel(to_pointer(first_left), to_pointer(first_right), size);
+}
+#endif
+
+/** Computes the dot product `a.b` and the squared norms `a.a` and `b.b` in a single pass,
+in the type `T`. Contiguous floating point ranges of type `T` are vectorized.
+*/
+template<typename T, typename InputIterator1, typename InputIterator2>
+std::array<T, 3> cosine_sums(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right)
+{
+    using tag = std::integral_constant<bool,
+        can_vectorize<InputIterator1, InputIterator2, InputIterator1>::value &&
+        std::is_floating_point<T>::value &&
+        std::is_same<element_t<InputIterator1>, T>::value>;
+    return cosine_sums<T>(first_left, last_left, first_right, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// shifted moments
+
+template<typename T, typename InputIterator>
+std::array<T, 5> shifted_moments(InputIterator first, InputIterator last, T shift, std::false_type)
+{
+    return shifted_moments_loop<T>(first, last, shift);
+}
+
+#if AAA_SIMD
+template<typename T, typename InputIterator>
+std::array<T, 5> shifted_moments(InputIterator first, InputIterator last, T shift, std::true_type)
+{
+    const auto kernel = shifted_moments_kernels<T>::select();
+    return kernel(to_pointer(first), static_cast<std::size_t>(std::distance(first, last)), shift);
+}
+#endif
+
+/** Computes the sums of `x - shift`, `(x - shift)^2` and `(x - shift)^3`, and the minimum
+and the maximum of the elements, in a single pass in the type `T`. The range should not be
+empty. Contiguous floating point ranges of type `T` are vectorized.
+*/
+template<typename T, typename InputIterator>
+std::array<T, 5> shifted_moments(InputIterator first, InputIterator last, T shift)
+{
+    assert(first != last);
+    using tag = std::integral_constant<bool,
+        can_vectorize<InputIterator, InputIterator, InputIterator>::value &&
+        std::is_floating_point<T>::value &&
+        std::is_same<element_t<InputIterator>, T>::value>;
+    return shifted_moments<T>(first, last, shift, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// reduce many
+
+template<typename T, typename... Reductions, typename InputIterator>
+std::array<T, sizeof...(Reductions)> reduce_many(InputIterator first, InputIterator last, std::false_type)
+{
+    return reduce_many_loop<T, Reductions...>(first, last, std::index_sequence_for<Reductions...>{});
+}
+
+#if AAA_SIMD
+template<typename T, typename... Reductions, typename InputIterator>
+std::array<T, sizeof...(Reductions)> reduce_many(InputIterator first, InputIterator last, std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first, last));
+    if (size == 0)
+    {
+        return {};
+    }
+    const auto kernel = reduce_many_kernels<T, Reductions...>::select();
+    return kernel(to_pointer(first), size);
+}
+#endif
+
+/** Computes the reductions of `reduce_many_loop` in a single pass. Contiguous floating
+point ranges of type `T` are vectorized, with several accumulators per reduction, so
+the sums then depend on the instruction set.
+*/
+template<typename T, typename... Reductions, typename InputIterator>
+std::array<T, sizeof...(Reductions)> reduce_many(InputIterator first, InputIterator last)
+{
+    static_assert(sizeof...(Reductions) > 0, "reduce_many needs at least one reduction");
+    using tag = std::integral_constant<bool,
+        can_vectorize<InputIterator, InputIterator, InputIterator>::value &&
+        std::is_floating_point<T>::value &&
+        std::is_same<element_t<InputIterator>, T>::value>;
+    return reduce_many<T, Reductions...>(first, last, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// lane sum
+
+template<typename T, typename Map, typename InputIterator1, typename InputIterator2>
+T lane_sum(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, Map, std::false_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    T lanes[num_lanes] = {};
+    return lane_sum_loop<Map>(first_left, first_right, 0, size, lanes);
+}
+
+#if AAA_SIMD
+template<typename T, typename Map, typename InputIterator1, typename InputIterator2>
+T lane_sum(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, Map, std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    if (size == 0)
+    {
+        return T{};
+    }
+    const auto kernel = lane_sum_kernels<Map, T>::select();
+    return kernel(to_pointer(first_left), to_pointer(first_right), size);
+}
+#endif
+
+/** Computes the sum of `map(left[i], right[i])` with `num_lanes` accumulators.
+The term of element `i` is added to the accumulator `i % num_lanes`, and the
+accumulators are then added in a fixed pairwise order. The kernels of all the
+instruction sets follow this order, and do not use fused multiply-adds,
+so the result is the same for all of them.
+*/
+template<typename T, typename Map, typename InputIterator1, typename InputIterator2>
+T lane_sum(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, Map map)
+{
+    using tag = std::integral_constant<bool,
+        can_vectorize<InputIterator1, InputIterator2, InputIterator1>::value &&
+        std::is_floating_point<T>::value &&
+        std::is_same<element_t<InputIterator1>, T>::value>;
+    return lane_sum<T>(first_left, last_left, first_right, map, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// accurate sum
+
+template<typename T, typename Tag, typename Map, typename InputIterator1, typename InputIterator2>
+T accurate_sum(Tag, InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init, Map,
+    std::false_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    return accurate_sum_loop<Map>(Tag{}, first_left, first_right, size, init);
+}
+
+#if AAA_SIMD
+template<typename T, typename Tag, typename Map, typename InputIterator1, typename InputIterator2>
+T accurate_sum(Tag, InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init, Map,
+    std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    if (size == 0)
+    {
+        return init;
+    }
+    const auto kernel = accurate_sum_kernels<Tag, Map, T>::select();
+    return kernel(Tag{}, to_pointer(first_left), to_pointer(first_right), size, init);
+}
+#endif
+
+/** Integer sums are exact in any order, so they skip the summation algorithms of the
+accuracy policies, whose error terms would only overflow.
+*/
+template<typename InputIterator1, typename InputIterator2, typename T>
+T exact_sum(InputIterator1 first_left, InputIterator1 last_left, InputIterator2, T init, operations::first_operand)
+{
+    return sum(first_left, last_left, init);
+}
+
+template<typename InputIterator1, typename InputIterator2, typename T>
+T exact_sum(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init, multiplies)
+{
+    return dot(first_left, last_left, first_right, init);
+}
+
+template<typename InputIterator1, typename InputIterator2, typename T, typename Map>
+T exact_sum(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init, Map map)
+{
+    const auto term = [&](const T left, const T right)
+    {
+        return T(map(left, right));
+    };
+    return std::inner_product(first_left, last_left, first_right, init, std::plus<T>{}, term);
+}
+
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename T, typename Map>
+T policy_sum(Tag, InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init, Map map,
+    std::false_type)
+{
+    return exact_sum(first_left, last_left, first_right, init, map);
+}
+
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename T, typename Map>
+T policy_sum(Tag, InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init, Map map,
+    std::true_type)
+{
+    using tag = std::integral_constant<bool,
+        can_vectorize<InputIterator1, InputIterator2, InputIterator1>::value &&
+        std::is_same<element_t<InputIterator1>, T>::value>;
+    return accurate_sum<T>(Tag{}, first_left, last_left, first_right, init, map, tag{});
+}
+
+/** Computes `init + map(left[0], right[0]) + map(left[1], right[1]) + ...`,
+with the summation algorithm of an accuracy policy, see @ref accuracy.
+Integers are added exactly, like without a policy.
+*/
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename T, typename Map>
+T accurate_sum(accuracy::policy<Tag>, InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right,
+    T init, Map map)
+{
+    return policy_sum(Tag{}, first_left, last_left, first_right, init, map, std::is_floating_point<T>{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// distances of rows
+
+template<typename Reduce, typename Map, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void tile_distances(InputIterator1 first_a, std::size_t num_a, InputIterator2 first_b, std::size_t num_b,
+    std::size_t dimension, OutputIterator first_out, std::size_t stride, std::false_type)
+{
+    tile_distances_loop<Reduce, Map>(first_a, num_a, first_b, num_b, dimension, first_out, stride);
+}
+
+#if AAA_SIMD
+template<typename Reduce, typename Map, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void tile_distances(InputIterator1 first_a, std::size_t num_a, InputIterator2 first_b, std::size_t num_b,
+    std::size_t dimension, OutputIterator first_out, std::size_t stride, std::true_type)
+{
+    if (num_a == 0 || num_b == 0)
+    {
+        return;
+    }
+    const auto kernel = tile_distances_kernels<Reduce, Map, element_t<OutputIterator>>::select();
+    kernel(to_pointer(first_a), num_a, to_pointer(first_b), num_b, dimension, to_pointer(first_out), stride);
+}
+#endif
+
+/** Computes the distances of each of the `num_a` rows of the row-major matrix `a`
+to each of the `num_b` rows of the row-major matrix `b`, where the rows have
+`dimension` elements. The distances of row `r` of `a` start at `first_out + r * stride`.
+The distance is `reduce` over the elements of `map(a_r[i], b_c[i])`.
+The kernels compare tiles of several rows of `a` and `b` in the registers,
+so that each part of a row is loaded once for all the rows of the tile.
+*/
+template<typename Reduce, typename Map, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void tile_distances(InputIterator1 first_a, std::size_t num_a, InputIterator2 first_b, std::size_t num_b,
+    std::size_t dimension, OutputIterator first_out, std::size_t stride)
+{
+    using tag = std::integral_constant<bool,
+        can_vectorize<InputIterator1, InputIterator2, OutputIterator>::value &&
+        std::is_floating_point<element_t<OutputIterator>>::value>;
+    tile_distances<Reduce, Map>(first_a, num_a, first_b, num_b, dimension, first_out, stride, tag{});
+}
+
+/** Computes the distance of the query to each row of a row-major matrix,
+with `num_rows = last_out - first_out` rows of the size of the query.
+*/
+template<typename Reduce, typename Map, typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void row_distances(InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out)
+{
+    const auto dimension = static_cast<std::size_t>(std::distance(first_query, last_query));
+    const auto num_rows = static_cast<std::size_t>(std::distance(first_out, last_out));
+    tile_distances<Reduce, Map>(first_query, 1, first_matrix, num_rows, dimension, first_out, num_rows);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// bounded distance
+
+template<typename Reduce, typename Map, typename InputIterator1, typename InputIterator2, typename T>
+T bounded_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T bound,
+    std::false_type)
+{
+    return bounded_distance_loop<Reduce, Map>(first_left, last_left, first_right, bound);
+}
+
+#if AAA_SIMD
+template<typename Reduce, typename Map, typename InputIterator1, typename InputIterator2, typename T>
+T bounded_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T bound,
+    std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    if (size == 0)
+    {
+        return T{};
+    }
+    const auto kernel = bounded_distance_kernels<Reduce, Map, T>::select();
+    return kernel(to_pointer(first_left), to_pointer(first_right), size, bound);
+}
+#endif
+
+/** Computes the distance `reduce` over the elements of `map(left[i], right[i])`,
+but stops early when a partial distance is greater than `bound`. Then the partial
+distance is returned, which is greater than `bound` and at most the distance.
+The terms of the distance should not be negative.
+*/
+template<typename Reduce, typename Map, typename InputIterator1, typename InputIterator2, typename T>
+T bounded_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T bound)
+{
+    using tag = std::integral_constant<bool,
+        can_vectorize<InputIterator1, InputIterator2, InputIterator1>::value &&
+        std::is_floating_point<T>::value &&
+        std::is_same<element_t<InputIterator1>, T>::value>;
+    return bounded_distance<Reduce, Map>(first_left, last_left, first_right, bound, tag{});
+}
+
+/** Computes `reduce(init, distance)` with the kernels of `bounded_distance`, without a bound. */
+template<typename Reduce, typename Map, typename InputIterator1, typename InputIterator2, typename T>
+T reduce_distance(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, T init)
+{
+    const auto unbounded = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+    return T(Reduce{}(init, bounded_distance<Reduce, Map>(first_left, last_left, first_right, unbounded)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// table lookups
+
+template<typename T>
+void table_lookup_sums(const T* table, std::size_t num_centroids, const std::uint8_t* codes,
+    std::size_t num_subspaces, std::size_t num_codes, T* out)
+{
+    table_lookup_sums_loop(table, num_centroids, codes, num_subspaces, num_codes, out);
+}
+
+#if AAA_SIMD
+/** Sums the entries of a table that are selected by rows of byte codes, see `table_lookup_sums_loop`.
+For `float` the kernels gather the entries of several rows at a time.
+*/
+inline void table_lookup_sums(const float* table, std::size_t num_centroids, const std::uint8_t* codes,
+    std::size_t num_subspaces, std::size_t num_codes, float* out)
+{
+    const auto kernel = table_lookup_sums_kernels::select();
+    kernel(table, num_centroids, codes, num_subspaces, num_codes, out);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// bit counts
+
+template<bool Xor, typename InputIterator1, typename InputIterator2>
+std::uint64_t bit_count(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right,
+    std::false_type)
+{
+    auto count = std::uint64_t{0};
+    for (; first_left != last_left; ++first_left, ++first_right)
+    {
+        count += popcount(Xor ? *first_left ^ *first_right : *first_left);
+    }
+    return count;
+}
+
+#if AAA_SIMD
+template<bool Xor, typename InputIterator1, typename InputIterator2>
+std::uint64_t bit_count(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right,
+    std::true_type)
+{
+    const auto size = static_cast<std::size_t>(std::distance(first_left, last_left));
+    if (size == 0)
+    {
+        return 0;
+    }
+    const auto kernel = bit_count_kernels<Xor>::select();
+    return kernel(to_pointer(first_left), to_pointer(first_right), size);
+}
+#endif
+
+/** The number of bits that are set in the words of the left range, or in
+`left[i] ^ right[i]` if `Xor` is true. The right range is not read if `Xor` is false.
+Contiguous ranges of `uint64_t` are vectorized.
+*/
+template<bool Xor, typename InputIterator1, typename InputIterator2>
+std::uint64_t bit_count(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right)
+{
+    using tag = std::integral_constant<bool,
+        can_vectorize<InputIterator1, InputIterator2, InputIterator1>::value &&
+        std::is_same<element_t<InputIterator1>, std::uint64_t>::value>;
+    return bit_count<Xor>(first_left, last_left, first_right, tag{});
+}
+
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void hamming_distances(InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out, std::false_type)
+{
+    const auto num_words = std::distance(first_query, last_query);
+    for (; first_out != last_out; ++first_out)
+    {
+        *first_out = bit_count<true>(first_query, last_query, first_matrix);
+        std::advance(first_matrix, num_words);
+    }
+}
+
+#if AAA_SIMD
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void hamming_distances(InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out, std::true_type)
+{
+    const auto num_words = static_cast<std::size_t>(std::distance(first_query, last_query));
+    const auto num_rows = static_cast<std::size_t>(std::distance(first_out, last_out));
+    if (num_words == 0 || num_rows == 0)
+    {
+        std::fill(first_out, last_out, 0);
+        return;
+    }
+    const auto kernel = hamming_distances_kernels::select();
+    kernel(to_pointer(first_query), to_pointer(first_matrix), num_words, num_rows, to_pointer(first_out));
+}
+#endif
+
+/** The number of bits that differ between the query and each row of the matrix.
+Contiguous ranges of `uint64_t` are vectorized.
+*/
+template<typename InputIterator1, typename InputIterator2, typename OutputIterator>
+void hamming_distances(InputIterator1 first_query, InputIterator1 last_query, InputIterator2 first_matrix,
+    OutputIterator first_out, OutputIterator last_out)
+{
+    using tag = std::integral_constant<bool,
+        can_vectorize<InputIterator1, InputIterator2, OutputIterator>::value &&
+        std::is_same<element_t<InputIterator1>, std::uint64_t>::value>;
+    hamming_distances(first_query, last_query, first_matrix, first_out, last_out, tag{});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// search
+
+template<typename T>
+constexpr T highest()
+{
+    return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+}
+
+template<typename T>
+constexpr T lowest()
+{
+    return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest();
+}
+
+#if AAA_SIMD
+/** Returns the first element that is equal to the extremum.
+The extremum ignores NaN, which matches the standard algorithms,
+unless the first element is NaN. In that case the first element is returned.
+*/
+template<typename Op, typename Iterator>
+Iterator find_extremum(Iterator first, Iterator last, element_t<Iterator> init)
+{
+    using T = element_t<Iterator>;
+    const auto size = static_cast<std::size_t>(std::distance(first, last));
+    if (size == 0 || *first != *first)
+    {
+        return first;
+    }
+    const auto kernel = extremum_kernels<Op, T>::select();
+    const auto value = kernel(to_pointer(first), size, init);
+    return std::find(first, last, value);
+}
+
+template<typename Iterator>
+Iterator min_element(Iterator first, Iterator last, std::true_type)
+{
+    return find_extremum<minimum>(first, last, highest<element_t<Iterator>>());
+}
+
+template<typename Iterator>
+Iterator max_element(Iterator first, Iterator last, std::true_type)
+{
+    return find_extremum<maximum>(first, last, lowest<element_t<Iterator>>());
+}
+#endif
+
+template<typename Iterator>
+Iterator min_element(Iterator first, Iterator last, std::false_type)
+{
+    return std::min_element(first, last);
+}
+
+template<typename Iterator>
+Iterator max_element(Iterator first, Iterator last, std::false_type)
+{
+    return std::max_element(first, last);
+}
+
+/** Same as `std::min_element`. */
+template<typename Iterator>
+Iterator min_element(Iterator first, Iterator last)
+{
+    using tag = can_vectorize<Iterator, Iterator, Iterator>;
+    return min_element(first, last, tag{});
+}
+
+/** Same as `std::max_element`. */
+template<typename Iterator>
+Iterator max_element(Iterator first, Iterator last)
+{
+    using tag = can_vectorize<Iterator, Iterator, Iterator>;
+    return max_element(first, last, tag{});
+}
+
+/** @} */
+
+} // namespace simd
+} // namespace aaa
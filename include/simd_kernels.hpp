@@ -0,0 +1,1096 @@
+// The kernels of simd.hpp that are the same for all instruction sets.
+// This file is included in the struct of each instruction set, with AAA_KERNEL_TARGET
+// defined as the target attribute of that instruction set, so it has no include guard.
+// It uses the primitives of the struct, like load, store and apply.
+
+#ifndef AAA_KERNEL_TARGET
+#error "simd_kernels.hpp is included by simd.hpp, inside the struct of an instruction set"
+#endif
+
+template<typename T>
+using register_t = decltype(load(static_cast<const T*>(nullptr)));
+
+// The words are counted by the popcnt instruction, in 4 accumulators.
+template<bool Xor>
+static AAA_KERNEL_TARGET std::uint64_t popcount_words(const std::uint64_t* a, const std::uint64_t* b, std::size_t size)
+{
+    std::uint64_t acc[4] = {};
+    auto i = std::size_t{0};
+    for (; i + 4 <= size; i += 4)
+    {
+        AAA_UNROLL
+        for (auto k = std::size_t{0}; k < 4; ++k)
+        {
+            acc[k] += static_cast<std::uint64_t>(__builtin_popcountll(Xor ? a[i + k] ^ b[i + k] : a[i + k]));
+        }
+    }
+    for (; i < size; ++i)
+    {
+        acc[0] += static_cast<std::uint64_t>(__builtin_popcountll(Xor ? a[i] ^ b[i] : a[i]));
+    }
+    return acc[0] + acc[1] + acc[2] + acc[3];
+}
+
+static AAA_KERNEL_TARGET void hamming_distances(const std::uint64_t* query, const std::uint64_t* matrix,
+    std::size_t num_words, std::size_t num_rows, std::uint64_t* out)
+{
+    for (auto r = std::size_t{0}; r < num_rows; ++r)
+    {
+        out[r] = bit_count<true>(query, matrix + r * num_words, num_words);
+    }
+}
+
+template<typename Op, typename T>
+static AAA_KERNEL_TARGET void transform(const T* left, const T* right, T* out, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(T);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        store(out + i, apply(Op{}, lane_t<Op, T>{}, load(left + i), load(right + i)));
+    }
+    for (; i < size; ++i)
+    {
+        out[i] = Op{}(left[i], right[i]);
+    }
+}
+
+template<typename Op, typename T>
+static AAA_KERNEL_TARGET void transform_scalar_vector(T left, const T* right, T* out, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(T);
+    const auto l = broadcast(lane_t<Op, T>{}, left);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        store(out + i, apply(Op{}, lane_t<Op, T>{}, l, load(right + i)));
+    }
+    for (; i < size; ++i)
+    {
+        out[i] = Op{}(left, right[i]);
+    }
+}
+
+template<typename Op, typename T>
+static AAA_KERNEL_TARGET void transform_vector_scalar(const T* left, T right, T* out, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(T);
+    const auto r = broadcast(lane_t<Op, T>{}, right);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        store(out + i, apply(Op{}, lane_t<Op, T>{}, load(left + i), r));
+    }
+    for (; i < size; ++i)
+    {
+        out[i] = Op{}(left[i], right);
+    }
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET void axpby(T a, const T* x, T b, const T* y, T* out, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(T);
+    const auto va = broadcast(lane<T>{}, a);
+    const auto vb = broadcast(lane<T>{}, b);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        const auto by = apply(multiplies{}, lane<T>{}, vb, load(y + i));
+        store(out + i, multiply_add(lane<T>{}, va, load(x + i), by));
+    }
+    for (; i < size; ++i)
+    {
+        out[i] = multiply_add(a, x[i], T(b * y[i]));
+    }
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET T sum(const T* in, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(T);
+    T lanes[width] = {};
+    auto acc = load(lanes);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        acc = apply(plus{}, lane_t<plus, T>{}, acc, load(in + i));
+    }
+    store(lanes, acc);
+    auto result = T{};
+    for (auto x : lanes)
+    {
+        result = T(result + x);
+    }
+    for (; i < size; ++i)
+    {
+        result = T(result + in[i]);
+    }
+    return result;
+}
+
+// The floating point products are accumulated with fused multiply-adds when the CPU has them.
+template<typename T>
+static AAA_KERNEL_TARGET register_t<T> accumulate_product(register_t<T> acc, register_t<T> a, register_t<T> b, std::true_type)
+{
+    return multiply_add(lane<T>{}, a, b, acc);
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET register_t<T> accumulate_product(register_t<T> acc, register_t<T> a, register_t<T> b, std::false_type)
+{
+    return apply(plus{}, lane_t<plus, T>{}, acc, apply(multiplies{}, lane_t<multiplies, T>{}, a, b));
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET T accumulate_product(T acc, T a, T b, std::true_type)
+{
+    return multiply_add(a, b, acc);
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET T accumulate_product(T acc, T a, T b, std::false_type)
+{
+    return T(acc + a * b);
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET register_t<T> accumulate_term(register_t<T> acc, register_t<T> a, register_t<T>, operations::first_operand)
+{
+    return apply(plus{}, lane_t<plus, T>{}, acc, a);
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET register_t<T> accumulate_term(register_t<T> acc, register_t<T> a, register_t<T> b, multiplies)
+{
+    return accumulate_product<T>(acc, a, b, std::is_floating_point<T>{});
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET register_t<T> accumulate_term(register_t<T> acc, register_t<T> a, register_t<T> b, operations::squared_difference)
+{
+    const auto difference = apply(minus{}, lane_t<minus, T>{}, a, b);
+    return accumulate_product<T>(acc, difference, difference, std::is_floating_point<T>{});
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET T accumulate_term(T acc, T a, T, operations::first_operand)
+{
+    return T(acc + a);
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET T accumulate_term(T acc, T a, T b, multiplies)
+{
+    return accumulate_product<T>(acc, a, b, std::is_floating_point<T>{});
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET T accumulate_term(T acc, T a, T b, operations::squared_difference)
+{
+    const auto difference = T(a - b);
+    return accumulate_product<T>(acc, difference, difference, std::is_floating_point<T>{});
+}
+
+// Several accumulators hide the latency of the additions.
+template<typename Map, typename T>
+static AAA_KERNEL_TARGET T sum_of_terms(const T* left, const T* right, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(T);
+    constexpr auto num_accumulators = std::size_t{4};
+    T lanes[width] = {};
+    register_t<T> acc[num_accumulators];
+    for (auto k = std::size_t{0}; k < num_accumulators; ++k)
+    {
+        acc[k] = load(lanes);
+    }
+    auto i = std::size_t{0};
+    for (; i + num_accumulators * width <= size; i += num_accumulators * width)
+    {
+        for (auto k = std::size_t{0}; k < num_accumulators; ++k)
+        {
+            acc[k] = accumulate_term<T>(acc[k], load(left + i + k * width), load(right + i + k * width), Map{});
+        }
+    }
+    for (; i + width <= size; i += width)
+    {
+        acc[0] = accumulate_term<T>(acc[0], load(left + i), load(right + i), Map{});
+    }
+    acc[0] = apply(plus{}, lane_t<plus, T>{}, apply(plus{}, lane_t<plus, T>{}, acc[0], acc[1]),
+        apply(plus{}, lane_t<plus, T>{}, acc[2], acc[3]));
+    store(lanes, acc[0]);
+    auto result = T{};
+    for (auto x : lanes)
+    {
+        result = T(result + x);
+    }
+    for (; i < size; ++i)
+    {
+        result = accumulate_term<T>(result, left[i], right[i], Map{});
+    }
+    return result;
+}
+
+// The dot product and the two squared norms share the loads, with 2 accumulators each.
+template<typename T>
+static AAA_KERNEL_TARGET std::array<T, 3> cosine_sums(const T* left, const T* right, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(T);
+    using fused = std::is_floating_point<T>;
+    T lanes[width] = {};
+    register_t<T> acc[3][2];
+    for (auto j = std::size_t{0}; j < 3; ++j)
+    {
+        acc[j][0] = load(lanes);
+        acc[j][1] = load(lanes);
+    }
+    auto i = std::size_t{0};
+    for (; i + 2 * width <= size; i += 2 * width)
+    {
+        AAA_UNROLL
+        for (auto k = std::size_t{0}; k < 2; ++k)
+        {
+            const auto a = load(left + i + k * width);
+            const auto b = load(right + i + k * width);
+            acc[0][k] = accumulate_product<T>(acc[0][k], a, b, fused{});
+            acc[1][k] = accumulate_product<T>(acc[1][k], a, a, fused{});
+            acc[2][k] = accumulate_product<T>(acc[2][k], b, b, fused{});
+        }
+    }
+    for (; i + width <= size; i += width)
+    {
+        const auto a = load(left + i);
+        const auto b = load(right + i);
+        acc[0][0] = accumulate_product<T>(acc[0][0], a, b, fused{});
+        acc[1][0] = accumulate_product<T>(acc[1][0], a, a, fused{});
+        acc[2][0] = accumulate_product<T>(acc[2][0], b, b, fused{});
+    }
+    auto sums = std::array<T, 3>{};
+    for (auto j = std::size_t{0}; j < 3; ++j)
+    {
+        store(lanes, apply(plus{}, lane<T>{}, acc[j][0], acc[j][1]));
+        for (auto x : lanes)
+        {
+            sums[j] = T(sums[j] + x);
+        }
+    }
+    for (; i < size; ++i)
+    {
+        sums[0] = accumulate_product<T>(sums[0], left[i], right[i], fused{});
+        sums[1] = accumulate_product<T>(sums[1], left[i], left[i], fused{});
+        sums[2] = accumulate_product<T>(sums[2], right[i], right[i], fused{});
+    }
+    return sums;
+}
+
+// The shifted sums of `shifted_moments_loop` and the extremes, with 2 accumulators each.
+template<typename T>
+static AAA_KERNEL_TARGET std::array<T, 5> shifted_moments(const T* in, std::size_t size, T shift)
+{
+    constexpr auto width = register_size / sizeof(T);
+    using fused = std::is_floating_point<T>;
+    const auto shifts = broadcast(lane<T>{}, shift);
+    T lanes[width] = {};
+    register_t<T> acc[5][2];
+    for (auto j = std::size_t{0}; j < 3; ++j)
+    {
+        acc[j][0] = load(lanes);
+        acc[j][1] = load(lanes);
+    }
+    for (auto k = std::size_t{0}; k < 2; ++k)
+    {
+        acc[3][k] = broadcast(lane<T>{}, in[0]);
+        acc[4][k] = acc[3][k];
+    }
+    auto i = std::size_t{0};
+    for (; i + 2 * width <= size; i += 2 * width)
+    {
+        AAA_UNROLL
+        for (auto k = std::size_t{0}; k < 2; ++k)
+        {
+            const auto x = load(in + i + k * width);
+            const auto d = apply(minus{}, lane<T>{}, x, shifts);
+            const auto d2 = apply(multiplies{}, lane<T>{}, d, d);
+            acc[0][k] = apply(plus{}, lane<T>{}, acc[0][k], d);
+            acc[1][k] = apply(plus{}, lane<T>{}, acc[1][k], d2);
+            acc[2][k] = accumulate_product<T>(acc[2][k], d2, d, fused{});
+            acc[3][k] = apply(minimum{}, lane_t<minimum, T>{}, x, acc[3][k]);
+            acc[4][k] = apply(maximum{}, lane_t<maximum, T>{}, x, acc[4][k]);
+        }
+    }
+    auto moments = std::array<T, 5>{ T{}, T{}, T{}, in[0], in[0] };
+    for (auto j = std::size_t{0}; j < 5; ++j)
+    {
+        store(lanes, j < 3 ? apply(plus{}, lane<T>{}, acc[j][0], acc[j][1]) :
+            j == 3 ? apply(minimum{}, lane_t<minimum, T>{}, acc[j][0], acc[j][1]) :
+            apply(maximum{}, lane_t<maximum, T>{}, acc[j][0], acc[j][1]));
+        for (auto x : lanes)
+        {
+            moments[j] = j < 3 ? T(moments[j] + x) : j == 3 ? minimum{}(moments[j], x) : maximum{}(moments[j], x);
+        }
+    }
+    for (; i < size; ++i)
+    {
+        const auto d = T(in[i] - shift);
+        moments[0] = T(moments[0] + d);
+        moments[1] = T(moments[1] + d * d);
+        moments[2] = T(moments[2] + d * d * d);
+        moments[3] = minimum{}(moments[3], in[i]);
+        moments[4] = maximum{}(moments[4], in[i]);
+    }
+    return moments;
+}
+
+// The tag is true for the reduction by `operations::first_operand`, which has nothing to fold.
+template<typename T, typename Reduce>
+static AAA_KERNEL_TARGET T fold_pair(const register_t<T> (&)[2], std::true_type)
+{
+    return T{};
+}
+
+template<typename T, typename Reduce>
+static AAA_KERNEL_TARGET T fold_pair(const register_t<T> (&acc)[2], std::false_type)
+{
+    constexpr auto width = register_size / sizeof(T);
+    T lanes[width];
+    store(lanes, apply(Reduce{}, lane<T>{}, acc[0], acc[1]));
+    auto result = T{};
+    for (auto x : lanes)
+    {
+        result = T(Reduce{}(result, x));
+    }
+    return result;
+}
+
+// The reductions of `reduce_many_loop` share the loads, with 2 accumulators each.
+template<typename T, typename... Reductions, std::size_t... I>
+static AAA_KERNEL_TARGET std::array<T, sizeof...(I)> reduce_many(const T* in, std::size_t size, std::index_sequence<I...>)
+{
+    constexpr auto width = register_size / sizeof(T);
+    using expand = int[];
+    T lanes[width] = {};
+    register_t<T> acc[sizeof...(I)][2];
+    for (auto j = std::size_t{0}; j < sizeof...(I); ++j)
+    {
+        acc[j][0] = load(lanes);
+        acc[j][1] = load(lanes);
+    }
+    auto i = std::size_t{0};
+    for (; i + 2 * width <= size; i += 2 * width)
+    {
+        AAA_UNROLL
+        for (auto k = std::size_t{0}; k < 2; ++k)
+        {
+            const auto x = load(in + i + k * width);
+            (void)expand{ 0, (acc[I][k] = accumulate_distance<T>(acc[I][k], x, x,
+                typename Reductions::reduce{}, typename Reductions::map{}), 0)... };
+        }
+    }
+    auto values = std::array<T, sizeof...(I)>{};
+    (void)expand{ 0, (values[I] = fold_pair<T, typename Reductions::reduce>(acc[I],
+        std::is_same<typename Reductions::reduce, operations::first_operand>{}), 0)... };
+    for (; i < size; ++i)
+    {
+        (void)expand{ 0, (values[I] = accumulate_distance<T>(values[I], in[i], in[i],
+            typename Reductions::reduce{}, typename Reductions::map{}), 0)... };
+    }
+    return values;
+}
+
+template<typename T, typename... Reductions>
+static AAA_KERNEL_TARGET std::array<T, sizeof...(Reductions)> reduce_many(const T* in, std::size_t size)
+{
+    return reduce_many<T, Reductions...>(in, size, std::index_sequence_for<Reductions...>{});
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET T dot(const T* left, const T* right, std::size_t size)
+{
+    return sum_of_terms<multiplies>(left, right, size);
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET T squared_distance(const T* left, const T* right, std::size_t size)
+{
+    return sum_of_terms<operations::squared_difference>(left, right, size);
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET register_t<T> accumulate_distance(register_t<T> acc, register_t<T> a, register_t<T> b,
+    plus, operations::squared_difference)
+{
+    return accumulate_term<T>(acc, a, b, operations::squared_difference{});
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET register_t<T> accumulate_distance(register_t<T> acc, register_t<T> a, register_t<T> b,
+    plus, multiplies)
+{
+    return accumulate_term<T>(acc, a, b, multiplies{});
+}
+
+// |a - b| is max(a - b, b - a) for floating point numbers, which needs no sign mask.
+template<typename T, typename Reduce>
+static AAA_KERNEL_TARGET register_t<T> accumulate_distance(register_t<T> acc, register_t<T> a, register_t<T> b,
+    Reduce, operations::absolute_difference)
+{
+    const auto difference = apply(maximum{}, lane<T>{}, apply(minus{}, lane<T>{}, a, b), apply(minus{}, lane<T>{}, b, a));
+    return apply(Reduce{}, lane<T>{}, acc, difference);
+}
+
+template<typename T, unsigned P>
+static AAA_KERNEL_TARGET register_t<T> powered(register_t<T> x, std::true_type)
+{
+    return x;
+}
+
+// The same multiplications as `operations::power`. The tag is true for P = 1.
+template<typename T, unsigned P>
+static AAA_KERNEL_TARGET register_t<T> powered(register_t<T> x, std::false_type)
+{
+    const auto half = powered<T, P / 2>(x, std::integral_constant<bool, P / 2 == 1>{});
+    const auto square = apply(multiplies{}, lane<T>{}, half, half);
+    return P % 2 == 0 ? square : apply(multiplies{}, lane<T>{}, square, x);
+}
+
+template<typename T, typename Reduce, unsigned P>
+static AAA_KERNEL_TARGET register_t<T> accumulate_distance(register_t<T> acc, register_t<T> a, register_t<T> b,
+    Reduce, operations::powered_absolute_difference<P>)
+{
+    const auto difference = apply(maximum{}, lane<T>{}, apply(minus{}, lane<T>{}, a, b), apply(minus{}, lane<T>{}, b, a));
+    return apply(Reduce{}, lane<T>{}, acc, powered<T, P>(difference, std::integral_constant<bool, P == 1>{}));
+}
+
+template<typename T, typename Reduce, unsigned P>
+static AAA_KERNEL_TARGET register_t<T> accumulate_distance(register_t<T> acc, register_t<T> a, register_t<T>,
+    Reduce, operations::powered_absolute<P>)
+{
+    const auto zero = broadcast(lane<T>{}, T{0});
+    const auto absolute = apply(maximum{}, lane<T>{}, a, apply(minus{}, lane<T>{}, zero, a));
+    return apply(Reduce{}, lane<T>{}, acc, powered<T, P>(absolute, std::integral_constant<bool, P == 1>{}));
+}
+
+// The tag is true for the reduction that keeps its initial value, like the count of `reduce_many`.
+template<typename T, typename Reduce>
+static AAA_KERNEL_TARGET register_t<T> accumulate_operand(register_t<T> acc, register_t<T>, std::true_type)
+{
+    return acc;
+}
+
+template<typename T, typename Reduce>
+static AAA_KERNEL_TARGET register_t<T> accumulate_operand(register_t<T> acc, register_t<T> a, std::false_type)
+{
+    return apply(Reduce{}, lane<T>{}, acc, a);
+}
+
+template<typename T, typename Reduce>
+static AAA_KERNEL_TARGET register_t<T> accumulate_distance(register_t<T> acc, register_t<T> a, register_t<T>,
+    Reduce, operations::first_operand)
+{
+    return accumulate_operand<T, Reduce>(acc, a, std::is_same<Reduce, operations::first_operand>{});
+}
+
+template<typename T, typename Reduce, typename Map>
+static AAA_KERNEL_TARGET T accumulate_distance(T acc, T a, T b, Reduce, Map)
+{
+    return T(Reduce{}(acc, T(Map{}(a, b))));
+}
+
+template<typename Reduce, typename T>
+static AAA_KERNEL_TARGET T fold_accumulators(const register_t<T> (&acc)[4])
+{
+    constexpr auto width = register_size / sizeof(T);
+    T lanes[width];
+    store(lanes, apply(Reduce{}, lane<T>{}, apply(Reduce{}, lane<T>{}, acc[0], acc[1]),
+        apply(Reduce{}, lane<T>{}, acc[2], acc[3])));
+    auto result = T{};
+    for (auto x : lanes)
+    {
+        result = T(Reduce{}(result, x));
+    }
+    return result;
+}
+
+// The terms are spread over 4 accumulators, that are folded to check the bound after each block.
+template<typename Reduce, typename Map, typename T>
+static AAA_KERNEL_TARGET T bounded_distance(const T* left, const T* right, std::size_t size, T bound)
+{
+    constexpr auto width = register_size / sizeof(T);
+    constexpr auto block_size = std::max(4 * width, bound_check_size<Reduce>::value);
+    if (size < width)
+    {
+        // Short rows, like the points of a join, skip folding the empty accumulators.
+        return bounded_distance_loop<Reduce, Map>(left, left + size, right, bound);
+    }
+    T zeros[width] = {};
+    register_t<T> acc[4] = { load(zeros), load(zeros), load(zeros), load(zeros) };
+    auto i = std::size_t{0};
+    while (i + block_size <= size)
+    {
+        for (const auto last = i + block_size; i < last; i += 4 * width)
+        {
+            AAA_UNROLL
+            for (auto k = std::size_t{0}; k < 4; ++k)
+            {
+                acc[k] = accumulate_distance<T>(acc[k], load(left + i + k * width), load(right + i + k * width),
+                    Reduce{}, Map{});
+            }
+        }
+        const auto partial = fold_accumulators<Reduce, T>(acc);
+        if (partial > bound)
+        {
+            return partial;
+        }
+    }
+    for (; i + width <= size; i += width)
+    {
+        acc[0] = accumulate_distance<T>(acc[0], load(left + i), load(right + i), Reduce{}, Map{});
+    }
+    auto result = fold_accumulators<Reduce, T>(acc);
+    for (; i < size; ++i)
+    {
+        result = accumulate_distance<T>(result, left[i], right[i], Reduce{}, Map{});
+    }
+    return result;
+}
+
+// The distances of `RowsA` consecutive rows of `a` to `RowsB` consecutive rows of `b`.
+// Each register of a row is loaded once and used for all the rows of the other matrix.
+template<std::size_t RowsA, std::size_t RowsB, typename Reduce, typename Map, typename T>
+static AAA_KERNEL_TARGET void distance_tile(const T* a, const T* b, std::size_t dimension, T* out, std::size_t stride)
+{
+    constexpr auto width = register_size / sizeof(T);
+    T lanes[width] = {};
+    register_t<T> acc[RowsA][RowsB];
+    for (auto r = std::size_t{0}; r < RowsA; ++r)
+    {
+        for (auto c = std::size_t{0}; c < RowsB; ++c)
+        {
+            acc[r][c] = load(lanes);
+        }
+    }
+    auto i = std::size_t{0};
+    for (; i + width <= dimension; i += width)
+    {
+        register_t<T> x[RowsA];
+        AAA_UNROLL
+        for (auto r = std::size_t{0}; r < RowsA; ++r)
+        {
+            x[r] = load(a + r * dimension + i);
+        }
+        AAA_UNROLL
+        for (auto c = std::size_t{0}; c < RowsB; ++c)
+        {
+            const auto y = load(b + c * dimension + i);
+            AAA_UNROLL
+            for (auto r = std::size_t{0}; r < RowsA; ++r)
+            {
+                acc[r][c] = accumulate_distance<T>(acc[r][c], x[r], y, Reduce{}, Map{});
+            }
+        }
+    }
+    for (auto r = std::size_t{0}; r < RowsA; ++r)
+    {
+        for (auto c = std::size_t{0}; c < RowsB; ++c)
+        {
+            store(lanes, acc[r][c]);
+            auto result = T{};
+            for (auto x : lanes)
+            {
+                result = T(Reduce{}(result, x));
+            }
+            for (auto j = i; j < dimension; ++j)
+            {
+                result = accumulate_distance<T>(result, a[r * dimension + j], b[c * dimension + j], Reduce{}, Map{});
+            }
+            out[r * stride + c] = result;
+        }
+    }
+}
+
+// The tiles of 4 rows of `a` and 2 rows of `b` fit in the registers of all the instruction sets.
+// A single row of `a` is compared with 4 rows of `b` at a time. The value of each pair
+// does not depend on the shape of its tile.
+template<typename Reduce, typename Map, typename T>
+static AAA_KERNEL_TARGET void tile_distances(const T* a, std::size_t num_a, const T* b, std::size_t num_b,
+    std::size_t dimension, T* out, std::size_t stride)
+{
+    constexpr auto rows_a = std::size_t{4};
+    constexpr auto rows_b = std::size_t{2};
+    constexpr auto single_rows_b = std::size_t{4};
+    auto r = std::size_t{0};
+    for (; r + rows_a <= num_a; r += rows_a)
+    {
+        auto c = std::size_t{0};
+        for (; c + rows_b <= num_b; c += rows_b)
+        {
+            distance_tile<rows_a, rows_b, Reduce, Map>(a + r * dimension, b + c * dimension, dimension, out + r * stride + c, stride);
+        }
+        for (; c < num_b; ++c)
+        {
+            distance_tile<rows_a, 1, Reduce, Map>(a + r * dimension, b + c * dimension, dimension, out + r * stride + c, stride);
+        }
+    }
+    for (; r < num_a; ++r)
+    {
+        auto c = std::size_t{0};
+        for (; c + single_rows_b <= num_b; c += single_rows_b)
+        {
+            distance_tile<1, single_rows_b, Reduce, Map>(a + r * dimension, b + c * dimension, dimension, out + r * stride + c, stride);
+        }
+        for (; c < num_b; ++c)
+        {
+            distance_tile<1, 1, Reduce, Map>(a + r * dimension, b + c * dimension, dimension, out + r * stride + c, stride);
+        }
+    }
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET void two_sum(register_t<T>& sum, register_t<T> x, register_t<T>& error)
+{
+    const auto s = apply(plus{}, lane<T>{}, sum, x);
+    const auto z = apply(minus{}, lane<T>{}, s, sum);
+    const auto sum_error = apply(minus{}, lane<T>{}, sum, apply(minus{}, lane<T>{}, s, z));
+    error = apply(plus{}, lane<T>{}, sum_error, apply(minus{}, lane<T>{}, x, z));
+    sum = s;
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET register_t<T> product_error(register_t<T> a, register_t<T> b, register_t<T> p, std::true_type)
+{
+    const auto minus_p = apply(minus{}, lane<T>{}, broadcast(lane<T>{}, T{0}), p);
+    return multiply_add(lane<T>{}, a, b, minus_p);
+}
+
+// Without fused multiply-add, the product error is computed by splitting the factors in halves.
+template<typename T>
+static AAA_KERNEL_TARGET register_t<T> product_error(register_t<T> a, register_t<T> b, register_t<T> p, std::false_type)
+{
+    const auto factor = broadcast(lane<T>{}, split_factor<T>());
+    const auto ca = apply(multiplies{}, lane<T>{}, factor, a);
+    const auto cb = apply(multiplies{}, lane<T>{}, factor, b);
+    const auto a_high = apply(minus{}, lane<T>{}, ca, apply(minus{}, lane<T>{}, ca, a));
+    const auto b_high = apply(minus{}, lane<T>{}, cb, apply(minus{}, lane<T>{}, cb, b));
+    const auto a_low = apply(minus{}, lane<T>{}, a, a_high);
+    const auto b_low = apply(minus{}, lane<T>{}, b, b_high);
+    auto error = apply(minus{}, lane<T>{}, apply(multiplies{}, lane<T>{}, a_high, b_high), p);
+    error = apply(plus{}, lane<T>{}, error, apply(multiplies{}, lane<T>{}, a_high, b_low));
+    error = apply(plus{}, lane<T>{}, error, apply(multiplies{}, lane<T>{}, a_low, b_high));
+    return apply(plus{}, lane<T>{}, error, apply(multiplies{}, lane<T>{}, a_low, b_low));
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET T product_error(T a, T b, T p, std::true_type)
+{
+    return multiply_add(a, b, T(-p));
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET T product_error(T a, T b, T p, std::false_type)
+{
+    return split_product_error(a, b, p);
+}
+
+template<typename Map, typename T>
+static AAA_KERNEL_TARGET T pairwise_sum(const T* left, const T* right, std::size_t size)
+{
+    if (size <= pairwise_block_size)
+    {
+        return sum_of_terms<Map>(left, right, size);
+    }
+    const auto half = pairwise_split(size);
+    return T(pairwise_sum<Map>(left, right, half) + pairwise_sum<Map>(left + half, right + half, size - half));
+}
+
+// Each lane has its own sum and compensation. With ExactProducts, the rounding errors
+// of the products are added to the compensation too, which is the Dot2 algorithm.
+template<typename Map, bool ExactProducts, typename T>
+static AAA_KERNEL_TARGET T compensated_sum(const T* left, const T* right, std::size_t size, T init)
+{
+    constexpr auto width = register_size / sizeof(T);
+    constexpr auto num_accumulators = std::size_t{2};
+    using fused = std::integral_constant<bool, fused_multiply_add>;
+    T lanes[num_accumulators * width] = {};
+    T error_lanes[num_accumulators * width] = {};
+    lanes[0] = init;
+    register_t<T> sums[num_accumulators];
+    register_t<T> errors[num_accumulators];
+    for (auto k = std::size_t{0}; k < num_accumulators; ++k)
+    {
+        sums[k] = load(lanes + k * width);
+        errors[k] = load(error_lanes + k * width);
+    }
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        const auto k = i / width % num_accumulators;
+        const auto a = load(left + i);
+        const auto b = load(right + i);
+        const auto x = term(Map{}, lane<T>{}, a, b);
+        auto error = x;
+        two_sum<T>(sums[k], x, error);
+        if (ExactProducts)
+        {
+            error = apply(plus{}, lane<T>{}, error, product_error<T>(a, b, x, fused{}));
+        }
+        errors[k] = apply(plus{}, lane<T>{}, errors[k], error);
+    }
+    for (auto k = std::size_t{0}; k < num_accumulators; ++k)
+    {
+        store(lanes + k * width, sums[k]);
+        store(error_lanes + k * width, errors[k]);
+    }
+    auto sum = T{};
+    auto error = T{};
+    for (auto k = std::size_t{0}; k < num_accumulators * width; ++k)
+    {
+        auto e = T{};
+        simd::two_sum(sum, lanes[k], e);
+        error = T(error + e + error_lanes[k]);
+    }
+    for (; i < size; ++i)
+    {
+        const auto x = T(Map{}(left[i], right[i]));
+        auto e = T{};
+        simd::two_sum(sum, x, e);
+        if (ExactProducts)
+        {
+            e = T(e + product_error<T>(left[i], right[i], x, fused{}));
+        }
+        error = T(error + e);
+    }
+    return T(sum + error);
+}
+
+template<typename Map, typename T>
+static AAA_KERNEL_TARGET T accurate_sum(accuracy::pairwise_summation, const T* left, const T* right, std::size_t size, T init)
+{
+    return T(init + pairwise_sum<Map>(left, right, size));
+}
+
+template<typename Map, typename T>
+static AAA_KERNEL_TARGET T accurate_sum(accuracy::compensated_summation, const T* left, const T* right, std::size_t size, T init)
+{
+    return compensated_sum<Map, false>(left, right, size, init);
+}
+
+template<typename Map, typename T>
+static AAA_KERNEL_TARGET T accurate_sum(accuracy::dot2_summation, const T* left, const T* right, std::size_t size, T init)
+{
+    return compensated_sum<Map, std::is_same<Map, multiplies>::value>(left, right, size, init);
+}
+
+// The exact products of the int32 lanes of two registers, added in pairs in int64 lanes.
+template<typename R>
+static AAA_KERNEL_TARGET R wide_products(R a, R b)
+{
+    const auto low = multiply_wide(widen_low(lane<std::int32_t>{}, a), widen_low(lane<std::int32_t>{}, b));
+    const auto high = multiply_wide(widen_high(lane<std::int32_t>{}, a), widen_high(lane<std::int32_t>{}, b));
+    return apply(plus{}, lane<std::int64_t>{}, low, high);
+}
+
+// The exact squares of the int32 lanes of a register, added in pairs in int64 lanes.
+template<typename R>
+static AAA_KERNEL_TARGET R wide_squares(R a)
+{
+    return apply(plus{}, lane<std::int64_t>{}, square_wide(widen_low(lane<std::int32_t>{}, a)), square_wide(widen_high(lane<std::int32_t>{}, a)));
+}
+
+// Products of int16 are added in pairs to int32, which only overflows when both products
+// are -32768 * -32768, to 2^31. The pairs minus 1 always fit in int32, so they are widened
+// to the int64 accumulators with 1 less, and the number of pairs is added at the end.
+static AAA_KERNEL_TARGET std::int64_t widening_dot(const std::int16_t* left, const std::int16_t* right, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(std::int16_t);
+    std::int64_t lanes[width / 4] = {};
+    auto acc = load(lanes);
+    const auto one = broadcast(lane<std::int32_t>{}, 1);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        const auto pairs = apply(minus{}, lane<std::int32_t>{}, multiply_pairs(load(left + i), load(right + i)), one);
+        const auto low = widen_low(lane<std::int32_t>{}, pairs);
+        const auto high = widen_high(lane<std::int32_t>{}, pairs);
+        acc = apply(plus{}, lane<std::int64_t>{}, acc, apply(plus{}, lane<std::int64_t>{}, low, high));
+    }
+    store(lanes, acc);
+    return std::int64_t(widening_tail(lanes, left, right, i, size, false) + static_cast<std::int64_t>(i / 2));
+}
+
+// Products of uint16 do not fit in int32, so the elements are widened to int32 and
+// multiplied exactly in int64 accumulators.
+static AAA_KERNEL_TARGET std::int64_t widening_dot(const std::uint16_t* left, const std::uint16_t* right, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(std::uint16_t);
+    std::int64_t lanes[width / 4] = {};
+    auto acc = load(lanes);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        const auto a = load(left + i);
+        const auto b = load(right + i);
+        acc = apply(plus{}, lane<std::int64_t>{}, acc, wide_products(widen_low(lane<std::uint16_t>{}, a), widen_low(lane<std::uint16_t>{}, b)));
+        acc = apply(plus{}, lane<std::int64_t>{}, acc, wide_products(widen_high(lane<std::uint16_t>{}, a), widen_high(lane<std::uint16_t>{}, b)));
+    }
+    store(lanes, acc);
+    return widening_tail(lanes, left, right, i, size, false);
+}
+
+// Products of int32 are computed exactly in int64 accumulators.
+static AAA_KERNEL_TARGET std::int64_t widening_dot(const std::int32_t* left, const std::int32_t* right, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(std::int32_t);
+    std::int64_t lanes[width / 2] = {};
+    auto acc = load(lanes);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        acc = apply(plus{}, lane<std::int64_t>{}, acc, wide_products(load(left + i), load(right + i)));
+    }
+    store(lanes, acc);
+    return widening_tail(lanes, left, right, i, size, false);
+}
+
+// The differences of 16 bit integers are computed exactly in int32, and their squares in int64.
+template<typename T>
+static AAA_KERNEL_TARGET std::int64_t short_squared_distance(const T* left, const T* right, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(T);
+    std::int64_t lanes[width / 4] = {};
+    auto acc = load(lanes);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        const auto a = load(left + i);
+        const auto b = load(right + i);
+        const auto low = apply(minus{}, lane<std::int32_t>{}, widen_low(lane<T>{}, a), widen_low(lane<T>{}, b));
+        const auto high = apply(minus{}, lane<std::int32_t>{}, widen_high(lane<T>{}, a), widen_high(lane<T>{}, b));
+        acc = apply(plus{}, lane<std::int64_t>{}, acc, wide_squares(low));
+        acc = apply(plus{}, lane<std::int64_t>{}, acc, wide_squares(high));
+    }
+    store(lanes, acc);
+    return widening_tail(lanes, left, right, i, size, true);
+}
+
+static AAA_KERNEL_TARGET std::int64_t widening_squared_distance(const std::int16_t* left, const std::int16_t* right, std::size_t size)
+{
+    return short_squared_distance(left, right, size);
+}
+
+static AAA_KERNEL_TARGET std::int64_t widening_squared_distance(const std::uint16_t* left, const std::uint16_t* right, std::size_t size)
+{
+    return short_squared_distance(left, right, size);
+}
+
+// The differences of int32 are computed exactly in int64.
+static AAA_KERNEL_TARGET std::int64_t widening_squared_distance(const std::int32_t* left, const std::int32_t* right, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(std::int32_t);
+    std::int64_t lanes[width / 2] = {};
+    auto acc = load(lanes);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        const auto a = load(left + i);
+        const auto b = load(right + i);
+        const auto low = apply(minus{}, lane<std::int64_t>{}, widen_low(lane<std::int32_t>{}, a), widen_low(lane<std::int32_t>{}, b));
+        const auto high = apply(minus{}, lane<std::int64_t>{}, widen_high(lane<std::int32_t>{}, a), widen_high(lane<std::int32_t>{}, b));
+        acc = apply(plus{}, lane<std::int64_t>{}, acc, apply(plus{}, lane<std::int64_t>{}, square_wide(low), square_wide(high)));
+    }
+    store(lanes, acc);
+    return widening_tail(lanes, left, right, i, size, true);
+}
+
+// Bytes are widened to int16, and their products are added in pairs to int32 accumulators.
+// The saturating multiply-add of bytes, pmaddubsw, would overflow for unsigned bytes.
+template<typename T>
+static AAA_KERNEL_TARGET std::int32_t byte_dot(const T* left, const T* right, std::size_t size)
+{
+    constexpr auto width = register_size;
+    std::int32_t lanes[width / 4] = {};
+    auto acc = load(lanes);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        const auto a = load(left + i);
+        const auto b = load(right + i);
+        acc = apply(plus{}, lane<std::int32_t>{}, acc, multiply_pairs(widen_low(lane<T>{}, a), widen_low(lane<T>{}, b)));
+        acc = apply(plus{}, lane<std::int32_t>{}, acc, multiply_pairs(widen_high(lane<T>{}, a), widen_high(lane<T>{}, b)));
+    }
+    store(lanes, acc);
+    return widening_tail(lanes, left, right, i, size, false);
+}
+
+// The differences of bytes are computed exactly in int16.
+template<typename T>
+static AAA_KERNEL_TARGET std::int32_t byte_squared_distance(const T* left, const T* right, std::size_t size)
+{
+    constexpr auto width = register_size;
+    std::int32_t lanes[width / 4] = {};
+    auto acc = load(lanes);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        const auto a = load(left + i);
+        const auto b = load(right + i);
+        const auto low = apply(minus{}, lane<std::int16_t>{}, widen_low(lane<T>{}, a), widen_low(lane<T>{}, b));
+        const auto high = apply(minus{}, lane<std::int16_t>{}, widen_high(lane<T>{}, a), widen_high(lane<T>{}, b));
+        acc = apply(plus{}, lane<std::int32_t>{}, acc, multiply_pairs(low, low));
+        acc = apply(plus{}, lane<std::int32_t>{}, acc, multiply_pairs(high, high));
+    }
+    store(lanes, acc);
+    return widening_tail(lanes, left, right, i, size, true);
+}
+
+static AAA_KERNEL_TARGET std::int32_t widening_dot(const std::int8_t* left, const std::int8_t* right, std::size_t size)
+{
+    return byte_dot(left, right, size);
+}
+
+static AAA_KERNEL_TARGET std::int32_t widening_dot(const std::uint8_t* left, const std::uint8_t* right, std::size_t size)
+{
+    return byte_dot(left, right, size);
+}
+
+static AAA_KERNEL_TARGET std::int32_t widening_squared_distance(const std::int8_t* left, const std::int8_t* right, std::size_t size)
+{
+    return byte_squared_distance(left, right, size);
+}
+
+static AAA_KERNEL_TARGET std::int32_t widening_squared_distance(const std::uint8_t* left, const std::uint8_t* right, std::size_t size)
+{
+    return byte_squared_distance(left, right, size);
+}
+
+// The absolute differences of bytes are summed by groups of 8 in int64 accumulators.
+template<typename T>
+static AAA_KERNEL_TARGET std::int32_t widening_manhattan_distance(const T* left, const T* right, std::size_t size)
+{
+    constexpr auto width = register_size;
+    std::int64_t lanes[width / 8] = {};
+    auto acc = load(lanes);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        acc = apply(plus{}, lane<std::int64_t>{}, acc, sum_absolute_differences(lane<T>{}, load(left + i), load(right + i)));
+    }
+    store(lanes, acc);
+    return widening_absolute_tail<std::int32_t>(lanes, left, right, i, size);
+}
+
+// The quotients are clamped so that the conversion to int32 does not overflow. The conversion
+// rounds to nearest even, and the saturating packs clamp the results to the range of the bytes.
+template<typename T>
+static AAA_KERNEL_TARGET void quantize(const float* in, float scale, std::int32_t zero_point, T* out, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(float);
+    const auto s = broadcast(lane<float>{}, scale);
+    const auto lowest = broadcast(lane<float>{}, -quantize_bound);
+    const auto highest = broadcast(lane<float>{}, quantize_bound);
+    const auto z = broadcast(lane<std::int32_t>{}, zero_point);
+    auto i = std::size_t{0};
+    for (; i + 4 * width <= size; i += 4 * width)
+    {
+        register_t<std::int32_t> q[4];
+        AAA_UNROLL
+        for (auto k = std::size_t{0}; k < 4; ++k)
+        {
+            const auto x = apply(divides{}, lane<float>{}, load(in + i + k * width), s);
+            const auto clamped = apply(minimum{}, lane<float>{}, apply(maximum{}, lane<float>{}, x, lowest), highest);
+            q[k] = apply(plus{}, lane<std::int32_t>{}, round_to_int32(clamped), z);
+        }
+        store(out + i, narrow(lane<T>{}, q[0], q[1], q[2], q[3]));
+    }
+    quantize_loop(in + i, in + size, scale, zero_point, out + i);
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET void dequantize(const T* in, float scale, std::int32_t zero_point, float* out, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(float);
+    const auto s = broadcast(lane<float>{}, scale);
+    const auto z = broadcast(lane<std::int32_t>{}, zero_point);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        const auto x = apply(minus{}, lane<std::int32_t>{}, load_widened(lane<T>{}, in + i), z);
+        store(out + i, apply(multiplies{}, lane<float>{}, to_float(x), s));
+    }
+    dequantize_loop(in + i, in + size, scale, zero_point, out + i);
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET register_t<T> term(operations::first_operand, lane<T>, register_t<T> left, register_t<T>)
+{
+    return left;
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET register_t<T> term(multiplies, lane<T>, register_t<T> left, register_t<T> right)
+{
+    return apply(multiplies{}, lane<T>{}, left, right);
+}
+
+template<typename T>
+static AAA_KERNEL_TARGET register_t<T> term(operations::squared_difference, lane<T>, register_t<T> left, register_t<T> right)
+{
+    const auto difference = apply(minus{}, lane<T>{}, left, right);
+    return apply(multiplies{}, lane<T>{}, difference, difference);
+}
+
+// Element i is always added to the accumulator i % num_lanes, whatever the register size.
+template<typename Map, typename T>
+static AAA_KERNEL_TARGET T lane_sum(const T* left, const T* right, std::size_t size)
+{
+    constexpr auto width = register_size / sizeof(T);
+    constexpr auto num_registers = num_lanes / width;
+    T lanes[num_lanes] = {};
+    register_t<T> acc[num_registers];
+    for (auto r = std::size_t{0}; r < num_registers; ++r)
+    {
+        acc[r] = load(lanes);
+    }
+    auto i = std::size_t{0};
+    for (; i + num_lanes <= size; i += num_lanes)
+    {
+        for (auto r = std::size_t{0}; r < num_registers; ++r)
+        {
+            const auto offset = i + r * width;
+            const auto x = term(Map{}, lane<T>{}, load(left + offset), load(right + offset));
+            acc[r] = apply(plus{}, lane<T>{}, acc[r], x);
+        }
+    }
+    for (auto r = std::size_t{0}; r < num_registers; ++r)
+    {
+        store(lanes + r * width, acc[r]);
+    }
+    return lane_sum_loop<Map>(left + i, right + i, i, size, lanes);
+}
+
+template<typename Op, typename T>
+static AAA_KERNEL_TARGET T extremum(const T* in, std::size_t size, T init)
+{
+    constexpr auto width = register_size / sizeof(T);
+    T lanes[width];
+    for (auto& x : lanes)
+    {
+        x = init;
+    }
+    auto acc = load(lanes);
+    auto i = std::size_t{0};
+    for (; i + width <= size; i += width)
+    {
+        acc = apply(Op{}, lane_t<Op, T>{}, load(in + i), acc);
+    }
+    store(lanes, acc);
+    auto result = init;
+    for (auto x : lanes)
+    {
+        result = Op{}(x, result);
+    }
+    for (; i < size; ++i)
+    {
+        result = Op{}(in[i], result);
+    }
+    return result;
+}
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+#include "pairwise.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "spatial_index.hpp"
+#include "traits.hpp"
+
+namespace aaa {
+namespace join {
+
+/**
+@addtogroup similarity_join
+
+A similarity join finds all the pairs of rows of two matrices, or of one matrix
+with itself, that are at a distance of at most `radius`, without comparing
+most of the pairs. The matrices are stored row by row, like in @ref pairwise.
+The metric is a parameter: `spatial::euclidean_metric`, `spatial::manhattan_metric`
+or `spatial::maximum_metric`, see @ref spatial_index.
+
+In each of these metrics, a coordinate of two rows differs by at most their distance:
+- Sort and sweep: the rows are sorted by the coordinate of largest spread, so
+  the rows of the second matrix that can be near a row of the first are a window
+  of the sorted rows, that is found by a binary search.
+- Blocking: the rows of the first matrix are split in blocks of nearby rows, at
+  the median of their widest coordinate. The rows in the window of a block are
+  filtered by their distance to the bounding box of the block, which is never
+  greater than the distance to its rows.
+- Early exit: the distances of the remaining pairs are computed by the kernels
+  of `bounded_distance`, that stop as soon as the partial distance is greater than
+  the radius, see @ref simd.
+
+The pairs are passed to `sink(i, j, distance)`, with the indices of the rows in
+the first and the second matrix. With a parallel execution policy the blocks are
+processed on the threads of the shared pool, and the sink is called from the
+thread of the block, so it should be thread safe. The order of the pairs is unspecified.
+A self join passes each pair once, with `i < j`.
+
+Example:
+```
+// 100000 and 200000 rows of 8 floats.
+std::vector<float> a(100000 * 8);
+std::vector<float> b(200000 * 8);
+
+using namespace aaa;
+
+// The pairs of a and b at a Euclidean distance of at most 0.1.
+std::mutex mutex;
+std::vector<std::pair<std::size_t, std::size_t>> pairs;
+join::radius_join<spatial::euclidean_metric>(execution::par, a, b, 8, 0.1f,
+    [&](std::size_t i, std::size_t j, float)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pairs.emplace_back(i, j);
+    });
+
+// The pairs of rows of a at a maximum distance of at most 0.01.
+join::radius_self_join<spatial::maximum_metric>(execution::par, a, 8, 0.01f,
+    [&](std::size_t i, std::size_t j, float distance) { ... });
+```
+
+@{
+*/
+
+/** The rows of a matrix sorted by one coordinate, and their original indices. */
+template<typename T>
+struct sorted_rows
+{
+    std::vector<T> rows;
+    std::vector<T> keys;
+    std::vector<std::size_t> indices;
+};
+
+/** Sorts the rows of the matrix by the coordinate `axis`, and by index for equal coordinates. */
+template<typename T, typename InputIterator>
+sorted_rows<T> sort_rows(InputIterator first, InputIterator last, std::size_t dimension, std::size_t axis)
+{
+    const auto data = std::vector<T>(first, last);
+    const auto size = data.size() / dimension;
+    auto sorted = sorted_rows<T>();
+    sorted.indices.resize(size);
+    std::iota(sorted.indices.begin(), sorted.indices.end(), std::size_t{0});
+    std::stable_sort(sorted.indices.begin(), sorted.indices.end(), [&](std::size_t i, std::size_t j)
+    {
+        return data[i * dimension + axis] < data[j * dimension + axis];
+    });
+    sorted.rows.resize(data.size());
+    sorted.keys.resize(size);
+    for (auto i = std::size_t{0}; i < size; ++i)
+    {
+        const auto row = data.begin() + static_cast<std::ptrdiff_t>(sorted.indices[i] * dimension);
+        std::copy_n(row, dimension, sorted.rows.begin() + static_cast<std::ptrdiff_t>(i * dimension));
+        sorted.keys[i] = row[static_cast<std::ptrdiff_t>(axis)];
+    }
+    return sorted;
+}
+
+/** Updates the minimum and the maximum of each coordinate with the rows of the matrix. */
+template<typename T, typename InputIterator>
+void extend_bounds(InputIterator first, InputIterator last, std::size_t dimension, std::vector<T>& low, std::vector<T>& high)
+{
+    for (auto i = std::size_t{0}; first != last; ++first, i = (i + 1) % dimension)
+    {
+        low[i] = std::min(low[i], T(*first));
+        high[i] = std::max(high[i], T(*first));
+    }
+}
+
+/** The coordinate with the largest spread of the rows of two matrices. */
+template<typename T, typename InputIterator1, typename InputIterator2>
+std::size_t widest_axis(InputIterator1 first_a, InputIterator1 last_a, InputIterator2 first_b, InputIterator2 last_b,
+    std::size_t dimension)
+{
+    auto low = std::vector<T>(dimension, simd::highest<T>());
+    auto high = std::vector<T>(dimension, simd::lowest<T>());
+    extend_bounds(first_a, last_a, dimension, low, high);
+    extend_bounds(first_b, last_b, dimension, low, high);
+    auto axis = std::size_t{0};
+    for (auto i = std::size_t{1}; i < dimension; ++i)
+    {
+        axis = high[i] - low[i] > high[axis] - low[axis] ? i : axis;
+    }
+    return axis;
+}
+
+/** The reduced distance of a row to the box `[low, high]`, or a value greater than
+`bound` if the distance is greater.
+*/
+template<typename Metric, typename T>
+T box_distance(const T* row, const T* low, const T* high, std::size_t dimension, T bound)
+{
+    auto result = T{};
+    for (auto i = std::size_t{0}; i < dimension; ++i)
+    {
+        const auto nearest = std::min(std::max(row[i], low[i]), high[i]);
+        result = T(typename Metric::reduce{}(result, T(typename Metric::map{}(row[i], nearest))));
+        if (result > bound)
+        {
+            return result;
+        }
+    }
+    return result;
+}
+
+/** The coordinate with the largest spread of the rows at the positions `[first, last)`. */
+template<typename T>
+std::size_t widest_axis(const std::vector<T>& rows, std::size_t dimension,
+    const std::size_t* first, const std::size_t* last)
+{
+    auto low = std::vector<T>(dimension, simd::highest<T>());
+    auto high = std::vector<T>(dimension, simd::lowest<T>());
+    for (; first != last; ++first)
+    {
+        const auto row = rows.begin() + static_cast<std::ptrdiff_t>(*first * dimension);
+        extend_bounds(row, row + static_cast<std::ptrdiff_t>(dimension), dimension, low, high);
+    }
+    auto axis = std::size_t{0};
+    for (auto i = std::size_t{1}; i < dimension; ++i)
+    {
+        axis = high[i] - low[i] > high[axis] - low[axis] ? i : axis;
+    }
+    return axis;
+}
+
+/** Splits the positions `[first, last)` of the rows at the median of their widest coordinate,
+until the parts have at most `pairwise::tile_rows` rows, and appends the end of each part to `ends`.
+*/
+template<typename T>
+void split_blocks(const std::vector<T>& rows, std::size_t dimension, std::size_t* first, std::size_t* last,
+    std::vector<std::size_t*>& ends)
+{
+    const auto size = static_cast<std::size_t>(last - first);
+    if (size <= pairwise::tile_rows)
+    {
+        ends.push_back(last);
+        return;
+    }
+    const auto axis = widest_axis(rows, dimension, first, last);
+    const auto middle = first + size / 2;
+    std::nth_element(first, middle, last, [&](std::size_t i, std::size_t j)
+    {
+        const auto x = rows[i * dimension + axis];
+        const auto y = rows[j * dimension + axis];
+        return x < y || (x == y && i < j);
+    });
+    split_blocks(rows, dimension, first, middle, ends);
+    split_blocks(rows, dimension, middle, last, ends);
+}
+
+/** Calls `sink(i, j, distance)` for the pairs of the block of rows of `a` at the sorted
+positions `[first, last)` and the sorted rows of `b` that are within the radius. If `self`,
+`a` and `b` are the same rows, and only the pairs of sorted positions `i < j` are compared.
+*/
+template<typename Metric, typename T, typename Sink>
+void join_block(const sorted_rows<T>& a, const std::size_t* first, const std::size_t* last, const sorted_rows<T>& b,
+    std::size_t dimension, std::size_t axis, T radius, bool self, Sink& sink)
+{
+    const auto reduced_radius = Metric::from_distance(radius);
+    auto low = std::vector<T>(dimension, simd::highest<T>());
+    auto high = std::vector<T>(dimension, simd::lowest<T>());
+    const auto row_a = [&](std::size_t i) { return a.rows.data() + i * dimension; };
+    const auto row_b = [&](std::size_t j) { return b.rows.data() + j * dimension; };
+    for (auto i = first; i != last; ++i)
+    {
+        extend_bounds(row_a(*i), row_a(*i + 1), dimension, low, high);
+    }
+
+    // The window of the block in the sorted rows of b, filtered by the bounding box.
+    const auto first_window = self ? *std::min_element(first, last) + 1 :
+        static_cast<std::size_t>(std::lower_bound(b.keys.begin(), b.keys.end(), low[axis] - radius) - b.keys.begin());
+    const auto last_window = static_cast<std::size_t>(
+        std::upper_bound(b.keys.begin(), b.keys.end(), high[axis] + radius) - b.keys.begin());
+    auto candidates = std::vector<std::size_t>();
+    auto candidate_keys = std::vector<T>();
+    for (auto j = first_window; j < last_window; ++j)
+    {
+        if (box_distance<Metric>(row_b(j), low.data(), high.data(), dimension, reduced_radius) <= reduced_radius)
+        {
+            candidates.push_back(j);
+            candidate_keys.push_back(b.keys[j]);
+        }
+    }
+
+    // The window of each row in the candidates, which are sorted by key.
+    for (; first != last; ++first)
+    {
+        const auto i = *first;
+        const auto key = a.keys[i];
+        auto c = self ?
+            std::upper_bound(candidates.begin(), candidates.end(), i) - candidates.begin() :
+            std::lower_bound(candidate_keys.begin(), candidate_keys.end(), key - radius) - candidate_keys.begin();
+        const auto last_c = std::upper_bound(candidate_keys.begin(), candidate_keys.end(), key + radius) - candidate_keys.begin();
+        for (; c < last_c; ++c)
+        {
+            const auto j = candidates[static_cast<std::size_t>(c)];
+            const auto reduced = simd::bounded_distance<typename Metric::reduce, typename Metric::map>(
+                row_a(i), row_a(i + 1), row_b(j), reduced_radius);
+            if (reduced <= reduced_radius)
+            {
+                const auto index_a = a.indices[i];
+                const auto index_b = b.indices[j];
+                if (self && index_b < index_a)
+                {
+                    sink(index_b, index_a, Metric::to_distance(reduced));
+                }
+                else
+                {
+                    sink(index_a, index_b, Metric::to_distance(reduced));
+                }
+            }
+        }
+    }
+}
+
+/** Calls `join_block` for each block of nearby rows of `a`, with an execution policy.
+The rows of `a` and `b` are sorted by the coordinate `axis`.
+*/
+template<typename Metric, typename Tag, typename T, typename Sink>
+void join_blocks(execution::policy<Tag> policy, const sorted_rows<T>& a, const sorted_rows<T>& b,
+    std::size_t dimension, std::size_t axis, T radius, bool self, Sink& sink)
+{
+    auto positions = std::vector<std::size_t>(a.indices.size());
+    std::iota(positions.begin(), positions.end(), std::size_t{0});
+    auto ends = std::vector<std::size_t*>();
+    split_blocks(a.rows, dimension, positions.data(), positions.data() + positions.size(), ends);
+    pairwise::for_each_tile(policy, ends.size(), [&](std::ptrdiff_t block)
+    {
+        const auto first = block == 0 ? positions.data() : ends[static_cast<std::size_t>(block) - 1];
+        join_block<Metric>(a, first, ends[static_cast<std::size_t>(block)], b, dimension, axis, radius, self, sink);
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** Calls `sink(i, j, distance)` for each row `i` of `a` and row `j` of `b` at a distance
+of at most `radius` in the metric, with an execution policy. The matrices are ranges of
+iterators with rows of `dimension` elements.
+*/
+template<typename Metric, typename Tag, typename InputIterator1, typename InputIterator2, typename Sink,
+    typename T = value_type_i<InputIterator1>>
+void radius_join(execution::policy<Tag> policy, InputIterator1 first_a, InputIterator1 last_a,
+    InputIterator2 first_b, InputIterator2 last_b, std::size_t dimension, T radius, Sink sink)
+{
+    assert(dimension > 0 && radius >= 0);
+    if (first_a == last_a || first_b == last_b)
+    {
+        return;
+    }
+    const auto axis = widest_axis<T>(first_a, last_a, first_b, last_b, dimension);
+    const auto a = sort_rows<T>(first_a, last_a, dimension, axis);
+    const auto b = sort_rows<T>(first_b, last_b, dimension, axis);
+    join_blocks<Metric>(policy, a, b, dimension, axis, radius, false, sink);
+}
+
+/** Calls `sink(i, j, distance)` for each row `i` of `a` and row `j` of `b` at a distance
+of at most `radius` in the metric, with an execution policy. The matrices are containers
+with rows of `dimension` elements.
+*/
+template<typename Metric, typename Tag, typename Container1, typename Container2, typename Sink,
+    typename T = value_type<Container1>>
+void radius_join(execution::policy<Tag> policy, const Container1& a, const Container2& b,
+    std::size_t dimension, T radius, Sink sink)
+{
+    assert(a.size() % dimension == 0 && b.size() % dimension == 0);
+    using std::begin;
+    using std::end;
+    radius_join<Metric>(policy, begin(a), end(a), begin(b), end(b), dimension, radius, sink);
+}
+
+/** Calls `sink(i, j, distance)` for each row `i` of `a` and row `j` of `b` at a distance
+of at most `radius` in the metric. The matrices are ranges of iterators.
+*/
+template<typename Metric, typename InputIterator1, typename InputIterator2, typename Sink,
+    typename T = value_type_i<InputIterator1>>
+void radius_join(InputIterator1 first_a, InputIterator1 last_a, InputIterator2 first_b, InputIterator2 last_b,
+    std::size_t dimension, T radius, Sink sink)
+{
+    radius_join<Metric>(execution::seq, first_a, last_a, first_b, last_b, dimension, radius, sink);
+}
+
+/** Calls `sink(i, j, distance)` for each row `i` of `a` and row `j` of `b` at a distance
+of at most `radius` in the metric. The matrices are containers.
+*/
+template<typename Metric, typename Container1, typename Container2, typename Sink,
+    typename T = value_type<Container1>>
+void radius_join(const Container1& a, const Container2& b, std::size_t dimension, T radius, Sink sink)
+{
+    radius_join<Metric>(execution::seq, a, b, dimension, radius, sink);
+}
+
+/** Calls `sink(i, j, distance)` for each pair of rows `i < j` of the matrix at a distance
+of at most `radius` in the metric, with an execution policy. The matrix is a range of
+iterators with rows of `dimension` elements.
+*/
+template<typename Metric, typename Tag, typename InputIterator, typename Sink, typename T = value_type_i<InputIterator>>
+void radius_self_join(execution::policy<Tag> policy, InputIterator first, InputIterator last,
+    std::size_t dimension, T radius, Sink sink)
+{
+    assert(dimension > 0 && radius >= 0);
+    if (first == last)
+    {
+        return;
+    }
+    const auto axis = widest_axis<T>(first, last, first, first, dimension);
+    const auto a = sort_rows<T>(first, last, dimension, axis);
+    join_blocks<Metric>(policy, a, a, dimension, axis, radius, true, sink);
+}
+
+/** Calls `sink(i, j, distance)` for each pair of rows `i < j` of the matrix at a distance
+of at most `radius` in the metric, with an execution policy. The matrix is a container
+with rows of `dimension` elements.
+*/
+template<typename Metric, typename Tag, typename Container, typename Sink, typename T = value_type<Container>>
+void radius_self_join(execution::policy<Tag> policy, const Container& a, std::size_t dimension, T radius, Sink sink)
+{
+    assert(a.size() % dimension == 0);
+    using std::begin;
+    using std::end;
+    radius_self_join<Metric>(policy, begin(a), end(a), dimension, radius, sink);
+}
+
+/** Calls `sink(i, j, distance)` for each pair of rows `i < j` of the matrix at a distance
+of at most `radius` in the metric. The matrix is a range of iterators.
+*/
+template<typename Metric, typename InputIterator, typename Sink, typename T = value_type_i<InputIterator>>
+void radius_self_join(InputIterator first, InputIterator last, std::size_t dimension, T radius, Sink sink)
+{
+    radius_self_join<Metric>(execution::seq, first, last, dimension, radius, sink);
+}
+
+/** Calls `sink(i, j, distance)` for each pair of rows `i < j` of the matrix at a distance
+of at most `radius` in the metric. The matrix is a container.
+*/
+template<typename Metric, typename Container, typename Sink, typename T = value_type<Container>>
+void radius_self_join(const Container& a, std::size_t dimension, T radius, Sink sink)
+{
+    radius_self_join<Metric>(execution::seq, a, dimension, radius, sink);
+}
+
+/** @} */
+
+} // namespace join
+} // namespace aaa
@@ -0,0 +1,764 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "neighbors.hpp"
+#include "operations.hpp"
+#include "pairwise.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "traits.hpp"
+
+namespace aaa {
+namespace spatial {
+
+/**
+@addtogroup spatial_index
+
+Spatial indexes find the nearest points of a query without comparing it with
+all the points, which pays off for data of low dimension, up to about 32.
+The points are a matrix that is stored row by row, like in @ref pairwise.
+- `kd_tree<T, Metric>` splits the space at the median of the coordinate with the
+  largest spread. The metric is `euclidean_metric`, `manhattan_metric` or
+  `maximum_metric`. The distances to the boxes of the nodes are bounds that are
+  never greater than the distances to their points, so the search is exact.
+- `vp_tree<T, Distance>` splits the points by their distance to a vantage point.
+  It works with any distance that satisfies the triangle inequality.
+  `metric_distance<Metric>` gives the distances of the spaces.
+
+Both trees support:
+- `nearest(query, k, first_index, first_distance)`, the `k` nearest points of a query,
+  from the nearest to the farthest. Equal distances are ordered by index.
+- `within_radius(query, radius, indices, distances)`, the points at a distance of
+  at most `radius`, in the order of the tree.
+
+The free functions `nearest_neighbors` and `radius_neighbors` run a batch of
+queries with an execution policy, see @ref parallel. With a parallel policy the
+trees are also built on the threads of the shared pool. The tree does not
+depend on the policy.
+
+The nodes, the reordered points and their original indices are stored in flat
+arrays of trivially copyable elements, that are returned by `nodes()`, `points()`
+and `indices()`. A tree can be constructed again from the arrays, for example
+after they are written to a file.
+
+Example:
+```
+// 1000000 points and 1000 queries in 2 dimensions.
+std::vector<double> points(1000000 * 2);
+std::vector<double> queries(1000 * 2);
+
+using namespace aaa;
+
+const auto tree = spatial::kd_tree<double, spatial::euclidean_metric>(execution::par, points, 2);
+
+// The 10 nearest points of each query.
+std::vector<std::uint32_t> indices(1000 * 10);
+std::vector<double> distances(1000 * 10);
+spatial::nearest_neighbors(execution::par, tree, queries, 10, indices, distances);
+
+// The points at a distance of at most 0.5 of each query.
+// The points of query i are at [offsets[i], offsets[i + 1]).
+std::vector<std::size_t> offsets;
+std::vector<std::uint32_t> found;
+std::vector<double> found_distances;
+spatial::radius_neighbors(execution::par, tree, queries, 0.5, offsets, found, found_distances);
+```
+
+@{
+*/
+
+/** The type of the indices of the points and the nodes. */
+using index_type = std::uint32_t;
+
+/** The leaves have at most this number of points. */
+constexpr std::size_t leaf_size = 16;
+
+/** The Euclidean distance. The trees compare the squared distances. */
+struct euclidean_metric
+{
+    using reduce = operations::plus;
+    using map = operations::squared_difference;
+    template<typename T> static T to_distance(T reduced) { return T(std::sqrt(reduced)); }
+    template<typename T> static T from_distance(T distance) { return T(distance * distance); }
+};
+
+struct manhattan_metric
+{
+    using reduce = operations::plus;
+    using map = operations::absolute_difference;
+    template<typename T> static T to_distance(T reduced) { return reduced; }
+    template<typename T> static T from_distance(T distance) { return distance; }
+};
+
+struct maximum_metric
+{
+    using reduce = operations::maximum;
+    using map = operations::absolute_difference;
+    template<typename T> static T to_distance(T reduced) { return reduced; }
+    template<typename T> static T from_distance(T distance) { return distance; }
+};
+
+/** Reduces the terms of the coordinates in order, computed in the type `T`.
+Since the rounding is monotonic, a point is never nearer than a bound that is
+reduced from smaller terms. The terms are not fused with the reduction.
+*/
+template<typename Metric, typename T, typename InputIterator1, typename InputIterator2>
+AAA_NO_CONTRACT T reduced_distance(InputIterator1 first_left, InputIterator2 first_right, std::size_t dimension)
+{
+    auto result = T{};
+    for (auto i = std::size_t{0}; i < dimension; ++i, ++first_left, ++first_right)
+    {
+        result = T(typename Metric::reduce{}(result, T(typename Metric::map{}(T(*first_left), T(*first_right)))));
+    }
+    return result;
+}
+
+/** Reduces terms that are already computed, like `reduced_distance`. */
+template<typename Metric, typename T>
+AAA_NO_CONTRACT T reduce_terms(const T* terms, std::size_t dimension)
+{
+    auto result = T{};
+    for (auto i = std::size_t{0}; i < dimension; ++i)
+    {
+        result = T(typename Metric::reduce{}(result, terms[i]));
+    }
+    return result;
+}
+
+/** The distance of a metric, as a function object for `vp_tree`. */
+template<typename Metric>
+struct metric_distance
+{
+    template<typename InputIterator1, typename InputIterator2, typename T = value_type_i<InputIterator1>>
+    T operator()(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right) const
+    {
+        const auto dimension = static_cast<std::size_t>(std::distance(first_left, last_left));
+        return Metric::to_distance(reduced_distance<Metric, T>(first_left, first_right, dimension));
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// building
+
+/** A subtree that is not built yet: its root node and its range of points. */
+struct subtree
+{
+    std::size_t node;
+    std::size_t first;
+    std::size_t last;
+};
+
+/** The number of nodes of a subtree with `size` points. The nodes with more than
+`leaf_size` points keep `Own` of them, and split the others in halves.
+*/
+template<std::size_t Own>
+std::size_t node_count(std::size_t size)
+{
+    if (size <= leaf_size)
+    {
+        return 1;
+    }
+    const auto rest = size - Own;
+    return 1 + node_count<Own>(rest / 2) + node_count<Own>(rest - rest / 2);
+}
+
+/** Builds a tree of `size` points by calling `build_subtree(subtree, task_size, tasks)`.
+The first call splits the top of the tree until the subtrees have at most
+`task_size` points, and adds them to `tasks`. The tasks are then built with the
+policy, with `tasks == nullptr`. The position of each node is known in advance
+from `node_count`, so the tree does not depend on the order of the tasks.
+*/
+template<typename Tag, typename BuildSubtree>
+void build_tree(execution::policy<Tag> policy, std::size_t size, BuildSubtree build_subtree)
+{
+    const auto num_tasks = 4 * neighbors::concurrency(policy);
+    const auto task_size = std::max(leaf_size, size / num_tasks);
+    auto tasks = std::vector<subtree>{};
+    build_subtree(subtree{ 0, 0, size }, task_size, &tasks);
+    pairwise::for_each_tile(policy, tasks.size(), [&](std::ptrdiff_t t)
+    {
+        build_subtree(tasks[t], task_size, static_cast<std::vector<subtree>*>(nullptr));
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// kd-tree
+
+/** A node of a `kd_tree`. The left child follows its parent. Leaves have `right == 0`. */
+template<typename T>
+struct kd_node
+{
+    T split;
+    index_type axis;
+    index_type first;
+    index_type last;
+    index_type right;
+};
+
+/** A kd-tree of points with `dimension` coordinates of type `T`, for the distance of `Metric`.
+The points of the left child of a node have coordinates at most `split` on the axis
+of the node, and the points of the right child at least `split`.
+*/
+template<typename T, typename Metric>
+class kd_tree
+{
+public:
+    using node = kd_node<T>;
+
+    /** Builds the tree of the points in the range of iterators, with an execution policy. */
+    template<typename Tag, typename InputIterator>
+    kd_tree(execution::policy<Tag> policy, InputIterator first, InputIterator last, std::size_t dimension)
+        : dimension_(dimension)
+    {
+        assert(dimension > 0);
+        const auto data = std::vector<T>(first, last);
+        const auto size = data.size() / dimension;
+        assert(size <= std::numeric_limits<index_type>::max());
+        indices_.resize(size);
+        std::iota(indices_.begin(), indices_.end(), index_type{0});
+        nodes_.resize(node_count<0>(size));
+        build_tree(policy, size, [&](subtree s, std::size_t task_size, std::vector<subtree>* tasks)
+        {
+            build_subtree(data, s, task_size, tasks);
+        });
+        points_.resize(data.size());
+        for (auto i = std::size_t{0}; i < size; ++i)
+        {
+            std::copy_n(data.begin() + indices_[i] * dimension, dimension, points_.begin() + i * dimension);
+        }
+    }
+
+    /** Builds the tree of the points in the container, with an execution policy. */
+    template<typename Tag, typename Container>
+    kd_tree(execution::policy<Tag> policy, const Container& points, std::size_t dimension)
+        : kd_tree(policy, std::begin(points), std::end(points), dimension)
+    {
+    }
+
+    /** Builds the tree of the points in the range of iterators. */
+    template<typename InputIterator>
+    kd_tree(InputIterator first, InputIterator last, std::size_t dimension)
+        : kd_tree(execution::seq, first, last, dimension)
+    {
+    }
+
+    /** Builds the tree of the points in the container. */
+    template<typename Container>
+    kd_tree(const Container& points, std::size_t dimension)
+        : kd_tree(execution::seq, points, dimension)
+    {
+    }
+
+    /** Restores a tree from the arrays of another tree. */
+    kd_tree(std::size_t dimension, std::vector<T> points, std::vector<index_type> indices, std::vector<node> nodes)
+        : dimension_(dimension), points_(std::move(points)), indices_(std::move(indices)), nodes_(std::move(nodes))
+    {
+        assert(points_.size() == indices_.size() * dimension_);
+        assert(!nodes_.empty());
+    }
+
+    std::size_t dimension() const { return dimension_; }
+    std::size_t size() const { return indices_.size(); }
+
+    /** The points in the order of the tree. */
+    const std::vector<T>& points() const { return points_; }
+
+    /** The original index of each point in the order of the tree. */
+    const std::vector<index_type>& indices() const { return indices_; }
+
+    const std::vector<node>& nodes() const { return nodes_; }
+
+    /** Writes the indices and the distances of the `k` nearest points of the query,
+    from the nearest to the farthest. The tree should have at least `k` points.
+    */
+    template<typename InputIterator, typename IndexIterator, typename DistanceIterator>
+    void nearest(InputIterator query, std::size_t k, IndexIterator first_index, DistanceIterator first_distance) const
+    {
+        assert(k <= size());
+        if (k == 0)
+        {
+            return;
+        }
+        auto heap = neighbors::bounded_heap<T>(k);
+        const auto limit = [&]()
+        {
+            return heap.size() < k ? simd::highest<T>() : heap.farthest();
+        };
+        const auto visit = [&](index_type index, T reduced)
+        {
+            heap.push(reduced, index);
+        };
+        auto terms = std::vector<T>(dimension_);
+        search(0, query, terms.data(), limit, visit);
+        for (const auto& candidate : heap.take_sorted())
+        {
+            *first_index = static_cast<value_type_i<IndexIterator>>(candidate.second);
+            *first_distance = Metric::to_distance(candidate.first);
+            ++first_index;
+            ++first_distance;
+        }
+    }
+
+    /** Appends the indices and the distances of the points at a distance of at most
+    `radius` of the query, in the order of the tree.
+    */
+    template<typename InputIterator, typename Index>
+    void within_radius(InputIterator query, T radius, std::vector<Index>& indices, std::vector<T>& distances) const
+    {
+        const auto reduced_radius = Metric::from_distance(radius);
+        const auto limit = [&]()
+        {
+            return reduced_radius;
+        };
+        const auto visit = [&](index_type index, T reduced)
+        {
+            indices.push_back(static_cast<Index>(index));
+            distances.push_back(Metric::to_distance(reduced));
+        };
+        auto terms = std::vector<T>(dimension_);
+        search(0, query, terms.data(), limit, visit);
+    }
+
+private:
+    void build_subtree(const std::vector<T>& data, subtree s, std::size_t task_size, std::vector<subtree>* tasks)
+    {
+        const auto size = s.last - s.first;
+        if (tasks != nullptr && size <= task_size)
+        {
+            tasks->push_back(s);
+            return;
+        }
+        auto& n = nodes_[s.node];
+        n = node{ T{}, 0, static_cast<index_type>(s.first), static_cast<index_type>(s.last), 0 };
+        if (size <= leaf_size)
+        {
+            return;
+        }
+        const auto first = indices_.begin() + static_cast<std::ptrdiff_t>(s.first);
+        const auto last = indices_.begin() + static_cast<std::ptrdiff_t>(s.last);
+        const auto middle = first + static_cast<std::ptrdiff_t>(size / 2);
+        const auto axis = widest_axis(data, first, last);
+        const auto coordinate = [&](index_type i)
+        {
+            return data[i * dimension_ + axis];
+        };
+        std::nth_element(first, middle, last, [&](index_type a, index_type b)
+        {
+            return coordinate(a) < coordinate(b);
+        });
+        n.split = coordinate(*middle);
+        n.axis = static_cast<index_type>(axis);
+        n.right = static_cast<index_type>(s.node + 1 + node_count<0>(size / 2));
+        const auto right = n.right;
+        build_subtree(data, subtree{ s.node + 1, s.first, s.first + size / 2 }, task_size, tasks);
+        build_subtree(data, subtree{ right, s.first + size / 2, s.last }, task_size, tasks);
+    }
+
+    template<typename IndexIterator>
+    std::size_t widest_axis(const std::vector<T>& data, IndexIterator first, IndexIterator last) const
+    {
+        auto lowest = std::vector<T>(data.begin() + *first * dimension_, data.begin() + (*first + 1) * dimension_);
+        auto highest = lowest;
+        for (auto it = first; it != last; ++it)
+        {
+            const auto point = data.begin() + *it * dimension_;
+            for (auto d = std::size_t{0}; d < dimension_; ++d)
+            {
+                lowest[d] = std::min(lowest[d], point[d]);
+                highest[d] = std::max(highest[d], point[d]);
+            }
+        }
+        auto axis = std::size_t{0};
+        for (auto d = std::size_t{1}; d < dimension_; ++d)
+        {
+            if (highest[d] - lowest[d] > highest[axis] - lowest[axis])
+            {
+                axis = d;
+            }
+        }
+        return axis;
+    }
+
+    /** Visits the points of the node whose distance is at most `limit()`.
+    `terms` has the terms of the distance of the query to the box of the node, on each axis.
+    */
+    template<typename InputIterator, typename Limit, typename Visit>
+    void search(std::size_t node_index, InputIterator query, T* terms, Limit limit, Visit visit) const
+    {
+        const auto& n = nodes_[node_index];
+        if (n.right == 0)
+        {
+            for (auto i = std::size_t{n.first}; i < n.last; ++i)
+            {
+                const auto reduced = reduced_distance<Metric, T>(query, points_.begin() + i * dimension_, dimension_);
+                if (reduced <= limit())
+                {
+                    visit(indices_[i], reduced);
+                }
+            }
+            return;
+        }
+        const auto coordinate = T(*std::next(query, static_cast<std::ptrdiff_t>(n.axis)));
+        const auto near = coordinate < n.split ? node_index + 1 : std::size_t{n.right};
+        const auto far = coordinate < n.split ? std::size_t{n.right} : node_index + 1;
+        search(near, query, terms, limit, visit);
+        const auto term = terms[n.axis];
+        terms[n.axis] = T(typename Metric::map{}(coordinate, n.split));
+        if (reduce_terms<Metric>(terms, dimension_) <= limit())
+        {
+            search(far, query, terms, limit, visit);
+        }
+        terms[n.axis] = term;
+    }
+
+    std::size_t dimension_;
+    std::vector<T> points_;
+    std::vector<index_type> indices_;
+    std::vector<node> nodes_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// vantage-point tree
+
+/** A node of a `vp_tree`. The vantage point is the point `first`.
+The left child follows its parent. Leaves have `right == 0`.
+*/
+template<typename T>
+struct vp_node
+{
+    T threshold;
+    index_type first;
+    index_type last;
+    index_type right;
+};
+
+/** A vantage-point tree of points with `dimension` coordinates of type `T`.
+`distance(first_left, last_left, first_right)` should be a metric.
+The points of the left child of a node are at a distance of at most `threshold`
+of the vantage point, and the points of the right child at least `threshold`.
+*/
+template<typename T, typename Distance>
+class vp_tree
+{
+public:
+    using node = vp_node<T>;
+
+    /** Builds the tree of the points in the range of iterators, with an execution policy. */
+    template<typename Tag, typename InputIterator>
+    vp_tree(execution::policy<Tag> policy, InputIterator first, InputIterator last, std::size_t dimension,
+        Distance distance = Distance{})
+        : dimension_(dimension), distance_(distance)
+    {
+        assert(dimension > 0);
+        points_.assign(first, last);
+        const auto size = points_.size() / dimension;
+        assert(size <= std::numeric_limits<index_type>::max());
+        indices_.resize(size);
+        std::iota(indices_.begin(), indices_.end(), index_type{0});
+        nodes_.resize(node_count<1>(size));
+        build_tree(policy, size, [&](subtree s, std::size_t task_size, std::vector<subtree>* tasks)
+        {
+            build_subtree(s, task_size, tasks);
+        });
+        const auto data = std::move(points_);
+        points_.resize(data.size());
+        for (auto i = std::size_t{0}; i < size; ++i)
+        {
+            std::copy_n(data.begin() + indices_[i] * dimension, dimension, points_.begin() + i * dimension);
+        }
+    }
+
+    /** Builds the tree of the points in the container, with an execution policy. */
+    template<typename Tag, typename Container>
+    vp_tree(execution::policy<Tag> policy, const Container& points, std::size_t dimension,
+        Distance distance = Distance{})
+        : vp_tree(policy, std::begin(points), std::end(points), dimension, distance)
+    {
+    }
+
+    /** Builds the tree of the points in the range of iterators. */
+    template<typename InputIterator>
+    vp_tree(InputIterator first, InputIterator last, std::size_t dimension, Distance distance = Distance{})
+        : vp_tree(execution::seq, first, last, dimension, distance)
+    {
+    }
+
+    /** Builds the tree of the points in the container. */
+    template<typename Container>
+    vp_tree(const Container& points, std::size_t dimension, Distance distance = Distance{})
+        : vp_tree(execution::seq, points, dimension, distance)
+    {
+    }
+
+    /** Restores a tree from the arrays of another tree. */
+    vp_tree(std::size_t dimension, std::vector<T> points, std::vector<index_type> indices, std::vector<node> nodes,
+        Distance distance = Distance{})
+        : dimension_(dimension), distance_(distance),
+        points_(std::move(points)), indices_(std::move(indices)), nodes_(std::move(nodes))
+    {
+        assert(points_.size() == indices_.size() * dimension_);
+        assert(!nodes_.empty());
+    }
+
+    std::size_t dimension() const { return dimension_; }
+    std::size_t size() const { return indices_.size(); }
+
+    /** The points in the order of the tree. */
+    const std::vector<T>& points() const { return points_; }
+
+    /** The original index of each point in the order of the tree. */
+    const std::vector<index_type>& indices() const { return indices_; }
+
+    const std::vector<node>& nodes() const { return nodes_; }
+
+    /** Writes the indices and the distances of the `k` nearest points of the query,
+    from the nearest to the farthest. The tree should have at least `k` points.
+    */
+    template<typename InputIterator, typename IndexIterator, typename DistanceIterator>
+    void nearest(InputIterator query, std::size_t k, IndexIterator first_index, DistanceIterator first_distance) const
+    {
+        assert(k <= size());
+        if (k == 0)
+        {
+            return;
+        }
+        auto heap = neighbors::bounded_heap<T>(k);
+        const auto limit = [&]()
+        {
+            return heap.size() < k ? simd::highest<T>() : heap.farthest();
+        };
+        const auto visit = [&](index_type index, T distance)
+        {
+            heap.push(distance, index);
+        };
+        search(0, query, limit, visit);
+        for (const auto& candidate : heap.take_sorted())
+        {
+            *first_index = static_cast<value_type_i<IndexIterator>>(candidate.second);
+            *first_distance = candidate.first;
+            ++first_index;
+            ++first_distance;
+        }
+    }
+
+    /** Appends the indices and the distances of the points at a distance of at most
+    `radius` of the query, in the order of the tree.
+    */
+    template<typename InputIterator, typename Index>
+    void within_radius(InputIterator query, T radius, std::vector<Index>& indices, std::vector<T>& distances) const
+    {
+        const auto limit = [&]()
+        {
+            return radius;
+        };
+        const auto visit = [&](index_type index, T distance)
+        {
+            indices.push_back(static_cast<Index>(index));
+            distances.push_back(distance);
+        };
+        search(0, query, limit, visit);
+    }
+
+private:
+    template<typename InputIterator>
+    T distance_to(InputIterator query, std::size_t position) const
+    {
+        const auto point = points_.begin() + static_cast<std::ptrdiff_t>(position * dimension_);
+        return T(distance_(point, point + static_cast<std::ptrdiff_t>(dimension_), query));
+    }
+
+    /** The points are still in their original order while the tree is built. */
+    void build_subtree(subtree s, std::size_t task_size, std::vector<subtree>* tasks)
+    {
+        const auto size = s.last - s.first;
+        if (tasks != nullptr && size <= task_size)
+        {
+            tasks->push_back(s);
+            return;
+        }
+        auto& n = nodes_[s.node];
+        n = node{ T{}, static_cast<index_type>(s.first), static_cast<index_type>(s.last), 0 };
+        if (size <= leaf_size)
+        {
+            return;
+        }
+        // The vantage point stays first, and the others are sorted around the median distance.
+        const auto vantage_point = points_.begin() + static_cast<std::ptrdiff_t>(indices_[s.first] * dimension_);
+        auto others = std::vector<std::pair<T, index_type>>{};
+        others.reserve(size - 1);
+        for (auto i = s.first + 1; i < s.last; ++i)
+        {
+            others.emplace_back(distance_to(vantage_point, indices_[i]), indices_[i]);
+        }
+        const auto inside = (size - 1) / 2;
+        std::nth_element(others.begin(), others.begin() + static_cast<std::ptrdiff_t>(inside), others.end());
+        for (auto i = std::size_t{0}; i < others.size(); ++i)
+        {
+            indices_[s.first + 1 + i] = others[i].second;
+        }
+        n.threshold = others[inside].first;
+        n.right = static_cast<index_type>(s.node + 1 + node_count<1>(inside));
+        const auto right = n.right;
+        build_subtree(subtree{ s.node + 1, s.first + 1, s.first + 1 + inside }, task_size, tasks);
+        build_subtree(subtree{ right, s.first + 1 + inside, s.last }, task_size, tasks);
+    }
+
+    /** Visits the points of the node whose distance is at most `limit()`.
+    By the triangle inequality, the points of the left child are at least at
+    `d - threshold` of the query, and those of the right child at `threshold - d`,
+    where `d` is the distance of the query to the vantage point.
+    */
+    template<typename InputIterator, typename Limit, typename Visit>
+    void search(std::size_t node_index, InputIterator query, Limit limit, Visit visit) const
+    {
+        const auto& n = nodes_[node_index];
+        if (n.right == 0)
+        {
+            for (auto i = std::size_t{n.first}; i < n.last; ++i)
+            {
+                const auto distance = distance_to(query, i);
+                if (distance <= limit())
+                {
+                    visit(indices_[i], distance);
+                }
+            }
+            return;
+        }
+        const auto distance = distance_to(query, n.first);
+        if (distance <= limit())
+        {
+            visit(indices_[n.first], distance);
+        }
+        if (distance < n.threshold)
+        {
+            search(node_index + 1, query, limit, visit);
+            if (n.threshold - distance <= limit())
+            {
+                search(n.right, query, limit, visit);
+            }
+        }
+        else
+        {
+            search(n.right, query, limit, visit);
+            if (distance - n.threshold <= limit())
+            {
+                search(node_index + 1, query, limit, visit);
+            }
+        }
+    }
+
+    std::size_t dimension_;
+    Distance distance_;
+    std::vector<T> points_;
+    std::vector<index_type> indices_;
+    std::vector<node> nodes_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// batches of queries
+
+/** The number of queries of each task of the batches. */
+constexpr std::size_t query_block_size = 64;
+
+/** The `k` nearest points of the tree to each query, with an execution policy.
+The queries are a container with rows of the dimension of the tree.
+The sizes of the indices and the distances should be `num_queries * k`.
+*/
+template<typename Tag, typename Tree, typename Container1, typename Container2, typename Container3>
+void nearest_neighbors(execution::policy<Tag> policy, const Tree& tree, const Container1& queries, std::size_t k,
+    Container2& indices, Container3& distances)
+{
+    const auto dimension = tree.dimension();
+    assert(queries.size() % dimension == 0);
+    const auto num_queries = queries.size() / dimension;
+    assert(indices.size() == num_queries * k);
+    assert(distances.size() == indices.size());
+    using std::begin;
+    const auto num_blocks = (num_queries + query_block_size - 1) / query_block_size;
+    pairwise::for_each_tile(policy, num_blocks, [&](std::ptrdiff_t block)
+    {
+        const auto first = static_cast<std::size_t>(block) * query_block_size;
+        const auto last = std::min(num_queries, first + query_block_size);
+        for (auto q = first; q < last; ++q)
+        {
+            const auto offset = static_cast<std::ptrdiff_t>(q * k);
+            tree.nearest(std::next(begin(queries), static_cast<std::ptrdiff_t>(q * dimension)), k,
+                std::next(begin(indices), offset), std::next(begin(distances), offset));
+        }
+    });
+}
+
+/** The `k` nearest points of the tree to each query. */
+template<typename Tree, typename Container1, typename Container2, typename Container3>
+void nearest_neighbors(const Tree& tree, const Container1& queries, std::size_t k,
+    Container2& indices, Container3& distances)
+{
+    nearest_neighbors(execution::seq, tree, queries, k, indices, distances);
+}
+
+/** The points of the tree at a distance of at most `radius` of each query, with an execution policy.
+The queries are a container with rows of the dimension of the tree. The points of
+query `i` are at `[offsets[i], offsets[i + 1])` of the indices and the distances,
+in the order of the tree. The outputs are resized.
+*/
+template<typename Tag, typename Tree, typename Container, typename T, typename Index>
+void radius_neighbors(execution::policy<Tag> policy, const Tree& tree, const Container& queries, T radius,
+    std::vector<std::size_t>& offsets, std::vector<Index>& indices, std::vector<T>& distances)
+{
+    const auto dimension = tree.dimension();
+    assert(queries.size() % dimension == 0);
+    const auto num_queries = queries.size() / dimension;
+    using std::begin;
+    const auto num_blocks = (num_queries + query_block_size - 1) / query_block_size;
+    auto block_indices = std::vector<std::vector<Index>>(num_blocks);
+    auto block_distances = std::vector<std::vector<T>>(num_blocks);
+    offsets.assign(num_queries + 1, 0);
+    pairwise::for_each_tile(policy, num_blocks, [&](std::ptrdiff_t block)
+    {
+        const auto first = static_cast<std::size_t>(block) * query_block_size;
+        const auto last = std::min(num_queries, first + query_block_size);
+        for (auto q = first; q < last; ++q)
+        {
+            tree.within_radius(std::next(begin(queries), static_cast<std::ptrdiff_t>(q * dimension)), radius,
+                block_indices[block], block_distances[block]);
+            offsets[q + 1] = block_indices[block].size();
+        }
+    });
+    // The offsets are relative to their block until the blocks are concatenated.
+    indices.clear();
+    distances.clear();
+    for (auto block = std::size_t{0}; block < num_blocks; ++block)
+    {
+        const auto first = block * query_block_size;
+        const auto last = std::min(num_queries, first + query_block_size);
+        for (auto q = first; q < last; ++q)
+        {
+            offsets[q + 1] += indices.size();
+        }
+        indices.insert(indices.end(), block_indices[block].begin(), block_indices[block].end());
+        distances.insert(distances.end(), block_distances[block].begin(), block_distances[block].end());
+    }
+}
+
+/** The points of the tree at a distance of at most `radius` of each query. */
+template<typename Tree, typename Container, typename T, typename Index>
+void radius_neighbors(const Tree& tree, const Container& queries, T radius,
+    std::vector<std::size_t>& offsets, std::vector<Index>& indices, std::vector<T>& distances)
+{
+    radius_neighbors(execution::seq, tree, queries, radius, offsets, indices, distances);
+}
+
+/** @} */
+
+} // namespace spatial
+} // namespace aaa
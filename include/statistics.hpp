@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "traits.hpp"
+
+namespace aaa {
+
+/**
+@addtogroup statistics
+
+The descriptive statistics of a range are its count, mean, variance, standard
+deviation, skewness, minimum and maximum. They are all computed in a single pass
+by `describe`, which returns them in a `statistics` object.
+
+The object keeps the count, the mean, and the sums of the squared and cubed
+deviations from the mean, which are updated for each element by Welford's
+method. Two objects are combined by `merge` with Chan's formulas, so that the
+statistics of a stream can be computed chunk by chunk, or in parallel. The
+ranges are read in blocks: the SIMD kernel `simd::shifted_moments` sums the
+powers of the deviations of a block from the current mean, which are then
+merged like a second object. The shift keeps the sums small, so the results are
+as accurate as the element-by-element updates.
+
+The statistics of integers are computed with `double`, and the statistics of
+`float` with `float`, like `sqrt_type_t`.
+
+Example:
+```
+std::vector<float> a = { 1, 2, 3, 4 };
+
+using namespace aaa;
+
+auto stats = describe(a);
+// stats.mean() == 2.5f, stats.variance() == 1.25f, stats.min() == 1, stats.max() == 4.
+
+// The statistics of a stream, chunk by chunk.
+auto total = statistics<float>();
+total.push(a.begin(), a.begin() + 2);
+total.push(a.begin() + 2, a.end());
+total.merge(describe(execution::par, a));
+// total.count() == 8, total.mean() == 2.5f.
+```
+
+@{
+*/
+
+/** The number of elements that are summed by a SIMD kernel before they are merged. */
+constexpr auto statistics_block_size = std::ptrdiff_t{1024};
+
+/** The count, mean, variance, skewness, minimum and maximum of a sequence of values
+of the floating point type `T`, which can be updated value by value, or by ranges,
+and merged with the statistics of other sequences.
+*/
+template<typename T>
+class statistics
+{
+public:
+    /** The statistics of an empty sequence. */
+    statistics() = default;
+
+    /** Adds a value to the sequence, by Welford's update. */
+    void push(T x)
+    {
+        const auto n = T(count_ + 1);
+        const auto delta = x - mean_;
+        const auto delta_n = delta / n;
+        const auto term = delta * delta_n * T(count_);
+        mean_ += delta_n;
+        m3_ += term * delta_n * (n - 2) - 3 * delta_n * m2_;
+        m2_ += term;
+        min_ = std::min(min_, x);
+        max_ = std::max(max_, x);
+        ++count_;
+    }
+
+    /** Adds the values of a range to the sequence. The blocks of the range are
+    summed by a SIMD kernel around the current mean, and merged.
+    */
+    template<typename InputIterator>
+    void push(InputIterator first, InputIterator last)
+    {
+        for (auto size = std::distance(first, last); size > 0; )
+        {
+            const auto block_size = std::min(size, statistics_block_size);
+            auto block_last = first;
+            std::advance(block_last, block_size);
+            const auto shift = count_ == 0 ? T(*first) : mean_;
+            merge(statistics(simd::shifted_moments<T>(first, block_last, shift), shift, block_size));
+            first = block_last;
+            size -= block_size;
+        }
+    }
+
+    /** Adds the values of another sequence to the sequence, by Chan's formulas. */
+    void merge(const statistics& other)
+    {
+        if (other.count_ == 0)
+        {
+            return;
+        }
+        if (count_ == 0)
+        {
+            *this = other;
+            return;
+        }
+        const auto na = T(count_);
+        const auto nb = T(other.count_);
+        const auto n = na + nb;
+        const auto delta = other.mean_ - mean_;
+        const auto delta_n = delta / n;
+        mean_ += delta_n * nb;
+        m3_ += other.m3_ + delta * delta_n * delta_n * na * nb * (na - nb) +
+            3 * delta_n * (na * other.m2_ - nb * m2_);
+        m2_ += other.m2_ + delta * delta_n * na * nb;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        count_ += other.count_;
+    }
+
+    /** The number of values. */
+    std::size_t count() const { return count_; }
+
+    /** The mean of the values. The sequence should not be empty. */
+    T mean() const { assert(count_ > 0); return mean_; }
+
+    /** The smallest value. The sequence should not be empty. */
+    T min() const { assert(count_ > 0); return min_; }
+
+    /** The largest value. The sequence should not be empty. */
+    T max() const { assert(count_ > 0); return max_; }
+
+    /** The population variance of the values. The sequence should not be empty. */
+    T variance() const { assert(count_ > 0); return m2_ / T(count_); }
+
+    /** The sample variance of the values. The sequence should have at least 2 values. */
+    T sample_variance() const { assert(count_ > 1); return m2_ / T(count_ - 1); }
+
+    /** The population standard deviation of the values. */
+    T standard_deviation() const { return std::sqrt(variance()); }
+
+    /** The sample standard deviation of the values. */
+    T sample_standard_deviation() const { return std::sqrt(sample_variance()); }
+
+    /** The population skewness of the values, which is 0 when all the values are equal. */
+    T skewness() const
+    {
+        assert(count_ > 0);
+        return m2_ == 0 ? T{} : std::sqrt(T(count_)) * m3_ / (m2_ * std::sqrt(m2_));
+    }
+
+private:
+    /** The statistics of a block of `n` values, from the sums of `simd::shifted_moments`. */
+    statistics(const std::array<T, 5>& moments, T shift, std::ptrdiff_t n)
+        : count_(static_cast<std::size_t>(n))
+        , min_(moments[3])
+        , max_(moments[4])
+    {
+        const auto s1 = moments[0];
+        const auto s2 = moments[1];
+        const auto mean = s1 / T(n);
+        mean_ = shift + mean;
+        m2_ = s2 - s1 * mean;
+        m3_ = moments[2] - 3 * mean * s2 + 2 * s1 * mean * mean;
+    }
+
+    std::size_t count_ = 0;
+    T mean_ = T{};
+    T m2_ = T{};
+    T m3_ = T{};
+    T min_ = std::numeric_limits<T>::max();
+    T max_ = std::numeric_limits<T>::lowest();
+};
+
+/** The statistics of a range, in a single pass. */
+template<typename InputIterator, typename T = sqrt_type_t<value_type_i<InputIterator>>>
+statistics<T> describe(InputIterator first, InputIterator last)
+{
+    auto result = statistics<T>();
+    result.push(first, last);
+    return result;
+}
+
+/** The statistics of a container, in a single pass. */
+template<typename Container, typename T = sqrt_type_t<value_type<Container>>>
+statistics<T> describe(const Container& a)
+{
+    using std::begin;
+    using std::end;
+    return describe(begin(a), end(a));
+}
+
+/** The statistics of a range, with an execution policy.
+The chunks of the range are described in parallel and merged in order.
+*/
+template<typename Tag, typename InputIterator, typename T = sqrt_type_t<value_type_i<InputIterator>>>
+statistics<T> describe(execution::policy<Tag> policy, InputIterator first, InputIterator last)
+{
+    const auto f = [&](std::ptrdiff_t first_chunk, std::ptrdiff_t last_chunk, statistics<T> init_chunk)
+    {
+        init_chunk.push(first + first_chunk, first + last_chunk);
+        return init_chunk;
+    };
+    const auto combine = [](statistics<T> left, const statistics<T>& right)
+    {
+        left.merge(right);
+        return left;
+    };
+    return execution::parallel_reduce(policy, std::distance(first, last), statistics<T>(), statistics<T>(), f, combine);
+}
+
+/** The statistics of a container, with an execution policy. */
+template<typename Tag, typename Container, typename T = sqrt_type_t<value_type<Container>>>
+statistics<T> describe(execution::policy<Tag> policy, const Container& a)
+{
+    using std::begin;
+    using std::end;
+    return describe(policy, begin(a), end(a));
+}
+
+/** The mean of a range. The range should not be empty. */
+template<typename InputIterator>
+sqrt_type_t<value_type_i<InputIterator>> mean(InputIterator first, InputIterator last)
+{
+    return describe(first, last).mean();
+}
+
+/** The mean of a container. The container should not be empty. */
+template<typename Container>
+sqrt_type_t<value_type<Container>> mean(const Container& a)
+{
+    return describe(a).mean();
+}
+
+/** The population variance of a range. The range should not be empty. */
+template<typename InputIterator>
+sqrt_type_t<value_type_i<InputIterator>> variance(InputIterator first, InputIterator last)
+{
+    return describe(first, last).variance();
+}
+
+/** The population variance of a container. The container should not be empty. */
+template<typename Container>
+sqrt_type_t<value_type<Container>> variance(const Container& a)
+{
+    return describe(a).variance();
+}
+
+/** The population standard deviation of a range. The range should not be empty. */
+template<typename InputIterator>
+sqrt_type_t<value_type_i<InputIterator>> standard_deviation(InputIterator first, InputIterator last)
+{
+    return describe(first, last).standard_deviation();
+}
+
+/** The population standard deviation of a container. The container should not be empty. */
+template<typename Container>
+sqrt_type_t<value_type<Container>> standard_deviation(const Container& a)
+{
+    return describe(a).standard_deviation();
+}
+
+/** @} */
+
+} // namespace aaa
@@ -1,7 +1,12 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
 
+#include "parallel.hpp"
+#include "simd.hpp"
 #include "traits.hpp"
 
 namespace aaa {
@@ -36,6 +41,14 @@ subtract(in3, 2.1, out); // Elementwise subtraction of a vector and a scalar.
 subtract(begin(in5) + 1, begin(in5) + 6, begin(in4), begin(out)); // Elementwise subtraction of two vectors.
 subtract(4.9, begin(in5) + 1, begin(in5) + 6, begin(out)); // Elementwise subtraction of a scalar and a vector.
 subtract(begin(in5) + 1, begin(in5) + 6, 2.1, begin(out)); // Elementwise subtraction of a vector and a scalar.
+
+// In this example the inner result is a temporary container.
+// Its storage is reused for the output, instead of allocating a new container.
+out = subtract(subtract(in1, in2), in1);
+
+// In these two examples we modify the first vector in place.
+subtract_inplace(out, in1); // Elementwise subtraction of two vectors.
+subtract_inplace(out, 3.3); // Elementwise subtraction of a vector and a scalar.
 ```
 
 @{
@@ -48,27 +61,21 @@ template<typename InputIterator1, typename InputIterator2, typename OutputIterat
     check_difference<value_type_i<InputIterator1>, value_type_i<InputIterator2>, value_type_i<OutputIterator>> = nullptr>
 void subtract(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, OutputIterator first_out)
 {
-    auto f = [](const value_type_i<InputIterator1>& left, const value_type_i<InputIterator2>& right)
-    {
-        return left - right;
-    };
-    std::transform(first_left, last_left, first_right, first_out, f);
+    simd::transform(first_left, last_left, first_right, first_out, operations::minus{});
 }
 
 template<typename Element, typename InputIterator, typename OutputIterator,
     check_difference<Element, value_type_i<InputIterator>, value_type_i<OutputIterator>> = nullptr>
 void subtract(const Element& left, InputIterator first_right, InputIterator last_right, OutputIterator first_out)
 {
-    auto f = [&](const value_type_i<InputIterator>& right) { return left - right; };
-    std::transform(first_right, last_right, first_out, f);
+    simd::transform_scalar_vector(left, first_right, last_right, first_out, operations::minus{});
 }
 
 template<typename InputIterator, typename Element, typename OutputIterator,
     check_difference<value_type_i<InputIterator>, Element, value_type_i<OutputIterator>> = nullptr>
 void subtract(InputIterator first_left, InputIterator last_left, const Element& right, OutputIterator first_out)
 {
-    auto f = [&](const value_type_i<InputIterator>& left) { return left - right; };
-    std::transform(first_left, last_left, first_out, f);
+    simd::transform_vector_scalar(first_left, last_left, right, first_out, operations::minus{});
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -132,6 +139,152 @@ Container subtract(const value_type<Container>& left, const Container& right)
     return out;
 }
 
+// Overloads for temporary containers, that reuse their storage for the output.
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container subtract(Container&& left, const Container& right)
+{
+    subtract(left, right, left);
+    return std::move(left);
+}
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container subtract(const Container& left, Container&& right)
+{
+    subtract(left, right, right);
+    return std::move(right);
+}
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container subtract(Container&& left, Container&& right)
+{
+    subtract(left, right, left);
+    return std::move(left);
+}
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container subtract(Container&& left, const value_type<Container>& right)
+{
+    subtract(left, right, left);
+    return std::move(left);
+}
+
+template<typename Container, check_rvalue<Container> = nullptr>
+Container subtract(const value_type<Container>& left, Container&& right)
+{
+    subtract(left, right, right);
+    return std::move(right);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// in place
+
+template<typename Container1, typename Container2,
+    check_difference<value_type<Container1>, value_type<Container2>, value_type<Container1>> = nullptr>
+    void subtract_inplace(Container1& left, const Container2& right)
+{
+    subtract(left, right, left);
+}
+
+template<typename Container, typename Element,
+    check_difference<value_type<Container>, Element, value_type<Container>> = nullptr>
+    void subtract_inplace(Container& left, const Element& right)
+{
+    subtract(left, right, left);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// execution policies
+
+template<typename Tag, typename InputIterator1, typename InputIterator2, typename OutputIterator,
+    check_difference<value_type_i<InputIterator1>, value_type_i<InputIterator2>, value_type_i<OutputIterator>> = nullptr>
+    void subtract(execution::policy<Tag> policy,
+        InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right, OutputIterator first_out)
+{
+    execution::parallel_for(policy, std::distance(first_left, last_left), [&](std::ptrdiff_t first, std::ptrdiff_t last)
+    {
+        subtract(first_left + first, first_left + last, first_right + first, first_out + first);
+    });
+}
+
+template<typename Tag, typename Element, typename InputIterator, typename OutputIterator,
+    check_difference<Element, value_type_i<InputIterator>, value_type_i<OutputIterator>> = nullptr>
+    void subtract(execution::policy<Tag> policy,
+        const Element& left, InputIterator first_right, InputIterator last_right, OutputIterator first_out)
+{
+    execution::parallel_for(policy, std::distance(first_right, last_right), [&](std::ptrdiff_t first, std::ptrdiff_t last)
+    {
+        subtract(left, first_right + first, first_right + last, first_out + first);
+    });
+}
+
+template<typename Tag, typename InputIterator, typename Element, typename OutputIterator,
+    check_difference<value_type_i<InputIterator>, Element, value_type_i<OutputIterator>> = nullptr>
+    void subtract(execution::policy<Tag> policy,
+        InputIterator first_left, InputIterator last_left, const Element& right, OutputIterator first_out)
+{
+    execution::parallel_for(policy, std::distance(first_left, last_left), [&](std::ptrdiff_t first, std::ptrdiff_t last)
+    {
+        subtract(first_left + first, first_left + last, right, first_out + first);
+    });
+}
+
+template<typename Tag, typename Container1, typename Container2, typename Container3,
+    check_difference<value_type<Container1>, value_type<Container2>, value_type<Container3>> = nullptr>
+    void subtract(execution::policy<Tag> policy, const Container1& left, const Container2& right, Container3& out)
+{
+    assert(left.size() == out.size());
+    assert(right.size() == out.size());
+    using std::begin;
+    using std::end;
+    subtract(policy, begin(left), end(left), begin(right), begin(out));
+}
+
+template<typename Tag, typename Element, typename Container1, typename Container2,
+    check_difference<Element, value_type<Container1>, value_type<Container2>> = nullptr>
+    void subtract(execution::policy<Tag> policy, const Element& left, const Container1& right, Container2& out)
+{
+    assert(right.size() == out.size());
+    using std::begin;
+    using std::end;
+    subtract(policy, left, begin(right), end(right), begin(out));
+}
+
+template<typename Tag, typename Container1, typename Element, typename Container2,
+    check_difference<value_type<Container1>, Element, value_type<Container2>> = nullptr>
+    void subtract(execution::policy<Tag> policy, const Container1& left, const Element& right, Container2& out)
+{
+    assert(left.size() == out.size());
+    using std::begin;
+    using std::end;
+    subtract(policy, begin(left), end(left), right, begin(out));
+}
+
+template<typename Tag, typename Container>
+Container subtract(execution::policy<Tag> policy, const Container& left, const Container& right)
+{
+    auto out = left;
+    subtract(policy, left, right, out);
+    return out;
+}
+
+template<typename Tag, typename Container>
+Container subtract(execution::policy<Tag> policy, const Container& left, const value_type<Container>& right)
+{
+    auto out = left;
+    subtract(policy, left, right, out);
+    return out;
+}
+
+template<typename Tag, typename Container>
+Container subtract(execution::policy<Tag> policy, const value_type<Container>& left, const Container& right)
+{
+    auto out = right;
+    subtract(policy, left, right, out);
+    return out;
+}
+
 /** @} */
 
 } // namespace aaa
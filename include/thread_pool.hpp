@@ -0,0 +1,389 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aaa {
+namespace execution {
+
+/**
+@addtogroup thread_pool
+
+The parallel algorithms run on a thread pool that is shared by all modules.
+The pool is started lazily, the first time that an algorithm is called with a
+parallel execution policy, and the threads are then reused by all later calls.
+
+The pool is a fork-join work-stealing scheduler. Each worker thread has its own
+deque of tasks. A task covers a range of indices, and it is split in halves
+until it covers a single index. The thread that splits a task pushes one half
+to the back of its own deque and continues with the other half. A worker takes
+tasks from the back of its own deque, and steals from the front of the deques
+of the other workers when its own deque is empty. The thread that calls
+`thread_pool::run` helps with the tasks until all of them are done, so that
+nested parallel calls do not deadlock.
+
+The number of threads of the shared pool is, in order of priority:
+- The value given to `set_num_threads`.
+- The environment variable `AAA_NUM_THREADS`.
+- `std::thread::hardware_concurrency()`.
+
+Example:
+```
+// Use 8 threads, including the calling thread, for the parallel algorithms.
+aaa::execution::set_num_threads(8);
+```
+
+@{
+*/
+
+class thread_pool
+{
+public:
+    /** Starts `num_threads - 1` worker threads.
+    The thread that calls `run` is the last thread.
+    */
+    explicit thread_pool(std::size_t num_threads)
+    {
+        const auto num_workers = std::max(std::size_t{1}, num_threads) - 1;
+        for (auto i = std::size_t{0}; i < num_workers; ++i)
+        {
+            queues_.emplace_back(new queue());
+        }
+        for (auto i = std::size_t{0}; i < num_workers; ++i)
+        {
+            workers_.emplace_back([this, i] { work(static_cast<std::ptrdiff_t>(i)); });
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        condition_.notify_all();
+        for (auto& worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    /** The number of threads, including the thread that calls `run`. */
+    std::size_t size() const
+    {
+        return workers_.size() + 1;
+    }
+
+    /** Calls `f(i)` for `i` in `[0, num_tasks)` and returns when all calls are done.
+    If `f` throws, the remaining calls are skipped and the first exception is rethrown.
+    */
+    template<typename Function>
+    void run(std::ptrdiff_t num_tasks, Function& f)
+    {
+        if (num_tasks <= 0)
+        {
+            return;
+        }
+        if (workers_.empty() || num_tasks == 1)
+        {
+            for (auto i = std::ptrdiff_t{0}; i < num_tasks; ++i)
+            {
+                f(i);
+            }
+            return;
+        }
+        job<Function> j(f, num_tasks);
+        push(task{ &j, 0, num_tasks });
+        const auto own = own_queue();
+        while (!j.done)
+        {
+            auto t = task{};
+            if (pop(own, t))
+            {
+                execute(t);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            ++sleeping_;
+            condition_.wait(lock, [&] { return j.done || queued_ > 0; });
+            --sleeping_;
+        }
+        if (j.error)
+        {
+            std::rethrow_exception(j.error);
+        }
+    }
+
+private:
+    struct job_base
+    {
+        explicit job_base(std::ptrdiff_t num_tasks) : remaining(num_tasks) {}
+        virtual ~job_base() = default;
+        virtual void call(std::ptrdiff_t i) = 0;
+
+        void run(std::ptrdiff_t i)
+        {
+            if (cancelled)
+            {
+                return;
+            }
+            try
+            {
+                call(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                cancelled = true;
+            }
+        }
+
+        std::atomic<std::ptrdiff_t> remaining;
+        std::atomic<bool> done{false};
+        std::atomic<bool> cancelled{false};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+    };
+
+    template<typename Function>
+    struct job : job_base
+    {
+        job(Function& f, std::ptrdiff_t num_tasks) : job_base(num_tasks), f(f) {}
+        void call(std::ptrdiff_t i) override { f(i); }
+        Function& f;
+    };
+
+    /** The indices `[first, last)` of a job. */
+    struct task
+    {
+        job_base* owner;
+        std::ptrdiff_t first;
+        std::ptrdiff_t last;
+    };
+
+    struct queue
+    {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    /** The worker that runs on the current thread. */
+    struct worker_context
+    {
+        const thread_pool* pool = nullptr;
+        std::ptrdiff_t index = -1;
+    };
+
+    static worker_context& context()
+    {
+        static thread_local worker_context c;
+        return c;
+    }
+
+    /** The index of the queue of the current thread, or -1 if it is not a worker of this pool. */
+    std::ptrdiff_t own_queue() const
+    {
+        return context().pool == this ? context().index : -1;
+    }
+
+    void work(std::ptrdiff_t index)
+    {
+        context().pool = this;
+        context().index = index;
+        for (;;)
+        {
+            auto t = task{};
+            if (pop(index, t))
+            {
+                execute(t);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            ++sleeping_;
+            condition_.wait(lock, [&] { return stop_ || queued_ > 0; });
+            --sleeping_;
+            if (stop_ && queued_ == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    /** Queues a task, and wakes a single thread if any is asleep.
+    The sleeping threads are counted under `mutex_` before they check `queued_`, and
+    `push` takes `mutex_` before the notification, so a wake up cannot get lost.
+    */
+    void push(const task& t)
+    {
+        auto index = own_queue();
+        if (index < 0)
+        {
+            index = static_cast<std::ptrdiff_t>(next_queue_++ % queues_.size());
+        }
+        {
+            std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+            queues_[index]->tasks.push_back(t);
+        }
+        ++queued_;
+        if (sleeping_ > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+            }
+            condition_.notify_one();
+        }
+    }
+
+    /** Takes a task from the back of the own queue, or steals one from the front of another queue. */
+    bool pop(std::ptrdiff_t own, task& t)
+    {
+        const auto num_queues = static_cast<std::ptrdiff_t>(queues_.size());
+        if (own >= 0)
+        {
+            std::lock_guard<std::mutex> lock(queues_[own]->mutex);
+            auto& tasks = queues_[own]->tasks;
+            if (!tasks.empty())
+            {
+                t = tasks.back();
+                tasks.pop_back();
+                --queued_;
+                return true;
+            }
+        }
+        const auto start = own >= 0 ? own + 1 : 0;
+        for (auto k = std::ptrdiff_t{0}; k < num_queues; ++k)
+        {
+            const auto victim = (start + k) % num_queues;
+            if (victim == own)
+            {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(queues_[victim]->mutex);
+            auto& tasks = queues_[victim]->tasks;
+            if (!tasks.empty())
+            {
+                t = tasks.front();
+                tasks.pop_front();
+                --queued_;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void execute(task t)
+    {
+        while (t.last - t.first > 1)
+        {
+            const auto middle = t.first + (t.last - t.first) / 2;
+            push(task{ t.owner, middle, t.last });
+            t.last = middle;
+        }
+        t.owner->run(t.first);
+        if (t.owner->remaining.fetch_sub(1) == 1)
+        {
+            // The caller of run can destroy the job as soon as it is done.
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                t.owner->done = true;
+            }
+            condition_.notify_all();
+        }
+    }
+
+    std::vector<std::unique_ptr<queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::atomic<std::ptrdiff_t> queued_{0};
+    std::atomic<std::ptrdiff_t> sleeping_{0};
+    std::atomic<std::size_t> next_queue_{0};
+    bool stop_ = false;
+};
+
+/** Returns the number of threads from `AAA_NUM_THREADS`, or else from the hardware. */
+inline std::size_t default_num_threads()
+{
+    const auto variable = std::getenv("AAA_NUM_THREADS");
+    if (variable != nullptr && std::atoi(variable) > 0)
+    {
+        return static_cast<std::size_t>(std::atoi(variable));
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/** The pool is read through `current` without a lock. The mutex is only taken
+to start the pool, or to restart it with another size.
+*/
+struct shared_thread_pool
+{
+    std::mutex mutex;
+    std::unique_ptr<thread_pool> pool;
+    std::atomic<thread_pool*> current{nullptr};
+    std::size_t num_threads = 0;
+};
+
+inline shared_thread_pool& shared_pool()
+{
+    static shared_thread_pool shared;
+    return shared;
+}
+
+/** Returns the thread pool that is used by the parallel algorithms. It is started on the first call. */
+inline thread_pool& default_thread_pool()
+{
+    auto& shared = shared_pool();
+    if (const auto pool = shared.current.load(std::memory_order_acquire))
+    {
+        return *pool;
+    }
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    if (!shared.pool)
+    {
+        const auto n = shared.num_threads > 0 ? shared.num_threads : default_num_threads();
+        shared.pool.reset(new thread_pool(n));
+        shared.current.store(shared.pool.get(), std::memory_order_release);
+    }
+    return *shared.pool;
+}
+
+/** Sets the number of threads of the shared pool, including the calling thread.
+The pool is restarted with the new size on its next use.
+It should not be called while a parallel algorithm is running.
+A value of 0 restores the default.
+*/
+inline void set_num_threads(std::size_t num_threads)
+{
+    auto& shared = shared_pool();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.num_threads = num_threads;
+    shared.current.store(nullptr, std::memory_order_release);
+    shared.pool.reset();
+}
+
+/** The number of threads that process the chunks of the parallel algorithms. */
+inline std::size_t num_threads()
+{
+    return default_thread_pool().size();
+}
+
+/** @} */
+
+} // namespace execution
+} // namespace aaa
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <type_traits>
 
@@ -23,6 +24,18 @@ template<>           struct sqrt_type<float> { using type = float; };
 template<>           struct sqrt_type<long double> { using type = long double; };
 template<typename T> using sqrt_type_t = typename sqrt_type<T>::type;
 
+/** The type in which the sums of the elements of type `T` are computed by default.
+The 8 bit integers are summed in `int32_t` and the 16 bit integers in `int64_t`,
+so that the products of two elements and the sums of many of them do not overflow.
+The product of two `uint16_t` already does not fit in `int32_t`.
+*/
+template<typename T> struct accumulator_type { using type = T; };
+template<>           struct accumulator_type<std::int8_t> { using type = std::int32_t; };
+template<>           struct accumulator_type<std::uint8_t> { using type = std::int32_t; };
+template<>           struct accumulator_type<std::int16_t> { using type = std::int64_t; };
+template<>           struct accumulator_type<std::uint16_t> { using type = std::int64_t; };
+template<typename T> using accumulator_type_t = typename accumulator_type<T>::type;
+
 
 // This is what we want. However, it requires Expression SFINAE, which is not
 // yet supported in MSVC, unless MSVC uses Clang.
@@ -60,6 +73,15 @@ using check_ratio = enable_if_same<A, B, C>;
 
 #endif
 
+/** Matches types that have a `value_type`, like containers. */
+template<typename Container>
+using check_container = value_type<Container>*;
+
+/** Matches a forwarding reference `T&&` that is bound to a non-const rvalue. */
+template<typename T>
+using check_rvalue = typename std::enable_if<
+    !std::is_lvalue_reference<T>::value && !std::is_const<T>::value, void*>::type;
+
 template<typename F, typename Input>
 using check_key = decltype(std::function<void(Input)>{std::declval<F>()})*;
 
@@ -1,5 +1,11 @@
+#include <atomic>
 #include <functional>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <random>
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 #include <array>
 #include <valarray>
@@ -16,6 +22,30 @@ void test_add();
 void test_subtract();
 void test_multiply();
 void test_divide();
+void test_simd();
+void test_simd_products();
+void test_accuracy();
+void test_row_distances();
+void test_pairwise_distances();
+void test_nearest_neighbors();
+void test_bounded_distances();
+void test_spatial_index();
+void test_quantized();
+void test_product_quantization();
+void test_hamming_space();
+void test_minkowski_space();
+void test_cosine_similarity();
+void test_kmeans();
+void test_lsh_index();
+void test_similarity_join();
+void test_statistics();
+void test_reduce_many();
+void test_lazy_expressions();
+void test_fused();
+void test_rvalue_and_inplace();
+void test_execution_policies();
+void test_thread_pool();
+void test_reproducible();
 void test_euclidean_space_operations();
 void test_manhattan_space_operations();
 void test_maximum_space_operations();
@@ -61,6 +91,54 @@ int main()
 	test_multiply();
     cout << "test_divide" << endl;
 	test_divide();
+    cout << "test_simd" << endl;
+    test_simd();
+    cout << "test_simd_products" << endl;
+    test_simd_products();
+    cout << "test_accuracy" << endl;
+    test_accuracy();
+    cout << "test_row_distances" << endl;
+    test_row_distances();
+    cout << "test_pairwise_distances" << endl;
+    test_pairwise_distances();
+    cout << "test_nearest_neighbors" << endl;
+    test_nearest_neighbors();
+    cout << "test_bounded_distances" << endl;
+    test_bounded_distances();
+    cout << "test_spatial_index" << endl;
+    test_spatial_index();
+    cout << "test_quantized" << endl;
+    test_quantized();
+    cout << "test_product_quantization" << endl;
+    test_product_quantization();
+    cout << "test_hamming_space" << endl;
+    test_hamming_space();
+    cout << "test_minkowski_space" << endl;
+    test_minkowski_space();
+    cout << "test_cosine_similarity" << endl;
+    test_cosine_similarity();
+    cout << "test_kmeans" << endl;
+    test_kmeans();
+    cout << "test_lsh_index" << endl;
+    test_lsh_index();
+    cout << "test_similarity_join" << endl;
+    test_similarity_join();
+    cout << "test_statistics" << endl;
+    test_statistics();
+    cout << "test_reduce_many" << endl;
+    test_reduce_many();
+    cout << "test_lazy_expressions" << endl;
+    test_lazy_expressions();
+    cout << "test_fused" << endl;
+    test_fused();
+    cout << "test_rvalue_and_inplace" << endl;
+    test_rvalue_and_inplace();
+    cout << "test_execution_policies" << endl;
+    test_execution_policies();
+    cout << "test_thread_pool" << endl;
+    test_thread_pool();
+    cout << "test_reproducible" << endl;
+    test_reproducible();
     cout << "test_euclidean_space_operations" << endl;
 	test_euclidean_space_operations();
     cout << "test_manhattan_space_operations" << endl;
@@ -467,6 +545,2173 @@ void test_divide()
 	assert_equal(aaa::divide(vi{8, 9}, vi{2, 3}), vi{4, 3});
 }
 
+template<typename T>
+void test_simd_type()
+{
+    using namespace aaa;
+
+    for (size_t n = 0; n < 70; ++n)
+    {
+        auto left = std::vector<T>(n);
+        auto right = std::vector<T>(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            left[i] = static_cast<T>(3 * i + 1);
+            right[i] = static_cast<T>(i % 7 + 1);
+        }
+        const auto scalar = T{ 3 };
+
+        auto out = std::vector<T>(n);
+        auto expected = std::vector<T>(n);
+
+        add(left, right, out);
+        std::transform(left.begin(), left.end(), right.begin(), expected.begin(), [](T a, T b) { return T(a + b); });
+        assert_equal(out, expected);
+
+        subtract(scalar, right, out);
+        std::transform(right.begin(), right.end(), expected.begin(), [&](T b) { return T(scalar - b); });
+        assert_equal(out, expected);
+
+        multiply(left, scalar, out);
+        std::transform(left.begin(), left.end(), expected.begin(), [&](T a) { return T(a * scalar); });
+        assert_equal(out, expected);
+
+        subtract(left.data(), left.data() + n, right.data(), out.data());
+        std::transform(left.begin(), left.end(), right.begin(), expected.begin(), [](T a, T b) { return T(a - b); });
+        assert_equal(out, expected);
+
+        auto valarray_out = std::valarray<T>(n);
+        multiply(left, right, valarray_out);
+        std::transform(left.begin(), left.end(), right.begin(), expected.begin(), [](T a, T b) { return T(a * b); });
+        assert_equal(std::vector<T>(begin(valarray_out), end(valarray_out)), expected);
+    }
+}
+
+template<typename T>
+void test_simd_reductions_type()
+{
+    for (size_t n = 0; n < 200; n += 7)
+    {
+        auto left = std::vector<T>(n);
+        auto right = std::vector<T>(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            left[i] = static_cast<T>((i * 37) % 101);
+            right[i] = static_cast<T>(i % 5);
+        }
+        if (n > 3)
+        {
+            left[n / 3] = T{ 0 };
+            left[n / 2] = static_cast<T>(120);
+        }
+
+        assert_equal(aaa::sum(left), std::accumulate(left.begin(), left.end(), T{}));
+        // An init of type T selects the kernels that accumulate in T, like the references.
+        assert_equal(aaa::euclidean::dot(left, right, T{}), std::inner_product(left.begin(), left.end(), right.begin(), T{}));
+        assert_equal(aaa::euclidean::squared_distance(left, right, T{}), std::inner_product(left.begin(), left.end(), right.begin(), T{},
+            [](T a, T b) { return T(a + b); }, [](T a, T b) { return T((a - b) * (a - b)); }));
+        assert_equal(aaa::min_element(left), std::min_element(left.begin(), left.end()));
+        assert_equal(aaa::max_element(left), std::max_element(left.begin(), left.end()));
+    }
+}
+
+void test_simd()
+{
+    using namespace std;
+    cout << "simd level " << aaa::simd::simd_level_name(aaa::simd::active_simd_level()) << endl;
+    assert(aaa::simd::active_simd_level() <= aaa::simd::detect_simd_level());
+
+    test_simd_reductions_type<int8_t>();
+    test_simd_reductions_type<uint8_t>();
+    test_simd_reductions_type<int16_t>();
+    test_simd_reductions_type<uint16_t>();
+    test_simd_reductions_type<int32_t>();
+    test_simd_reductions_type<uint32_t>();
+    test_simd_reductions_type<int64_t>();
+    test_simd_reductions_type<uint64_t>();
+
+    const auto nan = std::numeric_limits<double>::quiet_NaN();
+    const auto with_nan = std::vector<double>{ 3, nan, 1, 2, 5, 1, nan, 4, 0.5, 9, 9 };
+    assert_equal(aaa::min_element(with_nan), with_nan.begin() + 8);
+    assert_equal(aaa::max_element(with_nan), with_nan.begin() + 9);
+    const auto first_nan = std::vector<double>{ nan, 3, 1, 2, 5, 1, 7, 4, 0.5, 9 };
+    assert_equal(aaa::min_element(first_nan), first_nan.begin());
+    assert_equal(aaa::max_element(first_nan), first_nan.begin());
+    const auto floats = std::vector<float>{ 0.f, -0.f, 2.f, -3.f, 7.f, -3.f, 7.f, 1.f, 1.f };
+    assert_equal(aaa::min_element(floats), floats.begin() + 3);
+    assert_equal(aaa::max_element(floats), floats.begin() + 4);
+
+    test_simd_type<float>();
+    test_simd_type<double>();
+    test_simd_type<int8_t>();
+    test_simd_type<uint8_t>();
+    test_simd_type<int16_t>();
+    test_simd_type<int32_t>();
+    test_simd_type<uint32_t>();
+    test_simd_type<int64_t>();
+
+    auto in = std::vector<float>{ 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f, 9.f };
+    auto out = std::vector<float>(in.size());
+    aaa::divide(in.data(), in.data() + in.size(), in.data(), out.data());
+    assert_equal(out, std::vector<float>(in.size(), 1.f));
+    aaa::divide(1.f, in, out);
+    assert_equal(out[3], 0.25f);
+
+    // Mixed scalar types.
+    aaa::divide(in, 2, out);
+    assert_equal(out[8], 4.5f);
+    aaa::multiply(0.1, in, out);
+    assert_equal(out[8], float(0.1 * 9.f));
+
+    auto in8 = std::vector<int8_t>(33, 100);
+    auto out8 = std::vector<int8_t>(33);
+    aaa::add(in8, 100, out8);
+    assert_equal(out8[32], int8_t(200));
+}
+
+template<typename T>
+void test_simd_products_type()
+{
+    for (size_t n = 0; n < 300; n += 13)
+    {
+        auto left = std::vector<T>(n);
+        auto right = std::vector<T>(n);
+        auto dot = 0.0L;
+        auto squared_distance = 0.0L;
+        for (size_t i = 0; i < n; ++i)
+        {
+            left[i] = T(1) / T(i + 1);
+            right[i] = T(i % 17) - T(8.5);
+            dot += static_cast<long double>(left[i]) * right[i];
+            squared_distance += (static_cast<long double>(left[i]) - right[i]) * (static_cast<long double>(left[i]) - right[i]);
+        }
+        const auto tolerance = 1e-5L * (1 + squared_distance);
+        assert(std::abs(aaa::euclidean::dot(left, right) - dot) < tolerance);
+        assert(std::abs(aaa::euclidean::squared_distance(left, right) - squared_distance) < tolerance);
+        assert(std::abs(aaa::euclidean::squared_distance(left, right, T(1)) - squared_distance - 1) < tolerance);
+    }
+}
+
+template<typename T, typename Wide>
+void test_simd_widening_type()
+{
+    // The products and differences do not fit in T, but the sums of up to 100 of them fit in Wide.
+    const auto high = T(std::numeric_limits<T>::max() / 8);
+    const auto low = T(std::numeric_limits<T>::min() / 8);
+    for (size_t n = 0; n < 100; n += 9)
+    {
+        auto left = std::vector<T>(n);
+        auto right = std::vector<T>(n);
+        auto dot = Wide{};
+        auto squared_distance = Wide{};
+        for (size_t i = 0; i < n; ++i)
+        {
+            left[i] = i % 3 == 0 ? high : T(i * 7 % 50);
+            right[i] = i % 4 == 0 ? low : T(i % 9);
+            dot = Wide(dot + Wide(left[i]) * Wide(right[i]));
+            const auto difference = Wide(Wide(left[i]) - Wide(right[i]));
+            squared_distance = Wide(squared_distance + difference * difference);
+        }
+        // An accumulator of type T would wrap around.
+        if (n > 0)
+        {
+            assert(squared_distance > Wide(std::numeric_limits<T>::max()));
+            assert(dot < Wide(std::numeric_limits<T>::min()));
+        }
+        assert_equal(aaa::euclidean::dot(left, right, Wide{}), dot);
+        assert_equal(aaa::euclidean::squared_distance(left, right, Wide{}), squared_distance);
+        assert_equal(aaa::euclidean::squared_norm(right, Wide{5}), Wide(5 + aaa::euclidean::dot(right, right, Wide{})));
+    }
+}
+
+void test_simd_products()
+{
+    test_simd_products_type<float>();
+    test_simd_products_type<double>();
+    test_simd_widening_type<int16_t, int64_t>();
+    test_simd_widening_type<int32_t, int64_t>();
+
+    // The products of 16 bit integers do not fit in int32_t, so they are summed in int64_t by default.
+    const auto zeros = std::vector<uint16_t>(64);
+    const auto highest = std::vector<uint16_t>(64, 65535);
+    static_assert(std::is_same<decltype(aaa::euclidean::dot(zeros, highest)), std::int64_t>::value, "");
+    assert_equal(aaa::euclidean::squared_distance(zeros, highest), std::int64_t{64} * 65535 * 65535);
+    assert_equal(aaa::euclidean::dot(highest, highest), std::int64_t{64} * 65535 * 65535);
+    assert_equal(aaa::simd::squared_distance(zeros.begin(), zeros.end(), highest.begin(), std::int64_t{0}, std::false_type{}),
+        std::int64_t{64} * 65535 * 65535);
+    const auto lowest = std::vector<int16_t>(67, -32768);
+    const auto top = std::vector<int16_t>(67, 32767);
+    assert_equal(aaa::euclidean::dot(lowest, lowest), std::int64_t{67} * 32768 * 32768);
+    assert_equal(aaa::euclidean::squared_distance(lowest, top), std::int64_t{67} * 65535 * 65535);
+
+    // All the kernels give the same exact result for integers.
+#if AAA_SIMD
+    using namespace aaa::simd;
+    auto left = std::vector<int32_t>(77);
+    auto right = std::vector<int32_t>(77);
+    for (auto i = 0; i < 77; ++i)
+    {
+        // The squared differences do not fit in 32 bits, and their sum fits in 64 bits.
+        left[i] = (i % 2 == 0 ? 1 : -1) * (300000000 - i);
+        right[i] = i * 1000;
+    }
+    const auto expected = scalar::widening_squared_distance(left.data(), right.data(), left.size());
+    assert_equal(sse42::widening_squared_distance(left.data(), right.data(), left.size()), expected);
+    if (detect_simd_level() >= simd_level::avx2)
+    {
+        assert_equal(avx2::widening_squared_distance(left.data(), right.data(), left.size()), expected);
+    }
+    if (detect_simd_level() >= simd_level::avx512)
+    {
+        assert_equal(avx512::widening_squared_distance(left.data(), right.data(), left.size()), expected);
+    }
+
+    // Pairs of products of -32768 * -32768 overflow the multiply-add of int16 to int32.
+    auto shorts = std::vector<int16_t>(141);
+    auto ushorts = std::vector<uint16_t>(141);
+    for (auto i = 0; i < 141; ++i)
+    {
+        shorts[i] = i % 5 == 4 ? int16_t(i * 13) : i % 5 < 2 ? int16_t(-32768) : int16_t(32767);
+        ushorts[i] = uint16_t(65535 - i * (i % 3));
+    }
+    const auto reversed_shorts = std::vector<int16_t>(shorts.rbegin(), shorts.rend());
+    const auto reversed_ushorts = std::vector<uint16_t>(ushorts.rbegin(), ushorts.rend());
+    const auto check_shorts = [&](auto dot, auto squared_distance, auto udot, auto usquared_distance)
+    {
+        for (const auto size : { 0, 7, 64, 65, 141 })
+        {
+            const auto n = std::size_t(size);
+            assert_equal(dot(shorts.data(), shorts.data(), n), scalar::widening_dot(shorts.data(), shorts.data(), n));
+            assert_equal(dot(shorts.data(), reversed_shorts.data(), n), scalar::widening_dot(shorts.data(), reversed_shorts.data(), n));
+            assert_equal(squared_distance(shorts.data(), reversed_shorts.data(), n),
+                scalar::widening_squared_distance(shorts.data(), reversed_shorts.data(), n));
+            assert_equal(udot(ushorts.data(), reversed_ushorts.data(), n), scalar::widening_dot(ushorts.data(), reversed_ushorts.data(), n));
+            assert_equal(usquared_distance(ushorts.data(), reversed_ushorts.data(), n),
+                scalar::widening_squared_distance(ushorts.data(), reversed_ushorts.data(), n));
+        }
+    };
+    using short_kernel = std::int64_t (*)(const int16_t*, const int16_t*, std::size_t);
+    using ushort_kernel = std::int64_t (*)(const uint16_t*, const uint16_t*, std::size_t);
+    check_shorts(short_kernel(&sse42::widening_dot), short_kernel(&sse42::widening_squared_distance),
+        ushort_kernel(&sse42::widening_dot), ushort_kernel(&sse42::widening_squared_distance));
+    if (detect_simd_level() >= simd_level::avx2)
+    {
+        check_shorts(short_kernel(&avx2::widening_dot), short_kernel(&avx2::widening_squared_distance),
+            ushort_kernel(&avx2::widening_dot), ushort_kernel(&avx2::widening_squared_distance));
+    }
+    if (detect_simd_level() >= simd_level::avx512)
+    {
+        check_shorts(short_kernel(&avx512::widening_dot), short_kernel(&avx512::widening_squared_distance),
+            ushort_kernel(&avx512::widening_dot), ushort_kernel(&avx512::widening_squared_distance));
+    }
+#endif
+}
+
+template<typename Policy>
+void test_accuracy_policy(Policy policy)
+{
+    // The naive sum of a million 0.1f is off by about 1%.
+    const auto n = 1000000 + 37;
+    auto in = std::vector<float>(n, 0.1f);
+    const auto exact = static_cast<long double>(0.1f) * n;
+    const auto is_pairwise = std::is_same<Policy, aaa::accuracy::pairwise_policy>::value;
+    const auto tolerance = (is_pairwise ? 1e-5L : 1e-6L) * exact;
+    assert(std::abs(aaa::sum(in) - exact) > 1e-3L * exact);
+    assert(std::abs(aaa::sum(policy, in) - exact) < tolerance);
+    assert(std::abs(aaa::euclidean::squared_norm(policy, in) - exact * 0.1f) < tolerance);
+    assert(std::abs(aaa::sum(policy, in, 1.f) - exact - 1) < tolerance);
+
+    // Non contiguous containers and integers.
+    const auto small = std::valarray<double>{ 1e16, 1.0, -1e16, 1.0 };
+    assert(aaa::sum(policy, small) == 2.0 || is_pairwise);
+    // The squares do not fit in int, so they are added in long long.
+    auto ints = std::vector<int>(5000);
+    std::iota(ints.begin(), ints.end(), -2000);
+    assert_equal(aaa::sum(policy, ints), aaa::sum(ints));
+    assert_equal(aaa::euclidean::dot(policy, ints, ints, 0LL), 11664167500LL);
+    assert_equal(aaa::sum(policy, std::vector<double>{}, 3.0), 3.0);
+}
+
+template<typename T>
+void test_dot2_type()
+{
+    // 4097 * 4097 is not exact in float, and 134217729 * 134217729 not in double.
+    const auto big = T(std::ldexp(1.0, (std::numeric_limits<T>::digits + 1) / 2) + 1);
+    const auto expected = T(2 * big);
+    for (auto n : { 3, 67, 300 })
+    {
+        auto left = std::vector<T>(n);
+        auto right = std::vector<T>(n);
+        left[n / 2] = big;
+        right[n / 2] = big;
+        left[n - 1] = -big;
+        right[n - 1] = big - 2;
+        assert_equal(aaa::euclidean::dot(aaa::accuracy::dot2, left, right), expected);
+        assert(aaa::euclidean::dot(left, right) != expected);
+        const auto valarray_left = std::valarray<T>(left.data(), left.size());
+        const auto valarray_right = std::valarray<T>(right.data(), right.size());
+        assert_equal(aaa::euclidean::dot(aaa::accuracy::dot2, valarray_left, valarray_right), expected);
+
+        // All the instruction sets give the exact result.
+#if AAA_SIMD
+        using namespace aaa::simd;
+        using aaa::operations::multiplies;
+        const auto tag = aaa::accuracy::dot2_summation{};
+        assert_equal(scalar::accurate_sum<multiplies>(tag, left.data(), right.data(), left.size(), T{}), expected);
+        assert_equal(sse42::accurate_sum<multiplies>(tag, left.data(), right.data(), left.size(), T{}), expected);
+        if (detect_simd_level() >= simd_level::avx2)
+        {
+            assert_equal(avx2::accurate_sum<multiplies>(tag, left.data(), right.data(), left.size(), T{}), expected);
+        }
+        if (detect_simd_level() >= simd_level::avx512)
+        {
+            assert_equal(avx512::accurate_sum<multiplies>(tag, left.data(), right.data(), left.size(), T{}), expected);
+        }
+#endif
+    }
+}
+
+void test_accuracy()
+{
+    test_accuracy_policy(aaa::accuracy::pairwise);
+    test_accuracy_policy(aaa::accuracy::compensated);
+    test_accuracy_policy(aaa::accuracy::dot2);
+    test_dot2_type<float>();
+    test_dot2_type<double>();
+
+    // The large values cancel, and the small ones are not lost.
+    auto in = std::vector<double>(1000, 0.1);
+    in[500] = 1e20;
+    in[999] = -1e20;
+    assert(std::abs(aaa::sum(aaa::accuracy::compensated, in) - 99.8) < 1e-9);
+    assert(std::abs(aaa::sum(in) - 99.8) > 1);
+}
+
+template<typename T>
+void test_row_distances_type()
+{
+    // 7 rows cover a block of four rows and three single rows, and 13 elements leave a tail.
+    const auto dimension = std::size_t{13};
+    const auto num_rows = std::size_t{7};
+    auto query = std::vector<T>(dimension);
+    auto matrix = std::vector<T>(dimension * num_rows);
+    for (auto i = std::size_t{0}; i < dimension; ++i)
+    {
+        query[i] = T(i % 5) - T(1.5);
+    }
+    for (auto i = std::size_t{0}; i < matrix.size(); ++i)
+    {
+        matrix[i] = T(i % 7) * T(0.5) - T(1);
+    }
+    auto out = std::vector<T>(num_rows);
+    const auto row = [&](std::size_t r) { return matrix.begin() + r * dimension; };
+    const auto tolerance = T(1e-4);
+
+    aaa::euclidean::squared_distances(query, matrix, out);
+    for (auto r = std::size_t{0}; r < num_rows; ++r)
+    {
+        assert(std::abs(out[r] - aaa::euclidean::squared_distance(query.begin(), query.end(), row(r))) < tolerance);
+    }
+    aaa::euclidean::distances(query, matrix, out);
+    for (auto r = std::size_t{0}; r < num_rows; ++r)
+    {
+        assert(std::abs(out[r] - aaa::euclidean::distance(query.begin(), query.end(), row(r))) < tolerance);
+    }
+    aaa::manhattan::distances(query, matrix, out);
+    for (auto r = std::size_t{0}; r < num_rows; ++r)
+    {
+        assert(std::abs(out[r] - aaa::manhattan::distance(query.begin(), query.end(), row(r))) < tolerance);
+    }
+    aaa::manhattan::squared_distances(query, matrix, out);
+    for (auto r = std::size_t{0}; r < num_rows; ++r)
+    {
+        assert(std::abs(out[r] - aaa::manhattan::squared_distance(query.begin(), query.end(), row(r))) < tolerance);
+    }
+    aaa::maximum::distances(query, matrix, out);
+    for (auto r = std::size_t{0}; r < num_rows; ++r)
+    {
+        assert_equal(out[r], aaa::maximum::distance(query.begin(), query.end(), row(r)));
+    }
+
+    // All the instruction sets give the same maximum distances.
+#if AAA_SIMD
+    using namespace aaa::simd;
+    using aaa::operations::absolute_difference;
+    auto expected = std::vector<T>(num_rows);
+    scalar::tile_distances<maximum, absolute_difference>(query.data(), 1, matrix.data(), num_rows, dimension, expected.data(), num_rows);
+    assert_equal(out, expected);
+    sse42::tile_distances<maximum, absolute_difference>(query.data(), 1, matrix.data(), num_rows, dimension, out.data(), num_rows);
+    assert_equal(out, expected);
+    if (detect_simd_level() >= simd_level::avx2)
+    {
+        avx2::tile_distances<maximum, absolute_difference>(query.data(), 1, matrix.data(), num_rows, dimension, out.data(), num_rows);
+        assert_equal(out, expected);
+    }
+    if (detect_simd_level() >= simd_level::avx512)
+    {
+        avx512::tile_distances<maximum, absolute_difference>(query.data(), 1, matrix.data(), num_rows, dimension, out.data(), num_rows);
+        assert_equal(out, expected);
+    }
+#endif
+}
+
+void test_row_distances()
+{
+    test_row_distances_type<float>();
+    test_row_distances_type<double>();
+
+    // Integers and other containers use the generic loop.
+    const auto query = vi{ 1, -2, 3 };
+    const auto matrix = std::valarray<int>{ 1, -2, 3, 0, 0, 0, 4, 4, -4 };
+    auto out = std::array<int, 3>{};
+    aaa::euclidean::squared_distances(query, matrix, out);
+    assert_equal(out, std::array<int, 3>{{ 0, 14, 94 }});
+    aaa::manhattan::distances(query, matrix, out);
+    assert_equal(out, std::array<int, 3>{{ 0, 6, 16 }});
+    aaa::maximum::distances(query, matrix, out);
+    assert_equal(out, std::array<int, 3>{{ 0, 3, 7 }});
+
+    // Unsigned differences do not wrap.
+    const auto unsigned_query = std::vector<unsigned>{ 1, 5 };
+    const auto unsigned_matrix = std::vector<unsigned>{ 3, 2 };
+    auto unsigned_out = std::vector<unsigned>(1);
+    aaa::manhattan::distances(unsigned_query, unsigned_matrix, unsigned_out);
+    assert_equal(unsigned_out, std::vector<unsigned>{ 5 });
+
+    // An empty matrix.
+    auto empty = std::vector<double>{};
+    aaa::euclidean::distances(std::vector<double>{ 1, 2 }, std::vector<double>{}, empty);
+}
+
+template<typename T>
+void test_pairwise_distances_type()
+{
+    // More rows than a tile in both matrices. The values are exact in T, so the
+    // dot product formulation of the Euclidean distances gives exact results.
+    const auto dimension = std::size_t{5};
+    const auto num_a = aaa::pairwise::tile_rows + 6;
+    const auto num_b = aaa::pairwise::tile_columns<T>(dimension) + 3;
+    auto a = std::vector<T>(num_a * dimension);
+    auto b = std::vector<T>(num_b * dimension);
+    for (auto i = std::size_t{0}; i < a.size(); ++i)
+    {
+        a[i] = T(i * 7 % 11) * T(0.5) - T(2);
+    }
+    for (auto i = std::size_t{0}; i < b.size(); ++i)
+    {
+        b[i] = T(i * 5 % 13) * T(0.5) - T(3);
+    }
+    const auto row_a = [&](std::size_t i) { return a.begin() + i * dimension; };
+    const auto row_b = [&](std::size_t j) { return b.begin() + j * dimension; };
+
+    auto out = std::vector<T>(num_a * num_b);
+    auto parallel_out = std::vector<T>(num_a * num_b);
+    aaa::euclidean::pairwise_squared_distances(a, b, dimension, out);
+    aaa::euclidean::pairwise_squared_distances(aaa::execution::par, a, b, dimension, parallel_out);
+    assert_equal(out, parallel_out);
+    for (auto i = std::size_t{0}; i < num_a; ++i)
+    {
+        for (auto j = std::size_t{0}; j < num_b; ++j)
+        {
+            assert_equal(out[i * num_b + j], aaa::euclidean::squared_distance(row_a(i), row_a(i) + dimension, row_b(j)));
+        }
+    }
+    aaa::manhattan::pairwise_distances(aaa::execution::par, a, b, dimension, out);
+    aaa::maximum::pairwise_squared_distances(a, b, dimension, parallel_out);
+    for (auto i = std::size_t{0}; i < num_a; ++i)
+    {
+        for (auto j = std::size_t{0}; j < num_b; ++j)
+        {
+            assert_equal(out[i * num_b + j], aaa::manhattan::distance(row_a(i), row_a(i) + dimension, row_b(j)));
+            assert_equal(parallel_out[i * num_b + j], aaa::maximum::squared_distance(row_a(i), row_a(i) + dimension, row_b(j)));
+        }
+    }
+
+    // The condensed distances of the pairs i < j, with some equal rows.
+    std::copy(row_a(0), row_a(1), row_a(num_a - 1));
+    auto condensed = std::vector<T>(num_a * (num_a - 1) / 2);
+    auto full = std::vector<T>(num_a * num_a);
+    aaa::euclidean::pdist(a, dimension, condensed);
+    aaa::euclidean::pairwise_distances(a, a, dimension, full);
+    auto k = std::size_t{0};
+    for (auto i = std::size_t{0}; i < num_a; ++i)
+    {
+        assert_equal(full[i * num_a + i], T(0));
+        for (auto j = i + 1; j < num_a; ++j, ++k)
+        {
+            assert_equal(condensed[k], full[i * num_a + j]);
+        }
+    }
+    assert_equal(condensed[num_a - 2], T(0));
+    aaa::maximum::pdist(aaa::execution::par, a, dimension, condensed);
+    aaa::maximum::pairwise_distances(a, a, dimension, full);
+    k = 0;
+    for (auto i = std::size_t{0}; i < num_a; ++i)
+    {
+        for (auto j = i + 1; j < num_a; ++j, ++k)
+        {
+            assert_equal(condensed[k], full[i * num_a + j]);
+        }
+    }
+}
+
+void test_pairwise_distances()
+{
+    test_pairwise_distances_type<float>();
+    test_pairwise_distances_type<double>();
+
+    // Integers and other containers use the generic loops.
+    const auto a = std::valarray<int>{ 0, 0, 1, 2, 3, -1 };
+    auto out = vi(9);
+    aaa::euclidean::pairwise_squared_distances(a, a, 2, out);
+    assert_equal(out, vi{ 0, 5, 10, 5, 0, 13, 10, 13, 0 });
+    auto condensed = vi(3);
+    aaa::manhattan::squared_pdist(a, 2, condensed);
+    assert_equal(condensed, vi{ 9, 16, 25 });
+    aaa::maximum::pdist(aaa::execution::par, a, 2, condensed);
+    assert_equal(condensed, vi{ 2, 3, 3 });
+
+    // A single row has no pairs.
+    auto empty = std::vector<double>{};
+    aaa::euclidean::pdist(std::vector<double>{ 1, 2 }, 2, empty);
+}
+
+template<typename T>
+void test_nearest_neighbors_type()
+{
+    // Enough rows for several parts of the dataset, and two blocks of queries.
+    const auto dimension = std::size_t{7};
+    const auto num_data = 3 * aaa::neighbors::min_part_rows + 5;
+    const auto num_queries = aaa::pairwise::tile_rows + 3;
+    const auto k = std::size_t{6};
+    auto data = std::vector<T>(num_data * dimension);
+    auto queries = std::vector<T>(num_queries * dimension);
+    for (auto i = std::size_t{0}; i < data.size(); ++i)
+    {
+        data[i] = T(i * 7 % 23) * T(0.25);
+    }
+    for (auto i = std::size_t{0}; i < queries.size(); ++i)
+    {
+        queries[i] = T(i * 5 % 19) * T(0.25);
+    }
+    // Some rows are equal, so that the order of equal distances is tested.
+    std::copy(data.begin(), data.begin() + dimension, data.end() - dimension);
+
+    auto indices = std::vector<std::size_t>(num_queries * k);
+    auto distances = std::vector<T>(num_queries * k);
+    auto parallel_indices = std::vector<std::size_t>(num_queries * k);
+    auto parallel_distances = std::vector<T>(num_queries * k);
+    aaa::euclidean::nearest_neighbors(data, queries, dimension, k, indices, distances);
+    aaa::execution::set_num_threads(8);
+    aaa::euclidean::nearest_neighbors(aaa::execution::par, data, queries, dimension, k, parallel_indices, parallel_distances);
+    aaa::execution::set_num_threads(0);
+    assert_equal(indices, parallel_indices);
+    assert_equal(distances, parallel_distances);
+
+    for (auto q = std::size_t{0}; q < num_queries; ++q)
+    {
+        const auto query = queries.begin() + q * dimension;
+        auto all = std::vector<std::pair<T, std::size_t>>(num_data);
+        for (auto i = std::size_t{0}; i < num_data; ++i)
+        {
+            all[i] = { aaa::euclidean::squared_distance(query, query + dimension, data.begin() + i * dimension), i };
+        }
+        std::sort(all.begin(), all.end());
+        for (auto n = std::size_t{0}; n < k; ++n)
+        {
+            assert_equal(indices[q * k + n], all[n].second);
+            assert(std::abs(distances[q * k + n] - std::sqrt(all[n].first)) < T(1e-3));
+        }
+    }
+
+    aaa::maximum::nearest_neighbors(aaa::execution::par, data, queries, dimension, k, indices, distances);
+    for (auto q = std::size_t{0}; q < num_queries; ++q)
+    {
+        const auto query = queries.begin() + q * dimension;
+        auto all = std::vector<std::pair<T, std::size_t>>(num_data);
+        for (auto i = std::size_t{0}; i < num_data; ++i)
+        {
+            all[i] = { aaa::maximum::distance(query, query + dimension, data.begin() + i * dimension), i };
+        }
+        std::sort(all.begin(), all.end());
+        for (auto n = std::size_t{0}; n < k; ++n)
+        {
+            assert_equal(indices[q * k + n], all[n].second);
+            assert_equal(distances[q * k + n], all[n].first);
+        }
+    }
+}
+
+void test_nearest_neighbors()
+{
+    test_nearest_neighbors_type<float>();
+    test_nearest_neighbors_type<double>();
+
+    // Integers use the generic loops. Equal distances are ordered by index.
+    const auto data = vi{ 0, 0, 4, 0, 2, 1, 0, 4, -1, 0 };
+    const auto queries = vi{ 0, 0, 2, 2 };
+    auto indices = std::vector<int>(6);
+    auto distances = vi(6);
+    aaa::manhattan::nearest_neighbors(data, queries, 2, 3, indices, distances);
+    assert_equal(indices, vi{ 0, 4, 2, 2, 0, 1 });
+    assert_equal(distances, vi{ 0, 1, 3, 1, 4, 4 });
+
+    // No neighbors.
+    auto no_indices = std::vector<int>{};
+    auto no_distances = vi{};
+    aaa::manhattan::nearest_neighbors(data, queries, 2, 0, no_indices, no_distances);
+
+    // Close points with large norms, where the norms and the dot products cancel.
+    auto far_data = std::vector<float>{};
+    for (auto i = 0; i < 8; ++i)
+    {
+        far_data.push_back(10000 + 0.01f * float(8 - i));
+        far_data.push_back(10000);
+    }
+    auto far_indices = std::vector<std::size_t>(3);
+    auto far_distances = std::vector<float>(3);
+    const auto far_query = std::vector<float>{ 10000, 10000 };
+    aaa::euclidean::nearest_neighbors(far_data, far_query, 2, 3, far_indices, far_distances);
+    assert_equal(far_indices, std::vector<std::size_t>{ 7, 6, 5 });
+    assert(far_distances[0] > 0 && far_distances[0] < far_distances[1] && far_distances[1] < far_distances[2]);
+}
+
+template<typename T>
+void test_bounded_distances_type()
+{
+    // Sizes around the blocks and the registers of the kernels.
+    for (const auto size : { 0, 1, 7, 64, 127, 128, 129, 1000, 2048 })
+    {
+        auto a = std::vector<T>(size);
+        auto b = std::vector<T>(size);
+        for (auto i = 0; i < size; ++i)
+        {
+            a[i] = T(i % 13) * T(0.5);
+            b[i] = T(i % 7) * T(0.25);
+        }
+        const auto squared = aaa::euclidean::squared_distance(a, b);
+        const auto manhattan = aaa::manhattan::distance(a, b);
+        const auto maximum = aaa::maximum::distance(a, b);
+        const auto tolerance = T(1e-3) * (T(1) + squared);
+
+        // The bound is not reached.
+        assert(std::abs(aaa::euclidean::squared_distance_bounded(a, b, squared) - squared) < tolerance);
+        assert(std::abs(aaa::manhattan::distance_bounded(a, b, manhattan + T(1)) - manhattan) < tolerance);
+        assert_equal(aaa::maximum::distance_bounded(a, b, maximum), maximum);
+
+        // The bound is reached, and the partial distance is returned.
+        const auto bound = T(0.1);
+        if (squared > bound)
+        {
+            const auto partial = aaa::euclidean::squared_distance_bounded(a, b, bound);
+            assert(partial > bound && partial < squared + tolerance);
+        }
+        if (manhattan > bound)
+        {
+            const auto partial = aaa::manhattan::distance_bounded(a, b, bound);
+            assert(partial > bound && partial < manhattan + tolerance);
+        }
+        if (maximum > bound)
+        {
+            const auto partial = aaa::maximum::distance_bounded(a, b, bound);
+            assert(partial > bound && partial <= maximum);
+        }
+    }
+}
+
+void test_bounded_distances()
+{
+    test_bounded_distances_type<float>();
+    test_bounded_distances_type<double>();
+
+    // The generic loop checks the sums after each block, and the maximum after each element.
+    const auto ones = vi(1000, 1);
+    const auto zeros = vi(1000, 0);
+    const auto block = static_cast<int>(aaa::simd::bound_check_size<aaa::operations::plus>::value);
+    assert_equal(aaa::manhattan::distance_bounded(ones, zeros, 1000), 1000);
+    assert_equal(aaa::manhattan::distance_bounded(ones, zeros, 10), block);
+    assert_equal(aaa::euclidean::squared_distance_bounded(ones, zeros, 10), block);
+    assert_equal(aaa::maximum::distance_bounded(vi{ 0, 2, 5, 9 }, vi{ 0, 0, 0, 0 }, 3), 5);
+    assert_equal(aaa::maximum::distance_bounded(vi{ 0, 2, 5, 9 }, vi{ 0, 0, 0, 0 }, 9), 9);
+}
+
+/** The k nearest points by brute force, ordered by distance and then by index. */
+template<typename T, typename Distance>
+std::vector<std::pair<T, std::uint32_t>> brute_force_nearest(const std::vector<T>& points, const T* query,
+    std::size_t dimension, Distance distance)
+{
+    auto all = std::vector<std::pair<T, std::uint32_t>>{};
+    for (auto i = std::size_t{0}; i < points.size() / dimension; ++i)
+    {
+        all.emplace_back(distance(points.data() + i * dimension, points.data() + (i + 1) * dimension, query),
+            static_cast<std::uint32_t>(i));
+    }
+    std::sort(all.begin(), all.end());
+    return all;
+}
+
+template<typename Tree, typename T, typename Distance>
+void test_spatial_tree(const Tree& tree, const std::vector<T>& points, const std::vector<T>& queries,
+    std::size_t dimension, T radius, Distance distance)
+{
+    const auto k = std::size_t{5};
+    const auto num_queries = queries.size() / dimension;
+    auto indices = std::vector<std::uint32_t>(num_queries * k);
+    auto distances = std::vector<T>(num_queries * k);
+    aaa::spatial::nearest_neighbors(tree, queries, k, indices, distances);
+    auto parallel_indices = std::vector<std::uint32_t>(num_queries * k);
+    auto parallel_distances = std::vector<T>(num_queries * k);
+    aaa::spatial::nearest_neighbors(aaa::execution::par, tree, queries, k, parallel_indices, parallel_distances);
+    assert_equal(indices, parallel_indices);
+    assert_equal(distances, parallel_distances);
+
+    auto offsets = std::vector<std::size_t>{};
+    auto found = std::vector<std::uint32_t>{};
+    auto found_distances = std::vector<T>{};
+    aaa::spatial::radius_neighbors(aaa::execution::par, tree, queries, radius, offsets, found, found_distances);
+    assert_equal(offsets.size(), num_queries + 1);
+    assert_equal(offsets.back(), found.size());
+
+    for (auto q = std::size_t{0}; q < num_queries; ++q)
+    {
+        const auto all = brute_force_nearest(points, queries.data() + q * dimension, dimension, distance);
+        for (auto n = std::size_t{0}; n < k; ++n)
+        {
+            assert_equal(indices[q * k + n], all[n].second);
+            assert_equal(distances[q * k + n], all[n].first);
+        }
+        auto expected = std::vector<std::pair<std::uint32_t, T>>{};
+        for (const auto& candidate : all)
+        {
+            if (candidate.first <= radius)
+            {
+                expected.emplace_back(candidate.second, candidate.first);
+            }
+        }
+        auto result = std::vector<std::pair<std::uint32_t, T>>{};
+        for (auto i = offsets[q]; i < offsets[q + 1]; ++i)
+        {
+            result.emplace_back(found[i], found_distances[i]);
+        }
+        std::sort(expected.begin(), expected.end());
+        std::sort(result.begin(), result.end());
+        assert_equal(result, expected);
+    }
+}
+
+struct manhattan_distance
+{
+    template<typename InputIterator1, typename InputIterator2>
+    auto operator()(InputIterator1 first_left, InputIterator1 last_left, InputIterator2 first_right) const
+    {
+        return aaa::manhattan::distance(first_left, last_left, first_right);
+    }
+};
+
+template<typename T>
+void test_spatial_index_type()
+{
+    using namespace aaa::spatial;
+    // Points on a grid, so that there are many equal distances.
+    const auto dimension = std::size_t{3};
+    const auto num_points = std::size_t{2000};
+    auto points = std::vector<T>(num_points * dimension);
+    for (auto i = std::size_t{0}; i < points.size(); ++i)
+    {
+        points[i] = T(i * 7919 % 23) * T(0.5);
+    }
+    auto queries = std::vector<T>(100 * dimension);
+    for (auto i = std::size_t{0}; i < queries.size(); ++i)
+    {
+        queries[i] = T(i * 104729 % 29) * T(0.4);
+    }
+
+    const auto euclidean = metric_distance<euclidean_metric>{};
+    const auto manhattan = metric_distance<manhattan_metric>{};
+    const auto maximum = metric_distance<maximum_metric>{};
+
+    const auto tree = kd_tree<T, euclidean_metric>(points, dimension);
+    test_spatial_tree(tree, points, queries, dimension, T(2), euclidean);
+    test_spatial_tree(kd_tree<T, manhattan_metric>(points, dimension), points, queries, dimension, T(3), manhattan);
+    test_spatial_tree(kd_tree<T, maximum_metric>(points, dimension), points, queries, dimension, T(1.5), maximum);
+    test_spatial_tree(vp_tree<T, metric_distance<euclidean_metric>>(points, dimension), points, queries, dimension, T(2), euclidean);
+    test_spatial_tree(vp_tree<T, manhattan_distance>(points, dimension), points, queries, dimension, T(3), manhattan_distance{});
+
+    // The tree does not depend on the policy, and can be restored from its arrays.
+    aaa::execution::set_num_threads(8);
+    const auto parallel_tree = kd_tree<T, euclidean_metric>(aaa::execution::par, points, dimension);
+    const auto parallel_vp_tree = vp_tree<T, manhattan_distance>(aaa::execution::par, points, dimension);
+    aaa::execution::set_num_threads(0);
+    assert_equal(parallel_tree.indices(), tree.indices());
+    assert_equal(parallel_tree.points(), tree.points());
+    assert(std::equal(tree.nodes().begin(), tree.nodes().end(), parallel_tree.nodes().begin(),
+        [](const kd_node<T>& a, const kd_node<T>& b)
+        {
+            return a.split == b.split && a.axis == b.axis && a.first == b.first && a.last == b.last && a.right == b.right;
+        }));
+    assert_equal(parallel_vp_tree.indices(), vp_tree<T, manhattan_distance>(points, dimension).indices());
+    const auto restored = kd_tree<T, euclidean_metric>(dimension, tree.points(), tree.indices(), tree.nodes());
+    test_spatial_tree(restored, points, queries, dimension, T(2), euclidean);
+}
+
+void test_spatial_index()
+{
+    test_spatial_index_type<float>();
+    test_spatial_index_type<double>();
+
+    // Fewer points than a leaf, and k = 0.
+    const auto points = std::vector<double>{ 0, 0, 3, 4, 1, 1 };
+    const auto tree = aaa::spatial::kd_tree<double, aaa::spatial::euclidean_metric>(points, 2);
+    auto index = std::vector<int>(2);
+    auto distance = std::vector<double>(2);
+    const auto query = std::vector<double>{ 3, 3 };
+    tree.nearest(query.begin(), 2, index.begin(), distance.begin());
+    assert_equal(index, vi{ 1, 2 });
+    assert_equal(distance, std::vector<double>{ 1, std::sqrt(8.0) });
+    tree.nearest(query.begin(), 0, index.begin(), distance.begin());
+}
+
+template<typename T>
+void test_quantized_type()
+{
+    // Extreme values in all the positions of the registers, and sizes with tails.
+    for (const auto size : { 0, 1, 15, 16, 31, 64, 65, 1000 })
+    {
+        auto a = std::vector<T>(size);
+        auto b = std::vector<T>(size);
+        for (auto i = 0; i < size; ++i)
+        {
+            a[i] = T(i % 3 == 0 ? std::numeric_limits<T>::lowest() : i * 37);
+            b[i] = T(i % 5 == 0 ? std::numeric_limits<T>::max() : i * 101);
+        }
+        auto dot = std::int64_t{};
+        auto squared = std::int64_t{};
+        auto manhattan = std::int64_t{};
+        for (auto i = 0; i < size; ++i)
+        {
+            const auto x = std::int64_t{a[i]};
+            const auto y = std::int64_t{b[i]};
+            dot += x * y;
+            squared += (x - y) * (x - y);
+            manhattan += std::abs(x - y);
+        }
+        assert_equal(std::int64_t{aaa::euclidean::dot(a, b, std::int32_t{0})}, dot);
+        assert_equal(std::int64_t{aaa::euclidean::squared_distance(a, b, std::int32_t{0})}, squared);
+        assert_equal(std::int64_t{aaa::manhattan::distance(a, b, std::int32_t{0})}, manhattan);
+        assert_equal(std::int64_t{aaa::manhattan::distance(a, b, std::int32_t{7})}, manhattan + 7);
+        // Bytes are summed in int32_t by default.
+        static_assert(std::is_same<decltype(aaa::euclidean::dot(a, b)), std::int32_t>::value, "");
+        assert_equal(std::int64_t{aaa::euclidean::dot(a, b)}, dot);
+        assert_equal(std::int64_t{aaa::euclidean::squared_distance(a, b)}, squared);
+        assert_equal(std::int64_t{aaa::manhattan::distance(a, b)}, manhattan);
+    }
+
+    // The kernels give the same results as the loops, with ties, infinities, NaN and large zero points.
+    for (const auto size : { 0, 1, 15, 16, 63, 64, 65, 1000 })
+    {
+        auto in = std::vector<float>(size);
+        for (auto i = 0; i < size; ++i)
+        {
+            in[i] = float(i % 41 - 20) * 0.25f * float(i % 7 == 0 ? 1 << 20 : 1);
+        }
+        if (size > 3)
+        {
+            in[1] = std::numeric_limits<float>::infinity();
+            in[2] = -std::numeric_limits<float>::infinity();
+            in[3] = std::numeric_limits<float>::quiet_NaN();
+        }
+        for (const auto zero_point : { 0, 3, -128, 1 << 20, -(1 << 24), (1 << 24) + 1 })
+        {
+            auto q = std::vector<T>(in.size());
+            auto expected = std::vector<T>(in.size());
+            aaa::quantize(in, q, 0.5f, zero_point);
+            aaa::simd::quantize_loop(in.begin(), in.end(), 0.5f, zero_point, expected.begin());
+            assert_equal(q, expected);
+            auto out = std::vector<float>(in.size());
+            auto expected_out = std::vector<float>(in.size());
+            aaa::dequantize(q, out, 0.25f, zero_point);
+            aaa::simd::dequantize_loop(q.begin(), q.end(), 0.25f, zero_point, expected_out.begin());
+            assert_equal(out, expected_out);
+        }
+    }
+}
+
+void test_quantized()
+{
+    test_quantized_type<std::int8_t>();
+    test_quantized_type<std::uint8_t>();
+
+    // The values are rounded to nearest even, shifted by the zero point, and clamped.
+    const auto in = std::vector<float>{ -1.0f, -0.25f, 0.0f, 0.25f, 0.75f, 1.0f, 100.0f, -100.0f };
+    auto q = std::vector<std::int8_t>(in.size());
+    aaa::quantize(in, q, 0.5f, 1);
+    assert_equal(q, std::vector<std::int8_t>{ -1, 1, 1, 1, 3, 3, 127, -128 });
+    auto u = std::vector<std::uint8_t>(in.size());
+    aaa::quantize(in, u, 0.5f, 128);
+    assert_equal(u, std::vector<std::uint8_t>{ 126, 128, 128, 128, 130, 130, 255, 0 });
+    auto out = std::vector<float>(in.size());
+    aaa::dequantize(u, out, 0.5f, 128);
+    assert_equal(out, std::vector<float>{ -1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 63.5f, -64.0f });
+
+    // The products of bytes do not overflow with the default init.
+    const auto hundreds = std::vector<std::int8_t>(100, 100);
+    assert_equal(aaa::euclidean::dot(hundreds, hundreds), 1000000);
+    assert_equal(aaa::euclidean::squared_norm(hundreds), 1000000);
+
+    // The largest int32_t is not a float: the values are clamped to the largest float below it.
+    const auto large = std::vector<float>{ 3e9f, -3e9f, 2147483520.0f };
+    auto q32 = std::vector<std::int32_t>(large.size());
+    aaa::quantize(large, q32, 1.0f, 0);
+    assert_equal(q32, std::vector<std::int32_t>{ 2147483520, std::numeric_limits<std::int32_t>::lowest(), 2147483520 });
+}
+
+void test_product_quantization()
+{
+    using aaa::pq::product_quantizer;
+    const auto dimension = std::size_t{8};
+    const auto num_rows = std::size_t{300};
+    auto data = std::vector<float>(num_rows * dimension);
+    for (auto i = std::size_t{0}; i < data.size(); ++i)
+    {
+        data[i] = float((i * i * 7919 + i * 104729) % 10007) * 0.001f;
+    }
+
+    // 4 subspaces of 2 elements, with 16 centroids each.
+    const auto quantizer = product_quantizer<float>(data, dimension, 4, 16, 10);
+    assert_equal(quantizer.codebooks().size(), std::size_t{4 * 16 * 2});
+    auto codes = std::vector<std::uint8_t>(num_rows * 4);
+    quantizer.encode(data, codes);
+    aaa::execution::set_num_threads(8);
+    auto parallel_codes = std::vector<std::uint8_t>(codes.size());
+    quantizer.encode(aaa::execution::par, data, parallel_codes);
+    const auto parallel_quantizer = product_quantizer<float>(aaa::execution::par, data, dimension, 4, 16, 10);
+    aaa::execution::set_num_threads(0);
+    assert_equal(parallel_codes, codes);
+    assert_equal(parallel_quantizer.codebooks(), quantizer.codebooks());
+
+    // The decoded rows are the centroids, and encode to the same codes.
+    auto decoded = std::vector<float>(data.size());
+    quantizer.decode(codes, decoded);
+    auto codes_of_decoded = std::vector<std::uint8_t>(codes.size());
+    quantizer.encode(decoded, codes_of_decoded);
+    assert_equal(codes_of_decoded, codes);
+
+    // The estimated distances are the exact distances to the decoded rows.
+    const auto query = std::vector<float>{ 1, 2, 3, 4, 5, 6, 7, 8 };
+    auto table = std::vector<float>{};
+    quantizer.distance_table(query.begin(), table);
+    auto estimates = std::vector<float>(num_rows);
+    quantizer.asymmetric_distances(table, codes, estimates);
+    for (auto i = std::size_t{0}; i < num_rows; ++i)
+    {
+        const auto row = decoded.begin() + static_cast<std::ptrdiff_t>(i * dimension);
+        const auto exact = aaa::euclidean::squared_distance(query.begin(), query.end(), row);
+        assert(std::abs(estimates[i] - exact) <= 1e-3f * (1 + exact));
+    }
+
+    // The same sums for all instruction sets, including the rows after the last block.
+#if AAA_SIMD
+    using namespace aaa::simd;
+    for (const auto rows : { std::size_t{0}, std::size_t{1}, std::size_t{17}, num_rows })
+    {
+        auto expected = std::vector<float>(rows);
+        auto result = std::vector<float>(rows);
+        table_lookup_sums_loop(table.data(), 16, codes.data(), 4, rows, expected.data());
+        if (detect_simd_level() >= simd_level::avx2)
+        {
+            avx2::table_lookup_sums(table.data(), 16, codes.data(), 4, rows, result.data());
+            assert_equal(result, expected);
+        }
+        if (detect_simd_level() >= simd_level::avx512)
+        {
+            avx512::table_lookup_sums(table.data(), 16, codes.data(), 4, rows, result.data());
+            assert_equal(result, expected);
+        }
+    }
+#endif
+
+    // Re-ranking all the rows gives the exact nearest neighbors.
+    auto queries = std::vector<float>(data.begin() + 40, data.begin() + 40 + 3 * dimension);
+    queries[0] += 0.5f;
+    auto indices = std::vector<std::size_t>(3 * 5);
+    auto distances = std::vector<float>(3 * 5);
+    quantizer.search(queries, codes, data, 5, num_rows, indices, distances);
+    const auto distance = [](const float* first, const float* last, const float* query)
+    {
+        return std::sqrt(aaa::euclidean::squared_distance(first, last, query));
+    };
+    for (auto q = std::size_t{0}; q < 3; ++q)
+    {
+        const auto all = brute_force_nearest(data, queries.data() + q * dimension, dimension, distance);
+        for (auto n = std::size_t{0}; n < 5; ++n)
+        {
+            assert_equal(indices[q * 5 + n], std::size_t{all[n].second});
+            assert_equal(distances[q * 5 + n], all[n].first);
+        }
+    }
+    quantizer.search(aaa::execution::par, queries, codes, data, 5, 20, indices, distances);
+    assert_equal(indices[5], std::size_t{6});
+    assert_equal(distances[5], 0.0f);
+
+    // The codebooks are trained on evenly spaced rows, at most training_rows_per_centroid per centroid.
+    const auto num_samples = aaa::pq::training_rows_per_centroid * 2;
+    const auto num_many = 3 * num_samples + 1;
+    auto many = std::vector<float>(num_many * dimension);
+    for (auto i = std::size_t{0}; i < many.size(); ++i)
+    {
+        many[i] = float((i * 31 + i / dimension * 17) % 97);
+    }
+    auto sample = std::vector<float>();
+    for (auto i = std::size_t{0}; i < num_samples; ++i)
+    {
+        const auto row = many.begin() + std::ptrdiff_t(i * num_many / num_samples * dimension);
+        sample.insert(sample.end(), row, row + std::ptrdiff_t(dimension));
+    }
+    assert_equal(product_quantizer<float>(many, dimension, 4, 2, 5).codebooks(),
+        product_quantizer<float>(sample, dimension, 4, 2, 5).codebooks());
+}
+
+std::uint64_t count_bits(std::uint64_t x)
+{
+    auto count = std::uint64_t{0};
+    for (; x != 0; x >>= 1)
+    {
+        count += x & 1;
+    }
+    return count;
+}
+
+void test_hamming_space()
+{
+    auto words = std::vector<std::uint64_t>(2000);
+    auto x = std::uint64_t{88172645463325252ull};
+    for (auto& w : words)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        w = x;
+    }
+    words[3] = ~std::uint64_t{0};
+
+    // All the sizes around the blocks of the kernels.
+    for (auto size = std::size_t{0}; size <= 70; ++size)
+    {
+        auto norm = std::uint64_t{0};
+        auto distance = std::uint64_t{0};
+        for (auto i = std::size_t{0}; i < size; ++i)
+        {
+            norm += count_bits(words[i]);
+            distance += count_bits(words[i] ^ words[i + 1000]);
+        }
+        const auto left = std::vector<std::uint64_t>(words.begin(), words.begin() + size);
+        const auto right = std::vector<std::uint64_t>(words.begin() + 1000, words.begin() + 1000 + size);
+        assert_equal(aaa::hamming::norm(left), norm);
+        assert_equal(aaa::hamming::distance(left, right), distance);
+        assert_equal(aaa::hamming::distance(std::valarray<std::uint64_t>(left.data(), size), right), distance);
+#if AAA_SIMD
+        using namespace aaa::simd;
+        assert_equal(sse42::bit_count<true>(left.data(), right.data(), size), distance);
+        if (detect_simd_level() >= simd_level::avx2)
+        {
+            assert_equal(avx2::bit_count<false>(left.data(), left.data(), size), norm);
+            assert_equal(avx2::bit_count<true>(left.data(), right.data(), size), distance);
+        }
+        if (detect_simd_level() >= simd_level::avx512)
+        {
+            assert_equal(avx512::bit_count<false>(left.data(), left.data(), size), norm);
+            assert_equal(avx512::bit_count<true>(left.data(), right.data(), size), distance);
+        }
+#endif
+    }
+
+    // Codes of 4 words, compared with a query and searched.
+    const auto num_words = std::size_t{4};
+    const auto query = std::vector<std::uint64_t>(words.begin() + 40, words.begin() + 44);
+    auto out = std::vector<std::uint64_t>(words.size() / num_words);
+    aaa::hamming::distances(query, words, out);
+    auto out_int = std::vector<int>(out.size());
+    aaa::hamming::distances(query, words, out_int);
+    for (auto r = std::size_t{0}; r < out.size(); ++r)
+    {
+        const auto row = words.begin() + static_cast<std::ptrdiff_t>(r * num_words);
+        assert_equal(out[r], aaa::hamming::distance(row, row + 4, query.begin()));
+        assert_equal(out_int[r], int(out[r]));
+    }
+    assert_equal(out[10], std::uint64_t{0});
+
+    const auto queries = std::vector<std::uint64_t>(words.begin() + 100, words.begin() + 100 + 3 * num_words);
+    auto indices = std::vector<std::size_t>(3 * 5);
+    auto distances = std::vector<std::uint64_t>(3 * 5);
+    aaa::hamming::nearest_neighbors(words, queries, num_words, 5, indices, distances);
+    aaa::execution::set_num_threads(8);
+    auto parallel_indices = std::vector<std::size_t>(indices.size());
+    auto parallel_distances = std::vector<int>(distances.size());
+    aaa::hamming::nearest_neighbors(aaa::execution::par, words, queries, num_words, 5, parallel_indices, parallel_distances);
+    aaa::execution::set_num_threads(0);
+    for (auto q = std::size_t{0}; q < 3; ++q)
+    {
+        auto all = std::vector<std::pair<std::uint64_t, std::size_t>>{};
+        const auto first_query = queries.begin() + static_cast<std::ptrdiff_t>(q * num_words);
+        for (auto r = std::size_t{0}; r < out.size(); ++r)
+        {
+            const auto row = words.begin() + static_cast<std::ptrdiff_t>(r * num_words);
+            all.emplace_back(aaa::hamming::distance(first_query, first_query + 4, row), r);
+        }
+        std::sort(all.begin(), all.end());
+        for (auto n = std::size_t{0}; n < 5; ++n)
+        {
+            assert_equal(indices[q * 5 + n], all[n].second);
+            assert_equal(distances[q * 5 + n], all[n].first);
+            assert_equal(parallel_indices[q * 5 + n], all[n].second);
+            assert_equal(parallel_distances[q * 5 + n], int(all[n].first));
+        }
+    }
+    assert_equal(indices[0], std::size_t{25});
+}
+
+template<typename T>
+void test_minkowski_space_type()
+{
+    using namespace aaa::minkowski;
+    const auto close = [](T x, T y)
+    {
+        return std::abs(x - y) <= T(1e-4) * (std::abs(x) + std::abs(y) + 1);
+    };
+    // Sizes around the blocks of the kernels, which add the terms in another order.
+    for (const auto size : { 0, 1, 7, 16, 33, 200, 1000 })
+    {
+        auto a = std::vector<T>(size);
+        auto b = std::vector<T>(size);
+        for (auto i = 0; i < size; ++i)
+        {
+            a[i] = T(i % 7) * T(0.25) - T(0.5);
+            b[i] = T(i % 5) * T(0.5) - T(1);
+        }
+        auto cubes = T{};
+        auto powers = T{};
+        auto norm_cubes = T{};
+        for (auto i = 0; i < size; ++i)
+        {
+            const auto d = std::abs(a[i] - b[i]);
+            cubes += d * d * d;
+            powers += T(std::pow(d, T(2.5)));
+            norm_cubes += std::abs(a[i] * a[i] * a[i]);
+        }
+        assert(close(powered_distance<3>(a, b), cubes));
+        assert(close(powered_distance<3>(a, b, T(1)), cubes + T(1)));
+        assert(close(T(distance<3>(a, b)), T(std::cbrt(cubes))));
+        assert(close(powered_norm<3>(a), norm_cubes));
+        assert(close(powered_distance(2.5, a, b), powers));
+        assert(close(T(distance(2.5, a, b)), T(std::pow(powers, T(0.4)))));
+        assert(close(T(distance<1>(a, b)), aaa::manhattan::distance(a, b)));
+        assert(close(T(distance<2>(a, b)), T(aaa::euclidean::distance(a, b))));
+        assert(close(T(norm<2>(a)), T(aaa::euclidean::norm(a))));
+
+        // The runtime integer powers use the same kernels.
+        assert_equal(powered_distance(3.0, a, b), powered_distance<3>(a, b));
+        assert_equal(norm(4.0, a.begin(), a.end()), norm<4>(a.begin(), a.end()));
+    }
+
+    // Each row of a matrix, with the kernels of the other spaces.
+    const auto dimension = 19;
+    auto query = std::vector<T>(dimension);
+    auto matrix = std::vector<T>(dimension * 11);
+    for (auto i = 0; i < dimension; ++i)
+    {
+        query[i] = T(i % 3) - T(0.5);
+    }
+    for (auto i = 0; i < dimension * 11; ++i)
+    {
+        matrix[i] = T(i % 13) * T(0.125);
+    }
+    auto out = std::vector<T>(11);
+    auto runtime_out = std::vector<T>(11);
+    auto generic_out = std::vector<T>(11);
+    distances<5>(query, matrix, out);
+    distances(5.0, query, matrix, runtime_out);
+    distances(4.5, query, matrix, generic_out);
+    assert_equal(runtime_out, out);
+    for (auto r = 0; r < 11; ++r)
+    {
+        const auto row = matrix.begin() + r * dimension;
+        assert(close(out[r], T(distance<5>(query.begin(), query.end(), row))));
+        assert(close(generic_out[r], T(distance(4.5, query.begin(), query.end(), row))));
+    }
+}
+
+void test_minkowski_space()
+{
+    test_minkowski_space_type<float>();
+    test_minkowski_space_type<double>();
+
+    const auto a = std::vector<int>{ 1, -2, 3 };
+    const auto b = std::vector<int>{ 2, 2, -1 };
+    assert_equal(aaa::minkowski::powered_distance<3>(a, b), 1 + 64 + 64);
+    assert_equal(aaa::minkowski::powered_norm<2>(a), 14);
+    assert_equal(aaa::minkowski::norm<2>(std::vector<double>{ 3, -4 }), 5.0);
+    assert_equal(aaa::minkowski::norm(1.0, std::vector<float>{ 3, -4 }), 7.0f);
+}
+
+template<typename T>
+void test_cosine_similarity_type()
+{
+    using namespace aaa::euclidean;
+    const auto close = [](T x, T y)
+    {
+        return std::abs(x - y) <= T(1e-5) * (std::abs(x) + std::abs(y) + 1);
+    };
+    // Sizes around the blocks of the kernels.
+    for (const auto size : { 1, 3, 8, 16, 17, 64, 1001 })
+    {
+        auto a = std::vector<T>(size);
+        auto b = std::vector<T>(size);
+        for (auto i = 0; i < size; ++i)
+        {
+            a[i] = T(i % 7) - T(2.5);
+            b[i] = T(i % 4) * T(0.5) + T(0.25);
+        }
+        const auto expected = T(dot(a, b) / (norm(a) * norm(b)));
+        assert(close(cosine_similarity(a, b), expected));
+        assert(close(cosine_distance(a.begin(), a.end(), b.begin()), T(1) - expected));
+        assert(close(cosine_similarity(a, a), T(1)));
+#if AAA_SIMD
+        using namespace aaa::simd;
+        const auto sums = scalar::cosine_sums(a.data(), b.data(), a.size());
+        for (const auto& isa_sums : { sse42::cosine_sums(a.data(), b.data(), a.size()),
+            detect_simd_level() >= simd_level::avx2 ? avx2::cosine_sums(a.data(), b.data(), a.size()) : sums,
+            detect_simd_level() >= simd_level::avx512 ? avx512::cosine_sums(a.data(), b.data(), a.size()) : sums })
+        {
+            for (auto j = 0; j < 3; ++j)
+            {
+                assert(close(isa_sums[j], sums[j]));
+            }
+        }
+#endif
+    }
+    const auto zero = std::vector<T>(5);
+    const auto ones = std::vector<T>(5, T(1));
+    assert_equal(cosine_similarity(zero, ones), T(0));
+    assert(close(cosine_distance(ones, ones), T(0)));
+
+    // The similarities of a query to the rows, with the norms of the rows computed once.
+    const auto dimension = std::size_t{13};
+    const auto num_rows = std::size_t{70};
+    auto matrix = std::vector<T>(dimension * num_rows);
+    for (auto i = std::size_t{0}; i < matrix.size(); ++i)
+    {
+        matrix[i] = T(i * 31 % 17) - T(8);
+    }
+    std::fill(matrix.begin() + 5 * dimension, matrix.begin() + 6 * dimension, T(0));
+    const auto query = std::vector<T>(matrix.begin() + 2 * dimension, matrix.begin() + 3 * dimension);
+    auto norms = std::vector<T>(num_rows);
+    row_norms(matrix, dimension, norms);
+    auto out = std::vector<T>(num_rows);
+    cosine_similarities(query, matrix, norms, out);
+    for (auto r = std::size_t{0}; r < num_rows; ++r)
+    {
+        const auto row = matrix.begin() + static_cast<std::ptrdiff_t>(r * dimension);
+        assert(close(norms[r], norm(row, row + static_cast<std::ptrdiff_t>(dimension))));
+        assert(close(out[r], cosine_similarity(query.begin(), query.end(), row)));
+    }
+    assert_equal(out[5], T(0));
+
+    // Normalized vectors and rows have a norm of one, and zero rows are unchanged.
+    auto v = std::vector<T>{ T(3), T(4) };
+    assert_equal(normalize(v), T(5));
+    assert(close(v[0], T(0.6)) && close(v[1], T(0.8)));
+    auto normalized = matrix;
+    auto row_norm = std::vector<T>(num_rows);
+    aaa::execution::set_num_threads(8);
+    normalize_rows(aaa::execution::par, normalized, dimension, row_norm);
+    aaa::execution::set_num_threads(0);
+    assert_equal(row_norm, norms);
+    for (auto r = std::size_t{0}; r < num_rows; ++r)
+    {
+        const auto row = normalized.begin() + static_cast<std::ptrdiff_t>(r * dimension);
+        assert(close(norm(row, row + static_cast<std::ptrdiff_t>(dimension)), r == 5 ? T(0) : T(1)));
+    }
+}
+
+void test_cosine_similarity()
+{
+    test_cosine_similarity_type<float>();
+    test_cosine_similarity_type<double>();
+    const auto a = std::vector<int>{ 1, 0 };
+    const auto b = std::vector<int>{ 1, 1 };
+    assert(std::abs(aaa::euclidean::cosine_similarity(a, b) - std::sqrt(0.5)) < 1e-12);
+}
+
+// Lloyd's k-means without bounds, that computes all the distances.
+template<typename T>
+aaa::kmeans::clusters<T> brute_force_lloyd(const std::vector<T>& data, std::size_t dimension,
+    std::vector<T> centroids, std::size_t max_iterations)
+{
+    const auto num_rows = data.size() / dimension;
+    const auto k = centroids.size() / dimension;
+    auto labels = std::vector<std::size_t>(num_rows, k);
+    auto iteration = std::size_t{0};
+    while (iteration < max_iterations)
+    {
+        ++iteration;
+        auto changed = false;
+        for (auto i = std::size_t{0}; i < num_rows; ++i)
+        {
+            const auto row = data.begin() + static_cast<std::ptrdiff_t>(i * dimension);
+            auto best = std::size_t{0};
+            auto best_distance = std::numeric_limits<T>::infinity();
+            for (auto c = std::size_t{0}; c < k; ++c)
+            {
+                const auto d = aaa::euclidean::squared_distance(row, row + static_cast<std::ptrdiff_t>(dimension),
+                    centroids.begin() + static_cast<std::ptrdiff_t>(c * dimension));
+                if (d < best_distance)
+                {
+                    best = c;
+                    best_distance = d;
+                }
+            }
+            changed = changed || labels[i] != best;
+            labels[i] = best;
+        }
+        if (!changed)
+        {
+            break;
+        }
+        auto sums = std::vector<double>(centroids.size());
+        auto counts = std::vector<std::size_t>(k);
+        for (auto i = std::size_t{0}; i < num_rows; ++i)
+        {
+            ++counts[labels[i]];
+            for (auto j = std::size_t{0}; j < dimension; ++j)
+            {
+                sums[labels[i] * dimension + j] += data[i * dimension + j];
+            }
+        }
+        for (auto j = std::size_t{0}; j < centroids.size(); ++j)
+        {
+            if (counts[j / dimension] > 0)
+            {
+                centroids[j] = T(sums[j] / double(counts[j / dimension]));
+            }
+        }
+    }
+    return { centroids, labels, T(0), iteration };
+}
+
+void test_kmeans()
+{
+    using namespace aaa::kmeans;
+
+    // 4 blobs of 750 rows in 3 dimensions, with a small noise.
+    const auto dimension = std::size_t{3};
+    const auto num_rows = std::size_t{3000};
+    const auto centers = std::vector<float>{ 0, 0, 0, 10, 0, 0, 0, 10, 0, 0, 0, 10 };
+    auto blobs = std::vector<float>(num_rows * dimension);
+    for (auto i = std::size_t{0}; i < blobs.size(); ++i)
+    {
+        const auto blob = i / dimension % 4;
+        blobs[i] = centers[blob * dimension + i % dimension] + float((i * i * 7919 + i * 104729) % 10007) * 1e-4f - 0.5f;
+    }
+    const auto same_blobs = [&](const std::vector<std::size_t>& labels)
+    {
+        for (auto i = std::size_t{0}; i < num_rows; ++i)
+        {
+            assert_equal(labels[i], labels[i % 4]);
+        }
+        auto first_labels = std::vector<std::size_t>(labels.begin(), labels.begin() + 4);
+        std::sort(first_labels.begin(), first_labels.end());
+        assert(std::unique(first_labels.begin(), first_labels.end()) == first_labels.end());
+    };
+
+    const auto seeds = seed_centroids(blobs, dimension, 4, 7);
+    assert_equal(seeds.size(), 4 * dimension);
+    for (auto c = std::size_t{0}; c < 4; ++c)
+    {
+        assert(std::search(blobs.begin(), blobs.end(), seeds.begin() + static_cast<std::ptrdiff_t>(c * dimension),
+            seeds.begin() + static_cast<std::ptrdiff_t>((c + 1) * dimension)) != blobs.end());
+    }
+
+    const auto result = fit(blobs, dimension, 4, 100, 7);
+    same_blobs(result.labels);
+    for (auto c = std::size_t{0}; c < 4; ++c)
+    {
+        const auto blob = std::find(result.labels.begin(), result.labels.end(), c) - result.labels.begin();
+        const auto center = centers.begin() + blob % 4 * static_cast<std::ptrdiff_t>(dimension);
+        const auto centroid = result.centroids.begin() + static_cast<std::ptrdiff_t>(c * dimension);
+        assert(aaa::euclidean::squared_distance(center, center + static_cast<std::ptrdiff_t>(dimension), centroid) < 0.01f);
+    }
+    auto labels = std::vector<std::size_t>(num_rows);
+    assert(std::abs(assign(blobs, dimension, result.centroids, labels) - result.inertia) <= 1e-3f * result.inertia);
+    assert_equal(labels, result.labels);
+
+    // The same clusters for all execution policies.
+    aaa::execution::set_num_threads(8);
+    const auto parallel_result = fit(aaa::execution::par, blobs, dimension, 4, 100, 7);
+    const auto parallel_minibatch = fit_minibatch(aaa::execution::par, blobs, dimension, 4, 64, 50, 3);
+    aaa::execution::set_num_threads(0);
+    assert_equal(parallel_result.centroids, result.centroids);
+    assert_equal(parallel_result.labels, result.labels);
+    assert_equal(parallel_result.inertia, result.inertia);
+    assert_equal(parallel_result.iterations, result.iterations);
+
+    const auto minibatch = fit_minibatch(blobs, dimension, 4, 64, 50, 3);
+    same_blobs(minibatch.labels);
+    assert_equal(minibatch.iterations, std::size_t{50});
+    assert_equal(parallel_minibatch.centroids, minibatch.centroids);
+    assert(minibatch.inertia < 2 * result.inertia);
+
+    // The bounds skip distances, but give the assignments of the brute force.
+    const auto num_points = std::size_t{2500};
+    auto points = std::vector<double>(num_points * 5);
+    for (auto i = std::size_t{0}; i < points.size(); ++i)
+    {
+        points[i] = double((i * i * 7919 + i * 104729) % 10007) * 0.001;
+    }
+    const auto initial = seed_centroids(points, 5, 12);
+    const auto expected = brute_force_lloyd(points, 5, initial, 50);
+    const auto bounded = lloyd(points.begin(), points.end(), 5, initial, 50);
+    assert(expected.iterations > 5);
+    assert_equal(bounded.iterations, expected.iterations);
+    assert_equal(bounded.labels, expected.labels);
+    for (auto j = std::size_t{0}; j < initial.size(); ++j)
+    {
+        assert(std::abs(bounded.centroids[j] - expected.centroids[j]) <= 1e-9 * (1 + std::abs(expected.centroids[j])));
+    }
+
+    // When the iterations run out, the labels and the inertia are those of the returned centroids.
+    for (const auto max_iterations : { 0, 1, 2 })
+    {
+        const auto truncated = lloyd(points, 5, initial, max_iterations);
+        assert_equal(truncated.iterations, std::size_t(max_iterations));
+        auto labels = std::vector<std::size_t>(num_points);
+        const auto inertia = assign(points, 5, truncated.centroids, labels);
+        assert_equal(truncated.labels, labels);
+        assert(std::abs(truncated.inertia - inertia) <= 1e-9 * inertia);
+    }
+
+    // A single cluster is the mean of the rows.
+    const auto single = fit(std::vector<double>{ 1, 2, 3, 6 }, 1, 1);
+    assert_equal(single.centroids, std::vector<double>{ 3 });
+    assert_equal(single.inertia, 14.0);
+}
+
+void test_lsh_index()
+{
+    using namespace aaa::lsh;
+
+    // The probes are generated in the order of their scores, with one change of each hash.
+    const auto perturbations = std::vector<perturbation>{
+        { 0, -1, 0.01 }, { 1, 1, 0.04 }, { 0, 1, 0.81 }, { 1, -1, 0.64 + 0.5 } };
+    auto probes = std::vector<std::vector<std::size_t>>();
+    for_each_probe(perturbations, 6, [&](const std::vector<std::size_t>& set) { probes.push_back(set); });
+    const auto expected_probes = std::vector<std::vector<std::size_t>>{ { 0 }, { 1 }, { 0, 1 }, { 2 }, { 1, 2 } };
+    assert_equal(probes, expected_probes);
+
+    // 2000 points of 16 dimensions, and queries near the first 100 points.
+    const auto dimension = std::size_t{16};
+    const auto num_points = std::size_t{2000};
+    const auto num_queries = std::size_t{100};
+    auto points = std::vector<float>(num_points * dimension);
+    for (auto i = std::size_t{0}; i < points.size(); ++i)
+    {
+        points[i] = float((i * i * 7919 + i * 104729) % 10007) * 0.001f;
+    }
+    auto queries = std::vector<float>(points.begin(), points.begin() + static_cast<std::ptrdiff_t>(num_queries * dimension));
+    for (auto i = std::size_t{0}; i < queries.size(); ++i)
+    {
+        queries[i] += float(i % 5) * 0.02f - 0.04f;
+    }
+
+    const auto index = hash_index<float, euclidean_hash>(points, dimension, euclidean_hash{ 10 }, 8, 6, 1);
+    assert_equal(index.size(), num_points);
+    assert(index.num_buckets() > 8);
+
+    // A point is the nearest candidate of itself.
+    auto self = std::vector<std::uint32_t>(3);
+    auto self_distances = std::vector<float>(3);
+    for (auto i = std::size_t{0}; i < 50; ++i)
+    {
+        const auto point = points.begin() + static_cast<std::ptrdiff_t>(i * dimension);
+        assert(index.nearest(point, 3, 1, self.begin(), self_distances.begin()) >= 1);
+        assert_equal(self[0], std::uint32_t(i));
+        assert_equal(self_distances[0], 0.0f);
+    }
+
+    // More probes give more candidates, and the exact distances, sorted.
+    auto fewer = std::vector<std::uint32_t>();
+    auto more = std::vector<std::uint32_t>();
+    index.candidates(queries.begin(), 1, fewer);
+    index.candidates(queries.begin(), 20, more);
+    assert(more.size() > fewer.size());
+    assert(std::includes(more.begin(), more.end(), fewer.begin(), fewer.end()));
+
+    const auto k = std::size_t{5};
+    auto indices = std::vector<std::uint32_t>(num_queries * k);
+    auto distances = std::vector<float>(num_queries * k);
+    nearest_neighbors(index, queries, k, 20, indices, distances);
+    auto exact_indices = std::vector<std::size_t>(num_queries);
+    auto exact_distances = std::vector<float>(num_queries);
+    aaa::euclidean::nearest_neighbors(points, queries, dimension, 1, exact_indices, exact_distances);
+    auto recalled = std::size_t{0};
+    for (auto q = std::size_t{0}; q < num_queries; ++q)
+    {
+        recalled += indices[q * k] == exact_indices[q];
+        for (auto j = q * k; j < (q + 1) * k && indices[j] != no_neighbor; ++j)
+        {
+            const auto query = queries.begin() + static_cast<std::ptrdiff_t>(q * dimension);
+            const auto point = points.begin() + static_cast<std::ptrdiff_t>(indices[j] * dimension);
+            assert_equal(distances[j], aaa::euclidean::distance(query, query + static_cast<std::ptrdiff_t>(dimension), point));
+            assert(j == q * k || distances[j - 1] <= distances[j]);
+        }
+    }
+    assert(recalled >= 95);
+
+    // The same index and neighbors for all execution policies.
+    aaa::execution::set_num_threads(8);
+    const auto parallel_index = hash_index<float, euclidean_hash>(aaa::execution::par, points, dimension,
+        euclidean_hash{ 10 }, 8, 6, 1);
+    auto parallel_indices = std::vector<std::uint32_t>(indices.size());
+    auto parallel_distances = std::vector<float>(distances.size());
+    nearest_neighbors(aaa::execution::par, parallel_index, queries, k, 20, parallel_indices, parallel_distances);
+    aaa::execution::set_num_threads(0);
+    assert_equal(parallel_indices, indices);
+    assert_equal(parallel_distances, distances);
+
+    // The missing neighbors of a query without candidates.
+    const auto narrow = hash_index<float, euclidean_hash>(points, dimension, euclidean_hash{ 0.01 }, 2, 16, 1);
+    const auto far = std::vector<float>(dimension, 1000.0f);
+    auto far_indices = std::vector<std::uint32_t>(2);
+    auto far_distances = std::vector<float>(2);
+    nearest_neighbors(narrow, far, 2, 4, far_indices, far_distances);
+    assert_equal(far_indices, std::vector<std::uint32_t>(2, no_neighbor));
+    assert_equal(far_distances, std::vector<float>(2, std::numeric_limits<float>::infinity()));
+
+    // SimHash does not depend on the length of the vectors.
+    auto centered = points;
+    for (auto i = std::size_t{0}; i < centered.size(); ++i)
+    {
+        centered[i] -= 5.0f;
+    }
+    const auto cosine_index = hash_index<float, cosine_hash>(centered, dimension, cosine_hash{}, 4, 12, 3);
+    for (auto i = std::size_t{0}; i < 50; ++i)
+    {
+        auto scaled = std::vector<float>(centered.begin() + static_cast<std::ptrdiff_t>(i * dimension),
+            centered.begin() + static_cast<std::ptrdiff_t>((i + 1) * dimension));
+        for (auto& x : scaled)
+        {
+            x *= 3;
+        }
+        assert(cosine_index.nearest(scaled.begin(), 1, 1, self.begin(), self_distances.begin()) == 1);
+        assert_equal(self[0], std::uint32_t(i));
+        assert(std::abs(self_distances[0]) < 1e-5f);
+    }
+}
+
+template<typename Metric, typename Distance>
+void test_similarity_join_metric(Distance distance)
+{
+    using pairs = std::vector<std::pair<std::size_t, std::size_t>>;
+    // Multiples of 1/8, so that the distances are exact and some are equal to the radius.
+    const auto dimension = std::size_t{3};
+    auto a = std::vector<float>(500 * dimension);
+    auto b = std::vector<float>(700 * dimension);
+    for (auto i = std::size_t{0}; i < b.size(); ++i)
+    {
+        b[i] = float((i * i * 7919 + i * 104729) % 97) / 8;
+    }
+    for (auto i = std::size_t{0}; i < a.size(); ++i)
+    {
+        a[i] = float((i * i * 104729 + i * 7919) % 89) / 8;
+    }
+    const auto radius = 1.5f;
+    const auto row = [&](const std::vector<float>& m, std::size_t i)
+    {
+        return m.begin() + static_cast<std::ptrdiff_t>(i * dimension);
+    };
+
+    auto expected = pairs();
+    for (auto i = std::size_t{0}; i < a.size() / dimension; ++i)
+    {
+        for (auto j = std::size_t{0}; j < b.size() / dimension; ++j)
+        {
+            if (distance(row(a, i), row(a, i + 1), row(b, j)) <= radius)
+            {
+                expected.emplace_back(i, j);
+            }
+        }
+    }
+    assert(!expected.empty());
+    auto found = pairs();
+    aaa::join::radius_join<Metric>(a, b, dimension, radius, [&](std::size_t i, std::size_t j, float d)
+    {
+        assert_equal(d, distance(row(a, i), row(a, i + 1), row(b, j)));
+        found.emplace_back(i, j);
+    });
+    std::sort(found.begin(), found.end());
+    assert_equal(found, expected);
+
+    auto expected_self = pairs();
+    for (auto i = std::size_t{0}; i < b.size() / dimension; ++i)
+    {
+        for (auto j = i + 1; j < b.size() / dimension; ++j)
+        {
+            if (distance(row(b, i), row(b, i + 1), row(b, j)) <= radius)
+            {
+                expected_self.emplace_back(i, j);
+            }
+        }
+    }
+    std::mutex mutex;
+    auto found_self = pairs();
+    aaa::execution::set_num_threads(8);
+    aaa::join::radius_self_join<Metric>(aaa::execution::par, b, dimension, radius, [&](std::size_t i, std::size_t j, float)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        found_self.emplace_back(i, j);
+    });
+    aaa::execution::set_num_threads(0);
+    std::sort(found_self.begin(), found_self.end());
+    assert_equal(found_self, expected_self);
+}
+
+void test_similarity_join()
+{
+    using namespace aaa::spatial;
+    test_similarity_join_metric<euclidean_metric>([](auto first, auto last, auto right)
+    {
+        return aaa::euclidean::distance(first, last, right);
+    });
+    test_similarity_join_metric<manhattan_metric>([](auto first, auto last, auto right)
+    {
+        return aaa::manhattan::distance(first, last, right);
+    });
+    test_similarity_join_metric<maximum_metric>([](auto first, auto last, auto right)
+    {
+        return aaa::maximum::distance(first, last, right);
+    });
+
+    // Empty matrices have no pairs.
+    auto count = 0;
+    aaa::join::radius_join<euclidean_metric>(std::vector<double>{}, std::vector<double>{ 1, 2 }, 2, 1.0,
+        [&](std::size_t, std::size_t, double) { ++count; });
+    assert_equal(count, 0);
+}
+
+/** The statistics of a range by two passes in double. */
+template<typename T>
+std::array<double, 6> two_pass_statistics(const std::vector<T>& a)
+{
+    const auto n = double(a.size());
+    auto mean = 0.0;
+    for (auto x : a)
+    {
+        mean += double(x);
+    }
+    mean /= n;
+    auto m2 = 0.0;
+    auto m3 = 0.0;
+    for (auto x : a)
+    {
+        const auto d = double(x) - mean;
+        m2 += d * d;
+        m3 += d * d * d;
+    }
+    const auto skewness = m2 == 0 ? 0.0 : std::sqrt(n) * m3 / (m2 * std::sqrt(m2));
+    return { mean, m2 / n, skewness,
+        double(*std::min_element(a.begin(), a.end())), double(*std::max_element(a.begin(), a.end())), n };
+}
+
+template<typename T>
+void assert_statistics(const aaa::statistics<T>& stats, const std::array<double, 6>& expected, double tolerance)
+{
+    const auto near = [&](double value, double reference)
+    {
+        return std::abs(value - reference) <= tolerance * std::max(1.0, std::abs(reference));
+    };
+    assert(near(stats.mean(), expected[0]));
+    assert(near(stats.variance(), expected[1]));
+    assert(near(stats.skewness(), expected[2]));
+    assert_equal(double(stats.min()), expected[3]);
+    assert_equal(double(stats.max()), expected[4]);
+    assert_equal(double(stats.count()), expected[5]);
+}
+
+void test_statistics()
+{
+    // A skewed distribution far from 0, so that a single pass without a shift would lose digits.
+    auto generator = std::mt19937(7);
+    auto distribution = std::exponential_distribution<double>(0.5);
+    for (const auto size : { 1, 2, 3, 17, 1023, 1024, 1025, 5000, 70000 })
+    {
+        auto a = std::vector<double>(static_cast<std::size_t>(size));
+        auto b = std::vector<float>(a.size());
+        for (auto i = std::size_t{0}; i < a.size(); ++i)
+        {
+            a[i] = 1000.0 + distribution(generator);
+            b[i] = float(a[i]);
+        }
+        const auto expected = two_pass_statistics(a);
+        assert_statistics(aaa::describe(a), expected, 1e-9);
+        assert_statistics(aaa::describe(b), two_pass_statistics(b), 1e-3);
+
+        // Value by value, merged halves, and chunks in parallel.
+        auto pushed = aaa::statistics<double>();
+        for (auto x : a)
+        {
+            pushed.push(x);
+        }
+        assert_statistics(pushed, expected, 1e-9);
+        const auto middle = a.begin() + size / 2;
+        auto merged = aaa::describe(a.begin(), middle);
+        merged.merge(aaa::describe(middle, a.end()));
+        assert_statistics(merged, expected, 1e-9);
+        aaa::execution::set_num_threads(4);
+        assert_statistics(aaa::describe(aaa::execution::par, a), expected, 1e-9);
+        aaa::execution::set_num_threads(0);
+        assert_statistics(aaa::describe(aaa::execution::seq, a), expected, 1e-9);
+
+        assert(std::abs(aaa::mean(a) - expected[0]) < 1e-9 * expected[0]);
+        assert(std::abs(aaa::variance(a.begin(), a.end()) - expected[1]) < 1e-9 * std::max(1.0, expected[1]));
+        assert(std::abs(aaa::standard_deviation(a) - std::sqrt(expected[1])) < 1e-9 * std::max(1.0, expected[1]));
+    }
+
+    // Integers are described in double, and equal values have no variance or skewness.
+    const auto integers = aaa::describe(vi{ 1, 2, 3, 4 });
+    assert_equal(integers.mean(), 2.5);
+    assert_equal(integers.variance(), 1.25);
+    assert_equal(integers.sample_variance(), 5.0 / 3);
+    assert_equal(integers.min(), 1.0);
+    assert_equal(integers.max(), 4.0);
+    const auto constant = aaa::describe(std::vector<float>(3000, 2.5f));
+    assert_equal(constant.mean(), 2.5f);
+    assert_equal(constant.variance(), 0.0f);
+    assert_equal(constant.skewness(), 0.0f);
+
+    // Empty statistics are the identity of merge.
+    auto empty = aaa::statistics<double>();
+    empty.merge(integers);
+    assert_equal(empty.mean(), 2.5);
+    empty.merge(aaa::statistics<double>());
+    assert_equal(empty.count(), std::size_t{4});
+}
+
+void test_reduce_many()
+{
+    using namespace aaa::reductions;
+    // Small multiples of 1/2, so that the sums are exact in any order.
+    for (const auto size : { 0, 1, 7, 16, 33, 100, 1000, 40000 })
+    {
+        auto a = std::vector<float>(static_cast<std::size_t>(size));
+        for (auto i = std::size_t{0}; i < a.size(); ++i)
+        {
+            a[i] = float(int(i * 37 % 21) - 10) / 2;
+        }
+        auto expected_sum = 0.0f;
+        auto expected_squares = 0.0f;
+        for (auto x : a)
+        {
+            expected_sum += x;
+            expected_squares += x * x;
+        }
+        const auto results = aaa::reduce_many(a, sum{}, manhattan_norm{}, maximum_norm{}, count{},
+            squared_norm{}, euclidean_norm{});
+        assert_equal(std::get<0>(results), expected_sum);
+        assert_equal(std::get<1>(results), aaa::manhattan::norm(a));
+        assert_equal(std::get<2>(results), aaa::maximum::norm(a));
+        assert_equal(std::get<3>(results), a.size());
+        assert_equal(std::get<4>(results), expected_squares);
+        assert_equal(std::get<5>(results), std::sqrt(expected_squares));
+
+        aaa::execution::set_num_threads(4);
+        const auto parallel = aaa::reduce_many(aaa::execution::par, a, count{}, maximum_norm{}, sum{});
+        aaa::execution::set_num_threads(0);
+        assert_equal(std::get<0>(parallel), a.size());
+        assert_equal(std::get<1>(parallel), aaa::maximum::norm(a));
+        assert_equal(std::get<2>(parallel), expected_sum);
+    }
+
+    // Integers, iterators, and a single reduction.
+    const auto integers = vi{ 3, -7, 2, 0, 5 };
+    const auto results = aaa::reduce_many(integers.begin(), integers.end(), sum{}, manhattan_norm{},
+        maximum_norm{}, euclidean_norm{}, count{});
+    assert_equal(std::get<0>(results), 3);
+    assert_equal(std::get<1>(results), 17);
+    assert_equal(std::get<2>(results), 7);
+    assert_equal(std::get<3>(results), std::sqrt(87.0));
+    assert_equal(std::get<4>(results), std::size_t{5});
+    assert_equal(std::get<0>(aaa::reduce_many(aaa::execution::seq, integers, maximum_norm{})), 7);
+
+    // Bytes are reduced in int32_t, like their norms, and do not wrap around.
+    const auto bytes = std::vector<int8_t>(4, 100);
+    const auto byte_results = aaa::reduce_many(bytes, sum{}, squared_norm{}, manhattan_norm{}, maximum_norm{});
+    static_assert(std::is_same<std::decay_t<decltype(std::get<1>(byte_results))>, std::int32_t>::value, "");
+    assert_equal(std::get<0>(byte_results), 400);
+    assert_equal(std::get<1>(byte_results), 40000);
+    assert_equal(std::get<2>(byte_results), 400);
+    assert_equal(std::get<3>(byte_results), 100);
+    assert_equal(std::get<1>(byte_results), aaa::euclidean::squared_norm(bytes));
+    const auto lowest = std::vector<int8_t>(3, -128);
+    assert_equal(std::get<0>(aaa::reduce_many(aaa::execution::par, lowest, maximum_norm{})), 128);
+}
+
+void test_lazy_expressions()
+{
+    using vd = std::vector<double>;
+
+    const auto in1 = vd{ 1, 2, 3, 4, 5 };
+    const auto in2 = vd{ 5, 4, 3, 2, 1 };
+
+    // Same result as the eager functions.
+    vd out = aaa::lazy::divide(aaa::lazy::add(in1, in2), 2);
+    assert_equal(out, aaa::divide(aaa::add(in1, in2), 2.0));
+
+    out = aaa::lazy::negate(aaa::lazy::multiply(2.0, aaa::lazy::subtract(in1, in2)));
+    assert_equal(out, vd{ 8, 4, 0, -4, -8 });
+
+    // Other containers.
+    std::valarray<double> va = aaa::lazy::subtract(10, in1);
+    assert_equal(va[4], 5.0);
+    std::array<double, 5> arr;
+    aaa::lazy::evaluate(aaa::lazy::add(in1, va), arr);
+    assert_equal(arr[0], 10.0);
+
+    // Reductions and eager functions take expressions like containers.
+    assert_equal(aaa::euclidean::squared_norm(aaa::lazy::subtract(in1, in2)), 40.0);
+    assert_equal(aaa::sum(aaa::lazy::multiply(in1, in2)), 35.0);
+    aaa::add(aaa::lazy::negate(in1), in1, out);
+    assert_equal(out, vd(5, 0.0));
+
+    // Rvalue containers are owned by the expression.
+    const auto expression = aaa::lazy::add(vd{ 1, 1, 1 }, 1);
+    assert_equal(static_cast<vd>(expression), vd{ 2, 2, 2 });
+
+    // Intermediate values have the value type of the containers, like the eager functions.
+    const auto bytes = std::vector<uint8_t>{ 200, 100 };
+    std::vector<uint8_t> half = aaa::lazy::divide(aaa::lazy::add(bytes, bytes), 2);
+    assert_equal(half, std::vector<uint8_t>{ 72, 100 });
+}
+
+template<typename T>
+void test_fused_type()
+{
+    using v = std::vector<T>;
+    // The values are exact, so the result does not depend on fused multiply-add.
+    for (auto n = 0; n < 70; ++n)
+    {
+        auto x = v(n);
+        auto y = v(n);
+        for (auto i = 0; i < n; ++i)
+        {
+            x[i] = T(i % 7);
+            y[i] = T(3 - i % 5);
+        }
+        auto expected = v(n);
+        std::transform(begin(x), end(x), begin(y), begin(expected), [](T a, T b) { return T(2 * a + b); });
+        assert_equal(aaa::axpy(T(2), x, y), expected);
+        auto out = v(n);
+        aaa::axpy(2, x.data(), x.data() + n, y.data(), out.data());
+        assert_equal(out, expected);
+
+        std::transform(begin(x), end(x), begin(y), begin(expected), [](T a, T b) { return T(3 * a - 2 * b); });
+        assert_equal(aaa::axpby(T(3), x, T(-2), y), expected);
+
+        assert_equal(aaa::lerp(x, y, T(0)), x);
+        assert_equal(aaa::lerp(x, y, T(1)), y);
+        if (std::is_floating_point<T>::value)
+        {
+            std::transform(begin(x), end(x), begin(y), begin(expected), [](T a, T b) { return T(0.75 * a + 0.25 * b); });
+            assert_equal(aaa::lerp(x, y, T(0.25)), expected);
+        }
+    }
+}
+
+void test_fused()
+{
+    test_fused_type<float>();
+    test_fused_type<double>();
+    test_fused_type<int>();
+
+    // Other containers and mixed types.
+    const auto x = vi{ 1, 2, 3 };
+    const auto y = std::array<int, 3>{ 4, 5, 6 };
+    auto out = std::valarray<double>(3);
+    aaa::axpy(0.5, x, y, out);
+    assert_equal(out[2], 7.5);
+    aaa::lerp(x, y, 0.5, out);
+    assert_equal(out[0], 2.5);
+
+    // Larger than a block, so that the blocks are tested.
+    const auto n = 2500;
+    auto images = std::vector<std::vector<double>>(3, std::vector<double>(n));
+    for (auto i = 0; i < n; ++i)
+    {
+        images[0][i] = i;
+        images[1][i] = 2 * i;
+        images[2][i] = 4;
+    }
+    const auto weights = std::vector<double>{ 0.5, 0.25, 0.25 };
+    const auto blend = aaa::weighted_blend(images, weights);
+    for (auto i = 0; i < n; ++i)
+    {
+        assert_equal(blend[i], i + 1.0);
+    }
+    assert_equal(aaa::weighted_blend(std::vector<vi>{ x }, vi{ 3 }), vi{ 3, 6, 9 });
+    auto empty = std::vector<double>{ 1, 2 };
+    aaa::weighted_blend(std::vector<std::vector<double>>{}, std::vector<double>{}, empty);
+    assert_equal(empty, std::vector<double>(2, 0.0));
+}
+
+void test_rvalue_and_inplace()
+{
+    using vd = std::vector<double>;
+    const auto in = vd{ 1, 2, 3 };
+
+    // The storage of a temporary argument is reused for the output.
+    auto temporary = vd{ 4, 5, 6 };
+    const auto data = temporary.data();
+    auto out = aaa::add(std::move(temporary), in);
+    assert_equal(out, vd{ 5, 7, 9 });
+    assert_equal(out.data(), data);
+    out = aaa::subtract(in, std::move(out));
+    assert_equal(out, vd{ -4, -5, -6 });
+    assert_equal(out.data(), data);
+    out = aaa::negate(std::move(out));
+    assert_equal(out, vd{ 4, 5, 6 });
+    assert_equal(out.data(), data);
+    out = aaa::divide(aaa::multiply(aaa::add(in, in), 3.0), 2.0);
+    assert_equal(out, vd{ 3, 6, 9 });
+    assert_equal(aaa::subtract(1.0, vd{ 1, 2, 3 }), vd{ 0, -1, -2 });
+    assert_equal(aaa::multiply(vd{ 1, 2 }, vd{ 3, 4 }), vd{ 3, 8 });
+    assert_equal(aaa::axpy(2.0, vd{ 1, 2 }, vd{ 3, 4 }), vd{ 5, 8 });
+    assert_equal(aaa::axpby(2.0, in, 1.0, vd{ 1, 1, 1 }), vd{ 3, 5, 7 });
+    assert_equal(aaa::lerp(vd{ 1, 2 }, vd{ 3, 4 }, 0.5), vd{ 2, 3 });
+
+    // Lvalues are not modified.
+    auto lvalue = vd{ 1, 2, 3 };
+    assert_equal(aaa::add(lvalue, lvalue), vd{ 2, 4, 6 });
+    assert_equal(aaa::negate(lvalue), vd{ -1, -2, -3 });
+    assert_equal(lvalue, in);
+
+    // In place.
+    aaa::add_inplace(lvalue, in);
+    assert_equal(lvalue, vd{ 2, 4, 6 });
+    aaa::subtract_inplace(lvalue, 1.0);
+    assert_equal(lvalue, vd{ 1, 3, 5 });
+    aaa::multiply_inplace(lvalue, std::array<double, 3>{ 2, 2, 2 });
+    assert_equal(lvalue, vd{ 2, 6, 10 });
+    aaa::divide_inplace(lvalue, 2);
+    assert_equal(lvalue, vd{ 1, 3, 5 });
+    aaa::negate_inplace(lvalue);
+    assert_equal(lvalue, vd{ -1, -3, -5 });
+    auto ints = vi{ 1, 2, 3 };
+    aaa::add_inplace(ints, 1);
+    assert_equal(ints, vi{ 2, 3, 4 });
+}
+
+template<typename Policy>
+void test_execution_policy(Policy policy)
+{
+    // Several chunks, and a last chunk that is not full.
+    const auto n = 3 * aaa::execution::chunk_size + 5;
+    auto in1 = vi(n);
+    auto in2 = vi(n);
+    for (auto i = 0; i < n; ++i)
+    {
+        in1[i] = i % 13 - 6;
+        in2[i] = i % 7 + 1;
+    }
+    assert_equal(aaa::add(policy, in1, in2), aaa::add(in1, in2));
+    assert_equal(aaa::subtract(policy, 2, in2), aaa::subtract(2, in2));
+    assert_equal(aaa::multiply(policy, in1, 3), aaa::multiply(in1, 3));
+    assert_equal(aaa::divide(policy, in1, in2), aaa::divide(in1, in2));
+    assert_equal(aaa::negate(policy, in1), aaa::negate(in1));
+    auto out = vi(n);
+    aaa::add(policy, in1.data(), in1.data() + n, in2.data(), out.data());
+    assert_equal(out, aaa::add(in1, in2));
+
+    auto converted = std::vector<double>(n);
+    aaa::convert(policy, in1, converted);
+    assert_equal(aaa::sum(policy, converted), double(aaa::sum(in1)));
+    assert_equal(aaa::sum(policy, in1, 100), aaa::sum(in1, 100));
+    assert_equal(aaa::sum(policy, begin(in1), end(in1)), aaa::sum(in1));
+
+    assert_equal(aaa::euclidean::dot(policy, in1, in2), aaa::euclidean::dot(in1, in2));
+    assert_equal(aaa::euclidean::squared_norm(policy, in1), aaa::euclidean::squared_norm(in1));
+    assert_equal(aaa::euclidean::squared_distance(policy, in1, in2), aaa::euclidean::squared_distance(in1, in2));
+    assert_equal(aaa::euclidean::distance(policy, in1, in2, 0.0), aaa::euclidean::distance(in1, in2, 0.0));
+    assert_equal(aaa::manhattan::norm(policy, in1), aaa::manhattan::norm(in1));
+    assert_equal(aaa::manhattan::distance(policy, in1, in2), aaa::manhattan::distance(in1, in2));
+    assert_equal(aaa::maximum::norm(policy, in1), aaa::maximum::norm(in1));
+    assert_equal(aaa::maximum::distance(policy, in1, in2), aaa::maximum::distance(in1, in2));
+
+    // The first of several equal extrema is returned.
+    in1[n - 3] = -100;
+    in1[n - 2] = -100;
+    in1[2] = 100;
+    in1[n - 1] = 100;
+    assert(aaa::min_element(policy, in1) == begin(in1) + n - 3);
+    assert(aaa::max_element(policy, in1) == begin(in1) + 2);
+    const auto& const_in1 = in1;
+    assert(aaa::min_element(policy, const_in1) == aaa::min_element(const_in1));
+    assert(aaa::max_element(policy, begin(in1), begin(in1)) == begin(in1));
+
+    auto bits = std::vector<bool>(n);
+    for (auto i = 0; i < n; ++i)
+    {
+        bits[i] = i % 3 == 0;
+    }
+    assert_equal(aaa::logical_not(policy, bits), aaa::logical_not(bits));
+    assert_equal(aaa::logical_and(policy, bits, aaa::logical_not(bits)), std::vector<bool>(n, false));
+    assert_equal(aaa::logical_or(policy, bits, aaa::logical_not(bits)), std::vector<bool>(n, true));
+}
+
+void test_execution_policies()
+{
+    test_execution_policy(aaa::execution::seq);
+    test_execution_policy(aaa::execution::par);
+    test_execution_policy(aaa::execution::par_unseq);
+
+    // Exceptions are passed on to the caller.
+    auto caught = false;
+    try
+    {
+        aaa::execution::parallel_for(aaa::execution::par, 10 * aaa::execution::chunk_size,
+            [](std::ptrdiff_t, std::ptrdiff_t) { throw std::runtime_error("chunk"); });
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    assert(caught);
+
+    // The sequential policy gives the same result as no policy.
+    auto in = std::vector<float>(50000);
+    for (auto i = 0; i < 50000; ++i)
+    {
+        in[i] = 1.0f / (i + 1);
+    }
+    assert_equal(aaa::sum(aaa::execution::seq, in), aaa::sum(in));
+}
+
+void test_thread_pool()
+{
+    using namespace aaa::execution;
+
+    // Each index is called once, also for nested calls.
+    thread_pool pool(4);
+    assert_equal(pool.size(), std::size_t{4});
+    auto counts = std::vector<std::atomic<int>>(1000);
+    auto outer = [&](std::ptrdiff_t i)
+    {
+        auto inner = [&](std::ptrdiff_t j) { ++counts[10 * i + j]; };
+        pool.run(10, inner);
+    };
+    pool.run(100, outer);
+    for (const auto& count : counts)
+    {
+        assert_equal(count.load(), 1);
+    }
+
+    // Exceptions are passed on to the caller, and the pool can be reused after.
+    auto caught = false;
+    auto throwing = [](std::ptrdiff_t i) { if (i == 7) throw std::runtime_error("task"); };
+    try
+    {
+        pool.run(100, throwing);
+    }
+    catch (const std::runtime_error&)
+    {
+        caught = true;
+    }
+    assert(caught);
+    std::atomic<std::ptrdiff_t> total{0};
+    auto add_index = [&](std::ptrdiff_t i) { total += i; };
+    pool.run(100, add_index);
+    assert_equal(total.load(), std::ptrdiff_t{4950});
+
+    // The shared pool of the algorithms.
+    set_num_threads(3);
+    assert_equal(num_threads(), std::size_t{3});
+    test_execution_policy(par);
+    set_num_threads(1);
+    test_execution_policy(par);
+    set_num_threads(0);
+    assert_equal(num_threads(), default_num_threads());
+}
+
+template<typename T>
+void test_reproducible_type()
+{
+    using namespace aaa::execution;
+
+    // Values of different magnitudes, so that the order of the additions matters.
+    const auto n = 5 * chunk_size + 37;
+    auto a = std::vector<T>(n);
+    auto b = std::vector<T>(n);
+    for (auto i = std::ptrdiff_t{0}; i < n; ++i)
+    {
+        a[i] = T(1) / T(i % 1000 + 1) - T(i % 7);
+        b[i] = T(i % 13) * T(0.37) + T(1) / T(i % 11 + 1);
+    }
+    const auto s = aaa::sum(seq_reproducible, a);
+    const auto d = aaa::euclidean::dot(seq_reproducible, a, b);
+    const auto q = aaa::euclidean::squared_norm(seq_reproducible, a);
+    const auto e = aaa::euclidean::squared_distance(seq_reproducible, a, b);
+
+    for (auto threads : { 1, 3, 4 })
+    {
+        set_num_threads(static_cast<std::size_t>(threads));
+        assert_equal(aaa::sum(par_reproducible, a), s);
+        assert_equal(aaa::euclidean::dot(par_reproducible, a, b), d);
+        assert_equal(aaa::euclidean::squared_norm(par_reproducible, a), q);
+        assert_equal(aaa::euclidean::squared_distance(par_reproducible, a, b), e);
+    }
+    set_num_threads(0);
+
+    // A non contiguous container takes the generic loop, in the same order.
+    auto c = std::valarray<T>(a.data(), a.size());
+    assert_equal(aaa::sum(par_reproducible, c), s);
+    assert_equal(aaa::euclidean::squared_norm(seq_reproducible, c), q);
+    assert_equal(aaa::sum(seq_reproducible, c, T(2)), T(T(2) + s));
+
+    // The same order for all instruction sets, including the tails of the chunks.
+#if AAA_SIMD
+    using namespace aaa::simd;
+    using aaa::operations::multiplies;
+    const auto m = std::size_t{1000 + 13};
+    const auto expected = scalar::lane_sum<multiplies>(a.data(), b.data(), m);
+    assert_equal(sse42::lane_sum<multiplies>(a.data(), b.data(), m), expected);
+    if (detect_simd_level() >= simd_level::avx2)
+    {
+        assert_equal(avx2::lane_sum<multiplies>(a.data(), b.data(), m), expected);
+    }
+    if (detect_simd_level() >= simd_level::avx512)
+    {
+        assert_equal(avx512::lane_sum<multiplies>(a.data(), b.data(), m), expected);
+    }
+#endif
+
+    // Small and empty ranges.
+    const auto small = std::vector<T>{ T(1), T(2), T(3) };
+    assert_equal(aaa::sum(par_reproducible, small), T(6));
+    assert_equal(aaa::euclidean::norm(par_reproducible, std::vector<T>{ T(3), T(4) }), T(5));
+    assert_equal(aaa::euclidean::distance(seq_reproducible, small, small), T(0));
+    assert_equal(aaa::sum(seq_reproducible, std::vector<T>{}, T(7)), T(7));
+}
+
+void test_reproducible()
+{
+    test_reproducible_type<float>();
+    test_reproducible_type<double>();
+
+    // Integers give the exact result.
+    auto in = std::vector<int>(100000);
+    std::iota(in.begin(), in.end(), -50000);
+    assert_equal(aaa::sum(aaa::execution::par_reproducible, in), aaa::sum(in));
+    assert_equal(aaa::euclidean::squared_norm(aaa::execution::par_reproducible, in, 0LL),
+        aaa::euclidean::squared_norm(in, 0LL));
+}
+
 void test_euclidean_space_operations()
 {
 	std::vector<int>   c1 = { 1, 2};